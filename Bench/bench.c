@@ -0,0 +1,134 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "cmsis_os2.h"
+
+#if defined(BENCH_HOST)
+#include <time.h>
+#else
+#include CMSIS_device_header
+#endif
+
+
+// Kernel identification, included in every result row so runs on
+// different kernels can be compared side by side
+static char bench_kernel_id[32];
+
+
+/**
+    @brief  Prepare the cycle counter and emit the CSV header.
+
+    Must be called once, from a thread, before any suite is run.
+ */
+void BenchInit(void) {
+#if !defined(BENCH_HOST)
+    // Enable the DWT cycle counter, but leave it running: the profiler,
+    // boot profile and trace share it, and the suites only take deltas
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    memset(bench_kernel_id, 0, sizeof(bench_kernel_id));
+    osKernelGetInfo(NULL, bench_kernel_id, sizeof(bench_kernel_id) - 1);
+
+    printf("suite,test,kernel,samples,min,mean,max,unit\n");
+}
+
+
+/**
+    @brief  Read the free-running cycle counter.
+
+    On host ports this is the monotonic clock in nanoseconds, which
+    wraps every 4.3 seconds; only differences are meaningful.
+
+    @return The current count, in BENCH_UNIT.
+ */
+uint32_t BenchCycles(void) {
+#if defined(BENCH_HOST)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec);
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+
+/**
+    @brief  Number of cycle counter ticks per microsecond.
+
+    @return Cycles per microsecond at the current core clock
+            (1000 on host ports).
+ */
+uint32_t BenchCyclesPerMicrosecond(void) {
+#if defined(BENCH_HOST)
+    return 1000U;
+#else
+    return SystemCoreClock / 1000000U;
+#endif
+}
+
+
+/**
+    @brief  Clear a statistics record.
+
+    @param  stats   The record to clear.
+ */
+void BenchStatsReset(BenchStats *stats) {
+    stats->count = 0;
+    stats->min = UINT32_MAX;
+    stats->max = 0;
+    stats->total = 0;
+}
+
+
+/**
+    @brief  Accumulate one sample into a statistics record.
+
+    @param  stats   The record to update.
+    @param  sample  The measured value.
+ */
+void BenchStatsAdd(BenchStats *stats, uint32_t sample) {
+    stats->count++;
+    stats->total += sample;
+    if (sample < stats->min) stats->min = sample;
+    if (sample > stats->max) stats->max = sample;
+}
+
+
+/**
+    @brief  Accumulate how far one timer period strayed from nominal.
+
+    @param  stats       The record to update.
+    @param  period      The measured period.
+    @param  expected    The nominal period, in the same unit.
+ */
+void BenchStatsAddJitter(BenchStats *stats, uint32_t period, uint32_t expected) {
+    BenchStatsAdd(stats, period > expected ? period - expected : expected - period);
+}
+
+
+/**
+    @brief  Emit one CSV result row.
+
+    @param  suite   The suite name.
+    @param  test    The test name within the suite.
+    @param  unit    The unit of the samples, eg. "cycles".
+    @param  stats   The accumulated samples.
+ */
+void BenchReport(const char *suite, const char *test, const char *unit, const BenchStats *stats) {
+    uint32_t mean = stats->count ? (uint32_t)(stats->total / stats->count) : 0;
+    uint32_t min = stats->count ? stats->min : 0;
+
+    printf("%s,%s,%s,%lu,%lu,%lu,%lu,%s\n", suite, test, bench_kernel_id,
+           (unsigned long)stats->count, (unsigned long)min,
+           (unsigned long)mean, (unsigned long)stats->max, unit);
+}
@@ -0,0 +1,60 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host ports have no cycle counter: timestamps are nanoseconds there
+#if defined(BENCH_HOST)
+#define BENCH_UNIT              "ns"
+#else
+#define BENCH_UNIT              "cycles"
+#endif
+
+// Workloads shared by the kernel suites, so their rows compare one to one
+#define BENCH_SAMPLES           1000
+#define BENCH_MSG_SIZE          16
+#define BENCH_QUEUE_DEPTH       8
+#define BENCH_QUEUE_BURST       64
+#define BENCH_QUEUE_RUNS        100
+#define BENCH_POOL_BLOCKS       4
+#define BENCH_POOL_BLOCK_SIZE   64
+#define BENCH_TIMER_SAMPLES     200
+#define BENCH_STACK_SIZE        1024
+
+// Running statistics for one benchmark measurement
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} BenchStats;
+
+void     BenchInit(void);
+uint32_t BenchCycles(void);
+uint32_t BenchCyclesPerMicrosecond(void);
+void     BenchStatsReset(BenchStats *stats);
+void     BenchStatsAdd(BenchStats *stats, uint32_t sample);
+void     BenchStatsAddJitter(BenchStats *stats, uint32_t period, uint32_t expected);
+void     BenchReport(const char *suite, const char *test, const char *unit, const BenchStats *stats);
+
+// Individual suites
+void     BenchIsrWakeRun(void);
+void     BenchCmsisRun(void);
+void     BenchThreadXRun(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_H */
@@ -0,0 +1,455 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.h"
+#include "cmsis_os2.h"
+
+
+// Identical workloads for every kernel with a CMSIS-RTOS2 layer;
+// the kernel column of the report tells the runs apart. Sizes come
+// from bench.h and match the raw ThreadX suite.
+
+#define FLAG_PING               0x01U
+#define FLAG_PONG               0x02U
+
+// How the echo thread answers the driver
+enum {
+    ECHO_SEMAPHORE = 0,
+    ECHO_EVENT_FLAGS,
+    ECHO_THREAD_FLAGS,
+    ECHO_MESSAGE_QUEUE,
+    ECHO_MODE_COUNT
+};
+
+static const char *const echo_mode_names[ECHO_MODE_COUNT] = {
+    "semaphore_pingpong", "event_flags_pingpong", "thread_flags_pingpong", "message_queue_pingpong"
+};
+
+static osSemaphoreId_t    echo_sem_ping;
+static osSemaphoreId_t    echo_sem_pong;
+static osEventFlagsId_t   echo_flags;
+static osMessageQueueId_t echo_mq_ping;
+static osMessageQueueId_t echo_mq_pong;
+static osThreadId_t       echo_driver;
+static BenchStats         cmsis_stats;
+
+static volatile uint32_t  switch_stamp;
+static volatile uint32_t  switch_run;
+static osMessageQueueId_t stream_queue;
+static osSemaphoreId_t    stream_drained;
+static osEventFlagsId_t   wake_flags;
+static volatile uint32_t  wake_stamp;
+static uint32_t           timer_last;
+static uint32_t           timer_expected;
+
+
+/**
+    @brief  Partner thread: wait for a ping, answer with a pong.
+
+    @param  argument    The echo mode, one of ECHO_xxx.
+ */
+static void CmsisEcho(void *argument) {
+    uint32_t mode = (uint32_t)(uintptr_t)argument;
+    uint8_t msg[BENCH_MSG_SIZE];
+
+    for (;;) {
+        switch (mode) {
+            case ECHO_SEMAPHORE:
+                osSemaphoreAcquire(echo_sem_ping, osWaitForever);
+                osSemaphoreRelease(echo_sem_pong);
+                break;
+            case ECHO_EVENT_FLAGS:
+                osEventFlagsWait(echo_flags, FLAG_PING, osFlagsWaitAny, osWaitForever);
+                osEventFlagsSet(echo_flags, FLAG_PONG);
+                break;
+            case ECHO_THREAD_FLAGS:
+                osThreadFlagsWait(FLAG_PING, osFlagsWaitAny, osWaitForever);
+                osThreadFlagsSet(echo_driver, FLAG_PONG);
+                break;
+            default:
+                osMessageQueueGet(echo_mq_ping, msg, NULL, osWaitForever);
+                osMessageQueuePut(echo_mq_pong, msg, 0, osWaitForever);
+                break;
+        }
+    }
+}
+
+
+/**
+    @brief  Time BENCH_SAMPLES ping-pong round trips with a
+            higher priority echo thread.
+
+    Each round trip covers two signalling calls, two waits and two
+    context switches.
+
+    @param  mode    The echo mode, one of ECHO_xxx.
+ */
+static void CmsisPingPong(uint32_t mode) {
+    uint8_t msg[BENCH_MSG_SIZE];
+    memset(msg, 0xA5, sizeof(msg));
+
+    const osThreadAttr_t echo_attr = {
+        .name = "CmsisEcho",
+        .priority = osPriorityAboveNormal,
+        .stack_size = BENCH_STACK_SIZE
+    };
+    osThreadId_t echo = osThreadNew(CmsisEcho, (void *)(uintptr_t)mode, &echo_attr);
+
+    BenchStatsReset(&cmsis_stats);
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+
+        switch (mode) {
+            case ECHO_SEMAPHORE:
+                osSemaphoreRelease(echo_sem_ping);
+                osSemaphoreAcquire(echo_sem_pong, osWaitForever);
+                break;
+            case ECHO_EVENT_FLAGS:
+                osEventFlagsSet(echo_flags, FLAG_PING);
+                osEventFlagsWait(echo_flags, FLAG_PONG, osFlagsWaitAny, osWaitForever);
+                break;
+            case ECHO_THREAD_FLAGS:
+                osThreadFlagsSet(echo, FLAG_PING);
+                osThreadFlagsWait(FLAG_PONG, osFlagsWaitAny, osWaitForever);
+                break;
+            default:
+                osMessageQueuePut(echo_mq_ping, msg, 0, osWaitForever);
+                osMessageQueueGet(echo_mq_pong, msg, NULL, osWaitForever);
+                break;
+        }
+
+        BenchStatsAdd(&cmsis_stats, BenchCycles() - start);
+    }
+
+    BenchReport("cmsis", echo_mode_names[mode], BENCH_UNIT, &cmsis_stats);
+
+    // Echo is blocked waiting for the next ping
+    osThreadTerminate(echo);
+}
+
+
+/**
+    @brief  Uncontended operations that never switch threads.
+ */
+static void CmsisUncontended(void) {
+    uint8_t msg[BENCH_MSG_SIZE];
+    memset(msg, 0x5A, sizeof(msg));
+
+    osMutexId_t mutex = osMutexNew(NULL);
+    BenchStatsReset(&cmsis_stats);
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+        osMutexAcquire(mutex, osWaitForever);
+        osMutexRelease(mutex);
+        BenchStatsAdd(&cmsis_stats, BenchCycles() - start);
+    }
+    BenchReport("cmsis", "mutex_acquire_release", BENCH_UNIT, &cmsis_stats);
+    osMutexDelete(mutex);
+
+    osSemaphoreId_t sem = osSemaphoreNew(1, 1, NULL);
+    BenchStatsReset(&cmsis_stats);
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+        osSemaphoreAcquire(sem, 0);
+        osSemaphoreRelease(sem);
+        BenchStatsAdd(&cmsis_stats, BenchCycles() - start);
+    }
+    BenchReport("cmsis", "semaphore_acquire_release", BENCH_UNIT, &cmsis_stats);
+    osSemaphoreDelete(sem);
+
+    osMemoryPoolId_t pool = osMemoryPoolNew(BENCH_POOL_BLOCKS, BENCH_POOL_BLOCK_SIZE, NULL);
+    BenchStatsReset(&cmsis_stats);
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+        void *block = osMemoryPoolAlloc(pool, 0);
+        osMemoryPoolFree(pool, block);
+        BenchStatsAdd(&cmsis_stats, BenchCycles() - start);
+    }
+    BenchReport("cmsis", "memory_pool_alloc_free", BENCH_UNIT, &cmsis_stats);
+    osMemoryPoolDelete(pool);
+
+    osMessageQueueId_t queue = osMessageQueueNew(4, BENCH_MSG_SIZE, NULL);
+    BenchStatsReset(&cmsis_stats);
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+        osMessageQueuePut(queue, msg, 0, 0);
+        osMessageQueueGet(queue, msg, NULL, 0);
+        BenchStatsAdd(&cmsis_stats, BenchCycles() - start);
+    }
+    BenchReport("cmsis", "message_queue_put_get", BENCH_UNIT, &cmsis_stats);
+    osMessageQueueDelete(queue);
+
+    osEventFlagsId_t flags = osEventFlagsNew(NULL);
+    BenchStatsReset(&cmsis_stats);
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+        osEventFlagsSet(flags, FLAG_PING);
+        osEventFlagsWait(flags, FLAG_PING, osFlagsWaitAny, 0);
+        BenchStatsAdd(&cmsis_stats, BenchCycles() - start);
+    }
+    BenchReport("cmsis", "event_flags_set_wait", BENCH_UNIT, &cmsis_stats);
+    osEventFlagsDelete(flags);
+}
+
+
+/**
+    @brief  Equal priority partner: stamp the cycle counter and yield.
+ */
+static void CmsisYielder(void *argument) {
+    (void)argument;
+
+    while (switch_run) {
+        switch_stamp = BenchCycles();
+        osThreadYield();
+    }
+
+    osThreadExit();
+}
+
+
+/**
+    @brief  Time one yield-driven switch from a partner thread back to
+            the driver, at equal priority.
+ */
+static void CmsisContextSwitch(void) {
+    const osThreadAttr_t attr = {
+        .name = "CmsisYield",
+        .priority = osPriorityNormal,
+        .stack_size = BENCH_STACK_SIZE
+    };
+
+    switch_run = 1;
+    osThreadNew(CmsisYielder, NULL, &attr);
+
+    BenchStatsReset(&cmsis_stats);
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        osThreadYield();
+        BenchStatsAdd(&cmsis_stats, BenchCycles() - switch_stamp);
+    }
+
+    BenchReport("cmsis", "context_switch", BENCH_UNIT, &cmsis_stats);
+
+    // One more yield lets the partner see the flag and exit
+    switch_run = 0;
+    osThreadYield();
+}
+
+
+/**
+    @brief  Equal priority consumer: drain the stream queue, signalling
+            the driver at the end of each burst.
+ */
+static void CmsisConsumer(void *argument) {
+    (void)argument;
+    uint8_t msg[BENCH_MSG_SIZE];
+    uint32_t received = 0;
+
+    for (;;) {
+        osMessageQueueGet(stream_queue, msg, NULL, osWaitForever);
+        if (++received == BENCH_QUEUE_BURST) {
+            received = 0;
+            osSemaphoreRelease(stream_drained);
+        }
+    }
+}
+
+
+/**
+    @brief  Push bursts of messages through a BENCH_QUEUE_DEPTH queue to
+            a consumer, and report the cost per message.
+ */
+static void CmsisQueueThroughput(void) {
+    uint8_t msg[BENCH_MSG_SIZE];
+    memset(msg, 0x3C, sizeof(msg));
+
+    const osThreadAttr_t attr = {
+        .name = "CmsisConsumer",
+        .priority = osPriorityNormal,
+        .stack_size = BENCH_STACK_SIZE
+    };
+
+    stream_queue = osMessageQueueNew(BENCH_QUEUE_DEPTH, BENCH_MSG_SIZE, NULL);
+    stream_drained = osSemaphoreNew(1, 0, NULL);
+    osThreadId_t consumer = osThreadNew(CmsisConsumer, NULL, &attr);
+
+    BenchStatsReset(&cmsis_stats);
+
+    for (uint32_t run = 0; run < BENCH_QUEUE_RUNS; run++) {
+        uint32_t start = BenchCycles();
+        for (uint32_t i = 0; i < BENCH_QUEUE_BURST; i++) {
+            osMessageQueuePut(stream_queue, msg, 0, osWaitForever);
+        }
+        osSemaphoreAcquire(stream_drained, osWaitForever);
+        BenchStatsAdd(&cmsis_stats, (BenchCycles() - start) / BENCH_QUEUE_BURST);
+    }
+
+    BenchReport("cmsis", "queue_throughput", BENCH_UNIT "/msg", &cmsis_stats);
+
+    osThreadTerminate(consumer);
+    osSemaphoreDelete(stream_drained);
+    osMessageQueueDelete(stream_queue);
+}
+
+
+/**
+    @brief  Higher priority waiter: record how long after the set call
+            started it got to run.
+ */
+static void CmsisWakeWaiter(void *argument) {
+    (void)argument;
+
+    for (;;) {
+        osEventFlagsWait(wake_flags, FLAG_PING, osFlagsWaitAny, osWaitForever);
+        BenchStatsAdd(&cmsis_stats, BenchCycles() - wake_stamp);
+    }
+}
+
+
+/**
+    @brief  One-way event flags wake latency, thread to thread.
+ */
+static void CmsisEventFlagsWake(void) {
+    const osThreadAttr_t attr = {
+        .name = "CmsisWaiter",
+        .priority = osPriorityAboveNormal,
+        .stack_size = BENCH_STACK_SIZE
+    };
+
+    wake_flags = osEventFlagsNew(NULL);
+    BenchStatsReset(&cmsis_stats);
+
+    // Waiter runs at once and blocks on the flags
+    osThreadId_t waiter = osThreadNew(CmsisWakeWaiter, NULL, &attr);
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        wake_stamp = BenchCycles();
+        osEventFlagsSet(wake_flags, FLAG_PING);
+    }
+
+    BenchReport("cmsis", "event_flags_wake", BENCH_UNIT, &cmsis_stats);
+
+    osThreadTerminate(waiter);
+    osEventFlagsDelete(wake_flags);
+}
+
+
+/**
+    @brief  Periodic timer callback: accumulate each period's deviation
+            from one tick.
+ */
+static void CmsisTimerTick(void *argument) {
+    (void)argument;
+    uint32_t now = BenchCycles();
+
+    if (timer_last != 0 && cmsis_stats.count < BENCH_TIMER_SAMPLES) {
+        BenchStatsAddJitter(&cmsis_stats, now - timer_last, timer_expected);
+    }
+
+    timer_last = now;
+}
+
+
+/**
+    @brief  Jitter of a one-tick periodic timer.
+ */
+static void CmsisTimerJitter(void) {
+    timer_expected = BenchCyclesPerMicrosecond() * (1000000U / osKernelGetTickFreq());
+    timer_last = 0;
+    BenchStatsReset(&cmsis_stats);
+
+    osTimerId_t timer = osTimerNew(CmsisTimerTick, osTimerPeriodic, NULL, NULL);
+    osTimerStart(timer, 1);
+    osDelay(BENCH_TIMER_SAMPLES + 2);
+    osTimerStop(timer);
+
+    BenchReport("cmsis", "timer_jitter", BENCH_UNIT, &cmsis_stats);
+    osTimerDelete(timer);
+}
+
+
+/**
+    @brief  Short-lived thread used by the create/exit measurement.
+ */
+static void CmsisShortLived(void *argument) {
+    (void)argument;
+
+    // Returning from a thread function is not allowed on FreeRTOS
+    osThreadExit();
+}
+
+
+/**
+    @brief  Time creating a higher priority thread that exits at once.
+ */
+static void CmsisThreadLifecycle(void) {
+    const osThreadAttr_t attr = {
+        .name = "CmsisShort",
+        .priority = osPriorityAboveNormal,
+        .stack_size = BENCH_STACK_SIZE
+    };
+
+    BenchStatsReset(&cmsis_stats);
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+        osThreadNew(CmsisShortLived, NULL, &attr);
+        BenchStatsAdd(&cmsis_stats, BenchCycles() - start);
+
+        // Give the FreeRTOS idle task a chance to free the exited thread
+        osDelay(1);
+    }
+
+    BenchReport("cmsis", "thread_create_exit", BENCH_UNIT, &cmsis_stats);
+}
+
+
+/**
+    @brief  Shared CMSIS-RTOS2 workload suite.
+
+    Runs the same primitives on whichever kernel provides the CMSIS
+    layer, so results from the FreeRTOS and ThreadX builds can be
+    compared workload by workload. Must run in a thread created with
+    osThreadNew, as the thread flags test waits on the calling thread.
+ */
+void BenchCmsisRun(void) {
+    echo_driver = osThreadGetId();
+    osPriority_t saved_priority = osThreadGetPriority(echo_driver);
+
+    // Driver sits below the echo thread so every signal switches to it
+    osThreadSetPriority(echo_driver, osPriorityNormal);
+
+    echo_sem_ping = osSemaphoreNew(1, 0, NULL);
+    echo_sem_pong = osSemaphoreNew(1, 0, NULL);
+    echo_flags = osEventFlagsNew(NULL);
+    echo_mq_ping = osMessageQueueNew(1, BENCH_MSG_SIZE, NULL);
+    echo_mq_pong = osMessageQueueNew(1, BENCH_MSG_SIZE, NULL);
+
+    CmsisUncontended();
+    CmsisContextSwitch();
+
+    for (uint32_t mode = 0; mode < ECHO_MODE_COUNT; mode++) {
+        CmsisPingPong(mode);
+    }
+
+    CmsisQueueThroughput();
+    CmsisEventFlagsWake();
+    CmsisTimerJitter();
+    CmsisThreadLifecycle();
+
+    osMessageQueueDelete(echo_mq_pong);
+    osMessageQueueDelete(echo_mq_ping);
+    osEventFlagsDelete(echo_flags);
+    osSemaphoreDelete(echo_sem_pong);
+    osSemaphoreDelete(echo_sem_ping);
+
+    osThreadSetPriority(echo_driver, saved_priority);
+}
@@ -0,0 +1,220 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdint.h>
+
+#include "bench.h"
+#include "cmsis_os2.h"
+#include "cmsis_os2_ext.h"
+#include CMSIS_device_header
+
+
+// Software-triggered interrupt used to raise the wake-up events.
+// Any vector not claimed by the application will do.
+#ifndef BENCH_SWI_IRQn
+#define BENCH_SWI_IRQn          TIM17_IRQn
+#define BENCH_SWI_IRQHandler    TIM17_IRQHandler
+#endif
+
+// Must be no more urgent than the kernel's max syscall priority
+#ifndef BENCH_SWI_PRIORITY
+#define BENCH_SWI_PRIORITY      6
+#endif
+
+#define ISR_WAKE_SAMPLES        500
+#define ISR_WAKE_TIMEOUT_TICKS  100
+
+// How long the background load spins before it yields for a tick
+#define ISR_WAKE_LOAD_SPIN_MS   5
+
+// The ISR-to-thread signalling paths under test
+enum {
+    WAKE_EVENT_FLAGS = 0,
+    WAKE_THREAD_FLAGS,
+    WAKE_FAST_FLAGS,
+    WAKE_PATH_COUNT
+};
+
+static const char *const wake_path_names[WAKE_PATH_COUNT] = {
+    "event_flags", "thread_flags", "fast_flags"
+};
+
+static volatile uint32_t wake_path;
+static volatile uint32_t wake_isr_stamp;
+static volatile uint32_t wake_load_run;
+
+static osEventFlagsId_t wake_event_flags;
+static osFastFlagsId_t  wake_fast_flags;
+static osSemaphoreId_t  wake_go;
+static osSemaphoreId_t  wake_done;
+static osThreadId_t     wake_waiter;
+static BenchStats       wake_stats;
+
+
+/**
+    @brief  Raise the event for the path under test.
+
+    Stamps the cycle counter first so the measured latency covers
+    the signalling call itself plus the switch into the waiter.
+ */
+void BENCH_SWI_IRQHandler(void) {
+    wake_isr_stamp = BenchCycles();
+
+    switch (wake_path) {
+        case WAKE_EVENT_FLAGS:
+            osEventFlagsSet(wake_event_flags, 1U);
+            break;
+        case WAKE_THREAD_FLAGS:
+            osThreadFlagsSet(wake_waiter, 1U);
+            break;
+        default:
+            osFastFlagsSet(wake_fast_flags, 1U);
+            break;
+    }
+}
+
+
+/**
+    @brief  Highest priority thread: block on the current path and
+            record how long after the ISR it got to run.
+ */
+static void WakeWaiter(void *argument) {
+    (void)argument;
+
+    for (;;) {
+        uint32_t flags;
+
+        // The driver hands over each sample, so the path can change between samples
+        osSemaphoreAcquire(wake_go, osWaitForever);
+
+        switch (wake_path) {
+            case WAKE_EVENT_FLAGS:
+                flags = osEventFlagsWait(wake_event_flags, 1U, osFlagsWaitAny, osWaitForever);
+                break;
+            case WAKE_THREAD_FLAGS:
+                flags = osThreadFlagsWait(1U, osFlagsWaitAny, osWaitForever);
+                break;
+            default:
+                flags = osFastFlagsWait(wake_fast_flags, 1U, osFlagsWaitAny, osWaitForever);
+                break;
+        }
+
+        uint32_t now = BenchCycles();
+        if ((flags & osFlagsError) == 0) {
+            BenchStatsAdd(&wake_stats, now - wake_isr_stamp);
+        }
+
+        osSemaphoreRelease(wake_done);
+    }
+}
+
+
+/**
+    @brief  Background load: keeps the CPU busy above the priority of
+            the kernel's timer service task, yielding once per burst.
+ */
+static void WakeLoad(void *argument) {
+    (void)argument;
+
+    while (wake_load_run) {
+        uint32_t start = osKernelGetTickCount();
+        uint32_t spin = (ISR_WAKE_LOAD_SPIN_MS * osKernelGetTickFreq()) / 1000U;
+
+        while ((osKernelGetTickCount() - start) < spin) {
+            __NOP();
+        }
+
+        osDelay(1);
+    }
+
+    osThreadExit();
+}
+
+
+/**
+    @brief  Measure one path ISR_WAKE_SAMPLES times and report it.
+
+    @param  path    The signalling path to exercise.
+    @param  suite   The suite name to report under.
+ */
+static void WakeMeasure(uint32_t path, const char *suite) {
+    BenchStatsReset(&wake_stats);
+    wake_path = path;
+
+    for (uint32_t i = 0; i < ISR_WAKE_SAMPLES; i++) {
+        // Let the waiter block on the path, then fire the interrupt
+        osSemaphoreRelease(wake_go);
+        NVIC_SetPendingIRQ(BENCH_SWI_IRQn);
+
+        if (osSemaphoreAcquire(wake_done, ISR_WAKE_TIMEOUT_TICKS) != osOK) {
+            break;
+        }
+    }
+
+    BenchReport(suite, wake_path_names[path], "cycles", &wake_stats);
+}
+
+
+/**
+    @brief  ISR-to-thread wake latency suite.
+
+    Compares the event flags path (deferred to the timer service task
+    when set from an ISR on FreeRTOS) with thread flags and fast flags,
+    first on an idle system and then with a busy background thread.
+ */
+void BenchIsrWakeRun(void) {
+    osThreadId_t self = osThreadGetId();
+    osPriority_t saved_priority = osThreadGetPriority(self);
+
+    // Driver sits between the waiter and the background load
+    osThreadSetPriority(self, osPriorityHigh);
+
+    wake_event_flags = osEventFlagsNew(NULL);
+    wake_go = osSemaphoreNew(1, 0, NULL);
+    wake_done = osSemaphoreNew(1, 0, NULL);
+
+    const osThreadAttr_t waiter_attr = {
+        .name = "WakeWaiter",
+        .priority = osPriorityRealtime,
+        .stack_size = 1024
+    };
+    wake_waiter = osThreadNew(WakeWaiter, NULL, &waiter_attr);
+    wake_fast_flags = osFastFlagsNew(wake_waiter, NULL);
+
+    NVIC_SetPriority(BENCH_SWI_IRQn, BENCH_SWI_PRIORITY);
+    NVIC_ClearPendingIRQ(BENCH_SWI_IRQn);
+    NVIC_EnableIRQ(BENCH_SWI_IRQn);
+
+    for (uint32_t path = 0; path < WAKE_PATH_COUNT; path++) {
+        WakeMeasure(path, "isr_wake");
+    }
+
+    const osThreadAttr_t load_attr = {
+        .name = "WakeLoad",
+        .priority = osPriorityNormal,
+        .stack_size = 512
+    };
+    wake_load_run = 1;
+    osThreadNew(WakeLoad, NULL, &load_attr);
+
+    for (uint32_t path = 0; path < WAKE_PATH_COUNT; path++) {
+        WakeMeasure(path, "isr_wake_load");
+    }
+
+    // Load thread exits on its own once it sees the flag
+    wake_load_run = 0;
+    osDelay(ISR_WAKE_LOAD_SPIN_MS + 1);
+
+    NVIC_DisableIRQ(BENCH_SWI_IRQn);
+    osThreadTerminate(wake_waiter);
+    osFastFlagsDelete(wake_fast_flags);
+    osSemaphoreDelete(wake_done);
+    osSemaphoreDelete(wake_go);
+    osEventFlagsDelete(wake_event_flags);
+
+    osThreadSetPriority(self, saved_priority);
+}
@@ -0,0 +1,327 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.h"
+#include "tx_api.h"
+
+
+// The same workloads as bench_cmsis.c, on the raw ThreadX API, so the
+// cost of the CMSIS layer shows up as the difference between the
+// 'threadx' and 'cmsis' rows for each test
+#define TX_BENCH_PRIORITY       16
+#define TX_BENCH_PRIORITY_HIGH  15
+
+#define FLAG_PING               0x01U
+#define FLAG_PONG               0x02U
+
+#define TX_MSG_WORDS            (BENCH_MSG_SIZE / sizeof(ULONG))
+
+static TX_THREAD            partner_thread;
+static ULONG                partner_stack[BENCH_STACK_SIZE / sizeof(ULONG)];
+static TX_SEMAPHORE         sem_ping;
+static TX_SEMAPHORE         sem_pong;
+static TX_SEMAPHORE         stream_drained;
+static TX_EVENT_FLAGS_GROUP flags;
+static TX_QUEUE             stream_queue;
+static ULONG                stream_memory[BENCH_QUEUE_DEPTH * TX_MSG_WORDS];
+static TX_BLOCK_POOL        block_pool;
+static UCHAR                block_memory[BENCH_POOL_BLOCKS * (BENCH_POOL_BLOCK_SIZE + sizeof(VOID *))];
+static TX_TIMER             timer;
+static BenchStats           tx_stats;
+
+static volatile uint32_t    switch_stamp;
+static volatile uint32_t    wake_stamp;
+static uint32_t             timer_last;
+static uint32_t             timer_expected;
+
+#ifndef TX_TIMER_TICKS_PER_SECOND
+#define TX_TIMER_TICKS_PER_SECOND   ((ULONG)100)
+#endif
+
+
+/**
+    @brief  Start the partner thread for one test.
+
+    @param  entry       The partner's entry function.
+    @param  priority    Its priority.
+ */
+static void TxPartnerStart(VOID (*entry)(ULONG), UINT priority) {
+    tx_thread_create(&partner_thread, "TxPartner", entry, 0,
+                     partner_stack, sizeof(partner_stack),
+                     priority, priority, TX_NO_TIME_SLICE, TX_AUTO_START);
+}
+
+
+/**
+    @brief  Stop and delete the partner thread.
+ */
+static void TxPartnerStop(void) {
+    tx_thread_terminate(&partner_thread);
+    tx_thread_delete(&partner_thread);
+}
+
+
+/**
+    @brief  Equal priority partner: stamp the cycle counter and relinquish.
+ */
+static VOID TxYielder(ULONG input) {
+    (void)input;
+
+    for (;;) {
+        switch_stamp = BenchCycles();
+        tx_thread_relinquish();
+    }
+}
+
+
+/**
+    @brief  Time one relinquish-driven switch from a partner thread back
+            to the driver, at equal priority.
+ */
+static void TxContextSwitch(void) {
+    TxPartnerStart(TxYielder, TX_BENCH_PRIORITY);
+    BenchStatsReset(&tx_stats);
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        tx_thread_relinquish();
+        BenchStatsAdd(&tx_stats, BenchCycles() - switch_stamp);
+    }
+
+    BenchReport("threadx", "context_switch", BENCH_UNIT, &tx_stats);
+    TxPartnerStop();
+}
+
+
+/**
+    @brief  Higher priority echo: wait for a ping, answer with a pong.
+ */
+static VOID TxSemaphoreEcho(ULONG input) {
+    (void)input;
+
+    for (;;) {
+        tx_semaphore_get(&sem_ping, TX_WAIT_FOREVER);
+        tx_semaphore_put(&sem_pong);
+    }
+}
+
+
+static VOID TxEventFlagsEcho(ULONG input) {
+    (void)input;
+    ULONG actual;
+
+    for (;;) {
+        tx_event_flags_get(&flags, FLAG_PING, TX_OR_CLEAR, &actual, TX_WAIT_FOREVER);
+        tx_event_flags_set(&flags, FLAG_PONG, TX_OR);
+    }
+}
+
+
+/**
+    @brief  Semaphore and event flags ping-pong round trips.
+ */
+static void TxPingPong(void) {
+    ULONG actual;
+
+    tx_semaphore_create(&sem_ping, "TxPing", 0);
+    tx_semaphore_create(&sem_pong, "TxPong", 0);
+    TxPartnerStart(TxSemaphoreEcho, TX_BENCH_PRIORITY_HIGH);
+    BenchStatsReset(&tx_stats);
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+        tx_semaphore_put(&sem_ping);
+        tx_semaphore_get(&sem_pong, TX_WAIT_FOREVER);
+        BenchStatsAdd(&tx_stats, BenchCycles() - start);
+    }
+
+    BenchReport("threadx", "semaphore_pingpong", BENCH_UNIT, &tx_stats);
+    TxPartnerStop();
+    tx_semaphore_delete(&sem_pong);
+    tx_semaphore_delete(&sem_ping);
+
+    tx_event_flags_create(&flags, "TxFlags");
+    TxPartnerStart(TxEventFlagsEcho, TX_BENCH_PRIORITY_HIGH);
+    BenchStatsReset(&tx_stats);
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+        tx_event_flags_set(&flags, FLAG_PING, TX_OR);
+        tx_event_flags_get(&flags, FLAG_PONG, TX_OR_CLEAR, &actual, TX_WAIT_FOREVER);
+        BenchStatsAdd(&tx_stats, BenchCycles() - start);
+    }
+
+    BenchReport("threadx", "event_flags_pingpong", BENCH_UNIT, &tx_stats);
+    TxPartnerStop();
+    tx_event_flags_delete(&flags);
+}
+
+
+/**
+    @brief  Equal priority consumer: drain the stream queue, signalling
+            the driver at the end of each burst.
+ */
+static VOID TxConsumer(ULONG input) {
+    (void)input;
+    ULONG msg[TX_MSG_WORDS];
+    uint32_t received = 0;
+
+    for (;;) {
+        tx_queue_receive(&stream_queue, msg, TX_WAIT_FOREVER);
+        if (++received == BENCH_QUEUE_BURST) {
+            received = 0;
+            tx_semaphore_put(&stream_drained);
+        }
+    }
+}
+
+
+/**
+    @brief  Push bursts of messages through a BENCH_QUEUE_DEPTH queue to
+            a consumer, and report the cost per message.
+ */
+static void TxQueueThroughput(void) {
+    ULONG msg[TX_MSG_WORDS];
+    memset(msg, 0x3C, sizeof(msg));
+
+    tx_queue_create(&stream_queue, "TxStream", TX_MSG_WORDS, stream_memory, sizeof(stream_memory));
+    tx_semaphore_create(&stream_drained, "TxDrained", 0);
+    TxPartnerStart(TxConsumer, TX_BENCH_PRIORITY);
+    BenchStatsReset(&tx_stats);
+
+    for (uint32_t run = 0; run < BENCH_QUEUE_RUNS; run++) {
+        uint32_t start = BenchCycles();
+        for (uint32_t i = 0; i < BENCH_QUEUE_BURST; i++) {
+            tx_queue_send(&stream_queue, msg, TX_WAIT_FOREVER);
+        }
+        tx_semaphore_get(&stream_drained, TX_WAIT_FOREVER);
+        BenchStatsAdd(&tx_stats, (BenchCycles() - start) / BENCH_QUEUE_BURST);
+    }
+
+    BenchReport("threadx", "queue_throughput", BENCH_UNIT "/msg", &tx_stats);
+    TxPartnerStop();
+    tx_semaphore_delete(&stream_drained);
+    tx_queue_delete(&stream_queue);
+}
+
+
+/**
+    @brief  Higher priority waiter: record how long after the set call
+            started it got to run.
+ */
+static VOID TxWakeWaiter(ULONG input) {
+    (void)input;
+    ULONG actual;
+
+    for (;;) {
+        tx_event_flags_get(&flags, FLAG_PING, TX_OR_CLEAR, &actual, TX_WAIT_FOREVER);
+        BenchStatsAdd(&tx_stats, BenchCycles() - wake_stamp);
+    }
+}
+
+
+/**
+    @brief  One-way event flags wake latency, thread to thread.
+ */
+static void TxEventFlagsWake(void) {
+    tx_event_flags_create(&flags, "TxWake");
+    BenchStatsReset(&tx_stats);
+
+    // Waiter runs at once and blocks on the flags
+    TxPartnerStart(TxWakeWaiter, TX_BENCH_PRIORITY_HIGH);
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        wake_stamp = BenchCycles();
+        tx_event_flags_set(&flags, FLAG_PING, TX_OR);
+    }
+
+    BenchReport("threadx", "event_flags_wake", BENCH_UNIT, &tx_stats);
+    TxPartnerStop();
+    tx_event_flags_delete(&flags);
+}
+
+
+/**
+    @brief  Uncontended block pool allocate and release.
+ */
+static void TxBlockPool(void) {
+    VOID *block;
+
+    tx_block_pool_create(&block_pool, "TxPool", BENCH_POOL_BLOCK_SIZE, block_memory, sizeof(block_memory));
+    BenchStatsReset(&tx_stats);
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint32_t start = BenchCycles();
+        tx_block_allocate(&block_pool, &block, TX_NO_WAIT);
+        tx_block_release(block);
+        BenchStatsAdd(&tx_stats, BenchCycles() - start);
+    }
+
+    BenchReport("threadx", "memory_pool_alloc_free", BENCH_UNIT, &tx_stats);
+    tx_block_pool_delete(&block_pool);
+}
+
+
+/**
+    @brief  Periodic timer expiry: accumulate each period's deviation
+            from one tick.
+ */
+static VOID TxTimerTick(ULONG input) {
+    (void)input;
+    uint32_t now = BenchCycles();
+
+    if (timer_last != 0 && tx_stats.count < BENCH_TIMER_SAMPLES) {
+        BenchStatsAddJitter(&tx_stats, now - timer_last, timer_expected);
+    }
+
+    timer_last = now;
+}
+
+
+/**
+    @brief  Jitter of a one-tick periodic timer.
+ */
+static void TxTimerJitter(void) {
+    timer_expected = BenchCyclesPerMicrosecond() * (1000000U / TX_TIMER_TICKS_PER_SECOND);
+    timer_last = 0;
+    BenchStatsReset(&tx_stats);
+
+    tx_timer_create(&timer, "TxTimer", TxTimerTick, 0, 1, 1, TX_AUTO_ACTIVATE);
+    tx_thread_sleep(BENCH_TIMER_SAMPLES + 2);
+    tx_timer_deactivate(&timer);
+
+    BenchReport("threadx", "timer_jitter", BENCH_UNIT, &tx_stats);
+    tx_timer_delete(&timer);
+}
+
+
+/**
+    @brief  Raw ThreadX workload suite.
+
+    Runs the bench_cmsis.c workloads that have a direct ThreadX
+    equivalent, under the same test names. Call from any thread after
+    BenchInit(); the caller's priority is restored on return.
+ */
+void BenchThreadXRun(void) {
+    TX_THREAD *self = tx_thread_identify();
+    UINT saved_priority;
+
+    // Driver sits below the echo threads, level with the yielder and consumer
+    tx_thread_priority_change(self, TX_BENCH_PRIORITY, &saved_priority);
+
+    TxContextSwitch();
+    TxPingPong();
+    TxQueueThroughput();
+    TxEventFlagsWake();
+    TxBlockPool();
+    TxTimerJitter();
+
+    UINT old_priority;
+    tx_thread_priority_change(self, saved_priority, &old_priority);
+}
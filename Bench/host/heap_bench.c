@@ -0,0 +1,237 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Host-side heap benchmark: replays one randomised allocation trace against
+ * the TLSF allocator and, when the FreeRTOS-Kernel submodule is present,
+ * against heap_4, timing every call. The worst case is what matters for
+ * real-time code, so look at the max column; run on an idle machine, pinned
+ * to one core (eg. taskset -c 2), as host preemption shows up there too.
+ *
+ * Usage: heap_bench [operations] [seed]
+ *
+ * Output uses the same CSV layout as the on-device suites, with the
+ * allocator in the kernel column.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tlsf.h"
+
+#if defined(HEAP_BENCH_HEAP_4)
+#include "FreeRTOS.h"
+#endif
+
+#define BENCH_SLOTS             512
+#define BENCH_DEFAULT_OPS       1000000UL
+#define BENCH_DEFAULT_SEED      0x5EEDU
+
+// Running statistics, as BenchStats on the device
+typedef struct {
+    uint32_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t total;
+} HostStats;
+
+// One allocator under test
+typedef struct {
+    const char *name;
+    void *(*alloc)(size_t size);
+    void  (*release)(void *ptr);
+    void  (*fragmentation)(uint32_t *percent, size_t *largest);
+} HostHeap;
+
+static uint8_t tlsf_memory[HEAP_BENCH_SIZE] __attribute__((aligned(TLSF_ALIGN_SIZE)));
+static Tlsf *tlsf;
+static uint32_t rng_state;
+
+
+static uint32_t Random(void) {
+    // xorshift32: fast, and the same trace on every host
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+
+/**
+    @brief  Pick a request size: mostly small, with a tail of large blocks
+            to fragment the heap.
+ */
+static size_t RandomSize(void) {
+    uint32_t pick = Random() % 100;
+    if (pick < 75) return 8 + Random() % 121;
+    if (pick < 95) return 128 + Random() % 897;
+    return 1024 + Random() % 3073;
+}
+
+
+static uint64_t Nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+
+static void StatsReset(HostStats *stats) {
+    stats->count = 0;
+    stats->min = UINT64_MAX;
+    stats->max = 0;
+    stats->total = 0;
+}
+
+
+static void StatsAdd(HostStats *stats, uint64_t sample) {
+    stats->count++;
+    stats->total += sample;
+    if (sample < stats->min) stats->min = sample;
+    if (sample > stats->max) stats->max = sample;
+}
+
+
+static void Report(const char *test, const char *heap, const char *unit, const HostStats *stats) {
+    uint64_t mean = stats->count ? stats->total / stats->count : 0;
+    uint64_t min = stats->count ? stats->min : 0;
+
+    printf("heap,%s,%s,%lu,%llu,%llu,%llu,%s\n", test, heap, (unsigned long)stats->count,
+           (unsigned long long)min, (unsigned long long)mean, (unsigned long long)stats->max, unit);
+}
+
+
+static void *TlsfAlloc(size_t size) {
+    return TlsfMalloc(tlsf, size);
+}
+
+
+static void TlsfRelease(void *ptr) {
+    TlsfFree(tlsf, ptr);
+}
+
+
+static void TlsfFragmentation(uint32_t *percent, size_t *largest) {
+    TlsfStats stats;
+    TlsfGetStats(tlsf, &stats);
+    *percent = stats.fragmentation;
+    *largest = stats.largest_free_block;
+}
+
+
+#if defined(HEAP_BENCH_HEAP_4)
+static void Heap4Fragmentation(uint32_t *percent, size_t *largest) {
+    HeapStats_t stats;
+    vPortGetHeapStats(&stats);
+    *largest = stats.xSizeOfLargestFreeBlockInBytes;
+    *percent = stats.xAvailableHeapSpaceInBytes
+             ? 100U - (uint32_t)((stats.xSizeOfLargestFreeBlockInBytes * 100U) / stats.xAvailableHeapSpaceInBytes)
+             : 0;
+}
+#endif
+
+
+/**
+    @brief  Replay the allocation trace against one heap.
+
+    Each step picks a random slot: an empty slot gets a new block, a full
+    one is freed. The slot count bounds the live set, so the heap settles
+    into a fragmented steady state rather than filling up.
+
+    @param  heap    The allocator under test.
+    @param  ops     Number of steps.
+    @param  seed    Trace seed; the same seed gives the same trace.
+ */
+static void RunTrace(const HostHeap *heap, unsigned long ops, uint32_t seed) {
+    static void *slots[BENCH_SLOTS];
+    HostStats alloc_stats, free_stats, frag_stats, fail_stats;
+    uint32_t failures = 0;
+
+    memset(slots, 0, sizeof(slots));
+    StatsReset(&alloc_stats);
+    StatsReset(&free_stats);
+    StatsReset(&frag_stats);
+    StatsReset(&fail_stats);
+    rng_state = seed;
+
+    for (unsigned long i = 0; i < ops; i++) {
+        uint32_t slot = Random() % BENCH_SLOTS;
+
+        if (slots[slot] == NULL) {
+            size_t size = RandomSize();
+            uint64_t start = Nanoseconds();
+            slots[slot] = heap->alloc(size);
+            StatsAdd(&alloc_stats, Nanoseconds() - start);
+
+            if (slots[slot] == NULL) {
+                failures++;
+            } else {
+                // Touch the block so both heaps pay the same cache costs
+                memset(slots[slot], (int)slot, size);
+            }
+        } else {
+            uint64_t start = Nanoseconds();
+            heap->release(slots[slot]);
+            StatsAdd(&free_stats, Nanoseconds() - start);
+            slots[slot] = NULL;
+        }
+
+        if ((i & 0xFFFFUL) == 0xFFFFUL) {
+            uint32_t percent;
+            size_t largest;
+            heap->fragmentation(&percent, &largest);
+            StatsAdd(&frag_stats, percent);
+        }
+    }
+
+    StatsAdd(&fail_stats, failures);
+
+    Report("malloc", heap->name, "ns", &alloc_stats);
+    Report("free", heap->name, "ns", &free_stats);
+    Report("fragmentation", heap->name, "percent", &frag_stats);
+    Report("alloc_failures", heap->name, "count", &fail_stats);
+
+    for (uint32_t slot = 0; slot < BENCH_SLOTS; slot++) {
+        heap->release(slots[slot]);
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    unsigned long ops = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_DEFAULT_OPS;
+    uint32_t seed = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : BENCH_DEFAULT_SEED;
+    if (seed == 0) seed = BENCH_DEFAULT_SEED;
+
+    tlsf = TlsfCreate(tlsf_memory, sizeof(tlsf_memory));
+    if (tlsf == NULL) {
+        fprintf(stderr, "heap_bench: TLSF heap creation failed\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("suite,test,kernel,samples,min,mean,max,unit\n");
+
+    const HostHeap tlsf_heap = { "tlsf", TlsfAlloc, TlsfRelease, TlsfFragmentation };
+    RunTrace(&tlsf_heap, ops, seed);
+
+    if (TlsfCheck(tlsf) != 0) {
+        fprintf(stderr, "heap_bench: TLSF heap corrupt after run\n");
+        return EXIT_FAILURE;
+    }
+
+#if defined(HEAP_BENCH_HEAP_4)
+    const HostHeap heap_4 = { "heap_4", pvPortMalloc, vPortFree, Heap4Fragmentation };
+    RunTrace(&heap_4, ops, seed);
+#else
+    fprintf(stderr, "heap_bench: FreeRTOS-Kernel not checked out, heap_4 skipped\n");
+#endif
+
+    return EXIT_SUCCESS;
+}
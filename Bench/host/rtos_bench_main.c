@@ -0,0 +1,65 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Host runner for the RTOS suites on the ThreadX Linux port. Output is the
+ * same CSV as on the device, with times in nanoseconds; host scheduling
+ * noise lands in the max column, so run on an idle machine pinned to one
+ * core (eg. taskset -c 2).
+ *
+ * Usage: rtos_bench_host > host.csv
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "cmsis_os2.h"
+#include "tx_api.h"
+
+
+/**
+    @brief  Run the suites, then end the process: the Linux port has no
+            way back out of tx_kernel_enter().
+ */
+static void BenchMain(void *argument) {
+    (void)argument;
+
+    BenchInit();
+    BenchThreadXRun();
+    BenchCmsisRun();
+
+    fflush(stdout);
+    exit(0);
+}
+
+
+/**
+    @brief  ThreadX application entry; everything is created through the
+            CMSIS layer before the kernel starts.
+ */
+VOID tx_application_define(VOID *first_unused_memory) {
+    (void)first_unused_memory;
+}
+
+
+int main(void) {
+    const osThreadAttr_t attr = {
+        .name = "BenchMain",
+        .priority = osPriorityNormal,
+        .stack_size = 4 * BENCH_STACK_SIZE
+    };
+
+    osKernelInitialize();
+    if (osThreadNew(BenchMain, NULL, &attr) == NULL) {
+        fprintf(stderr, "cannot create the benchmark thread\n");
+        return 1;
+    }
+
+    osKernelStart();
+    return 1;
+}
@@ -0,0 +1,67 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Just enough of FreeRTOS.h to build portable/MemMang/heap_4.c on the host
+ * for heap_bench. Not a FreeRTOS port: there is no scheduler to suspend.
+ */
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+typedef long            BaseType_t;
+typedef unsigned long   UBaseType_t;
+typedef uint32_t        TickType_t;
+
+#define pdFALSE                             ((BaseType_t)0)
+#define pdTRUE                              ((BaseType_t)1)
+#define pdPASS                              pdTRUE
+#define pdFAIL                              pdFALSE
+
+#define configTOTAL_HEAP_SIZE               HEAP_BENCH_SIZE
+#define configSUPPORT_DYNAMIC_ALLOCATION    1
+#define configAPPLICATION_ALLOCATED_HEAP    0
+#define configUSE_MALLOC_FAILED_HOOK        0
+#define configHEAP_CLEAR_MEMORY_ON_FREE     0
+#define configENABLE_HEAP_PROTECTOR         0
+#define configASSERT(x)                     assert(x)
+
+#define portBYTE_ALIGNMENT                  8
+#define portBYTE_ALIGNMENT_MASK             (0x0007)
+#define portPOINTER_SIZE_TYPE               uintptr_t
+#define portMAX_DELAY                       ((TickType_t)0xffffffffUL)
+
+#define PRIVILEGED_FUNCTION
+#define PRIVILEGED_DATA
+#define mtCOVERAGE_TEST_MARKER()
+#define traceMALLOC(pvAddress, uiSize)
+#define traceFREE(pvAddress, uiSize)
+
+typedef struct xHeapStats {
+    size_t xAvailableHeapSpaceInBytes;
+    size_t xSizeOfLargestFreeBlockInBytes;
+    size_t xSizeOfSmallestFreeBlockInBytes;
+    size_t xNumberOfFreeBlocks;
+    size_t xMinimumEverFreeBytesRemaining;
+    size_t xNumberOfSuccessfulAllocations;
+    size_t xNumberOfSuccessfulFrees;
+} HeapStats_t;
+
+void   *pvPortMalloc(size_t xWantedSize);
+void   *pvPortCalloc(size_t xNum, size_t xSize);
+void    vPortFree(void *pv);
+void    vPortInitialiseBlocks(void);
+size_t  xPortGetFreeHeapSize(void);
+size_t  xPortGetMinimumEverFreeHeapSize(void);
+void    vPortGetHeapStats(HeapStats_t *pxHeapStats);
+void    vPortHeapResetState(void);
+
+#endif /* INC_FREERTOS_H */
@@ -0,0 +1,31 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Stands in for the device header (CMSIS_device_header) on host builds.
+ * There is no SysTick: osKernelGetSysTimerCount() degrades to whole ticks.
+ */
+#ifndef BENCH_HOST_DEVICE_H
+#define BENCH_HOST_DEVICE_H
+
+#include <stdint.h>
+
+#include "cmsis_compiler.h"
+
+typedef struct {
+    uint32_t CTRL;
+    uint32_t LOAD;
+    uint32_t VAL;
+} BenchHostSysTick;
+
+static BenchHostSysTick bench_host_systick;
+
+#define SysTick                     (&bench_host_systick)
+#define SystemCoreClock             1000000000U
+
+#endif /* BENCH_HOST_DEVICE_H */
@@ -0,0 +1,33 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Just enough of cmsis_compiler.h to build the ThreadX CMSIS-RTOS2 layer
+ * on the ThreadX Linux port, for rtos_bench_host and the host build of the
+ * Demo (Demo/host). Host threads never run
+ * in handler mode and the port does its own locking, so the exception
+ * and interrupt mask registers always read as zero.
+ */
+#ifndef __CMSIS_COMPILER_H
+#define __CMSIS_COMPILER_H
+
+#include <stdint.h>
+
+#define __WEAK                      __attribute__((weak))
+#define __NO_RETURN                 __attribute__((__noreturn__))
+#define __STATIC_INLINE             static inline
+
+__STATIC_INLINE uint32_t __get_IPSR(void)       { return 0U; }
+__STATIC_INLINE uint32_t __get_PRIMASK(void)    { return 0U; }
+__STATIC_INLINE uint32_t __get_BASEPRI(void)    { return 0U; }
+__STATIC_INLINE void __set_PRIMASK(uint32_t m)  { (void)m; }
+__STATIC_INLINE void __disable_irq(void)        { }
+__STATIC_INLINE void __enable_irq(void)         { }
+__STATIC_INLINE void __NOP(void)                { }
+
+#endif /* __CMSIS_COMPILER_H */
@@ -0,0 +1,17 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+// heap_bench is single threaded: the heap needs no locking
+#define vTaskSuspendAll()
+#define xTaskResumeAll()                    pdFALSE
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+#endif /* INC_TASK_H */
@@ -56,7 +56,11 @@
 #define configENABLE_TRUSTZONE                   0
 #define configRUN_FREERTOS_SECURE_ONLY           0
 #define configMINIMAL_SECURE_STACK_SIZE					( 1024 )
+#if defined(APP_ENABLE_HARD_FLOAT)
+#define configENABLE_FPU                         1
+#else
 #define configENABLE_FPU                         0
+#endif
 #define configENABLE_MPU                         0
 
 #define configUSE_PREEMPTION                     1
@@ -65,7 +69,10 @@
 #define configUSE_IDLE_HOOK                      0
 #define configUSE_TICK_HOOK                      0
 #define configCPU_CLOCK_HZ                       ( SystemCoreClock )
-#define configTICK_RATE_HZ                       ((TickType_t)1000)
+#ifndef APP_TICK_RATE_HZ
+#define APP_TICK_RATE_HZ                         1000
+#endif
+#define configTICK_RATE_HZ                       ((TickType_t)APP_TICK_RATE_HZ)
 #define configMAX_PRIORITIES                     ( 56 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)2048)
 #define configTOTAL_HEAP_SIZE                    ((size_t)8192)
@@ -77,6 +84,9 @@
 #define configUSE_RECURSIVE_MUTEXES              1
 #define configUSE_COUNTING_SEMAPHORES            1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
+#define configUSE_TASK_NOTIFICATIONS             1
+/* Slot 0 backs CMSIS thread flags, the last slot backs osFastFlags */
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES    2
 /* USER CODE BEGIN MESSAGE_BUFFER_LENGTH_TYPE */
 /* Defaults to size_t for backward compatibility, but can be changed
    if lengths will always be less than the number of bytes in a size_t. */
@@ -112,6 +122,10 @@ to exclude the API function. */
 /* 
  * The CMSIS-RTOS V2 FreeRTOS wrapper is dependent on the heap implementation used
  * by the application thus the correct define need to be enabled below
+ *
+ * For the constant time TLSF heap, define USE_FreeRTOS_HEAP_TLSF instead and
+ * build ST_Code/Core/Src/heap_tlsf.c in place of portable/MemMang/heap_4.c.
+ * No target builds the FreeRTOS kernel at present, so the stock heap stays.
  */
 #define USE_FreeRTOS_HEAP_4
 
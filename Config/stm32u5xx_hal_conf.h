@@ -37,25 +37,25 @@
 #define HAL_MODULE_ENABLED
 //#define HAL_ADC_MODULE_ENABLED
 //#define HAL_COMP_MODULE_ENABLED
-//#define HAL_CORDIC_MODULE_ENABLED
+#define HAL_CORDIC_MODULE_ENABLED
 #define HAL_CORTEX_MODULE_ENABLED
-//#define HAL_CRC_MODULE_ENABLED
+#define HAL_CRC_MODULE_ENABLED
 //#define HAL_CRYP_MODULE_ENABLED
 //#define HAL_DAC_MODULE_ENABLED
 //#define HAL_DCACHE_MODULE_ENABLED
 //#define HAL_DCMI_MODULE_ENABLED
 #define HAL_DMA_MODULE_ENABLED
 //#define HAL_DMA2D_MODULE_ENABLED
-//#define HAL_EXTI_MODULE_ENABLED
+#define HAL_EXTI_MODULE_ENABLED
 //#define HAL_FDCAN_MODULE_ENABLED
 #define HAL_FLASH_MODULE_ENABLED
-//#define HAL_FMAC_MODULE_ENABLED
+#define HAL_FMAC_MODULE_ENABLED
 #define HAL_GPIO_MODULE_ENABLED
 //#define HAL_GTZC_MODULE_ENABLED
 //#define HAL_HASH_MODULE_ENABLED
 //#define HAL_HCD_MODULE_ENABLED
 //#define HAL_I2C_MODULE_ENABLED
-//#define HAL_ICACHE_MODULE_ENABLED
+#define HAL_ICACHE_MODULE_ENABLED
 //#define HAL_IRDA_MODULE_ENABLED
 //#define HAL_IWDG_MODULE_ENABLED
 //#define HAL_LPTIM_MODULE_ENABLED
@@ -0,0 +1,82 @@
+/**************************************************************************/
+/*                                                                        */
+/*       Copyright (c) Microsoft Corporation. All rights reserved.        */
+/*                                                                        */
+/*       This software is licensed under the Microsoft Software License   */
+/*       Terms for Microsoft Azure RTOS. Full text of the license can be  */
+/*       found in the LICENSE file at https://aka.ms/AzureRTOS_EULA       */
+/*       and in the root directory of this software.                      */
+/*                                                                        */
+/**************************************************************************/
+
+/**************************************************************************/
+/*                                                                        */
+/*  PORT SPECIFIC C INFORMATION                            RELEASE        */
+/*                                                                        */
+/*    tx_user.h                                           PORTABLE C      */
+/*                                                                        */
+/*  DESCRIPTION                                                           */
+/*                                                                        */
+/*    This file contains user defines for configuring ThreadX in specific */
+/*    ways. It is picked up by the ThreadX build through TX_USER_FILE,    */
+/*    see the top level CMakeLists.txt. Only options that differ from the */
+/*    ThreadX defaults are listed here; see tx_user_sample.h for the rest.*/
+/*                                                                        */
+/**************************************************************************/
+
+#ifndef TX_USER_H
+#define TX_USER_H
+
+/* Number of thread priorities. The CMSIS-RTOS2 wrapper mirrors the 56
+   CMSIS priority levels onto the top of this range and needs at least 64. */
+
+#define TX_MAX_PRIORITIES                       64
+
+/* The ThreadX tick comes from the TIM6 time base, shared with the HAL
+   (Demo/Src/stm32u5xx_hal_timebase_tim_template.c), at cmake -DTICK_RATE_HZ. */
+
+#ifndef APP_TICK_RATE_HZ
+#define APP_TICK_RATE_HZ                        1000
+#endif
+#define TX_TIMER_TICKS_PER_SECOND               ((ULONG) APP_TICK_RATE_HZ)
+
+/* Execution profiling (cmake -DENABLE_PROFILING=ON). ThreadX calls the
+   _tx_execution_xxx hooks in Demo/Src/profile.c on every context change;
+   the per-thread counters live in the thread control block. */
+
+#ifdef APP_ENABLE_PROFILING
+#define TX_ENABLE_EXECUTION_CHANGE_NOTIFY
+#define TX_THREAD_USER_EXTENSION                ULONG tx_thread_profile_cycles; \
+                                                ULONG tx_thread_profile_runs;
+#endif
+
+/* Stack monitoring (cmake -DENABLE_STACK_MONITOR=ON). ThreadX fills every
+   stack with TX_STACK_FILL at creation; stack checking adds overflow
+   detection on each context switch. Demo/Src/stack_monitor.c scans for
+   the fill pattern to find each thread's high-water mark. */
+
+#ifdef APP_ENABLE_STACK_MONITOR
+#define TX_ENABLE_STACK_CHECKING
+#endif
+
+/* Event trace (cmake -DENABLE_TRACE=ON). ThreadX records scheduling, ISR and
+   API events in TraceX format into the buffer given to tx_trace_enable(),
+   see Demo/Src/trace.c. Timestamps are DWT cycle counts. */
+
+#ifdef APP_ENABLE_TRACE
+#define TX_ENABLE_EVENT_TRACE
+#define TX_TRACE_TIME_SOURCE                    *((volatile ULONG *) 0xE0001004)
+#define TX_TRACE_TIME_MASK                      0xFFFFFFFFUL
+#endif
+
+/* Tickless idle (cmake -DENABLE_TICKLESS=ON). With nothing ready to run, the
+   scheduler calls tx_low_power_enter() and tx_low_power_exit() in
+   Demo/Src/tickless.c around WFI; they stop the periodic ticks until the
+   next timer expiry and credit the time slept on wake. */
+
+#ifdef APP_ENABLE_TICKLESS
+#define TX_LOW_POWER
+#define TX_ENABLE_WFI
+#endif
+
+#endif
@@ -68,8 +68,6 @@ void MX_ThreadX_Init(void);
 #define PASS_VERIFY_STACK_SIZE              46*APP_STACK_SIZE
 #define SERVICE_PORT_STACK_SIZE							4*APP_STACK_SIZE
 #define TILE_STACK_SIZE											2*APP_STACK_SIZE
-#define USER_BUTTON_STACK_SIZE							APP_STACK_SIZE
-#define LED_TASK_STACK_SIZE									APP_STACK_SIZE
 
 #define TILE_QUEUE_SIZE											5
 //
@@ -93,15 +91,9 @@ void MX_ThreadX_Init(void);
 #define THREAD_PASS_VERIFY_PRIO2               				21
 #define THREAD_PASS_VERIFY_PREEMPTION_THRESHOLD2			THREAD_PASS_VERIFY_PRIO2
 
-#define USER_BUTTON_TASK_PRIO               					26
-#define USER_BUTTON_TASK_PREEMPTION_THRESHOLD					USER_BUTTON_TASK_PRIO
-
 #define TILE_TASK_PRIO                  							27
 #define TILE_TASK_PREEMPTION_THRESHOLD								TILE_TASK_PRIO
 
-#define LED_TASK_PRIO               									28
-#define LED_TASK_PREEMPTION_THRESHOLD									LED_TASK_PRIO
-
 #define SERVICE_PORT_PRIO               							31
 #define SERVICE_PORT_PREEMPTION_THRESHOLD   					SERVICE_PORT_PRIO
 /* USER CODE END PD */
@@ -0,0 +1,51 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Boot phases, each stamped as it ends
+typedef enum {
+    BOOT_PHASE_MAIN = 0,            // main() entered: time zero
+    BOOT_PHASE_HAL_INIT,            // HAL_Init(), which starts the TIM6 time base
+    BOOT_PHASE_CLOCK_CONFIG,        // SystemClock_Config()
+    BOOT_PHASE_GPIO_INIT,           // MX_GPIO_Init()
+    BOOT_PHASE_KERNEL_INIT,         // tx_kernel_enter() up to App_ThreadX_Init()
+    BOOT_PHASE_APP_INIT,            // App_ThreadX_Init(): threads created
+    BOOT_PHASE_FIRST_SAMPLE,        // First pass of the acquisition thread
+    BOOT_PHASE_NETWORK,             // Network connected
+    BOOT_PHASE_LOG_CHANNEL,         // Log channel open
+    BOOT_PHASE_COUNT
+} BootPhase;
+
+#if defined(APP_ENABLE_BOOT_PROFILE)
+
+void BootProfileStart(void);
+void BootProfileMark(BootPhase phase);
+void BootProfileReport(void);
+
+#define BOOT_PROFILE_START()        BootProfileStart()
+#define BOOT_PROFILE_MARK(phase)    BootProfileMark(phase)
+
+#else
+
+#define BOOT_PROFILE_START()
+#define BOOT_PROFILE_MARK(phase)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOOT_PROFILE_H */
@@ -0,0 +1,98 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sample history for the trigger-detect stage, cmake -DENABLE_CAPTURE=ON.
+ * The acquisition side writes samples into fixed-size segments; the most
+ * recent CAPTURE_HISTORY_SAMPLES are kept. A trigger freezes a window of
+ * samples before and after a point into a snapshot by taking a reference
+ * on the segments that hold it, so nothing is copied. The snapshot fills
+ * in as the post-trigger samples arrive, and acquisition carries on
+ * meanwhile into segments from a pool sized so it never runs out.
+ */
+
+// Samples per segment: the unit of hand-off. Smaller segments waste less
+// of a snapshot's pool share; larger ones mean fewer segment changes
+#ifndef CAPTURE_SEGMENT_SAMPLES
+#define CAPTURE_SEGMENT_SAMPLES     64
+#endif
+
+// Samples kept before the newest: covers the pre-trigger window plus how
+// far behind the newest sample a trigger may be taken
+#ifndef CAPTURE_HISTORY_SAMPLES
+#define CAPTURE_HISTORY_SAMPLES     512
+#endif
+
+// Longest post-trigger window
+#ifndef CAPTURE_POST_MAX
+#define CAPTURE_POST_MAX            256
+#endif
+
+// Snapshots held at once
+#ifndef CAPTURE_SNAPSHOTS
+#define CAPTURE_SNAPSHOTS           2
+#endif
+
+// Segments one snapshot can span, and the pool: the history, the segment
+// being written and every snapshot's worst case, so a write never waits
+#define CAPTURE_HISTORY_SEGMENTS    ((CAPTURE_HISTORY_SAMPLES + CAPTURE_SEGMENT_SAMPLES - 1) / CAPTURE_SEGMENT_SAMPLES)
+#define CAPTURE_SNAPSHOT_SEGMENTS   (CAPTURE_HISTORY_SEGMENTS + 1 + (CAPTURE_POST_MAX + CAPTURE_SEGMENT_SAMPLES - 1) / CAPTURE_SEGMENT_SAMPLES)
+#define CAPTURE_SEGMENTS            (CAPTURE_HISTORY_SEGMENTS + 1 + CAPTURE_SNAPSHOTS * CAPTURE_SNAPSHOT_SEGMENTS)
+
+// q1.15, as the dsp.c kernels take
+typedef int16_t CaptureSample;
+
+/*
+ * A frozen window. first, trigger and count are set by CaptureTrigger();
+ * the samples are readable with CaptureSpan() once CaptureWait() returns.
+ * The rest belongs to capture.c.
+ */
+typedef struct {
+    uint64_t         first;         // Sample number of the first sample, from CaptureInit()
+    uint64_t         trigger;       // ... and of the trigger
+    uint32_t         count;         // Samples in the window
+    volatile uint8_t state;
+    uint8_t          used;          // Entries in segments[]
+    uint8_t          segments[CAPTURE_SNAPSHOT_SEGMENTS];
+} CaptureSnapshot;
+
+typedef struct {
+    uint64_t written;               // Samples since CaptureInit()
+    uint32_t snapshots_taken;
+    uint32_t snapshots_refused;     // Every snapshot was held
+    uint32_t segments_free;
+} CaptureStats;
+
+#if defined(APP_ENABLE_CAPTURE)
+
+UINT             CaptureInit(void);
+void             CaptureWrite(const CaptureSample *samples, uint32_t count);
+uint64_t         CaptureWritten(void);
+CaptureSnapshot *CaptureTrigger(uint64_t trigger, uint32_t pre, uint32_t post);
+UINT             CaptureWait(CaptureSnapshot *snapshot, ULONG wait_option);
+uint32_t         CaptureSpan(const CaptureSnapshot *snapshot, uint32_t offset, const CaptureSample **samples);
+void             CaptureRelease(CaptureSnapshot *snapshot);
+void             CaptureGetStats(CaptureStats *stats);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAPTURE_H */
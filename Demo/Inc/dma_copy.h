@@ -0,0 +1,68 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef DMA_COPY_H
+#define DMA_COPY_H
+
+#include <stdint.h>
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Memory to memory copies and fills on GPDMA1, cmake -DENABLE_DMA_COPY=ON.
+ * A submission starts the transfer and returns at once with a handle to
+ * wait on; the CPU is free meanwhile. Copies under the threshold, and
+ * any submitted while every channel is busy, are done by the CPU before
+ * the call returns, and get DMA_COPY_DONE.
+ */
+
+// Below this many bytes memcpy() beats setting up a transfer
+#ifndef DMA_COPY_THRESHOLD
+#define DMA_COPY_THRESHOLD          256
+#endif
+
+// GPDMA1 channels 12 to 12 + DMA_COPY_CHANNELS - 1: the ones with the
+// deeper FIFO
+#define DMA_COPY_CHANNELS           2
+
+// Linked-list items per submission; each covers up to 64KB of a segment
+#define DMA_COPY_MAX_NODES          8
+
+#define DMA_COPY_IRQ_PRIORITY       14
+
+// Handle of a submitted transfer
+typedef uint32_t DmaCopyHandle;
+
+#define DMA_COPY_DONE               ((DmaCopyHandle)0)
+
+// One piece of a scatter/gather copy
+typedef struct {
+    void        *dst;
+    const void  *src;
+    uint32_t    length;
+} DmaCopySegment;
+
+#if defined(APP_ENABLE_DMA_COPY)
+
+UINT          DmaCopyInit(void);
+DmaCopyHandle DmaCopyMemcpy(void *dst, const void *src, uint32_t length);
+DmaCopyHandle DmaCopyMemset(void *dst, uint8_t value, uint32_t length);
+DmaCopyHandle DmaCopyGather(const DmaCopySegment *segments, uint32_t count);
+UINT          DmaCopyWait(DmaCopyHandle handle, ULONG wait_option);
+void          DmaCopySetThreshold(uint32_t bytes);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DMA_COPY_H */
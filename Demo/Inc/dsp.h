@@ -0,0 +1,84 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef DSP_H
+#define DSP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Filter and vector math kernels. Every call runs in portable C unless
+ * the build has -DENABLE_DSP_ACCEL=ON, when filters run on the FMAC and
+ * the vector functions on the CORDIC. A call that finds its unit busy,
+ * or a filter the FMAC cannot take, falls back to the C kernel, which
+ * is also what the host build runs.
+ *
+ * Samples and coefficients are q1.15. Angles are q1.31 fractions of pi,
+ * so INT32_MIN is -180 degrees and INT32_MAX just under +180.
+ */
+
+// Filter size limits; the FMAC itself takes up to 127 FIR taps, or an
+// IIR filter of up to 64 feed-forward and 63 feedback coefficients
+#define DSP_FILTER_MAX_B            64
+#define DSP_FILTER_MAX_A            8
+
+// ThreadX ticks to wait for the FMAC before redoing a block in C
+#define DSP_FMAC_TIMEOUT_TICKS      100
+
+#define DSP_IRQ_PRIORITY            14
+
+/*
+ * A FIR (taps_a == 0) or direct form 1 IIR filter, in the FMAC's terms:
+ *   y[n] = 2^gain_shift * (sum b[k] x[n-k], k = 0..taps_b-1
+ *                        + sum a[k] y[n-k-1], k = 0..taps_a-1)
+ * The feedback is added, so a[] is the negated denominator of the usual
+ * form. Results saturate to q1.15. The history carries between calls.
+ */
+typedef struct {
+    const int16_t *b;
+    const int16_t *a;
+    uint8_t       taps_b;
+    uint8_t       taps_a;
+    uint8_t       gain_shift;       // 0 to 7
+    int16_t       x_history[DSP_FILTER_MAX_B - 1];  // Oldest first
+    int16_t       y_history[DSP_FILTER_MAX_A];
+} DspFilter;
+
+bool     DspFilterInit(DspFilter *filter, const int16_t *b, uint8_t taps_b,
+                       const int16_t *a, uint8_t taps_a, uint8_t gain_shift);
+void     DspFilterReset(DspFilter *filter);
+void     DspFilterRun(DspFilter *filter, const int16_t *in, int16_t *out, uint16_t count);
+
+int32_t  DspAtan2(int16_t y, int16_t x);
+uint32_t DspMagnitude2(int16_t x, int16_t y);
+uint32_t DspMagnitude3(int16_t x, int16_t y, int16_t z);
+void     DspPolar(const int16_t *x, const int16_t *y, int32_t *angle, uint32_t *magnitude, uint32_t count);
+int32_t  DspSqrt(int32_t x);
+
+/**
+    @brief  An angle in hundredths of a degree, -18000 to 17999.
+ */
+static inline int32_t DspAngleToCentidegrees(int32_t angle) {
+    return (int32_t)(((int64_t)angle * 18000) >> 31);
+}
+
+#if defined(APP_ENABLE_DSP_ACCEL)
+UINT     DspInit(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_H */
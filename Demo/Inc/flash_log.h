@@ -0,0 +1,77 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tx_api.h"
+#include "stm32u5xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Append-only record store in internal flash, for data that could not be
+ * sent while the network was down. Records go into whole pages, which
+ * are read back and handed over in the order they were written; see
+ * flash_log.c for the layout. The host build runs it against a simulated
+ * flash (Demo/host/flash_sim.c) that can inject power loss.
+ */
+
+// The last pages of bank 2, away from the code in bank 1, so programming
+// does not stall instruction fetches. Keep them out of the app image
+#ifndef FLASH_LOG_PAGES
+#define FLASH_LOG_PAGES             16
+#endif
+
+// STM32U585: 2MB in two banks of 1MB. The HAL's FLASH_SIZE reads the
+// size register, which the non-secure side cannot
+#define FLASH_LOG_DEVICE_SIZE       0x200000UL
+#define FLASH_LOG_BANK_SIZE         (FLASH_LOG_DEVICE_SIZE / 2U)
+
+#define FLASH_LOG_PAGE_SIZE         FLASH_PAGE_SIZE
+#define FLASH_LOG_BASE              (FLASH_BASE_NS + FLASH_LOG_DEVICE_SIZE - FLASH_LOG_PAGES * FLASH_LOG_PAGE_SIZE)
+
+// Bytes staged in SRAM before they are programmed; a multiple of the
+// 128-byte burst. Staged records are lost if power fails first
+#define FLASH_LOG_BATCH_SIZE        256
+
+// Largest payload: a page less its header and one record's overhead
+#define FLASH_LOG_MAX_RECORD        (FLASH_LOG_PAGE_SIZE - 4 * 16)
+
+// Reads from the store; the host build maps addresses to its model
+#ifndef FLASH_LOG_POINTER
+#define FLASH_LOG_POINTER(address)  ((const uint8_t *)(address))
+#endif
+
+typedef struct {
+    uint32_t records_written;       // Since boot
+    uint32_t records_read;          // Consumed since boot
+    uint32_t quads_skipped;         // Quad-words of records cut short by power loss, or corrupt
+    uint32_t pages_used;            // Holding records not yet read
+    uint32_t pages_dropped;         // Reclaimed unread because the store was full
+    uint32_t erase_count_min;       // Over the store's pages
+    uint32_t erase_count_max;
+} FlashLogStats;
+
+UINT           FlashLogInit(void);
+bool           FlashLogAppend(uint8_t type, const void *data, uint16_t length);
+bool           FlashLogFlush(void);
+bool           FlashLogIsEmpty(void);
+const uint8_t *FlashLogPeek(uint8_t *type, uint16_t *length);
+void           FlashLogConsume(void);
+void           FlashLogGetStats(FlashLogStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLASH_LOG_H */
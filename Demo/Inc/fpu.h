@@ -0,0 +1,35 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hard-float builds, cmake -DENABLE_HARD_FLOAT=ON. The FPU context is
+ * per thread: a thread carries one only once it has run an FP instruction,
+ * and only then do its context switches save and restore the FP registers.
+ * Lazy stacking defers even that until another user needs the registers.
+ */
+#if defined(APP_ENABLE_HARD_FLOAT)
+
+bool FpuInit(void);
+bool FpuThreadActive(void);
+void FpuThreadRelease(void);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FPU_H */
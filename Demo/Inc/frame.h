@@ -0,0 +1,74 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Framed records for the channels, so a reader can tell a whole record
+ * from one cut short by a drop, and find the next one after it:
+ *
+ *   0   sync        0xA5 0x5A
+ *   2   length      payload bytes, little endian
+ *   4   type        FRAME_TYPE_...
+ *   5   version     FRAME_VERSION
+ *   6   sequence    little endian, one up per frame sealed
+ *   8   payload
+ *   8+length  crc   CRC-32 of everything before it, little endian
+ *
+ * The CRC is the zlib/Ethernet one, so hosts check it with crc32() from
+ * any library; tools/frame_decode.py does. It runs on the CRC unit when
+ * the build has -DENABLE_CRC_ACCEL=ON, fed by DMA for large frames, and
+ * in C, to the same result, otherwise, on the host and when the unit is
+ * taken.
+ *
+ * Frames are built in place: write the payload at FRAME_PAYLOAD(frame)
+ * and seal it, so it goes out in one write without being copied.
+ */
+
+#define FRAME_SYNC_0                0xA5
+#define FRAME_SYNC_1                0x5A
+#define FRAME_VERSION               1
+
+#define FRAME_HEADER_SIZE           8
+#define FRAME_TRAILER_SIZE          4
+#define FRAME_MAX_PAYLOAD           0xFFFFUL
+
+// Buffer size for a payload, and where its payload goes
+#define FRAME_SIZE(payload)         ((payload) + FRAME_HEADER_SIZE + FRAME_TRAILER_SIZE)
+#define FRAME_PAYLOAD(frame)        ((frame) + FRAME_HEADER_SIZE)
+
+// Record types; the host decoder prints any others as numbers
+#define FRAME_TYPE_TEXT             1
+#define FRAME_TYPE_TELEMETRY        2
+
+// CRC unit: bytes from which the words go by DMA rather than by CPU
+// stores, the ThreadX ticks to wait for it, and its interrupt priority
+#define FRAME_CRC_DMA_THRESHOLD     1024
+#define FRAME_CRC_TIMEOUT_TICKS     100
+#define FRAME_IRQ_PRIORITY          14
+
+uint32_t FrameCrc32(const void *data, uint32_t length);
+uint32_t FrameSeal(uint8_t *frame, uint8_t type, uint16_t length);
+
+#if defined(APP_ENABLE_CRC_ACCEL)
+UINT     FrameInit(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_H */
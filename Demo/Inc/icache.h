@@ -0,0 +1,36 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef ICACHE_H
+#define ICACHE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Instruction cache monitor counts since the last reset
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;                // Saturate at 0xFFFF
+} ICacheStats;
+
+#if defined(APP_ENABLE_ICACHE)
+
+void ICacheInit(void);
+void ICacheInvalidate(void);
+void ICacheGetStats(ICacheStats *stats);
+void ICacheResetStats(void);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ICACHE_H */
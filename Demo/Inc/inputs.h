@@ -0,0 +1,62 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef INPUTS_H
+#define INPUTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Interrupt-driven digital inputs, cmake -DENABLE_INPUTS=ON, one INPUT()
+ * row per input:
+ *   INPUT(name, port letter, pin number, pull, active level, debounce ms)
+ * An edge on the pin's EXTI line masks the line and starts a one-shot
+ * ThreadX timer; when it expires the pin is read again and, if it has
+ * settled at a new level, the event goes out to every subscriber's event
+ * flags group. No thread polls and none is needed per input. The EXTI
+ * line is the pin number, so two inputs cannot share a pin number.
+ */
+#define INPUTS_TABLE(INPUT)                                                                         \
+    INPUT(UserButton, C, 13, GPIO_NOPULL, 1, 20)
+
+#define INPUTS_IRQ_PRIORITY         14
+
+// Event flags groups that can subscribe
+#define INPUTS_SUBSCRIBERS          4
+
+#define INPUTS_DEFINE_INDEX(name, port, number, pull, active, debounce_ms)  INPUT_##name,
+
+typedef enum {
+    INPUTS_TABLE(INPUTS_DEFINE_INDEX)
+    INPUTS_COUNT
+} InputIndex;
+
+// Event flags, two per input: it became active, or inactive again
+#define INPUT_EVENT_ACTIVE(name)    (1UL << (2U * INPUT_##name))
+#define INPUT_EVENT_INACTIVE(name)  (1UL << (2U * INPUT_##name + 1U))
+#define INPUT_EVENT_ANY(name)       (INPUT_EVENT_ACTIVE(name) | INPUT_EVENT_INACTIVE(name))
+
+#if defined(APP_ENABLE_INPUTS)
+
+UINT InputsInit(void);
+UINT InputsSubscribe(TX_EVENT_FLAGS_GROUP *group, ULONG events);
+bool InputIsActive(InputIndex input);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INPUTS_H */
@@ -0,0 +1,87 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef LED_PATTERN_H
+#define LED_PATTERN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * LED patterns played by hardware, cmake -DENABLE_LED_PATTERNS=ON. TIM2
+ * drives the LED on PA5 (TIM2_CH1) with PWM, and on each PWM period's
+ * update event GPDMA1 writes the next brightness into the compare
+ * register. Starting a pattern turns its steps into a list of DMA items,
+ * one per brightness level with a repeat count; after that the timer and
+ * the DMA play it, looping if asked, with no thread and no interrupts
+ * beyond one at the end of a pattern that does not loop.
+ */
+
+// PWM rate, and so the time resolution of a pattern
+#define LED_PWM_HZ                  1000
+
+// DMA items a pattern can become: one per level step, one per fade
+// slice, and another for each 16s of a long step
+#define LED_PATTERN_MAX_ITEMS       48
+
+// Levels a fade passes through
+#define LED_FADE_SLICES             16
+
+// GPDMA1 channel 8, which carries the compare updates
+#define LED_PATTERN_IRQ_PRIORITY    14
+
+/*
+ * One step: go to a brightness, at once or fading from the step before,
+ * and stay for a time. Brightness runs from 0 (off) to 255 (fully on)
+ * and is squared on the way to the PWM, which looks roughly even.
+ */
+typedef struct {
+    uint8_t  level;
+    uint8_t  fade;
+    uint16_t ms;
+} LedStep;
+
+typedef struct {
+    const LedStep *steps;
+    uint8_t       count;
+    uint8_t       repeat;           // Loop, or hold the last level once done
+} LedPattern;
+
+#define LED_ON(ms)                  { 255, 0, (ms) }
+#define LED_OFF(ms)                 { 0, 0, (ms) }
+#define LED_LEVEL(level, ms)        { (level), 0, (ms) }
+#define LED_FADE(level, ms)         { (level), 1, (ms) }
+
+// Define a pattern from its steps, e.g.
+//   LED_PATTERN(led_pattern_double, true, LED_ON(100), LED_OFF(100), LED_ON(100), LED_OFF(700))
+#define LED_PATTERN(name, repeat, ...)                                                              \
+    static const LedStep name##_steps[] = { __VA_ARGS__ };                                          \
+    const LedPattern name = { name##_steps, sizeof(name##_steps) / sizeof(LedStep), (repeat) }
+
+#if defined(APP_ENABLE_LED_PATTERNS)
+
+extern const LedPattern led_pattern_heartbeat;  // 500 ms on, 500 ms off
+extern const LedPattern led_pattern_breathe;    // Fade up and down over 3 s
+extern const LedPattern led_pattern_fault;      // Three short flashes, then a pause
+
+UINT LedPatternInit(void);
+bool LedPatternStart(const LedPattern *pattern);
+void LedPatternSet(uint8_t level);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_PATTERN_H */
@@ -1,13 +1,43 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tx_api.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// The connect thread opens the log channel in the background, and reopens
+// it whenever it drops: with fast start, and with the flash backlog, which
+// keeps frames meanwhile
+#if defined(APP_ENABLE_FAST_START) || defined(APP_ENABLE_FLASH_LOG)
+#define LOG_CONNECT_THREAD
+#endif
+
+// Runs below the acquisition threads
+#ifndef LOG_CONNECT_THREAD_PRIO
+#define LOG_CONNECT_THREAD_PRIO     20
+#endif
+
+#define LOG_CONNECT_STACK_SIZE      2048
+
+// Channel send buffer: a multiple of 512 bytes, and at least the largest
+// frame passed to ServerLogFrame()
+#ifndef LOG_SEND_BUFFER_SIZE
+#define LOG_SEND_BUFFER_SIZE        512
+#endif
+
 void ServerLog(const char *str);
+bool ServerLogFrame(uint8_t *frame, uint8_t type, uint16_t length);
 void CloseLogChannel(void);
 
+#if defined(LOG_CONNECT_THREAD)
+UINT LogConnectStart(TX_BYTE_POOL *pool);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,70 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef PINS_H
+#define PINS_H
+
+#include <stdint.h>
+
+#include "stm32u5xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Board pin table, one PIN() row per pin:
+ *   PIN(name, port letter, pin number, mode, pull, speed, initial level)
+ * The level only applies to outputs. PinsInit() sets every pin up from
+ * this table, and each row gets its own inline operations:
+ *   PIN_SET(name), PIN_CLEAR(name), PIN_TOGGLE(name), PIN_READ(name)
+ * The port and mask are constants, so set and clear compile to a single
+ * BSRR store, and toggle to one ODR load and one BSRR store. None of them
+ * read-modify-write ODR, so they are safe against other threads and ISRs
+ * driving other pins on the same port.
+ */
+#define PINS_TABLE(PIN)                                                                             \
+    PIN(UnderTest, A, 5, GPIO_MODE_OUTPUT_PP, GPIO_PULLUP, GPIO_SPEED_FREQ_VERY_HIGH, 0)
+
+// Store to a port's bit set/reset register; the host build routes it
+// through the simulated GPIO
+#ifndef PIN_BSRR_WRITE
+#define PIN_BSRR_WRITE(port, value)     ((port)->BSRR = (value))
+#endif
+
+// The firmware builds at -O0, which inlines nothing on its own: force it,
+// so each op stays a register access, as profile and trace pins need
+#define PIN_INLINE                      static inline __attribute__((always_inline))
+
+/**
+    @brief  Invert the pins in mask, leaving the rest of the port alone.
+ */
+PIN_INLINE void PinToggleMask(GPIO_TypeDef *port, uint32_t mask) {
+    uint32_t odr = port->ODR;
+    PIN_BSRR_WRITE(port, ((odr & mask) << 16) | (~odr & mask));
+}
+
+#define PINS_DEFINE_OPS(name, port, number, mode, pull, speed, level)                               \
+    PIN_INLINE void Pin##name##Set(void) { PIN_BSRR_WRITE(GPIO##port, 1UL << (number)); }           \
+    PIN_INLINE void Pin##name##Clear(void) { PIN_BSRR_WRITE(GPIO##port, 1UL << ((number) + 16)); }  \
+    PIN_INLINE void Pin##name##Toggle(void) { PinToggleMask(GPIO##port, 1UL << (number)); }         \
+    PIN_INLINE uint32_t Pin##name##Read(void) { return (GPIO##port->IDR >> (number)) & 1UL; }
+
+PINS_TABLE(PINS_DEFINE_OPS)
+
+#define PIN_SET(name)                   Pin##name##Set()
+#define PIN_CLEAR(name)                 Pin##name##Clear()
+#define PIN_TOGGLE(name)                Pin##name##Toggle()
+#define PIN_READ(name)                  Pin##name##Read()
+
+void PinsInit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PINS_H */
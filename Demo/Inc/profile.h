@@ -0,0 +1,59 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reporting period in ms; keep well below 2^32 cycles (~26 s at 160 MHz)
+#ifndef PROFILE_PERIOD_MS
+#define PROFILE_PERIOD_MS           1000
+#endif
+
+#ifndef PROFILE_THREAD_PRIO
+#define PROFILE_THREAD_PRIO         30
+#endif
+
+#define PROFILE_STACK_SIZE          2048
+
+// Report limits: keep a report line within the log channel send buffer
+#define PROFILE_MAX_THREADS         12
+#define PROFILE_MAX_ISRS            8
+#define PROFILE_NAME_LENGTH         8
+
+// Report format version, see tools/profile_decode.py
+#define PROFILE_FORMAT_VERSION      1
+
+#if defined(TX_ENABLE_EXECUTION_CHANGE_NOTIFY)
+
+// ISRs outside ThreadX bracket their bodies with these so their
+// cycles are not charged to the thread they interrupted
+VOID _tx_execution_isr_enter(VOID);
+VOID _tx_execution_isr_exit(VOID);
+
+#define PROFILE_ISR_ENTER()         _tx_execution_isr_enter()
+#define PROFILE_ISR_EXIT()          _tx_execution_isr_exit()
+
+UINT ProfileStart(TX_BYTE_POOL *pool);
+
+#else
+
+#define PROFILE_ISR_ENTER()
+#define PROFILE_ISR_EXIT()
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROFILE_H */
@@ -0,0 +1,43 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef RAMFUNC_H
+#define RAMFUNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Mark a hot function RAMFUNC to run it from SRAM, clear of the flash wait
+ * states. Config/ramfunc.ld collects the .ramfunc sections after .data and
+ * RamFuncInit() copies them in. Without -DENABLE_RAMFUNC=ON the attribute
+ * is empty and everything stays in flash.
+ */
+#if defined(APP_ENABLE_RAMFUNC)
+
+// One section per line keeps each function a separate entry in the map
+#define RAMFUNC_STR2(x)             #x
+#define RAMFUNC_STR(x)              RAMFUNC_STR2(x)
+#define RAMFUNC                     __attribute__((section(".ramfunc." RAMFUNC_STR(__LINE__)), noinline))
+
+void RamFuncInit(void);
+
+#define RAMFUNC_INIT()              RamFuncInit()
+
+#else
+
+#define RAMFUNC
+#define RAMFUNC_INIT()
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RAMFUNC_H */
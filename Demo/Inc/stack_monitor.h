@@ -0,0 +1,35 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef STACK_MONITOR_H
+#define STACK_MONITOR_H
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scan period in ms
+#ifndef STACK_MONITOR_PERIOD_MS
+#define STACK_MONITOR_PERIOD_MS     10000
+#endif
+
+#ifndef STACK_MONITOR_THREAD_PRIO
+#define STACK_MONITOR_THREAD_PRIO   31
+#endif
+
+#define STACK_MONITOR_STACK_SIZE    1024
+
+ULONG StackMonitorUsed(const TX_THREAD *thread);
+UINT  StackMonitorStart(TX_BYTE_POOL *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STACK_MONITOR_H */
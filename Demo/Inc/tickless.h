@@ -0,0 +1,46 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef TICKLESS_H
+#define TICKLESS_H
+
+#include <stdint.h>
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shortest idle period, in ThreadX ticks, worth stopping the ticks for
+#ifndef TICKLESS_MIN_TICKS
+#define TICKLESS_MIN_TICKS          2
+#endif
+
+// Longest single sleep in us: TIM6 is 16 bits, at 100 us per count here
+#ifndef TICKLESS_MAX_SLEEP_US
+#define TICKLESS_MAX_SLEEP_US       6000000UL
+#endif
+
+// Idle statistics since boot
+typedef struct {
+    uint32_t sleeps;                // Tickless sleeps taken
+    uint32_t early_wakes;           // Sleeps cut short by another interrupt
+    uint64_t slept_us;              // Total time spent in tickless sleep
+} TicklessStats;
+
+#if defined(TX_LOW_POWER)
+
+void TicklessGetStats(TicklessStats *stats);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TICKLESS_H */
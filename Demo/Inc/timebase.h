@@ -0,0 +1,56 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * TIM6 time base, in Demo/Src/stm32u5xx_hal_timebase_tim_template.c. One
+ * interrupt drives both HAL_GetTick() and the RTOS tick.
+ */
+
+// Tick rate for the HAL and the RTOS: cmake -DTICK_RATE_HZ=...
+#ifndef APP_TICK_RATE_HZ
+#define APP_TICK_RATE_HZ            1000
+#endif
+
+// Tick ISR measurements since boot or the last reset, in DWT cycles
+typedef struct {
+    uint32_t count;                 // Ticks measured
+    uint32_t duration_min;          // Cycles spent in the ISR
+    uint32_t duration_max;
+    uint64_t duration_total;
+    uint32_t jitter_max;            // |interval between ticks - nominal|
+    uint64_t jitter_total;
+    uint32_t gaps;                  // Intervals over two periods, not counted as jitter
+} TimebaseTickStats;
+
+uint64_t TimebaseGetMicros(void);
+void TimebaseCreditTicks(uint32_t ticks);
+
+#if !defined(TIMEBASE_FREERTOS)
+void TimebaseStartRtosTick(void);
+#endif
+
+#if defined(APP_ENABLE_TICK_STATS)
+
+void TimebaseGetTickStats(TimebaseTickStats *stats);
+void TimebaseResetTickStats(void);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMEBASE_H */
@@ -0,0 +1,60 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "tx_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Trace buffer size in bytes; each event takes 32 bytes
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE           16384
+#endif
+
+// Object registry entries: threads, queues, semaphores etc. named in the trace
+#ifndef TRACE_REGISTRY_ENTRIES
+#define TRACE_REGISTRY_ENTRIES      32
+#endif
+
+#ifndef TRACE_THREAD_PRIO
+#define TRACE_THREAD_PRIO           31
+#endif
+
+#define TRACE_STACK_SIZE            1024
+
+// Raw bytes carried by each '#trace' log line
+#define TRACE_CHUNK_SIZE            48
+
+#if defined(TX_ENABLE_EVENT_TRACE)
+
+// User markers: id 0-1023, shown as user events in TraceX
+#define TRACE_MARKER(id, a, b)      tx_trace_user_event_insert(TX_TRACE_USER_EVENT_START + (id), (a), (b), 0, 0)
+
+// ISRs outside ThreadX bracket their bodies with these
+#define TRACE_ISR_ENTER()           tx_trace_isr_enter_insert(__get_IPSR())
+#define TRACE_ISR_EXIT()            tx_trace_isr_exit_insert(__get_IPSR())
+
+UINT TraceStart(TX_BYTE_POOL *pool);
+void TraceDumpRequest(void);
+
+#else
+
+#define TRACE_MARKER(id, a, b)
+#define TRACE_ISR_ENTER()
+#define TRACE_ISR_EXIT()
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H */
@@ -27,6 +27,24 @@
 
 #include "main.h"
 #include "app_azure_rtos_config.h"
+#include "boot_profile.h"
+#include "capture.h"
+#include "dma_copy.h"
+#include "dsp.h"
+#include "flash_log.h"
+#include "frame.h"
+#include "inputs.h"
+#include "led_pattern.h"
+#include "logging.h"
+#include "pins.h"
+#include "profile.h"
+#include "stack_monitor.h"
+#include "trace.h"
+#include "timebase.h"
+#if defined(APP_RUN_BENCHMARKS)
+#include "bench.h"
+#include "cmsis_os2.h"
+#endif
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -40,6 +58,15 @@
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
 
+/* Heartbeat frame payload: pass count and uptime in ms */
+#define HEARTBEAT_PAYLOAD_SIZE 8
+
+/* StartupTask toggles the LED and logs the heartbeat. With LED patterns
+   and no flash backlog it would have nothing to do, so it is not made */
+#if !defined(APP_ENABLE_LED_PATTERNS) || defined(APP_ENABLE_FLASH_LOG)
+#define APP_STARTUP_TASK
+#endif
+
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -62,6 +89,9 @@ TX_THREAD txStartupTask;
 //	Task function prototypes
 //
 void StartupTask_Entry(ULONG thread_input);
+#if defined(APP_RUN_BENCHMARKS)
+static void BenchTask_Entry(void *argument);
+#endif
 
 //	Global byte pool point declaration
 TX_BYTE_POOL *pGlobal_byte_pool = TX_NULL;
@@ -86,7 +116,73 @@ UINT App_ThreadX_Init(VOID *memory_ptr)
 
   /* USER CODE BEGIN App_ThreadX_Init */
 
+  BOOT_PROFILE_MARK(BOOT_PHASE_KERNEL_INIT);
+
+  /* ThreadX ticks from TIM6 along with the HAL, instead of from SysTick */
+  TimebaseStartRtosTick();
+
+#if defined(APP_ENABLE_DMA_COPY)
+  /* GPDMA1 channels for DmaCopyMemcpy() and friends */
+  if (DmaCopyInit() != TX_SUCCESS)
+  {
+    ret = TX_NOT_AVAILABLE;
+  }
+#endif
+
+#if defined(APP_ENABLE_DSP_ACCEL)
+  /* FMAC and CORDIC for the dsp.c kernels, which run in C until then */
+  if (DspInit() != TX_SUCCESS)
+  {
+    ret = TX_NOT_AVAILABLE;
+  }
+#endif
+
+#if defined(APP_ENABLE_CRC_ACCEL)
+  /* CRC unit for frame.c, which computes CRCs in C until then */
+  if (FrameInit() != TX_SUCCESS)
+  {
+    ret = TX_NOT_AVAILABLE;
+  }
+#endif
+
+#if defined(APP_ENABLE_FLASH_LOG)
+  /* Find the frames earlier runs kept in flash, before anything logs */
+  if (FlashLogInit() != TX_SUCCESS)
+  {
+    ret = TX_NOT_AVAILABLE;
+  }
+#endif
+
+#if defined(APP_ENABLE_CAPTURE)
+  /* Sample history for the trigger-detect stage, before acquisition starts */
+  if (CaptureInit() != TX_SUCCESS)
+  {
+    ret = TX_NOT_AVAILABLE;
+  }
+#endif
+
+#if defined(APP_ENABLE_INPUTS)
+  /* Button and other EXTI inputs, debounced by timers instead of polled */
+  if (InputsInit() != TX_SUCCESS)
+  {
+    ret = TX_NOT_AVAILABLE;
+  }
+#endif
+
+#if defined(APP_ENABLE_LED_PATTERNS)
+  /* TIM2 and GPDMA1 blink the LED from here on, with no thread */
+  if (LedPatternInit() != TX_SUCCESS || !LedPatternStart(&led_pattern_heartbeat))
+  {
+    ret = TX_NOT_AVAILABLE;
+  }
+#if !defined(APP_STARTUP_TASK)
+  /* The first blink stands in for StartupTask's first pass */
+  BOOT_PROFILE_MARK(BOOT_PHASE_FIRST_SAMPLE);
+#endif
+#endif
+
 #if (USE_MEMORY_POOL_ALLOCATION == 1)
+#if defined(APP_STARTUP_TASK)
   CHAR *pMemPool;
 
 	/* Allocate the stack for StartupTask.  */
@@ -110,8 +206,59 @@ UINT App_ThreadX_Init(VOID *memory_ptr)
   {
     ret = TX_THREAD_ERROR;
   }
+#endif
 
+#if defined(TX_ENABLE_EXECUTION_CHANGE_NOTIFY)
+  /* Per-thread CPU usage reports on the log channel */
+  if (ProfileStart(pGlobal_byte_pool) != TX_SUCCESS)
+  {
+    ret = TX_THREAD_ERROR;
+  }
+#endif
+
+#if defined(TX_ENABLE_STACK_CHECKING)
+  /* Stack high-water reports on the log channel, see tools/stack_report.py */
+  if (StackMonitorStart(pGlobal_byte_pool) != TX_SUCCESS)
+  {
+    ret = TX_THREAD_ERROR;
+  }
+#endif
+
+#if defined(TX_ENABLE_EVENT_TRACE)
+  /* TraceX event trace; TraceDumpRequest(), or the user button, sends it over the log channel */
+  if (TraceStart(pGlobal_byte_pool) != TX_SUCCESS)
+  {
+    ret = TX_THREAD_ERROR;
+  }
+#endif
+
+#if defined(APP_RUN_BENCHMARKS)
+  /* One pass of the benchmark suites, CSV on the log channel. The CMSIS
+     suite needs a thread created through the CMSIS layer */
+  const osThreadAttr_t bench_attr = {
+    .name = "Bench",
+    .priority = osPriorityNormal,
+    .stack_size = 2048
+  };
+  if (osThreadNew(BenchTask_Entry, NULL, &bench_attr) == NULL)
+  {
+    ret = TX_THREAD_ERROR;
+  }
+#endif
+
+#if defined(LOG_CONNECT_THREAD)
+  /* Open the log channel in the background, after the threads above, so
+     they run from boot instead of waiting for the network. The same
+     thread reopens it whenever it drops */
+  if (LogConnectStart(pGlobal_byte_pool) != TX_SUCCESS)
+  {
+    ret = TX_THREAD_ERROR;
+  }
 #endif
+
+#endif
+
+  BOOT_PROFILE_MARK(BOOT_PHASE_APP_INIT);
   /* USER CODE END App_ThreadX_Init */
 
   return ret;
@@ -145,16 +292,55 @@ void MX_ThreadX_Init(void)
   * @retval None
   */
 /* USER CODE END Header_StartStartupTask */
+#if defined(APP_STARTUP_TASK)
 void StartupTask_Entry(ULONG thread_input)
 {
+#if defined(APP_ENABLE_FLASH_LOG)
+  static uint8_t heartbeat[FRAME_SIZE(HEARTBEAT_PAYLOAD_SIZE)] __attribute__((aligned(4)));
+  uint32_t passes = 0;
+#endif
 
   /* Infinite loop */
   for(;;)
   {
-	HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5);
-	/* Sleep for 500 ms */
-	tx_thread_sleep(500);
+#if !defined(APP_ENABLE_LED_PATTERNS)
+	PIN_TOGGLE(UnderTest);
+#endif
+	BOOT_PROFILE_MARK(BOOT_PHASE_FIRST_SAMPLE);
+#if defined(APP_ENABLE_FLASH_LOG)
+	/* Telemetry for the backlog to keep while the network is down */
+	uint32_t uptime_ms = (uint32_t)(TimebaseGetMicros() / 1000U);
+	passes++;
+	memcpy(FRAME_PAYLOAD(heartbeat), &passes, sizeof(passes));
+	memcpy(FRAME_PAYLOAD(heartbeat) + sizeof(passes), &uptime_ms, sizeof(uptime_ms));
+	ServerLogFrame(heartbeat, FRAME_TYPE_TELEMETRY, HEARTBEAT_PAYLOAD_SIZE);
+#endif
+	/* Sleep for 500 ms, whatever the tick rate */
+	tx_thread_sleep(500 * TX_TIMER_TICKS_PER_SECOND / 1000);
   }
 }
+#endif
+
+#if defined(APP_RUN_BENCHMARKS)
+/**
+  * @brief  Run every benchmark suite once, then exit.
+  * @param  argument: Not used
+  * @retval None
+  */
+static void BenchTask_Entry(void *argument)
+{
+  (void)argument;
+
+  BenchInit();
+  BenchThreadXRun();
+  BenchCmsisRun();
+#if !defined(BENCH_HOST)
+  /* Needs a real NVIC: not on the host build */
+  BenchIsrWakeRun();
+#endif
+
+  osThreadExit();
+}
+#endif
 
 /* USER CODE END 1 */
@@ -0,0 +1,128 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdio.h>
+
+#include "boot_profile.h"
+#include "logging.h"
+#include "timebase.h"
+#include "stm32u5xx_hal.h"
+
+#if defined(APP_ENABLE_BOOT_PROFILE)
+
+/*
+ * Each phase is stamped once, as it ends, with the DWT cycle counter and
+ * the TIM6 microsecond clock. The cycle counter starts at main() but wraps
+ * after ~26 s at 160 MHz, which the wait for the network can exceed, so
+ * times are reported from the microsecond clock. It only starts in
+ * HAL_Init(); the cycles to that point make up the difference.
+ */
+typedef struct {
+    uint32_t cycles;
+    uint64_t us;
+    uint8_t  marked;
+} BootMark;
+
+static BootMark boot_marks[BOOT_PHASE_COUNT];
+static uint8_t  boot_reported;
+
+static const char *const boot_phase_names[BOOT_PHASE_COUNT] = {
+    "main",
+    "hal_init",
+    "clock_config",
+    "gpio_init",
+    "kernel_init",
+    "app_init",
+    "first_sample",
+    "network",
+    "log_channel"
+};
+
+
+/**
+    @brief  Start the cycle counter and stamp main() entry as time zero.
+
+    Call first thing in main().
+ */
+void BootProfileStart(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    BootProfileMark(BOOT_PHASE_MAIN);
+}
+
+
+/**
+    @brief  Stamp the end of a boot phase.
+
+    Only the first call for each phase counts, so it can sit in a loop.
+
+    @param  phase   The phase that just ended.
+ */
+void BootProfileMark(BootPhase phase) {
+    BootMark *mark = &boot_marks[phase];
+    if (mark->marked != 0) return;
+
+    mark->cycles = DWT->CYCCNT;
+    mark->us = TimebaseGetMicros();
+    mark->marked = 1;
+}
+
+
+/**
+    @brief  Log the boot phases, once, when the log channel first opens.
+
+    Line format: #boot "<phase>" <at> <took> <cycles>, where <at> is
+    microseconds since main(), <took> is microseconds since the phase
+    stamped before it, and <cycles> is the cycle count since main(), or
+    '-' once that has wrapped. Phases not reached yet are left out.
+ */
+void BootProfileReport(void) {
+    if (boot_reported != 0) return;
+    boot_reported = 1;
+
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    if (cycles_per_us == 0) cycles_per_us = 1;
+
+    // Microseconds from main() to the start of the microsecond clock
+    uint64_t offset = 0;
+    const BootMark *hal = &boot_marks[BOOT_PHASE_HAL_INIT];
+    if (hal->marked != 0 && hal->cycles / cycles_per_us > hal->us) {
+        offset = hal->cycles / cycles_per_us - hal->us;
+    }
+
+    uint64_t at[BOOT_PHASE_COUNT];
+    for (uint32_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+        at[i] = (i == BOOT_PHASE_MAIN) ? 0 : boot_marks[i].us + offset;
+    }
+
+    char line[80];
+    for (uint32_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (boot_marks[i].marked == 0) continue;
+
+        // Phases need not end in enum order: the first sample can come
+        // before or after the network
+        uint64_t previous = 0;
+        for (uint32_t j = 0; j < BOOT_PHASE_COUNT; j++) {
+            if (j != i && boot_marks[j].marked != 0 && at[j] <= at[i] && at[j] > previous) {
+                previous = at[j];
+            }
+        }
+
+        char cycles[12] = "-";
+        if (at[i] < (uint64_t)UINT32_MAX / cycles_per_us) {
+            snprintf(cycles, sizeof(cycles), "%lu", (unsigned long)boot_marks[i].cycles);
+        }
+
+        snprintf(line, sizeof(line), "#boot \"%s\" %lu %lu %s", boot_phase_names[i],
+                 (unsigned long)at[i], (unsigned long)(at[i] - previous), cycles);
+        ServerLog(line);
+    }
+}
+
+#endif /* APP_ENABLE_BOOT_PROFILE */
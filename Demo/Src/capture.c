@@ -0,0 +1,370 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <string.h>
+
+#include "capture.h"
+
+#if defined(APP_ENABLE_CAPTURE)
+
+#if CAPTURE_SEGMENTS > 255
+#error "Capture segment numbers are 8 bits: shrink the windows or grow CAPTURE_SEGMENT_SAMPLES"
+#endif
+
+#if CAPTURE_SNAPSHOTS > 32
+#error "Each snapshot needs an event flag"
+#endif
+
+/*
+ * Every segment holds CAPTURE_SEGMENT_SAMPLES consecutive samples and
+ * starts at a multiple of that, so sample n is always at n % SEGMENT in
+ * the segment that starts at n - n % SEGMENT. A segment carries a count
+ * of the references to it: one from the history while it is among the
+ * newest, one from the writer while it is being filled, and one from each
+ * snapshot that includes it. At zero it goes back to the free list.
+ *
+ * There is one writer, a thread or an ISR. It fills its segment without
+ * a lock; a snapshot only reads samples before its end, which the writer
+ * has finished with. Segment hand-offs, triggers and releases change the
+ * lists inside a short TX_DISABLE section that never touches the samples.
+ */
+
+typedef enum {
+    CAPTURE_SNAPSHOT_FREE = 0,
+    CAPTURE_SNAPSHOT_FILLING,       // Waiting for post-trigger samples
+    CAPTURE_SNAPSHOT_READY
+} CaptureSnapshotState;
+
+static CaptureSample        capture_samples[CAPTURE_SEGMENTS][CAPTURE_SEGMENT_SAMPLES];
+static uint8_t              capture_refs[CAPTURE_SEGMENTS];
+static uint8_t              capture_free[CAPTURE_SEGMENTS];         // Stack of free segments
+static uint32_t             capture_free_count;
+static uint8_t              capture_history[CAPTURE_HISTORY_SEGMENTS];  // Oldest first
+static uint32_t             capture_history_count;
+static uint8_t              capture_current;                        // Segment being written
+static uint64_t             capture_current_start;                  // ... its first sample number
+static volatile uint64_t    capture_written;
+static CaptureSnapshot      capture_snapshots[CAPTURE_SNAPSHOTS];
+static TX_EVENT_FLAGS_GROUP capture_events;
+static CaptureStats         capture_stats;
+static uint8_t              capture_ready;
+
+
+/*
+ * SEGMENTS
+ *
+ * Call with interrupts disabled
+ */
+
+static void CaptureUnref(uint8_t segment) {
+    if (--capture_refs[segment] == 0) capture_free[capture_free_count++] = segment;
+}
+
+
+/**
+    @brief  Start the next segment. The pool is sized so one is free.
+ */
+static void CaptureOpenSegment(void) {
+    uint8_t segment = capture_free[--capture_free_count];
+    capture_refs[segment] = 1;
+    capture_current = segment;
+
+    // Filling snapshots whose window reaches into it take it too
+    for (uint32_t i = 0; i < CAPTURE_SNAPSHOTS; i++) {
+        CaptureSnapshot *snapshot = &capture_snapshots[i];
+        if (snapshot->state == CAPTURE_SNAPSHOT_FILLING &&
+            capture_current_start < snapshot->first + snapshot->count) {
+            snapshot->segments[snapshot->used++] = segment;
+            capture_refs[segment]++;
+        }
+    }
+}
+
+
+/**
+    @brief  Move the full segment into the history, dropping the oldest,
+            and open the next.
+ */
+static void CaptureNextSegment(void) {
+    if (capture_history_count == CAPTURE_HISTORY_SEGMENTS) {
+        CaptureUnref(capture_history[0]);
+        memmove(capture_history, capture_history + 1, CAPTURE_HISTORY_SEGMENTS - 1U);
+        capture_history_count--;
+    }
+
+    // The writer's reference becomes the history's
+    capture_history[capture_history_count++] = capture_current;
+    capture_current_start += CAPTURE_SEGMENT_SAMPLES;
+    CaptureOpenSegment();
+}
+
+
+/**
+    @brief  Mark the snapshots whose windows are now complete, and wake
+            their waiters.
+
+    @return The event flags to set.
+ */
+static ULONG CaptureCompleted(void) {
+    ULONG flags = 0;
+
+    for (uint32_t i = 0; i < CAPTURE_SNAPSHOTS; i++) {
+        CaptureSnapshot *snapshot = &capture_snapshots[i];
+        if (snapshot->state == CAPTURE_SNAPSHOT_FILLING &&
+            capture_written >= snapshot->first + snapshot->count) {
+            snapshot->state = CAPTURE_SNAPSHOT_READY;
+            flags |= 1UL << i;
+        }
+    }
+
+    return flags;
+}
+
+
+/*
+ * API
+ */
+
+/**
+    @brief  Set up the segment pool and an empty history.
+
+    Call once, from App_ThreadX_Init().
+
+    @return TX_SUCCESS, or the ThreadX error.
+ */
+UINT CaptureInit(void) {
+    UINT status = tx_event_flags_create(&capture_events, "Capture");
+    if (status != TX_SUCCESS) return status;
+
+    for (uint32_t i = 0; i < CAPTURE_SEGMENTS; i++) {
+        capture_free[i] = (uint8_t)(CAPTURE_SEGMENTS - 1U - i);
+    }
+    capture_free_count = CAPTURE_SEGMENTS;
+
+    CaptureOpenSegment();
+    capture_ready = 1;
+    return TX_SUCCESS;
+}
+
+
+/**
+    @brief  Add samples to the history.
+
+    Call from one place only, a thread or an ISR: the acquisition
+    stage. It never blocks, and copies each sample once.
+
+    @param  samples The new samples, oldest first.
+    @param  count   How many.
+ */
+void CaptureWrite(const CaptureSample *samples, uint32_t count) {
+    TX_INTERRUPT_SAVE_AREA
+
+    if (capture_ready == 0) return;
+
+    while (count > 0) {
+        uint32_t offset = (uint32_t)(capture_written - capture_current_start);
+        uint32_t part = CAPTURE_SEGMENT_SAMPLES - offset;
+        if (part > count) part = count;
+
+        memcpy(&capture_samples[capture_current][offset], samples, part * sizeof(CaptureSample));
+        samples += part;
+        count -= part;
+
+        TX_DISABLE
+        capture_written += part;
+        ULONG flags = CaptureCompleted();
+        if (offset + part == CAPTURE_SEGMENT_SAMPLES) CaptureNextSegment();
+        TX_RESTORE
+
+        if (flags != 0) tx_event_flags_set(&capture_events, flags, TX_OR);
+    }
+}
+
+
+/**
+    @brief  Samples written since CaptureInit(): the number the next
+            sample will have.
+ */
+uint64_t CaptureWritten(void) {
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    uint64_t written = capture_written;
+    TX_RESTORE
+
+    return written;
+}
+
+
+/**
+    @brief  Freeze a window of samples around a trigger.
+
+    Takes a reference on the segments that hold the window; the cost
+    does not depend on how many samples it covers. May be called from a
+    thread or an ISR, while earlier snapshots are still held.
+
+    @param  trigger The trigger's sample number, from CaptureWritten().
+                    It may be behind the newest sample, up to
+                    CAPTURE_HISTORY_SAMPLES less the pre window. One
+                    older than the history, or newer than the newest
+                    sample, is moved to the oldest or newest sample.
+    @param  pre     Samples to keep before the trigger. Fewer are kept
+                    if the history does not reach back that far.
+    @param  post    Samples to keep from the trigger on, up to
+                    CAPTURE_POST_MAX.
+
+    @return The snapshot, or NULL if every snapshot is held.
+ */
+CaptureSnapshot *CaptureTrigger(uint64_t trigger, uint32_t pre, uint32_t post) {
+    TX_INTERRUPT_SAVE_AREA
+    CaptureSnapshot *snapshot = NULL;
+    uint32_t index = 0;
+
+    if (capture_ready == 0) return NULL;
+    if (post > CAPTURE_POST_MAX) post = CAPTURE_POST_MAX;
+
+    TX_DISABLE
+    for (index = 0; index < CAPTURE_SNAPSHOTS; index++) {
+        if (capture_snapshots[index].state == CAPTURE_SNAPSHOT_FREE) {
+            snapshot = &capture_snapshots[index];
+            break;
+        }
+    }
+
+    if (snapshot == NULL) {
+        capture_stats.snapshots_refused++;
+        TX_RESTORE
+        return NULL;
+    }
+
+    uint64_t oldest = capture_current_start - (uint64_t)capture_history_count * CAPTURE_SEGMENT_SAMPLES;
+    if (trigger > capture_written) trigger = capture_written;
+    if (trigger < oldest) trigger = oldest;
+
+    uint64_t first = trigger - oldest < pre ? oldest : trigger - pre;
+    uint64_t end = trigger + post;
+
+    snapshot->first = first;
+    snapshot->trigger = trigger;
+    snapshot->count = (uint32_t)(end - first);
+    snapshot->used = 0;
+
+    for (uint32_t i = 0; i < capture_history_count; i++) {
+        uint64_t start = oldest + (uint64_t)i * CAPTURE_SEGMENT_SAMPLES;
+        if (start + CAPTURE_SEGMENT_SAMPLES > first && start < end) {
+            snapshot->segments[snapshot->used++] = capture_history[i];
+            capture_refs[capture_history[i]]++;
+        }
+    }
+
+    // Segments from here on are added as the writer opens them
+    if (capture_current_start < end) {
+        snapshot->segments[snapshot->used++] = capture_current;
+        capture_refs[capture_current]++;
+    }
+
+    snapshot->state = CAPTURE_SNAPSHOT_FILLING;
+    capture_stats.snapshots_taken++;
+    ULONG flags = CaptureCompleted();
+    TX_RESTORE
+
+    // A flag left from the slot's last snapshot must not pass for this one
+    if ((flags & (1UL << index)) == 0) tx_event_flags_set(&capture_events, ~(1UL << index), TX_AND);
+    if (flags != 0) tx_event_flags_set(&capture_events, flags, TX_OR);
+
+    return snapshot;
+}
+
+
+/**
+    @brief  Wait for a snapshot's post-trigger samples.
+
+    @param  snapshot    From CaptureTrigger().
+    @param  wait_option ThreadX ticks, TX_NO_WAIT or TX_WAIT_FOREVER.
+
+    @return TX_SUCCESS once the window is complete, else TX_NO_EVENTS.
+ */
+UINT CaptureWait(CaptureSnapshot *snapshot, ULONG wait_option) {
+    ULONG flag = 1UL << (uint32_t)(snapshot - capture_snapshots);
+    ULONG actual;
+
+    // Consume the flag: a set for an earlier snapshot in this slot that
+    // lands late must not keep waking the wait for this one
+    while (snapshot->state != CAPTURE_SNAPSHOT_READY) {
+        UINT status = tx_event_flags_get(&capture_events, flag, TX_OR_CLEAR, &actual, wait_option);
+        if (status != TX_SUCCESS) return status;
+    }
+
+    return TX_SUCCESS;
+}
+
+
+/**
+    @brief  Get a run of a ready snapshot's samples, in place.
+
+    A window spans several segments, so read it a run at a time:
+
+        for (uint32_t offset = 0, run; offset < snapshot->count; offset += run) {
+            const CaptureSample *samples;
+            run = CaptureSpan(snapshot, offset, &samples);
+            ...
+        }
+
+    @param  snapshot    A snapshot CaptureWait() has returned for.
+    @param  offset      Sample offset in the window.
+    @param  samples     Set to the first sample.
+
+    @return Samples that follow on at samples, or 0 past the end.
+ */
+uint32_t CaptureSpan(const CaptureSnapshot *snapshot, uint32_t offset, const CaptureSample **samples) {
+    if (snapshot->state != CAPTURE_SNAPSHOT_READY || offset >= snapshot->count) return 0;
+
+    uint64_t number = snapshot->first + offset;
+    uint64_t base = snapshot->first / CAPTURE_SEGMENT_SAMPLES;
+    uint32_t segment = snapshot->segments[number / CAPTURE_SEGMENT_SAMPLES - base];
+    uint32_t within = (uint32_t)(number % CAPTURE_SEGMENT_SAMPLES);
+
+    *samples = &capture_samples[segment][within];
+
+    uint32_t run = CAPTURE_SEGMENT_SAMPLES - within;
+    return run < snapshot->count - offset ? run : snapshot->count - offset;
+}
+
+
+/**
+    @brief  Hand a snapshot back, ready or not. Its segments return to
+            the pool once nothing else holds them.
+ */
+void CaptureRelease(CaptureSnapshot *snapshot) {
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    for (uint32_t i = 0; i < snapshot->used; i++) {
+        CaptureUnref(snapshot->segments[i]);
+    }
+    snapshot->used = 0;
+    snapshot->state = CAPTURE_SNAPSHOT_FREE;
+    TX_RESTORE
+}
+
+
+/**
+    @brief  Read the capture counts.
+
+    @param  stats   Filled in with the counts since CaptureInit().
+ */
+void CaptureGetStats(CaptureStats *stats) {
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    *stats = capture_stats;
+    stats->written = capture_written;
+    stats->segments_free = capture_free_count;
+    TX_RESTORE
+}
+
+#endif /* APP_ENABLE_CAPTURE */
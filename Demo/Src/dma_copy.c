@@ -0,0 +1,429 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdbool.h>
+#include <string.h>
+
+#include "dma_copy.h"
+#include "profile.h"
+#include "trace.h"
+#include "stm32u5xx_hal.h"
+
+#if defined(APP_ENABLE_DMA_COPY)
+
+// Handles carry the channel in the low bits and its transfer sequence
+// number above
+#define DMA_COPY_INDEX_BITS         4U
+#define DMA_COPY_INDEX_MASK         ((1UL << DMA_COPY_INDEX_BITS) - 1U)
+#define DMA_COPY_SEQUENCE_MASK      (0xFFFFFFFFUL >> DMA_COPY_INDEX_BITS)
+
+// Largest block one linked-list item moves: BNDT is 16 bits
+#define DMA_COPY_BLOCK_MAX          0xFFFFUL
+
+/*
+ * Each channel runs one submission at a time, as a linked list of up to
+ * DMA_COPY_MAX_NODES items in normal (not circular) mode, and raises its
+ * transfer complete interrupt after the last item. The interrupt records
+ * the sequence number it finished and sets the channel's event flag;
+ * waiters compare their handle's sequence number with it, so a handle
+ * stays valid after the channel has moved on to later transfers.
+ *
+ * Internal SRAM is not behind the data cache, so no cache maintenance is
+ * needed before or after a transfer.
+ */
+typedef struct {
+    DMA_HandleTypeDef   dma;
+    DMA_QListTypeDef    queue;
+    DMA_NodeTypeDef     nodes[DMA_COPY_MAX_NODES];
+    uint32_t            fill;           // Fill pattern: the memset source
+    uint32_t            used;           // Items in the queue
+    volatile uint8_t    busy;
+    volatile uint32_t   submitted;      // Sequence number of the last transfer started,
+    volatile uint32_t   completed;      // ... the last one finished,
+    volatile uint32_t   failed;         // ... and the last one that hit a bus error
+} DmaCopyChannel;
+
+static DmaCopyChannel       dma_copy_channels[DMA_COPY_CHANNELS];
+static TX_EVENT_FLAGS_GROUP dma_copy_events;
+static uint32_t             dma_copy_threshold = DMA_COPY_THRESHOLD;
+
+static DMA_Channel_TypeDef *const dma_copy_instances[DMA_COPY_CHANNELS] = {
+    GPDMA1_Channel12,
+    GPDMA1_Channel13
+};
+
+static const IRQn_Type dma_copy_irqs[DMA_COPY_CHANNELS] = {
+    GPDMA1_Channel12_IRQn,
+    GPDMA1_Channel13_IRQn
+};
+
+
+/**
+    @brief  Transfer finished, or stopped on an error: called from the
+            channel's interrupt through HAL_DMA_IRQHandler().
+ */
+static void DmaCopyFinish(DMA_HandleTypeDef *hdma, bool failed) {
+    DmaCopyChannel *channel = hdma->Parent;
+    uint32_t index = (uint32_t)(channel - dma_copy_channels);
+
+    if (failed) channel->failed = channel->submitted;
+    channel->completed = channel->submitted;
+    channel->busy = 0;
+
+    tx_event_flags_set(&dma_copy_events, 1UL << index, TX_OR);
+}
+
+
+static void DmaCopyComplete(DMA_HandleTypeDef *hdma) {
+    DmaCopyFinish(hdma, false);
+}
+
+
+static void DmaCopyError(DMA_HandleTypeDef *hdma) {
+    DmaCopyFinish(hdma, true);
+}
+
+
+void GPDMA1_Channel12_IRQHandler(void) {
+    PROFILE_ISR_ENTER();
+    TRACE_ISR_ENTER();
+    HAL_DMA_IRQHandler(&dma_copy_channels[0].dma);
+    TRACE_ISR_EXIT();
+    PROFILE_ISR_EXIT();
+}
+
+
+void GPDMA1_Channel13_IRQHandler(void) {
+    PROFILE_ISR_ENTER();
+    TRACE_ISR_ENTER();
+    HAL_DMA_IRQHandler(&dma_copy_channels[1].dma);
+    TRACE_ISR_EXIT();
+    PROFILE_ISR_EXIT();
+}
+
+
+/**
+    @brief  Set up the copy channels.
+
+    Call once, from App_ThreadX_Init().
+
+    @return TX_SUCCESS, the ThreadX error, or TX_NOT_AVAILABLE if a
+            channel could not be configured.
+ */
+UINT DmaCopyInit(void) {
+    UINT status = tx_event_flags_create(&dma_copy_events, "DmaCopy");
+    if (status != TX_SUCCESS) return status;
+
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+    for (uint32_t i = 0; i < DMA_COPY_CHANNELS; i++) {
+        DmaCopyChannel *channel = &dma_copy_channels[i];
+        DMA_HandleTypeDef *dma = &channel->dma;
+
+        dma->Instance = dma_copy_instances[i];
+        dma->Parent = channel;
+        dma->InitLinkedList.Priority = DMA_LOW_PRIORITY_LOW_WEIGHT;
+        dma->InitLinkedList.LinkStepMode = DMA_LSM_FULL_EXECUTION;
+        dma->InitLinkedList.LinkAllocatedPort = DMA_LINK_ALLOCATED_PORT0;
+        dma->InitLinkedList.TransferEventMode = DMA_TCEM_LAST_LL_ITEM_TRANSFER;
+        dma->InitLinkedList.LinkedListMode = DMA_LINKEDLIST_NORMAL;
+
+        if (HAL_DMAEx_List_Init(dma) != HAL_OK ||
+            HAL_DMA_RegisterCallback(dma, HAL_DMA_XFER_CPLT_CB_ID, DmaCopyComplete) != HAL_OK ||
+            HAL_DMA_RegisterCallback(dma, HAL_DMA_XFER_ERROR_CB_ID, DmaCopyError) != HAL_OK) {
+            return TX_NOT_AVAILABLE;
+        }
+
+        HAL_NVIC_SetPriority(dma_copy_irqs[i], DMA_COPY_IRQ_PRIORITY, 0);
+        HAL_NVIC_EnableIRQ(dma_copy_irqs[i]);
+    }
+
+    return TX_SUCCESS;
+}
+
+
+/**
+    @brief  Change the size below which copies stay on the CPU.
+
+    @param  bytes   The new threshold.
+ */
+void DmaCopySetThreshold(uint32_t bytes) {
+    dma_copy_threshold = bytes;
+}
+
+
+/**
+    @brief  Take a free channel, with an empty queue.
+
+    @return The channel, or NULL if all are busy.
+ */
+static DmaCopyChannel *DmaCopyClaim(void) {
+    TX_INTERRUPT_SAVE_AREA
+    DmaCopyChannel *channel = NULL;
+
+    TX_DISABLE
+    for (uint32_t i = 0; i < DMA_COPY_CHANNELS; i++) {
+        if (dma_copy_channels[i].busy == 0) {
+            channel = &dma_copy_channels[i];
+            channel->busy = 1;
+            break;
+        }
+    }
+    TX_RESTORE
+
+    if (channel == NULL) return NULL;
+
+    // The previous transfer's queue is still linked to the channel
+    if (channel->dma.LinkedListQueue != NULL) HAL_DMAEx_List_UnLinkQ(&channel->dma);
+    if (channel->queue.Head != NULL) HAL_DMAEx_List_ResetQ(&channel->queue);
+    channel->used = 0;
+    return channel;
+}
+
+
+/**
+    @brief  Hand a claimed channel back unused.
+ */
+static void DmaCopyRelease(DmaCopyChannel *channel) {
+    channel->busy = 0;
+}
+
+
+/**
+    @brief  Queue one segment, split into as many items as its length needs.
+
+    The data width is the widest that the addresses and length allow:
+    word copies move four times as much per bus transfer as byte copies.
+    Word items also use 4-beat bursts; the GPDMA splits any burst that
+    would cross a 1KB boundary itself.
+
+    @param  channel     A claimed channel.
+    @param  dst         Destination address.
+    @param  src         Source address; with fixed set, read every time.
+    @param  length      Bytes to move.
+    @param  fixed       Whether the source address stays put (memset).
+
+    @return true, or false if the channel has run out of items.
+ */
+static bool DmaCopyQueue(DmaCopyChannel *channel, uint32_t dst, uint32_t src, uint32_t length, bool fixed) {
+    uint32_t alignment = dst | length | (fixed ? 0U : src);
+    uint32_t width = (alignment & 3U) == 0 ? 4U : ((alignment & 1U) == 0 ? 2U : 1U);
+
+    DMA_NodeConfTypeDef conf = { 0 };
+    conf.NodeType = DMA_GPDMA_LINEAR_NODE;
+    conf.Init.Request = DMA_REQUEST_SW;
+    conf.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+    conf.Init.Direction = DMA_MEMORY_TO_MEMORY;
+    conf.Init.SrcInc = fixed ? DMA_SINC_FIXED : DMA_SINC_INCREMENTED;
+    conf.Init.DestInc = DMA_DINC_INCREMENTED;
+    conf.Init.SrcDataWidth = width == 4U ? DMA_SRC_DATAWIDTH_WORD
+                           : (width == 2U ? DMA_SRC_DATAWIDTH_HALFWORD : DMA_SRC_DATAWIDTH_BYTE);
+    conf.Init.DestDataWidth = width == 4U ? DMA_DEST_DATAWIDTH_WORD
+                            : (width == 2U ? DMA_DEST_DATAWIDTH_HALFWORD : DMA_DEST_DATAWIDTH_BYTE);
+    conf.Init.SrcBurstLength = width == 4U ? 4U : 1U;
+    conf.Init.DestBurstLength = conf.Init.SrcBurstLength;
+    conf.Init.Priority = DMA_LOW_PRIORITY_LOW_WEIGHT;
+    conf.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT1;
+    conf.Init.TransferEventMode = DMA_TCEM_LAST_LL_ITEM_TRANSFER;
+    conf.Init.Mode = DMA_NORMAL;
+    conf.DataHandlingConfig.DataExchange = DMA_EXCHANGE_NONE;
+    conf.DataHandlingConfig.DataAlignment = DMA_DATA_RIGHTALIGN_ZEROPADDED;
+    conf.TriggerConfig.TriggerPolarity = DMA_TRIG_POLARITY_MASKED;
+
+    uint32_t block_max = DMA_COPY_BLOCK_MAX & ~(width - 1U);
+    while (length > 0) {
+        if (channel->used == DMA_COPY_MAX_NODES) return false;
+
+        uint32_t block = length < block_max ? length : block_max;
+        conf.SrcAddress = src;
+        conf.DstAddress = dst;
+        conf.DataSize = block;
+
+        DMA_NodeTypeDef *node = &channel->nodes[channel->used];
+        if (HAL_DMAEx_List_BuildNode(&conf, node) != HAL_OK ||
+            HAL_DMAEx_List_InsertNode_Tail(&channel->queue, node) != HAL_OK) {
+            return false;
+        }
+
+        channel->used++;
+        dst += block;
+        if (!fixed) src += block;
+        length -= block;
+    }
+
+    return true;
+}
+
+
+/**
+    @brief  Start the queued items.
+
+    @return The handle, or DMA_COPY_DONE if the channel would not start,
+            in which case nothing was moved and the channel is released.
+ */
+static DmaCopyHandle DmaCopyStart(DmaCopyChannel *channel) {
+    uint32_t index = (uint32_t)(channel - dma_copy_channels);
+
+    uint32_t sequence = (channel->submitted + 1U) & DMA_COPY_SEQUENCE_MASK;
+    if (sequence == 0) sequence = 1;
+
+    tx_event_flags_set(&dma_copy_events, ~(1UL << index), TX_AND);
+    channel->submitted = sequence;
+
+    if (HAL_DMAEx_List_LinkQ(&channel->dma, &channel->queue) != HAL_OK ||
+        HAL_DMAEx_List_Start_IT(&channel->dma) != HAL_OK) {
+        channel->completed = sequence;
+        DmaCopyRelease(channel);
+        return DMA_COPY_DONE;
+    }
+
+    return (sequence << DMA_COPY_INDEX_BITS) | index;
+}
+
+
+/**
+    @brief  Copy memory in the background.
+
+    The buffers must not be touched until DmaCopyWait() returns for the
+    handle. Copies where the two addresses differ in alignment run byte
+    by byte, so keep large buffers word aligned.
+
+    @param  dst     Destination.
+    @param  src     Source; must not overlap the destination.
+    @param  length  Bytes to copy.
+
+    @return The handle to wait on, or DMA_COPY_DONE if the copy was
+            done on the CPU.
+ */
+DmaCopyHandle DmaCopyMemcpy(void *dst, const void *src, uint32_t length) {
+    const DmaCopySegment segment = { dst, src, length };
+    return DmaCopyGather(&segment, 1);
+}
+
+
+/**
+    @brief  Fill memory in the background.
+
+    Any bytes before the first word boundary or after the last are
+    filled on the CPU; the DMA fills whole words between.
+
+    @param  dst     Destination.
+    @param  value   The byte to fill with.
+    @param  length  Bytes to fill.
+
+    @return The handle to wait on, or DMA_COPY_DONE if the fill was
+            done on the CPU.
+ */
+DmaCopyHandle DmaCopyMemset(void *dst, uint8_t value, uint32_t length) {
+    uint8_t *bytes = dst;
+    uint32_t head = (uint32_t)(-(uintptr_t)bytes) & 3U;
+    if (head > length) head = length;
+    uint32_t middle = (length - head) & ~3U;
+    uint32_t tail = length - head - middle;
+
+    DmaCopyChannel *channel = middle >= dma_copy_threshold ? DmaCopyClaim() : NULL;
+    if (channel == NULL) {
+        memset(dst, value, length);
+        return DMA_COPY_DONE;
+    }
+
+    memset(bytes, value, head);
+    memset(bytes + head + middle, value, tail);
+
+    channel->fill = value * 0x01010101UL;
+    if (!DmaCopyQueue(channel, (uint32_t)(bytes + head), (uint32_t)&channel->fill, middle, true)) {
+        DmaCopyRelease(channel);
+        memset(bytes + head, value, middle);
+        return DMA_COPY_DONE;
+    }
+
+    DmaCopyHandle handle = DmaCopyStart(channel);
+    if (handle == DMA_COPY_DONE) memset(bytes + head, value, middle);
+    return handle;
+}
+
+
+/**
+    @brief  Scatter/gather copy: several segments as one transfer with
+            one handle.
+
+    Segments over 64KB take more than one of the channel's
+    DMA_COPY_MAX_NODES items; a transfer that needs more than that is
+    done on the CPU.
+
+    @param  segments    The pieces to copy, in order.
+    @param  count       How many.
+
+    @return The handle to wait on, or DMA_COPY_DONE if the copy was
+            done on the CPU.
+ */
+DmaCopyHandle DmaCopyGather(const DmaCopySegment *segments, uint32_t count) {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        total += segments[i].length;
+    }
+
+    DmaCopyChannel *channel = total >= dma_copy_threshold ? DmaCopyClaim() : NULL;
+    if (channel != NULL) {
+        bool queued = true;
+        for (uint32_t i = 0; i < count && queued; i++) {
+            const DmaCopySegment *segment = &segments[i];
+            if (segment->length == 0) continue;
+            queued = DmaCopyQueue(channel, (uint32_t)segment->dst, (uint32_t)segment->src, segment->length, false);
+        }
+
+        if (queued) {
+            DmaCopyHandle handle = DmaCopyStart(channel);
+            if (handle != DMA_COPY_DONE) return handle;
+        } else {
+            DmaCopyRelease(channel);
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        memcpy(segments[i].dst, segments[i].src, segments[i].length);
+    }
+    return DMA_COPY_DONE;
+}
+
+
+/**
+    @brief  Wait for a transfer to finish.
+
+    Any number of threads may wait on the same handle. Only the most
+    recent failure on each channel is remembered, so check a handle
+    before submitting much more work.
+
+    @param  handle          From DmaCopyMemcpy(), DmaCopyMemset() or
+                            DmaCopyGather().
+    @param  wait_option     ThreadX ticks to wait, TX_NO_WAIT to poll or
+                            TX_WAIT_FOREVER.
+
+    @return TX_SUCCESS once the data has moved, TX_NO_EVENTS on timeout,
+            TX_NOT_DONE if the transfer stopped on a bus error, or
+            TX_PTR_ERROR if the handle names no channel.
+ */
+UINT DmaCopyWait(DmaCopyHandle handle, ULONG wait_option) {
+    if (handle == DMA_COPY_DONE) return TX_SUCCESS;
+
+    uint32_t index = handle & DMA_COPY_INDEX_MASK;
+    uint32_t sequence = handle >> DMA_COPY_INDEX_BITS;
+    if (index >= DMA_COPY_CHANNELS) return TX_PTR_ERROR;
+
+    DmaCopyChannel *channel = &dma_copy_channels[index];
+
+    // Done once the channel has finished this or a later sequence number
+    while (((channel->completed - sequence) & DMA_COPY_SEQUENCE_MASK) > (DMA_COPY_SEQUENCE_MASK >> 1)) {
+        ULONG actual;
+        UINT status = tx_event_flags_get(&dma_copy_events, 1UL << index, TX_OR, &actual, wait_option);
+        if (status != TX_SUCCESS) return status;
+    }
+
+    return channel->failed == sequence ? TX_NOT_DONE : TX_SUCCESS;
+}
+
+#endif /* APP_ENABLE_DMA_COPY */
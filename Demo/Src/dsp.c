@@ -0,0 +1,585 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <string.h>
+
+#include "dsp.h"
+
+#if defined(APP_ENABLE_DSP_ACCEL)
+#include "profile.h"
+#include "trace.h"
+#include "stm32u5xx_hal.h"
+#endif
+
+// Software CORDIC: iterations, atan(2^-i) as q1.31 fractions of pi, and
+// the reciprocal of the gain the iterations add, in q1.31
+#define DSP_CORDIC_ITERATIONS       24
+#define DSP_CORDIC_GAIN_INV         1304065748L
+
+// Vector inputs are scaled up this far for the iterations, leaving room
+// for the CORDIC gain and a full scale diagonal
+#define DSP_VECTOR_SHIFT            14
+
+static const int32_t dsp_atan_table[DSP_CORDIC_ITERATIONS] = {
+    536870912, 316933406, 167458907, 85004756, 42667331, 21354465,
+    10679838, 5340245, 2670163, 1335087, 667544, 333772,
+    166886, 83443, 41722, 20861, 10430, 5215,
+    2608, 1304, 652, 326, 163, 81
+};
+
+
+/*
+ * PORTABLE KERNELS
+ */
+
+static int16_t DspSaturate(int64_t value) {
+    if (value > INT16_MAX) return INT16_MAX;
+    if (value < INT16_MIN) return INT16_MIN;
+    return (int16_t)value;
+}
+
+
+/**
+    @brief  Filter a block in C, reading the history for samples before
+            the block's first.
+ */
+static void DspFilterSoftware(const DspFilter *filter, const int16_t *in, int16_t *out, uint16_t count) {
+    int32_t taps_b = filter->taps_b;
+    int32_t taps_a = filter->taps_a;
+
+    for (int32_t n = 0; n < count; n++) {
+        int64_t acc = 0;
+
+        for (int32_t k = 0; k < taps_b; k++) {
+            int32_t i = n - k;
+            int16_t x = i >= 0 ? in[i] : filter->x_history[taps_b - 1 + i];
+            acc += (int32_t)filter->b[k] * x;
+        }
+
+        for (int32_t k = 0; k < taps_a; k++) {
+            int32_t i = n - k - 1;
+            int16_t y = i >= 0 ? out[i] : filter->y_history[taps_a + i];
+            acc += (int32_t)filter->a[k] * y;
+        }
+
+        out[n] = DspSaturate(acc >> (15 - filter->gain_shift));
+    }
+}
+
+
+/**
+    @brief  Keep the last samples of a block for the next one.
+
+    @param  history     taps samples, oldest first.
+    @param  block       The block's samples.
+ */
+static void DspHistoryUpdate(int16_t *history, uint32_t taps, const int16_t *block, uint16_t count) {
+    if (taps == 0) return;
+
+    if (count >= taps) {
+        memcpy(history, block + count - taps, taps * sizeof(int16_t));
+    } else {
+        memmove(history, history + count, (taps - count) * sizeof(int16_t));
+        memcpy(history + taps - count, block, count * sizeof(int16_t));
+    }
+}
+
+
+/**
+    @brief  Angle and length of a vector, by CORDIC in vectoring mode.
+
+    @param  magnitude   Set to the length, in input units.
+
+    @return The angle.
+ */
+static int32_t DspVectorSoftware(int16_t x, int16_t y, uint32_t *magnitude) {
+    if (x == 0 && y == 0) {
+        *magnitude = 0;
+        return 0;
+    }
+
+    int32_t vx = (int32_t)x * (1L << DSP_VECTOR_SHIFT);
+    int32_t vy = (int32_t)y * (1L << DSP_VECTOR_SHIFT);
+    uint32_t angle = 0;
+
+    // The iterations converge for -90 to +90 degrees: start the left half
+    // plane half a turn round
+    if (vx < 0) {
+        vx = -vx;
+        vy = -vy;
+        angle = 0x80000000UL;
+    }
+
+    for (uint32_t i = 0; i < DSP_CORDIC_ITERATIONS; i++) {
+        int32_t dx = vx >> i;
+        int32_t dy = vy >> i;
+
+        if (vy > 0) {
+            vx += dy;
+            vy -= dx;
+            angle += (uint32_t)dsp_atan_table[i];
+        } else {
+            vx -= dy;
+            vy += dx;
+            angle -= (uint32_t)dsp_atan_table[i];
+        }
+    }
+
+    *magnitude = (uint32_t)(((uint64_t)vx * DSP_CORDIC_GAIN_INV) >> (31 + DSP_VECTOR_SHIFT));
+    return (int32_t)angle;
+}
+
+
+/**
+    @brief  Integer square root, rounded down.
+ */
+static uint32_t DspIsqrt(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value) bit >>= 2;
+
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
+
+
+#if defined(APP_ENABLE_DSP_ACCEL)
+/*
+ * ACCELERATORS
+ *
+ * Each unit is taken for a whole call and never waited for: a call that
+ * finds it taken runs in C instead. The CORDIC is driven through its
+ * registers, as the HAL's per-call setup would cost more than the
+ * calculation. The FMAC streams a block in and out by DMA, on GPDMA1
+ * channels 10 and 11, after the filter's coefficients and history are
+ * loaded, so any number of filters can share it.
+ */
+
+// FMAC local memory beyond the filter's own needs, for each of X1 and Y
+#define DSP_FMAC_HEADROOM           4
+
+#define DSP_CORDIC_CSR_32BIT        (CORDIC_PRECISION_6CYCLES | CORDIC_INSIZE_32BITS | CORDIC_OUTSIZE_32BITS)
+
+static FMAC_HandleTypeDef   dsp_fmac;
+static DMA_HandleTypeDef    dsp_fmac_dma_in;
+static DMA_HandleTypeDef    dsp_fmac_dma_out;
+static TX_SEMAPHORE         dsp_fmac_done;
+static volatile uint8_t     dsp_fmac_failed;
+static volatile uint8_t     dsp_fmac_busy;
+static volatile uint8_t     dsp_cordic_busy;
+static uint8_t              dsp_ready;
+
+
+/**
+    @brief  Take a unit, if it is free.
+ */
+static bool DspClaim(volatile uint8_t *busy) {
+    TX_INTERRUPT_SAVE_AREA
+    bool claimed = false;
+
+    TX_DISABLE
+    if (dsp_ready != 0 && *busy == 0) {
+        *busy = 1;
+        claimed = true;
+    }
+    TX_RESTORE
+
+    return claimed;
+}
+
+
+static void DspRelease(volatile uint8_t *busy) {
+    *busy = 0;
+}
+
+
+void HAL_FMAC_OutputDataReadyCallback(FMAC_HandleTypeDef *hfmac) {
+    (void)hfmac;
+    tx_semaphore_put(&dsp_fmac_done);
+}
+
+
+void HAL_FMAC_ErrorCallback(FMAC_HandleTypeDef *hfmac) {
+    (void)hfmac;
+    dsp_fmac_failed = 1;
+    tx_semaphore_put(&dsp_fmac_done);
+}
+
+
+void FMAC_IRQHandler(void) {
+    PROFILE_ISR_ENTER();
+    TRACE_ISR_ENTER();
+    HAL_FMAC_IRQHandler(&dsp_fmac);
+    TRACE_ISR_EXIT();
+    PROFILE_ISR_EXIT();
+}
+
+
+void GPDMA1_Channel10_IRQHandler(void) {
+    PROFILE_ISR_ENTER();
+    TRACE_ISR_ENTER();
+    HAL_DMA_IRQHandler(&dsp_fmac_dma_in);
+    TRACE_ISR_EXIT();
+    PROFILE_ISR_EXIT();
+}
+
+
+void GPDMA1_Channel11_IRQHandler(void) {
+    PROFILE_ISR_ENTER();
+    TRACE_ISR_ENTER();
+    HAL_DMA_IRQHandler(&dsp_fmac_dma_out);
+    TRACE_ISR_EXIT();
+    PROFILE_ISR_EXIT();
+}
+
+
+/**
+    @brief  Set up a DMA channel to feed or drain the FMAC, a half word
+            at a time.
+ */
+static HAL_StatusTypeDef DspFmacDmaInit(DMA_HandleTypeDef *dma, DMA_Channel_TypeDef *instance,
+                                        uint32_t request, bool to_fmac) {
+    dma->Instance = instance;
+    dma->Init.Request = request;
+    dma->Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+    dma->Init.Direction = to_fmac ? DMA_MEMORY_TO_PERIPH : DMA_PERIPH_TO_MEMORY;
+    dma->Init.SrcInc = to_fmac ? DMA_SINC_INCREMENTED : DMA_SINC_FIXED;
+    dma->Init.DestInc = to_fmac ? DMA_DINC_FIXED : DMA_DINC_INCREMENTED;
+    dma->Init.SrcDataWidth = DMA_SRC_DATAWIDTH_HALFWORD;
+    dma->Init.DestDataWidth = DMA_DEST_DATAWIDTH_HALFWORD;
+    dma->Init.Priority = DMA_HIGH_PRIORITY;
+    dma->Init.SrcBurstLength = 1;
+    dma->Init.DestBurstLength = 1;
+    dma->Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT0;
+    dma->Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+    dma->Init.Mode = DMA_NORMAL;
+    return HAL_DMA_Init(dma);
+}
+
+
+/**
+    @brief  Bring up the FMAC, its DMA channels and the CORDIC.
+
+    Call once, from App_ThreadX_Init(). Until it has succeeded every
+    call runs in C.
+
+    @return TX_SUCCESS, the ThreadX error, or TX_NOT_AVAILABLE if a
+            unit could not be configured.
+ */
+UINT DspInit(void) {
+    UINT status = tx_semaphore_create(&dsp_fmac_done, "DspFmac", 0);
+    if (status != TX_SUCCESS) return status;
+
+    __HAL_RCC_FMAC_CLK_ENABLE();
+    __HAL_RCC_CORDIC_CLK_ENABLE();
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+    dsp_fmac.Instance = FMAC;
+    if (HAL_FMAC_Init(&dsp_fmac) != HAL_OK ||
+        DspFmacDmaInit(&dsp_fmac_dma_in, GPDMA1_Channel10, GPDMA1_REQUEST_FMAC_WRITE, true) != HAL_OK ||
+        DspFmacDmaInit(&dsp_fmac_dma_out, GPDMA1_Channel11, GPDMA1_REQUEST_FMAC_READ, false) != HAL_OK) {
+        return TX_NOT_AVAILABLE;
+    }
+
+    __HAL_LINKDMA(&dsp_fmac, hdmaIn, dsp_fmac_dma_in);
+    __HAL_LINKDMA(&dsp_fmac, hdmaOut, dsp_fmac_dma_out);
+
+    HAL_NVIC_SetPriority(FMAC_IRQn, DSP_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(FMAC_IRQn);
+    HAL_NVIC_SetPriority(GPDMA1_Channel10_IRQn, DSP_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(GPDMA1_Channel10_IRQn);
+    HAL_NVIC_SetPriority(GPDMA1_Channel11_IRQn, DSP_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(GPDMA1_Channel11_IRQn);
+
+    dsp_ready = 1;
+    return TX_SUCCESS;
+}
+
+
+/**
+    @brief  Whether the FMAC can run this filter: FIR needs at least two
+            taps, IIR fewer feedback than feed-forward coefficients.
+ */
+static bool DspFmacSupports(const DspFilter *filter) {
+    if (filter->taps_b < 2) return false;
+    return filter->taps_a == 0 || filter->taps_a < filter->taps_b;
+}
+
+
+/**
+    @brief  Filter a block on the FMAC.
+
+    @return true, or false if the FMAC was busy, would not take the
+            filter or did not finish; the block then needs doing in C.
+ */
+static bool DspFilterFmac(DspFilter *filter, const int16_t *in, int16_t *out, uint16_t count) {
+    // Waits for the DMA, so threads only
+    if (!DspFmacSupports(filter) || tx_thread_identify() == TX_NULL) return false;
+    if (!DspClaim(&dsp_fmac_busy)) return false;
+
+    uint8_t p = filter->taps_b;
+    uint8_t q = filter->taps_a;
+
+    FMAC_FilterConfigTypeDef config = { 0 };
+    config.CoeffBaseAddress = 0;
+    config.CoeffBufferSize = p + q;
+    config.InputBaseAddress = p + q;
+    config.InputBufferSize = p + DSP_FMAC_HEADROOM;
+    config.InputThreshold = FMAC_THRESHOLD_1;
+    config.OutputBaseAddress = 2 * p + q + DSP_FMAC_HEADROOM;
+    config.OutputBufferSize = q + DSP_FMAC_HEADROOM;
+    config.OutputThreshold = FMAC_THRESHOLD_1;
+    config.pCoeffB = (int16_t *)filter->b;
+    config.CoeffBSize = p;
+    config.pCoeffA = q != 0 ? (int16_t *)filter->a : NULL;
+    config.CoeffASize = q;
+    config.InputAccess = FMAC_BUFFER_ACCESS_DMA;
+    config.OutputAccess = FMAC_BUFFER_ACCESS_DMA;
+    config.Clip = FMAC_CLIP_ENABLED;
+    config.Filter = q == 0 ? FMAC_FUNC_CONVO_FIR : FMAC_FUNC_IIR_DIRECT_FORM_1;
+    config.P = p;
+    config.Q = q;
+    config.R = filter->gain_shift;
+
+    // Sized here, read by the HAL until the filter is stopped below
+    uint16_t out_size = count;
+    uint16_t in_size = count;
+    bool done = false;
+
+    dsp_fmac_failed = 0;
+    if (HAL_FMAC_FilterConfig(&dsp_fmac, &config) == HAL_OK &&
+        HAL_FMAC_FilterPreload(&dsp_fmac, filter->x_history, p - 1,
+                               q != 0 ? filter->y_history : NULL, q) == HAL_OK &&
+        HAL_FMAC_FilterStart(&dsp_fmac, out, &out_size) == HAL_OK &&
+        HAL_FMAC_AppendFilterData(&dsp_fmac, (int16_t *)in, &in_size) == HAL_OK) {
+        done = tx_semaphore_get(&dsp_fmac_done, DSP_FMAC_TIMEOUT_TICKS) == TX_SUCCESS && dsp_fmac_failed == 0;
+    }
+
+    HAL_FMAC_FilterStop(&dsp_fmac);
+
+    // A completion that raced the timeout must not satisfy the next call
+    while (tx_semaphore_get(&dsp_fmac_done, TX_NO_WAIT) == TX_SUCCESS) {
+    }
+
+    DspRelease(&dsp_fmac_busy);
+    return done;
+}
+#endif /* APP_ENABLE_DSP_ACCEL */
+
+
+/*
+ * API
+ */
+
+/**
+    @brief  Set up a filter, with zero history.
+
+    The coefficient arrays are not copied and must outlive the filter.
+
+    @param  filter      The filter to set up.
+    @param  b           taps_b feed-forward coefficients, b[0] for the
+                        newest sample.
+    @param  a           taps_a feedback coefficients, a[0] for the newest
+                        output; NULL for FIR.
+    @param  gain_shift  Output gain as a power of two, 0 to 7.
+
+    @return true, or false if the filter is too long.
+ */
+bool DspFilterInit(DspFilter *filter, const int16_t *b, uint8_t taps_b,
+                   const int16_t *a, uint8_t taps_a, uint8_t gain_shift) {
+    if (taps_b == 0 || taps_b > DSP_FILTER_MAX_B || taps_a > DSP_FILTER_MAX_A || gain_shift > 7) {
+        return false;
+    }
+
+    filter->b = b;
+    filter->a = a;
+    filter->taps_b = taps_b;
+    filter->taps_a = a != NULL ? taps_a : 0;
+    filter->gain_shift = gain_shift;
+    DspFilterReset(filter);
+    return true;
+}
+
+
+/**
+    @brief  Clear a filter's history, as if it had been fed zeros.
+ */
+void DspFilterReset(DspFilter *filter) {
+    memset(filter->x_history, 0, sizeof(filter->x_history));
+    memset(filter->y_history, 0, sizeof(filter->y_history));
+}
+
+
+/**
+    @brief  Filter a block of samples, carrying on from the last block.
+
+    @param  filter  The filter.
+    @param  in      count samples in; must not overlap out.
+    @param  out     count samples out.
+    @param  count   Samples in the block.
+ */
+void DspFilterRun(DspFilter *filter, const int16_t *in, int16_t *out, uint16_t count) {
+    if (count == 0) return;
+
+#if defined(APP_ENABLE_DSP_ACCEL)
+    if (!DspFilterFmac(filter, in, out, count))
+#endif
+    {
+        DspFilterSoftware(filter, in, out, count);
+    }
+
+    DspHistoryUpdate(filter->x_history, filter->taps_b - 1U, in, count);
+    DspHistoryUpdate(filter->y_history, filter->taps_a, out, count);
+}
+
+
+/**
+    @brief  Angle of the vector (x, y) from the x axis: atan2(y, x).
+
+    For a magnetometer in the horizontal plane, the heading.
+
+    @return The angle, 0 for a zero vector.
+ */
+int32_t DspAtan2(int16_t y, int16_t x) {
+#if defined(APP_ENABLE_DSP_ACCEL)
+    if (DspClaim(&dsp_cordic_busy)) {
+        // Inputs at half scale keep the modulus below one
+        CORDIC->CSR = CORDIC_FUNCTION_PHASE | DSP_CORDIC_CSR_32BIT | CORDIC_SCALE_0 |
+                      CORDIC_NBWRITE_2 | CORDIC_NBREAD_1;
+        CORDIC->WDATA = (uint32_t)((int32_t)x * 32768);
+        CORDIC->WDATA = (uint32_t)((int32_t)y * 32768);
+        int32_t angle = (int32_t)CORDIC->RDATA;
+        DspRelease(&dsp_cordic_busy);
+        return angle;
+    }
+#endif
+
+    uint32_t magnitude;
+    return DspVectorSoftware(x, y, &magnitude);
+}
+
+
+/**
+    @brief  Length of the vector (x, y), in input units.
+ */
+uint32_t DspMagnitude2(int16_t x, int16_t y) {
+#if defined(APP_ENABLE_DSP_ACCEL)
+    if (DspClaim(&dsp_cordic_busy)) {
+        CORDIC->CSR = CORDIC_FUNCTION_MODULUS | DSP_CORDIC_CSR_32BIT | CORDIC_SCALE_0 |
+                      CORDIC_NBWRITE_2 | CORDIC_NBREAD_1;
+        CORDIC->WDATA = (uint32_t)((int32_t)x * 32768);
+        CORDIC->WDATA = (uint32_t)((int32_t)y * 32768);
+        uint32_t modulus = CORDIC->RDATA;
+        DspRelease(&dsp_cordic_busy);
+        return modulus >> 15;
+    }
+#endif
+
+    return DspIsqrt((uint64_t)((int32_t)x * x) + (uint64_t)((int32_t)y * y));
+}
+
+
+/**
+    @brief  Length of the vector (x, y, z), in input units: for a
+            magnetometer, the field strength.
+ */
+uint32_t DspMagnitude3(int16_t x, int16_t y, int16_t z) {
+#if defined(APP_ENABLE_DSP_ACCEL)
+    if (DspClaim(&dsp_cordic_busy)) {
+        // |(x, y, z)| = |(|(x, y)|, z)|, all at half scale, so under 0.87
+        CORDIC->CSR = CORDIC_FUNCTION_MODULUS | DSP_CORDIC_CSR_32BIT | CORDIC_SCALE_0 |
+                      CORDIC_NBWRITE_2 | CORDIC_NBREAD_1;
+        CORDIC->WDATA = (uint32_t)((int32_t)x * 32768);
+        CORDIC->WDATA = (uint32_t)((int32_t)y * 32768);
+        CORDIC->WDATA = CORDIC->RDATA;
+        CORDIC->WDATA = (uint32_t)((int32_t)z * 32768);
+        uint32_t modulus = CORDIC->RDATA;
+        DspRelease(&dsp_cordic_busy);
+        return modulus >> 15;
+    }
+#endif
+
+    return DspIsqrt((uint64_t)((int32_t)x * x) + (uint64_t)((int32_t)y * y) + (uint64_t)((int32_t)z * z));
+}
+
+
+/**
+    @brief  Angle and length of many vectors in one go.
+
+    @param  x, y        count vector components.
+    @param  angle       count angles out, as DspAtan2().
+    @param  magnitude   count lengths out, as DspMagnitude2().
+    @param  count       Vectors to convert.
+ */
+void DspPolar(const int16_t *x, const int16_t *y, int32_t *angle, uint32_t *magnitude, uint32_t count) {
+#if defined(APP_ENABLE_DSP_ACCEL)
+    if (DspClaim(&dsp_cordic_busy)) {
+        CORDIC->CSR = CORDIC_FUNCTION_PHASE | DSP_CORDIC_CSR_32BIT | CORDIC_SCALE_0 |
+                      CORDIC_NBWRITE_2 | CORDIC_NBREAD_2;
+        for (uint32_t i = 0; i < count; i++) {
+            CORDIC->WDATA = (uint32_t)((int32_t)x[i] * 32768);
+            CORDIC->WDATA = (uint32_t)((int32_t)y[i] * 32768);
+            angle[i] = (int32_t)CORDIC->RDATA;
+            magnitude[i] = CORDIC->RDATA >> 15;
+        }
+        DspRelease(&dsp_cordic_busy);
+        return;
+    }
+#endif
+
+    for (uint32_t i = 0; i < count; i++) {
+        angle[i] = DspVectorSoftware(x[i], y[i], &magnitude[i]);
+    }
+}
+
+
+/**
+    @brief  Square root of a q1.31 value from 0 to just under 1.
+
+    @return The root, in q1.31; 0 for a negative value.
+ */
+int32_t DspSqrt(int32_t x) {
+    if (x <= 0) return 0;
+
+#if defined(APP_ENABLE_DSP_ACCEL)
+    if (DspClaim(&dsp_cordic_busy)) {
+        // The CORDIC takes 0.027 to 0.75 at scale 0 and 0.75 to 1.75,
+        // halved, at scale 1: shift small values up by an even amount
+        // into 0.25 to 1, and the root back down by half that
+        uint32_t shift = (uint32_t)__builtin_clz((uint32_t)x) - 1U;
+        shift &= ~1U;
+        int32_t scaled = (int32_t)((uint32_t)x << shift);
+
+        int32_t root;
+        if (scaled < 0x60000000L) {
+            CORDIC->CSR = CORDIC_FUNCTION_SQUAREROOT | DSP_CORDIC_CSR_32BIT | CORDIC_SCALE_0 |
+                          CORDIC_NBWRITE_1 | CORDIC_NBREAD_1;
+            CORDIC->WDATA = (uint32_t)scaled;
+            root = (int32_t)CORDIC->RDATA;
+        } else {
+            CORDIC->CSR = CORDIC_FUNCTION_SQUAREROOT | DSP_CORDIC_CSR_32BIT | CORDIC_SCALE_1 |
+                          CORDIC_NBWRITE_1 | CORDIC_NBREAD_1;
+            CORDIC->WDATA = (uint32_t)(scaled / 2);
+            root = (int32_t)CORDIC->RDATA * 2;
+        }
+        DspRelease(&dsp_cordic_busy);
+        return root >> (shift / 2U);
+    }
+#endif
+
+    return (int32_t)DspIsqrt((uint64_t)x << 31);
+}
@@ -0,0 +1,619 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <string.h>
+
+#include "flash_log.h"
+#include "frame.h"
+#include "icache.h"
+
+#if defined(APP_ENABLE_FLASH_LOG)
+
+/*
+ * Flash programs a quad-word (16 bytes) at a time, once per erase, so
+ * everything is laid out in quad-words, each with its own check:
+ *
+ *   page      header    magic, page sequence, erase count, check
+ *             drained   the same with the drained magic, programmed once
+ *                       every record in the page has been read
+ *             records   ...
+ *   record    header    magic, length, type, record sequence, check
+ *             payload   padded with 0xFF to whole quad-words
+ *             commit    magic, record sequence, payload CRC, check
+ *
+ * Quad-words are programmed in order and a record's commit goes last, so
+ * power lost part way through leaves a record without a valid commit,
+ * which readers step over a quad-word at a time until the next header.
+ * New records go after the last quad-word that is not blank, never over
+ * one that was only partly programmed.
+ *
+ * Pages are used in sequence order, not address order: a new page is the
+ * free or drained one erased the fewest times, which levels the wear. If
+ * none is free, the oldest unread page is dropped.
+ */
+
+#define FLASH_LOG_QUAD              16U
+#define FLASH_LOG_BURST             (8U * FLASH_LOG_QUAD)
+#define FLASH_LOG_DATA_OFFSET       (2U * FLASH_LOG_QUAD)
+
+#define FLASH_LOG_PAGE_MAGIC        0x474F4C46UL        // "FLOG"
+#define FLASH_LOG_DRAINED_MAGIC     0x4E415244UL        // "DRAN"
+#define FLASH_LOG_RECORD_MAGIC      0x4352U             // "RC"
+#define FLASH_LOG_COMMIT_MAGIC      0x54494D43UL        // "CMIT"
+
+typedef enum {
+    FLASH_LOG_PAGE_FREE = 0,
+    FLASH_LOG_PAGE_DATA,
+    FLASH_LOG_PAGE_DRAINED
+} FlashLogPageState;
+
+typedef enum {
+    FLASH_LOG_PARSE_RECORD = 0,     // A committed record
+    FLASH_LOG_PARSE_SKIP,           // Not the start of one
+    FLASH_LOG_PARSE_END             // Blank flash, or the end of what is programmed
+} FlashLogParse;
+
+// Page header and drained marker
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t erase_count;
+    uint32_t check;
+} FlashLogPageQuad;
+
+typedef struct {
+    uint16_t magic;
+    uint16_t length;
+    uint8_t  type;
+    uint8_t  reserved[3];
+    uint32_t sequence;
+    uint32_t check;
+} FlashLogRecordQuad;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t crc;
+    uint32_t check;
+} FlashLogCommitQuad;
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t erase_count;
+    uint8_t  state;
+} FlashLogPage;
+
+static FlashLogPage  flash_log_pages[FLASH_LOG_PAGES];
+static TX_MUTEX      flash_log_lock;
+static FlashLogStats flash_log_stats;
+static uint32_t      flash_log_page_sequence;       // For the next page opened
+static uint32_t      flash_log_record_sequence;     // For the next record
+static int32_t       flash_log_head = -1;           // Page being written, or -1
+static uint32_t      flash_log_programmed;          // ... programmed up to here
+static int32_t       flash_log_tail = -1;           // Oldest page with unread records, or -1
+static uint32_t      flash_log_tail_offset;         // ... and the next record in it
+static uint32_t      flash_log_peeked;              // Size of the record FlashLogPeek() returned
+static uint8_t       flash_log_ready;
+
+static uint8_t  flash_log_batch[FLASH_LOG_BATCH_SIZE] __attribute__((aligned(16)));
+static uint32_t flash_log_batch_used;
+
+
+/*
+ * FLASH ACCESS
+ */
+
+static uint32_t FlashLogAddress(int32_t page, uint32_t offset) {
+    return FLASH_LOG_BASE + (uint32_t)page * FLASH_LOG_PAGE_SIZE + offset;
+}
+
+
+static const uint8_t *FlashLogRead(int32_t page, uint32_t offset) {
+    return FLASH_LOG_POINTER(FlashLogAddress(page, offset));
+}
+
+
+static bool FlashLogIsBlank(const uint8_t *data, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        if (data[i] != 0xFFU) return false;
+    }
+    return true;
+}
+
+
+/**
+    @brief  Whether a quad-word's last word is the CRC of the rest.
+ */
+static bool FlashLogQuadValid(const void *quad) {
+    uint32_t check;
+    memcpy(&check, (const uint8_t *)quad + 12, sizeof(check));
+    return FrameCrc32(quad, 12) == check;
+}
+
+
+static void FlashLogQuadSeal(void *quad) {
+    uint32_t check = FrameCrc32(quad, 12);
+    memcpy((uint8_t *)quad + 12, &check, sizeof(check));
+}
+
+
+/**
+    @brief  Program whole quad-words, in bursts of eight where the
+            address allows.
+ */
+static bool FlashLogProgram(int32_t page, uint32_t offset, const uint8_t *data, uint32_t size) {
+    bool done = true;
+
+    HAL_FLASH_Unlock();
+    while (done && size > 0) {
+        uint32_t address = FlashLogAddress(page, offset);
+        uint32_t step = FLASH_LOG_QUAD;
+        uint32_t type = FLASH_TYPEPROGRAM_QUADWORD;
+
+        if ((address % FLASH_LOG_BURST) == 0 && size >= FLASH_LOG_BURST) {
+            step = FLASH_LOG_BURST;
+            type = FLASH_TYPEPROGRAM_BURST;
+        }
+
+        done = HAL_FLASH_Program(type, address, (uintptr_t)data) == HAL_OK;
+        offset += step;
+        data += step;
+        size -= step;
+    }
+    HAL_FLASH_Lock();
+
+#if defined(APP_ENABLE_ICACHE)
+    // The cache may hold the blank flash that was there before
+    ICacheInvalidate();
+#endif
+
+    return done;
+}
+
+
+static bool FlashLogErase(int32_t page) {
+    FLASH_EraseInitTypeDef erase = { 0 };
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.Banks = FLASH_BANK_2;
+    erase.Page = (FlashLogAddress(page, 0) - FLASH_BASE_NS - FLASH_LOG_BANK_SIZE) / FLASH_LOG_PAGE_SIZE;
+    erase.NbPages = 1;
+
+    uint32_t page_error;
+    HAL_FLASH_Unlock();
+    bool done = HAL_FLASHEx_Erase(&erase, &page_error) == HAL_OK;
+    HAL_FLASH_Lock();
+
+#if defined(APP_ENABLE_ICACHE)
+    ICacheInvalidate();
+#endif
+
+    return done;
+}
+
+
+/*
+ * PAGES AND RECORDS
+ */
+
+static uint32_t FlashLogPadded(uint32_t length) {
+    return (length + FLASH_LOG_QUAD - 1U) & ~(FLASH_LOG_QUAD - 1U);
+}
+
+
+/**
+    @brief  Check for a committed record at an offset in a page.
+
+    @param  end     Offset the page is programmed up to.
+    @param  header  Set to the record's header.
+
+    @return FLASH_LOG_PARSE_RECORD, FLASH_LOG_PARSE_SKIP if the quad-word
+            there does not start a whole record, or FLASH_LOG_PARSE_END.
+ */
+static FlashLogParse FlashLogParseRecord(int32_t page, uint32_t offset, uint32_t end, FlashLogRecordQuad *header) {
+    if (offset + FLASH_LOG_QUAD > end) return FLASH_LOG_PARSE_END;
+
+    const uint8_t *quad = FlashLogRead(page, offset);
+    if (FlashLogIsBlank(quad, FLASH_LOG_QUAD)) return FLASH_LOG_PARSE_END;
+
+    memcpy(header, quad, sizeof(*header));
+    if (header->magic != FLASH_LOG_RECORD_MAGIC || !FlashLogQuadValid(header) ||
+        header->length > FLASH_LOG_MAX_RECORD) {
+        return FLASH_LOG_PARSE_SKIP;
+    }
+
+    uint32_t commit_offset = offset + FLASH_LOG_QUAD + FlashLogPadded(header->length);
+    if (commit_offset + FLASH_LOG_QUAD > end) return FLASH_LOG_PARSE_SKIP;
+
+    FlashLogCommitQuad commit;
+    memcpy(&commit, FlashLogRead(page, commit_offset), sizeof(commit));
+    if (commit.magic != FLASH_LOG_COMMIT_MAGIC || !FlashLogQuadValid(&commit) ||
+        commit.sequence != header->sequence ||
+        FrameCrc32(FlashLogRead(page, offset + FLASH_LOG_QUAD), header->length) != commit.crc) {
+        return FLASH_LOG_PARSE_SKIP;
+    }
+
+    return FLASH_LOG_PARSE_RECORD;
+}
+
+
+/**
+    @brief  Mark a page's records as all read, so they are not sent again
+            after a restart and the page can be reused.
+ */
+static void FlashLogDrainPage(int32_t page) {
+    FlashLogPage *state = &flash_log_pages[page];
+
+    FlashLogPageQuad drained = { FLASH_LOG_DRAINED_MAGIC, state->sequence, state->erase_count, 0 };
+    FlashLogQuadSeal(&drained);
+
+    // On failure the page is read again after a restart: no data is lost
+    FlashLogProgram(page, FLASH_LOG_QUAD, (const uint8_t *)&drained, sizeof(drained));
+    state->state = FLASH_LOG_PAGE_DRAINED;
+}
+
+
+/**
+    @brief  Move the read position to the next page in write order.
+ */
+static void FlashLogNextTail(void) {
+    uint32_t after = flash_log_pages[flash_log_tail].sequence;
+    int32_t next = -1;
+
+    for (int32_t i = 0; i < FLASH_LOG_PAGES; i++) {
+        const FlashLogPage *page = &flash_log_pages[i];
+        if (page->state != FLASH_LOG_PAGE_DATA || page->sequence <= after) continue;
+        if (next < 0 || page->sequence < flash_log_pages[next].sequence) next = i;
+    }
+
+    flash_log_tail = next;
+    flash_log_tail_offset = FLASH_LOG_DATA_OFFSET;
+}
+
+
+/**
+    @brief  Start writing a new page: the least worn free one, or else
+            the oldest unread one.
+
+    @return true, or false if no page could be erased and set up.
+ */
+static bool FlashLogOpenPage(void) {
+    int32_t choice = -1;
+
+    for (int32_t i = 0; i < FLASH_LOG_PAGES; i++) {
+        const FlashLogPage *page = &flash_log_pages[i];
+        if (page->state == FLASH_LOG_PAGE_DATA) continue;
+        if (choice < 0 || page->erase_count < flash_log_pages[choice].erase_count) choice = i;
+    }
+
+    if (choice < 0) {
+        // Full: drop the oldest records, unless one is being sent
+        if (flash_log_tail < 0 || flash_log_tail == flash_log_head || flash_log_peeked != 0) return false;
+
+        choice = flash_log_tail;
+        FlashLogNextTail();
+        flash_log_stats.pages_dropped++;
+    }
+
+    FlashLogPage *page = &flash_log_pages[choice];
+    page->state = FLASH_LOG_PAGE_FREE;
+
+    if (!FlashLogIsBlank(FlashLogRead(choice, 0), FLASH_LOG_PAGE_SIZE)) {
+        page->erase_count++;
+        if (!FlashLogErase(choice)) return false;
+    }
+
+    FlashLogPageQuad header = { FLASH_LOG_PAGE_MAGIC, flash_log_page_sequence, page->erase_count, 0 };
+    FlashLogQuadSeal(&header);
+    if (!FlashLogProgram(choice, 0, (const uint8_t *)&header, sizeof(header))) return false;
+
+    page->sequence = flash_log_page_sequence++;
+    page->state = FLASH_LOG_PAGE_DATA;
+
+    flash_log_head = choice;
+    flash_log_programmed = FLASH_LOG_DATA_OFFSET;
+    if (flash_log_tail < 0) {
+        flash_log_tail = choice;
+        flash_log_tail_offset = FLASH_LOG_DATA_OFFSET;
+    }
+
+    return true;
+}
+
+
+/**
+    @brief  Program the staged quad-words. Call with the lock held.
+ */
+static bool FlashLogFlushLocked(void) {
+    if (flash_log_batch_used == 0) return true;
+
+    bool done = FlashLogProgram(flash_log_head, flash_log_programmed, flash_log_batch, flash_log_batch_used);
+    flash_log_programmed += flash_log_batch_used;
+    flash_log_batch_used = 0;
+
+    // Leave a page that failed to program: new records go to a fresh one
+    if (!done) flash_log_head = -1;
+    return done;
+}
+
+
+/**
+    @brief  Stage one quad-word, programming the batch when it fills.
+ */
+static bool FlashLogStage(const void *quad) {
+    memcpy(&flash_log_batch[flash_log_batch_used], quad, FLASH_LOG_QUAD);
+    flash_log_batch_used += FLASH_LOG_QUAD;
+
+    if (flash_log_batch_used < FLASH_LOG_BATCH_SIZE) return true;
+    return FlashLogFlushLocked();
+}
+
+
+/*
+ * API
+ */
+
+/**
+    @brief  Find the records left by earlier runs and get ready to add
+            to them.
+
+    Call once, from App_ThreadX_Init(). Records in the newest page after
+    the last committed one were cut short by power loss and are skipped.
+
+    @return TX_SUCCESS, or the ThreadX error.
+ */
+UINT FlashLogInit(void) {
+    UINT status = tx_mutex_create(&flash_log_lock, "FlashLog", TX_INHERIT);
+    if (status != TX_SUCCESS) return status;
+
+    int32_t newest = -1;
+    uint32_t most_worn = 0;
+    for (int32_t i = 0; i < FLASH_LOG_PAGES; i++) {
+        FlashLogPage *page = &flash_log_pages[i];
+        FlashLogPageQuad header, drained;
+        memcpy(&header, FlashLogRead(i, 0), sizeof(header));
+        memcpy(&drained, FlashLogRead(i, FLASH_LOG_QUAD), sizeof(drained));
+
+        // A page whose header did not survive has lost its erase count
+        // with it; it is taken as the most worn below
+        if (header.magic != FLASH_LOG_PAGE_MAGIC || !FlashLogQuadValid(&header)) {
+            page->state = FLASH_LOG_PAGE_FREE;
+            page->erase_count = UINT32_MAX;
+            continue;
+        }
+
+        page->sequence = header.sequence;
+        page->erase_count = header.erase_count;
+        if (header.erase_count > most_worn) most_worn = header.erase_count;
+        page->state = drained.magic == FLASH_LOG_DRAINED_MAGIC && FlashLogQuadValid(&drained) &&
+                      drained.sequence == header.sequence ? FLASH_LOG_PAGE_DRAINED : FLASH_LOG_PAGE_DATA;
+
+        if (newest < 0 || page->sequence > flash_log_pages[newest].sequence) newest = i;
+        if (page->state == FLASH_LOG_PAGE_DATA &&
+            (flash_log_tail < 0 || page->sequence < flash_log_pages[flash_log_tail].sequence)) {
+            flash_log_tail = i;
+        }
+    }
+
+    for (int32_t i = 0; i < FLASH_LOG_PAGES; i++) {
+        if (flash_log_pages[i].erase_count == UINT32_MAX) flash_log_pages[i].erase_count = most_worn;
+    }
+
+    flash_log_page_sequence = newest < 0 ? 0 : flash_log_pages[newest].sequence + 1U;
+    flash_log_tail_offset = FLASH_LOG_DATA_OFFSET;
+
+    // Carry on writing the newest page, after its last programmed quad-word
+    if (newest >= 0 && flash_log_pages[newest].state == FLASH_LOG_PAGE_DATA) {
+        uint32_t end = FLASH_LOG_PAGE_SIZE;
+        while (end > FLASH_LOG_DATA_OFFSET && FlashLogIsBlank(FlashLogRead(newest, end - FLASH_LOG_QUAD), FLASH_LOG_QUAD)) {
+            end -= FLASH_LOG_QUAD;
+        }
+
+        flash_log_head = newest;
+        flash_log_programmed = end;
+
+        // Record sequence numbers carry on from the last one, so a commit
+        // from this run never completes a header cut short in the last
+        uint32_t offset = FLASH_LOG_DATA_OFFSET;
+        FlashLogRecordQuad header;
+        FlashLogParse parse;
+        while ((parse = FlashLogParseRecord(newest, offset, end, &header)) != FLASH_LOG_PARSE_END) {
+            if (parse == FLASH_LOG_PARSE_SKIP) {
+                offset += FLASH_LOG_QUAD;
+                continue;
+            }
+
+            flash_log_record_sequence = header.sequence + 1U;
+            offset += 2U * FLASH_LOG_QUAD + FlashLogPadded(header.length);
+        }
+    }
+
+    flash_log_ready = 1;
+    return TX_SUCCESS;
+}
+
+
+/**
+    @brief  Add a record.
+
+    It is staged in SRAM and programmed with the records after it, when
+    FLASH_LOG_BATCH_SIZE bytes have built up, or by FlashLogFlush().
+
+    @param  type    Any value, returned with the record.
+    @param  data    The payload.
+    @param  length  Payload bytes, up to FLASH_LOG_MAX_RECORD.
+
+    @return true, or false if the record could not be stored.
+ */
+bool FlashLogAppend(uint8_t type, const void *data, uint16_t length) {
+    if (flash_log_ready == 0 || length > FLASH_LOG_MAX_RECORD) return false;
+
+    // Outside the lock, which other threads' appends wait on
+    uint32_t crc = FrameCrc32(data, length);
+    uint32_t size = 2U * FLASH_LOG_QUAD + FlashLogPadded(length);
+    bool done = true;
+
+    tx_mutex_get(&flash_log_lock, TX_WAIT_FOREVER);
+
+    if (flash_log_head >= 0 && flash_log_programmed + flash_log_batch_used + size > FLASH_LOG_PAGE_SIZE) {
+        done = FlashLogFlushLocked();
+        flash_log_head = -1;
+    }
+
+    if (flash_log_head < 0) done = FlashLogOpenPage();
+
+    if (done) {
+        FlashLogRecordQuad header = { FLASH_LOG_RECORD_MAGIC, length, type, { 0, 0, 0 },
+                                      flash_log_record_sequence, 0 };
+        FlashLogQuadSeal(&header);
+        done = FlashLogStage(&header);
+
+        const uint8_t *payload = data;
+        uint8_t quad[FLASH_LOG_QUAD];
+        for (uint32_t offset = 0; done && offset < length; offset += FLASH_LOG_QUAD) {
+            uint32_t part = length - offset < FLASH_LOG_QUAD ? length - offset : FLASH_LOG_QUAD;
+            memset(quad, 0xFF, sizeof(quad));
+            memcpy(quad, payload + offset, part);
+            done = FlashLogStage(quad);
+        }
+
+        FlashLogCommitQuad commit = { FLASH_LOG_COMMIT_MAGIC, flash_log_record_sequence, crc, 0 };
+        FlashLogQuadSeal(&commit);
+        if (done) done = FlashLogStage(&commit);
+
+        flash_log_record_sequence++;
+        if (done) flash_log_stats.records_written++;
+    }
+
+    tx_mutex_put(&flash_log_lock);
+    return done;
+}
+
+
+/**
+    @brief  Program any staged records now.
+
+    @return true, or false if programming failed.
+ */
+bool FlashLogFlush(void) {
+    if (flash_log_ready == 0) return true;
+
+    tx_mutex_get(&flash_log_lock, TX_WAIT_FOREVER);
+    bool done = FlashLogFlushLocked();
+    tx_mutex_put(&flash_log_lock);
+
+    return done;
+}
+
+
+/**
+    @brief  Whether every stored record has been read.
+ */
+bool FlashLogIsEmpty(void) {
+    return flash_log_tail < 0;
+}
+
+
+/**
+    @brief  Get the oldest unread record, without consuming it.
+
+    Staged records are programmed first. The payload is read in place,
+    so it can go straight to a channel write; it stays valid until
+    FlashLogConsume() or the next call. Once every record is read, the
+    page being written is closed, so a restart does not read them again.
+
+    @param  type    Set to the record's type.
+    @param  length  Set to the payload bytes.
+
+    @return The payload, or NULL if there are no unread records.
+ */
+const uint8_t *FlashLogPeek(uint8_t *type, uint16_t *length) {
+    if (flash_log_ready == 0) return NULL;
+
+    const uint8_t *payload = NULL;
+    tx_mutex_get(&flash_log_lock, TX_WAIT_FOREVER);
+    flash_log_peeked = 0;
+
+    // A record still partly staged would read as one cut short. If this
+    // fails, whatever did get programmed is read
+    FlashLogFlushLocked();
+
+    while (flash_log_tail >= 0) {
+        bool head = flash_log_tail == flash_log_head;
+        uint32_t end = head ? flash_log_programmed : FLASH_LOG_PAGE_SIZE;
+
+        FlashLogRecordQuad header;
+        FlashLogParse parse = FlashLogParseRecord(flash_log_tail, flash_log_tail_offset, end, &header);
+
+        if (parse == FLASH_LOG_PARSE_RECORD) {
+            payload = FlashLogRead(flash_log_tail, flash_log_tail_offset + FLASH_LOG_QUAD);
+            *type = header.type;
+            *length = header.length;
+            flash_log_peeked = 2U * FLASH_LOG_QUAD + FlashLogPadded(header.length);
+            break;
+        }
+
+        if (parse == FLASH_LOG_PARSE_SKIP) {
+            flash_log_tail_offset += FLASH_LOG_QUAD;
+            flash_log_stats.quads_skipped++;
+            continue;
+        }
+
+        // Page read to the end: it can be reused. The page being written
+        // is closed too, and the next record starts a new one
+        FlashLogDrainPage(flash_log_tail);
+        if (head) {
+            flash_log_head = -1;
+            flash_log_tail = -1;
+        } else {
+            FlashLogNextTail();
+        }
+    }
+
+    tx_mutex_put(&flash_log_lock);
+    return payload;
+}
+
+
+/**
+    @brief  Consume the record FlashLogPeek() returned, once it has been
+            sent.
+ */
+void FlashLogConsume(void) {
+    tx_mutex_get(&flash_log_lock, TX_WAIT_FOREVER);
+    if (flash_log_peeked != 0) {
+        flash_log_tail_offset += flash_log_peeked;
+        flash_log_peeked = 0;
+        flash_log_stats.records_read++;
+    }
+    tx_mutex_put(&flash_log_lock);
+}
+
+
+/**
+    @brief  Read the store's counts and page wear.
+
+    @param  stats   Filled in with the counts since boot.
+ */
+void FlashLogGetStats(FlashLogStats *stats) {
+    tx_mutex_get(&flash_log_lock, TX_WAIT_FOREVER);
+
+    *stats = flash_log_stats;
+    stats->pages_used = 0;
+    stats->erase_count_min = UINT32_MAX;
+    stats->erase_count_max = 0;
+
+    for (int32_t i = 0; i < FLASH_LOG_PAGES; i++) {
+        const FlashLogPage *page = &flash_log_pages[i];
+        if (page->state == FLASH_LOG_PAGE_DATA) stats->pages_used++;
+        if (page->erase_count < stats->erase_count_min) stats->erase_count_min = page->erase_count;
+        if (page->erase_count > stats->erase_count_max) stats->erase_count_max = page->erase_count;
+    }
+
+    tx_mutex_put(&flash_log_lock);
+}
+
+#endif /* APP_ENABLE_FLASH_LOG */
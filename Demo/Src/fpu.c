@@ -0,0 +1,63 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include "fpu.h"
+#include "stm32u5xx_hal.h"
+
+#if defined(APP_ENABLE_HARD_FLOAT)
+
+#define FPU_CP10_CP11_FULL          ((3UL << 20) | (3UL << 22))
+#define FPU_NSACR_CP10_CP11         (SCB_NSACR_CP10_Msk | SCB_NSACR_CP11_Msk)
+
+
+/**
+    @brief  Give the application the FPU, with lazy state preservation.
+
+    Call first thing in main(), before any floating point code runs.
+
+    @return false if the secure side has not granted the FPU to the
+            non-secure application, in which case FP code will fault.
+ */
+bool FpuInit(void) {
+    if ((SCB->NSACR & FPU_NSACR_CP10_CP11) != FPU_NSACR_CP10_CP11) return false;
+
+    SCB->CPACR |= FPU_CP10_CP11_FULL;
+    __DSB();
+    __ISB();
+
+    // Exceptions taken with FP state live reserve room for it in the
+    // frame, but only write the registers if the handler uses the FPU
+    FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+    return true;
+}
+
+
+/**
+    @brief  Whether the calling thread currently carries FPU context.
+
+    @return true once the thread has run an FP instruction.
+ */
+bool FpuThreadActive(void) {
+    return (__get_CONTROL() & CONTROL_FPCA_Msk) != 0U;
+}
+
+
+/**
+    @brief  Drop the calling thread's FPU context.
+
+    For a thread that used floating point once, for a calibration say,
+    and is integer only from then on: its context switches go back to
+    the short, integer frame until it next runs an FP instruction. Only
+    call where no FP value is live, such as the top of the thread's loop,
+    as the registers are no longer saved for it.
+ */
+void FpuThreadRelease(void) {
+    __set_CONTROL(__get_CONTROL() & ~CONTROL_FPCA_Msk);
+    __ISB();
+}
+
+#endif /* APP_ENABLE_HARD_FLOAT */
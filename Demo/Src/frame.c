@@ -0,0 +1,347 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdbool.h>
+
+#include "frame.h"
+
+#if defined(APP_ENABLE_CRC_ACCEL)
+#include "profile.h"
+#include "trace.h"
+#include "stm32u5xx_hal.h"
+#endif
+
+static uint16_t frame_sequence;
+
+// CRC-32 (reflected 0x04C11DB7) of each byte value
+static const uint32_t frame_crc_table[256] = {
+    0x00000000UL, 0x77073096UL, 0xEE0E612CUL, 0x990951BAUL, 0x076DC419UL, 0x706AF48FUL,
+    0xE963A535UL, 0x9E6495A3UL, 0x0EDB8832UL, 0x79DCB8A4UL, 0xE0D5E91EUL, 0x97D2D988UL,
+    0x09B64C2BUL, 0x7EB17CBDUL, 0xE7B82D07UL, 0x90BF1D91UL, 0x1DB71064UL, 0x6AB020F2UL,
+    0xF3B97148UL, 0x84BE41DEUL, 0x1ADAD47DUL, 0x6DDDE4EBUL, 0xF4D4B551UL, 0x83D385C7UL,
+    0x136C9856UL, 0x646BA8C0UL, 0xFD62F97AUL, 0x8A65C9ECUL, 0x14015C4FUL, 0x63066CD9UL,
+    0xFA0F3D63UL, 0x8D080DF5UL, 0x3B6E20C8UL, 0x4C69105EUL, 0xD56041E4UL, 0xA2677172UL,
+    0x3C03E4D1UL, 0x4B04D447UL, 0xD20D85FDUL, 0xA50AB56BUL, 0x35B5A8FAUL, 0x42B2986CUL,
+    0xDBBBC9D6UL, 0xACBCF940UL, 0x32D86CE3UL, 0x45DF5C75UL, 0xDCD60DCFUL, 0xABD13D59UL,
+    0x26D930ACUL, 0x51DE003AUL, 0xC8D75180UL, 0xBFD06116UL, 0x21B4F4B5UL, 0x56B3C423UL,
+    0xCFBA9599UL, 0xB8BDA50FUL, 0x2802B89EUL, 0x5F058808UL, 0xC60CD9B2UL, 0xB10BE924UL,
+    0x2F6F7C87UL, 0x58684C11UL, 0xC1611DABUL, 0xB6662D3DUL, 0x76DC4190UL, 0x01DB7106UL,
+    0x98D220BCUL, 0xEFD5102AUL, 0x71B18589UL, 0x06B6B51FUL, 0x9FBFE4A5UL, 0xE8B8D433UL,
+    0x7807C9A2UL, 0x0F00F934UL, 0x9609A88EUL, 0xE10E9818UL, 0x7F6A0DBBUL, 0x086D3D2DUL,
+    0x91646C97UL, 0xE6635C01UL, 0x6B6B51F4UL, 0x1C6C6162UL, 0x856530D8UL, 0xF262004EUL,
+    0x6C0695EDUL, 0x1B01A57BUL, 0x8208F4C1UL, 0xF50FC457UL, 0x65B0D9C6UL, 0x12B7E950UL,
+    0x8BBEB8EAUL, 0xFCB9887CUL, 0x62DD1DDFUL, 0x15DA2D49UL, 0x8CD37CF3UL, 0xFBD44C65UL,
+    0x4DB26158UL, 0x3AB551CEUL, 0xA3BC0074UL, 0xD4BB30E2UL, 0x4ADFA541UL, 0x3DD895D7UL,
+    0xA4D1C46DUL, 0xD3D6F4FBUL, 0x4369E96AUL, 0x346ED9FCUL, 0xAD678846UL, 0xDA60B8D0UL,
+    0x44042D73UL, 0x33031DE5UL, 0xAA0A4C5FUL, 0xDD0D7CC9UL, 0x5005713CUL, 0x270241AAUL,
+    0xBE0B1010UL, 0xC90C2086UL, 0x5768B525UL, 0x206F85B3UL, 0xB966D409UL, 0xCE61E49FUL,
+    0x5EDEF90EUL, 0x29D9C998UL, 0xB0D09822UL, 0xC7D7A8B4UL, 0x59B33D17UL, 0x2EB40D81UL,
+    0xB7BD5C3BUL, 0xC0BA6CADUL, 0xEDB88320UL, 0x9ABFB3B6UL, 0x03B6E20CUL, 0x74B1D29AUL,
+    0xEAD54739UL, 0x9DD277AFUL, 0x04DB2615UL, 0x73DC1683UL, 0xE3630B12UL, 0x94643B84UL,
+    0x0D6D6A3EUL, 0x7A6A5AA8UL, 0xE40ECF0BUL, 0x9309FF9DUL, 0x0A00AE27UL, 0x7D079EB1UL,
+    0xF00F9344UL, 0x8708A3D2UL, 0x1E01F268UL, 0x6906C2FEUL, 0xF762575DUL, 0x806567CBUL,
+    0x196C3671UL, 0x6E6B06E7UL, 0xFED41B76UL, 0x89D32BE0UL, 0x10DA7A5AUL, 0x67DD4ACCUL,
+    0xF9B9DF6FUL, 0x8EBEEFF9UL, 0x17B7BE43UL, 0x60B08ED5UL, 0xD6D6A3E8UL, 0xA1D1937EUL,
+    0x38D8C2C4UL, 0x4FDFF252UL, 0xD1BB67F1UL, 0xA6BC5767UL, 0x3FB506DDUL, 0x48B2364BUL,
+    0xD80D2BDAUL, 0xAF0A1B4CUL, 0x36034AF6UL, 0x41047A60UL, 0xDF60EFC3UL, 0xA867DF55UL,
+    0x316E8EEFUL, 0x4669BE79UL, 0xCB61B38CUL, 0xBC66831AUL, 0x256FD2A0UL, 0x5268E236UL,
+    0xCC0C7795UL, 0xBB0B4703UL, 0x220216B9UL, 0x5505262FUL, 0xC5BA3BBEUL, 0xB2BD0B28UL,
+    0x2BB45A92UL, 0x5CB36A04UL, 0xC2D7FFA7UL, 0xB5D0CF31UL, 0x2CD99E8BUL, 0x5BDEAE1DUL,
+    0x9B64C2B0UL, 0xEC63F226UL, 0x756AA39CUL, 0x026D930AUL, 0x9C0906A9UL, 0xEB0E363FUL,
+    0x72076785UL, 0x05005713UL, 0x95BF4A82UL, 0xE2B87A14UL, 0x7BB12BAEUL, 0x0CB61B38UL,
+    0x92D28E9BUL, 0xE5D5BE0DUL, 0x7CDCEFB7UL, 0x0BDBDF21UL, 0x86D3D2D4UL, 0xF1D4E242UL,
+    0x68DDB3F8UL, 0x1FDA836EUL, 0x81BE16CDUL, 0xF6B9265BUL, 0x6FB077E1UL, 0x18B74777UL,
+    0x88085AE6UL, 0xFF0F6A70UL, 0x66063BCAUL, 0x11010B5CUL, 0x8F659EFFUL, 0xF862AE69UL,
+    0x616BFFD3UL, 0x166CCF45UL, 0xA00AE278UL, 0xD70DD2EEUL, 0x4E048354UL, 0x3903B3C2UL,
+    0xA7672661UL, 0xD06016F7UL, 0x4969474DUL, 0x3E6E77DBUL, 0xAED16A4AUL, 0xD9D65ADCUL,
+    0x40DF0B66UL, 0x37D83BF0UL, 0xA9BCAE53UL, 0xDEBB9EC5UL, 0x47B2CF7FUL, 0x30B5FFE9UL,
+    0xBDBDF21CUL, 0xCABAC28AUL, 0x53B39330UL, 0x24B4A3A6UL, 0xBAD03605UL, 0xCDD70693UL,
+    0x54DE5729UL, 0x23D967BFUL, 0xB3667A2EUL, 0xC4614AB8UL, 0x5D681B02UL, 0x2A6F2B94UL,
+    0xB40BBE37UL, 0xC30C8EA1UL, 0x5A05DF1BUL, 0x2D02EF8DUL
+};
+
+
+/**
+    @brief  CRC-32 a byte at a time from the table: the reference the
+            CRC unit has to match.
+ */
+static uint32_t FrameCrcSoftware(const uint8_t *data, uint32_t length) {
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    while (length-- > 0) {
+        crc = frame_crc_table[(crc ^ *data++) & 0xFFU] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+
+#if defined(APP_ENABLE_CRC_ACCEL)
+/*
+ * CRC UNIT
+ *
+ * The unit runs the default polynomial and initial value with its input
+ * bit reversed and its output reflected, which is the reflected CRC-32
+ * bar the final inversion. Input reversal is per byte for byte stores and
+ * per word for word stores, so a little endian word's first byte still
+ * goes in first. Words come from the CPU, or above the DMA threshold from
+ * GPDMA1 channel 9, which stores them to the data register while the
+ * calling thread waits. Like the FMAC and CORDIC in dsp.c, the unit is
+ * taken for a whole call; a call that finds it taken runs in C.
+ */
+
+// Largest whole-word block one DMA transfer moves: BNDT is 16 bits
+#define FRAME_CRC_DMA_BLOCK_MAX     0xFFFCUL
+
+static CRC_HandleTypeDef    frame_crc;
+static DMA_HandleTypeDef    frame_crc_dma;
+static TX_SEMAPHORE         frame_crc_done;
+static volatile uint8_t     frame_crc_failed;
+static volatile uint8_t     frame_crc_busy;
+static uint8_t              frame_ready;
+
+
+/**
+    @brief  Take the CRC unit, if it is free.
+ */
+static bool FrameClaim(void) {
+    TX_INTERRUPT_SAVE_AREA
+    bool claimed = false;
+
+    TX_DISABLE
+    if (frame_ready != 0 && frame_crc_busy == 0) {
+        frame_crc_busy = 1;
+        claimed = true;
+    }
+    TX_RESTORE
+
+    return claimed;
+}
+
+
+static void FrameRelease(void) {
+    frame_crc_busy = 0;
+}
+
+
+static void FrameCrcDmaComplete(DMA_HandleTypeDef *hdma) {
+    (void)hdma;
+    tx_semaphore_put(&frame_crc_done);
+}
+
+
+static void FrameCrcDmaError(DMA_HandleTypeDef *hdma) {
+    (void)hdma;
+    frame_crc_failed = 1;
+    tx_semaphore_put(&frame_crc_done);
+}
+
+
+void GPDMA1_Channel9_IRQHandler(void) {
+    PROFILE_ISR_ENTER();
+    TRACE_ISR_ENTER();
+    HAL_DMA_IRQHandler(&frame_crc_dma);
+    TRACE_ISR_EXIT();
+    PROFILE_ISR_EXIT();
+}
+
+
+/**
+    @brief  Bring up the CRC unit and the DMA channel that feeds it.
+
+    Call once, from App_ThreadX_Init(). Until it has succeeded every
+    CRC runs in C.
+
+    @return TX_SUCCESS, the ThreadX error, or TX_NOT_AVAILABLE if the
+            unit or the channel could not be configured.
+ */
+UINT FrameInit(void) {
+    UINT status = tx_semaphore_create(&frame_crc_done, "FrameCrc", 0);
+    if (status != TX_SUCCESS) return status;
+
+    __HAL_RCC_CRC_CLK_ENABLE();
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+    frame_crc.Instance = CRC;
+    frame_crc.Init.DefaultPolynomialUse = DEFAULT_POLYNOMIAL_ENABLE;
+    frame_crc.Init.DefaultInitValueUse = DEFAULT_INIT_VALUE_ENABLE;
+    frame_crc.Init.InputDataInversionMode = CRC_INPUTDATA_INVERSION_BYTE;
+    frame_crc.Init.OutputDataInversionMode = CRC_OUTPUTDATA_INVERSION_ENABLE;
+    frame_crc.InputDataFormat = CRC_INPUTDATA_FORMAT_BYTES;
+
+    DMA_HandleTypeDef *dma = &frame_crc_dma;
+    dma->Instance = GPDMA1_Channel9;
+    dma->Init.Request = DMA_REQUEST_SW;
+    dma->Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+    dma->Init.Direction = DMA_MEMORY_TO_MEMORY;
+    dma->Init.SrcInc = DMA_SINC_INCREMENTED;
+    dma->Init.DestInc = DMA_DINC_FIXED;
+    dma->Init.SrcDataWidth = DMA_SRC_DATAWIDTH_WORD;
+    dma->Init.DestDataWidth = DMA_DEST_DATAWIDTH_WORD;
+    dma->Init.Priority = DMA_LOW_PRIORITY_LOW_WEIGHT;
+    dma->Init.SrcBurstLength = 1;
+    dma->Init.DestBurstLength = 1;
+    dma->Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT0;
+    dma->Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+    dma->Init.Mode = DMA_NORMAL;
+
+    if (HAL_CRC_Init(&frame_crc) != HAL_OK ||
+        HAL_DMA_Init(dma) != HAL_OK ||
+        HAL_DMA_RegisterCallback(dma, HAL_DMA_XFER_CPLT_CB_ID, FrameCrcDmaComplete) != HAL_OK ||
+        HAL_DMA_RegisterCallback(dma, HAL_DMA_XFER_ERROR_CB_ID, FrameCrcDmaError) != HAL_OK) {
+        return TX_NOT_AVAILABLE;
+    }
+
+    HAL_NVIC_SetPriority(GPDMA1_Channel9_IRQn, FRAME_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(GPDMA1_Channel9_IRQn);
+
+    frame_ready = 1;
+    return TX_SUCCESS;
+}
+
+
+/**
+    @brief  Feed whole words to the CRC unit by DMA, waiting for each
+            block.
+
+    @return true, or false if a block failed or did not finish.
+ */
+static bool FrameCrcDma(const uint8_t *data, uint32_t bytes) {
+    while (bytes > 0) {
+        uint32_t block = bytes < FRAME_CRC_DMA_BLOCK_MAX ? bytes : FRAME_CRC_DMA_BLOCK_MAX;
+
+        frame_crc_failed = 0;
+        if (HAL_DMA_Start_IT(&frame_crc_dma, (uint32_t)data, (uint32_t)&CRC->DR, block) != HAL_OK) return false;
+
+        if (tx_semaphore_get(&frame_crc_done, FRAME_CRC_TIMEOUT_TICKS) != TX_SUCCESS || frame_crc_failed != 0) {
+            HAL_DMA_Abort(&frame_crc_dma);
+
+            // A completion that raced the timeout must not satisfy the next call
+            while (tx_semaphore_get(&frame_crc_done, TX_NO_WAIT) == TX_SUCCESS) {
+            }
+            return false;
+        }
+
+        data += block;
+        bytes -= block;
+    }
+
+    return true;
+}
+
+
+/**
+    @brief  CRC-32 on the CRC unit.
+
+    @param  crc     Set to the CRC on success.
+
+    @return true, or false if the unit was taken or its DMA failed; the
+            CRC then needs doing in C.
+ */
+static bool FrameCrcUnit(const uint8_t *data, uint32_t length, uint32_t *crc) {
+    if (!FrameClaim()) return false;
+
+    bool done = true;
+    __HAL_CRC_DR_RESET(&frame_crc);
+    MODIFY_REG(CRC->CR, CRC_CR_REV_IN, CRC_INPUTDATA_INVERSION_BYTE);
+
+    // Bytes up to a word boundary
+    while (length > 0 && ((uint32_t)data & 3U) != 0) {
+        *(__IO uint8_t *)&CRC->DR = *data++;
+        length--;
+    }
+
+    uint32_t words = length & ~3UL;
+    if (words > 0) {
+        MODIFY_REG(CRC->CR, CRC_CR_REV_IN, CRC_INPUTDATA_INVERSION_WORD);
+
+        // The DMA wait blocks, so threads only
+        if (words >= FRAME_CRC_DMA_THRESHOLD && tx_thread_identify() != TX_NULL) {
+            done = FrameCrcDma(data, words);
+        } else {
+            const uint32_t *word = (const uint32_t *)data;
+            for (uint32_t i = 0; i < words / 4U; i++) {
+                CRC->DR = word[i];
+            }
+        }
+
+        MODIFY_REG(CRC->CR, CRC_CR_REV_IN, CRC_INPUTDATA_INVERSION_BYTE);
+        data += words;
+        length -= words;
+    }
+
+    while (length-- > 0) {
+        *(__IO uint8_t *)&CRC->DR = *data++;
+    }
+
+    *crc = CRC->DR ^ 0xFFFFFFFFUL;
+    FrameRelease();
+    return done;
+}
+#endif /* APP_ENABLE_CRC_ACCEL */
+
+
+/*
+ * API
+ */
+
+/**
+    @brief  CRC-32 of a buffer, as zlib's crc32() computes it.
+
+    @param  data    The bytes to check.
+    @param  length  How many there are.
+
+    @return The CRC.
+ */
+uint32_t FrameCrc32(const void *data, uint32_t length) {
+#if defined(APP_ENABLE_CRC_ACCEL)
+    uint32_t crc;
+    if (FrameCrcUnit(data, length, &crc)) return crc;
+#endif
+
+    return FrameCrcSoftware(data, length);
+}
+
+
+/**
+    @brief  Fill in a frame's header and CRC around its payload.
+
+    Word align the frame to have the CRC unit take the payload a word
+    at a time.
+
+    @param  frame   FRAME_SIZE(length) bytes, with the payload already
+                    at FRAME_PAYLOAD(frame).
+    @param  type    The record type.
+    @param  length  Payload bytes.
+
+    @return The frame's size, header and CRC included.
+ */
+uint32_t FrameSeal(uint8_t *frame, uint8_t type, uint16_t length) {
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    uint16_t sequence = frame_sequence++;
+    TX_RESTORE
+
+    frame[0] = FRAME_SYNC_0;
+    frame[1] = FRAME_SYNC_1;
+    frame[2] = (uint8_t)length;
+    frame[3] = (uint8_t)(length >> 8);
+    frame[4] = type;
+    frame[5] = FRAME_VERSION;
+    frame[6] = (uint8_t)sequence;
+    frame[7] = (uint8_t)(sequence >> 8);
+
+    uint32_t crc = FrameCrc32(frame, FRAME_HEADER_SIZE + (uint32_t)length);
+    uint8_t *trailer = FRAME_PAYLOAD(frame) + length;
+    trailer[0] = (uint8_t)crc;
+    trailer[1] = (uint8_t)(crc >> 8);
+    trailer[2] = (uint8_t)(crc >> 16);
+    trailer[3] = (uint8_t)(crc >> 24);
+
+    return FRAME_SIZE((uint32_t)length);
+}
@@ -0,0 +1,63 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include "icache.h"
+#include "stm32u5xx_hal.h"
+
+#if defined(APP_ENABLE_ICACHE)
+
+
+/**
+    @brief  Turn on the instruction cache and its hit and miss monitors.
+
+    Code runs from flash with wait states; the cache hides them for
+    loops and handlers that fit in its 8KB. Call once, after HAL_Init().
+    If the cache is already on, its configuration is left alone, as it
+    can only be changed while the cache is off.
+ */
+void ICacheInit(void) {
+    if (READ_BIT(ICACHE->CR, ICACHE_CR_EN) == 0U) {
+        // Two ways: fewer conflict misses than direct mapped, for a
+        // little more power
+        HAL_ICACHE_ConfigAssociativityMode(ICACHE_2WAYS);
+        HAL_ICACHE_Enable();
+    }
+
+    HAL_ICACHE_Monitor_Reset(ICACHE_MONITOR_HIT_MISS);
+    HAL_ICACHE_Monitor_Start(ICACHE_MONITOR_HIT_MISS);
+}
+
+
+/**
+    @brief  Discard the cached instructions.
+
+    Needed only after code in flash has been rewritten.
+ */
+void ICacheInvalidate(void) {
+    HAL_ICACHE_Invalidate();
+}
+
+
+/**
+    @brief  Read the monitor counts.
+
+    @param  stats   Filled in with the counts since the last reset.
+ */
+void ICacheGetStats(ICacheStats *stats) {
+    stats->hits = HAL_ICACHE_Monitor_GetHitValue();
+    stats->misses = HAL_ICACHE_Monitor_GetMissValue();
+}
+
+
+/**
+    @brief  Zero the monitor counts.
+ */
+void ICacheResetStats(void) {
+    HAL_ICACHE_Monitor_Reset(ICACHE_MONITOR_HIT_MISS);
+}
+
+#endif /* APP_ENABLE_ICACHE */
@@ -0,0 +1,241 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include "inputs.h"
+#include "profile.h"
+#include "trace.h"
+#include "stm32u5xx_hal.h"
+
+#if defined(APP_ENABLE_INPUTS)
+
+_Static_assert(INPUTS_COUNT <= 16, "each input takes two of the 32 event flags");
+
+/*
+ * Each input moves between two states. Armed: its EXTI line is unmasked
+ * and the timer idle. Settling: an edge has masked the line and started
+ * the timer, so contact bounce costs one interrupt rather than dozens.
+ * The timer expiry, in the ThreadX timer thread, compares the pin with
+ * the last settled level, reports any change and re-arms the line. An
+ * edge that came while the line was masked is caught by reading the pin
+ * again once it is unmasked.
+ */
+
+typedef struct {
+    GPIO_TypeDef *port;
+    uint32_t      number;
+    uint32_t      pull;
+    uint32_t      line;         // EXTI_LINE_n
+    uint32_t      gpio_sel;     // EXTI_GPIOx
+    IRQn_Type     irq;
+    uint8_t       active;       // Pin level when active
+    uint16_t      debounce_ms;
+} InputConfig;
+
+typedef struct {
+    EXTI_HandleTypeDef exti;
+    TX_TIMER           timer;
+    volatile uint8_t   level;   // Last settled pin level
+} Input;
+
+typedef struct {
+    TX_EVENT_FLAGS_GROUP *group;
+    ULONG                events;
+} InputSubscriber;
+
+#define INPUTS_CONFIG_ROW(name, port, number, pull, active, debounce_ms)                           \
+    { GPIO##port, (number), (pull), EXTI_LINE_##number, EXTI_GPIO##port, EXTI##number##_IRQn,        \
+      (active), (debounce_ms) },
+
+static const InputConfig input_configs[INPUTS_COUNT] = {
+    INPUTS_TABLE(INPUTS_CONFIG_ROW)
+};
+
+static Input           inputs[INPUTS_COUNT];
+static InputSubscriber input_subscribers[INPUTS_SUBSCRIBERS];
+static uint32_t        input_subscriber_count;
+
+
+static uint8_t InputRead(const InputConfig *config) {
+    return (uint8_t)((config->port->IDR >> config->number) & 1UL);
+}
+
+
+/**
+    @brief  Mask or unmask an input's EXTI line. The mask register is
+            shared by every line, so interrupts are off around the
+            read-modify-write.
+ */
+static void InputArm(const InputConfig *config, bool armed) {
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    if (armed) {
+        SET_BIT(EXTI->IMR1, 1UL << config->number);
+    } else {
+        CLEAR_BIT(EXTI->IMR1, 1UL << config->number);
+    }
+    TX_RESTORE
+}
+
+
+/**
+    @brief  Mask the line and wait for the pin to settle. From the line's
+            interrupt, through HAL_EXTI_IRQHandler(), or the timer.
+ */
+static void InputSettle(InputIndex index) {
+    const InputConfig *config = &input_configs[index];
+    ULONG ticks = ((ULONG)config->debounce_ms * TX_TIMER_TICKS_PER_SECOND + 999U) / 1000U;
+
+    InputArm(config, false);
+
+    // The timer is idle: it only runs while the line is masked
+    tx_timer_change(&inputs[index].timer, ticks > 0 ? ticks : 1U, 0);
+    tx_timer_activate(&inputs[index].timer);
+}
+
+
+/**
+    @brief  Debounce timer expiry, in the ThreadX timer thread.
+ */
+static void InputSettled(ULONG index) {
+    const InputConfig *config = &input_configs[index];
+    Input *input = &inputs[index];
+    uint8_t level = InputRead(config);
+
+    if (level != input->level) {
+        input->level = level;
+
+        ULONG event = level == config->active ? 1UL << (2U * index) : 1UL << (2U * index + 1U);
+        for (uint32_t i = 0; i < input_subscriber_count; i++) {
+            if ((input_subscribers[i].events & event) != 0) {
+                tx_event_flags_set(input_subscribers[i].group, event, TX_OR);
+            }
+        }
+    }
+
+    // Forget edges from the bounce, then look for a change since the read
+    HAL_EXTI_ClearPending(&input->exti, EXTI_TRIGGER_RISING_FALLING);
+    InputArm(config, true);
+    if (InputRead(config) != input->level) InputSettle((InputIndex)index);
+}
+
+
+#define INPUTS_DEFINE_HANDLERS(name, port, number, pull, active, debounce_ms)                      \
+    static void Input##name##Edge(void) {                                                           \
+        InputSettle(INPUT_##name);                                                                  \
+    }                                                                                               \
+                                                                                                    \
+    void EXTI##number##_IRQHandler(void) {                                                          \
+        PROFILE_ISR_ENTER();                                                                        \
+        TRACE_ISR_ENTER();                                                                          \
+        HAL_EXTI_IRQHandler(&inputs[INPUT_##name].exti);                                            \
+        TRACE_ISR_EXIT();                                                                           \
+        PROFILE_ISR_EXIT();                                                                         \
+    }
+
+INPUTS_TABLE(INPUTS_DEFINE_HANDLERS)
+
+#define INPUTS_EDGE_CALLBACK(name, port, number, pull, active, debounce_ms)                        \
+    Input##name##Edge,
+
+// HAL_EXTI callbacks take no argument: one per input
+static void (*const input_edge_callbacks[INPUTS_COUNT])(void) = {
+    INPUTS_TABLE(INPUTS_EDGE_CALLBACK)
+};
+
+#define INPUTS_ENABLE_CLOCK(name, port, number, pull, active, debounce_ms)                         \
+    __HAL_RCC_GPIO##port##_CLK_ENABLE();
+
+
+/**
+    @brief  Set up every input in INPUTS_TABLE and arm its EXTI line.
+
+    Call once, from App_ThreadX_Init(). Each input starts at the level
+    its pin has now, without an event.
+
+    @return TX_SUCCESS, the ThreadX error, or TX_NOT_AVAILABLE if an EXTI
+            line could not be configured.
+ */
+UINT InputsInit(void) {
+    INPUTS_TABLE(INPUTS_ENABLE_CLOCK)
+
+    for (uint32_t i = 0; i < INPUTS_COUNT; i++) {
+        const InputConfig *config = &input_configs[i];
+        Input *input = &inputs[i];
+
+        // Created idle: InputSettle() sets the time each run
+        UINT status = tx_timer_create(&input->timer, "Input", InputSettled, i, 1, 0, TX_NO_ACTIVATE);
+        if (status != TX_SUCCESS) return status;
+
+        GPIO_InitTypeDef gpio = { 0 };
+        gpio.Pin = 1UL << config->number;
+        gpio.Mode = GPIO_MODE_INPUT;
+        gpio.Pull = config->pull;
+        HAL_GPIO_Init(config->port, &gpio);
+        input->level = InputRead(config);
+
+        EXTI_ConfigTypeDef exti = { 0 };
+        exti.Line = config->line;
+        exti.Mode = EXTI_MODE_INTERRUPT;
+        exti.Trigger = EXTI_TRIGGER_RISING_FALLING;
+        exti.GPIOSel = config->gpio_sel;
+
+        if (HAL_EXTI_SetConfigLine(&input->exti, &exti) != HAL_OK ||
+            HAL_EXTI_RegisterCallback(&input->exti, HAL_EXTI_COMMON_CB_ID, input_edge_callbacks[i]) != HAL_OK) {
+            return TX_NOT_AVAILABLE;
+        }
+
+        HAL_NVIC_SetPriority(config->irq, INPUTS_IRQ_PRIORITY, 0);
+        HAL_NVIC_EnableIRQ(config->irq);
+
+        // A change between the read and the arming
+        if (InputRead(config) != input->level) InputSettle((InputIndex)i);
+    }
+
+    return TX_SUCCESS;
+}
+
+
+/**
+    @brief  Have input events set flags in an event flags group.
+
+    The group's owner waits on it as usual, typically with TX_OR_CLEAR,
+    so any number of threads can follow the same input without taking
+    each other's events. Subscriptions last until reset.
+
+    @param  group   Created by the subscriber.
+    @param  events  INPUT_EVENT_ACTIVE(), INPUT_EVENT_INACTIVE() or
+                    INPUT_EVENT_ANY() flags, ORed together.
+
+    @return TX_SUCCESS, or TX_NO_INSTANCE if INPUTS_SUBSCRIBERS groups
+            have subscribed already.
+ */
+UINT InputsSubscribe(TX_EVENT_FLAGS_GROUP *group, ULONG events) {
+    TX_INTERRUPT_SAVE_AREA
+    UINT status = TX_NO_INSTANCE;
+
+    TX_DISABLE
+    if (input_subscriber_count < INPUTS_SUBSCRIBERS) {
+        input_subscribers[input_subscriber_count].group = group;
+        input_subscribers[input_subscriber_count].events = events;
+        input_subscriber_count++;
+        status = TX_SUCCESS;
+    }
+    TX_RESTORE
+
+    return status;
+}
+
+
+/**
+    @brief  An input's settled state.
+ */
+bool InputIsActive(InputIndex input) {
+    return inputs[input].level == input_configs[input].active;
+}
+
+#endif /* APP_ENABLE_INPUTS */
@@ -0,0 +1,284 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include "led_pattern.h"
+#include "profile.h"
+#include "trace.h"
+#include "stm32u5xx_hal.h"
+#include "mv_syscalls.h"
+
+// TIM2 counts microseconds
+#define LED_COUNTER_HZ              1000000U
+#define LED_PERIOD_TICKS            (LED_COUNTER_HZ / LED_PWM_HZ)
+
+// Largest repeat count of one item: BNDT is 16 bits of bytes
+#define LED_ITEM_MAX_PERIODS        (0xFFFFU / 4U)
+
+#if defined(APP_ENABLE_LED_PATTERNS)
+
+LED_PATTERN(led_pattern_heartbeat, true,
+            LED_ON(500), LED_OFF(500));
+
+LED_PATTERN(led_pattern_breathe, true,
+            LED_FADE(255, 1500), LED_FADE(0, 1500));
+
+LED_PATTERN(led_pattern_fault, true,
+            LED_ON(150), LED_OFF(150), LED_ON(150), LED_OFF(150), LED_ON(150), LED_OFF(1250));
+
+/*
+ * Each DMA item writes one compare value to CCR1 once per update event,
+ * as many times as the level is held for, so an item is a level and a
+ * repeat count, and the source address stays put. CCR1 is preloaded, so
+ * a value written at one update takes effect at the next: the PWM never
+ * sees a half-finished period. A looping pattern is a circular queue
+ * with the transfer complete interrupt off; a one-shot one stops after
+ * its last item, with that level in CCR1, and interrupts once so the
+ * HAL knows the channel is free.
+ */
+static TIM_HandleTypeDef led_tim;
+static DMA_HandleTypeDef led_dma;
+static DMA_QListTypeDef  led_queue;
+static DMA_NodeTypeDef   led_items[LED_PATTERN_MAX_ITEMS];
+static uint32_t          led_levels[LED_PATTERN_MAX_ITEMS];    // Each item's compare value
+static uint32_t          led_used;
+static TX_MUTEX          led_lock;
+static uint8_t           led_ready;
+
+
+void GPDMA1_Channel8_IRQHandler(void) {
+    PROFILE_ISR_ENTER();
+    TRACE_ISR_ENTER();
+    HAL_DMA_IRQHandler(&led_dma);
+    TRACE_ISR_EXIT();
+    PROFILE_ISR_EXIT();
+}
+
+
+/**
+    @brief  Brightness 0 to 255 as a compare value: squared, so equal
+            steps look about equal, and 255 keeps the output high.
+ */
+static uint32_t LedCompare(uint32_t level) {
+    return (level * level * LED_PERIOD_TICKS) / (255U * 255U);
+}
+
+
+/**
+    @brief  Append items holding a level for a number of PWM periods.
+
+    @return true, or false if the pattern has run out of items.
+ */
+static bool LedQueue(uint32_t level, uint32_t periods) {
+    DMA_NodeConfTypeDef conf = { 0 };
+    conf.NodeType = DMA_GPDMA_LINEAR_NODE;
+    conf.Init.Request = GPDMA1_REQUEST_TIM2_UP;
+    conf.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+    conf.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    conf.Init.SrcInc = DMA_SINC_FIXED;
+    conf.Init.DestInc = DMA_DINC_FIXED;
+    conf.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_WORD;
+    conf.Init.DestDataWidth = DMA_DEST_DATAWIDTH_WORD;
+    conf.Init.SrcBurstLength = 1;
+    conf.Init.DestBurstLength = 1;
+    conf.Init.Priority = DMA_LOW_PRIORITY_LOW_WEIGHT;
+    conf.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT1;
+    conf.Init.TransferEventMode = DMA_TCEM_LAST_LL_ITEM_TRANSFER;
+    conf.Init.Mode = DMA_NORMAL;
+    conf.DataHandlingConfig.DataExchange = DMA_EXCHANGE_NONE;
+    conf.DataHandlingConfig.DataAlignment = DMA_DATA_RIGHTALIGN_ZEROPADDED;
+    conf.TriggerConfig.TriggerPolarity = DMA_TRIG_POLARITY_MASKED;
+    conf.DstAddress = (uint32_t)&TIM2->CCR1;
+
+    if (periods == 0) periods = 1;
+    while (periods > 0) {
+        if (led_used == LED_PATTERN_MAX_ITEMS) return false;
+
+        uint32_t part = periods < LED_ITEM_MAX_PERIODS ? periods : LED_ITEM_MAX_PERIODS;
+        led_levels[led_used] = LedCompare(level);
+        conf.SrcAddress = (uint32_t)&led_levels[led_used];
+        conf.DataSize = part * 4U;
+
+        DMA_NodeTypeDef *item = &led_items[led_used];
+        if (HAL_DMAEx_List_BuildNode(&conf, item) != HAL_OK ||
+            HAL_DMAEx_List_InsertNode_Tail(&led_queue, item) != HAL_OK) {
+            return false;
+        }
+
+        led_used++;
+        periods -= part;
+    }
+
+    return true;
+}
+
+
+/**
+    @brief  Stop the pattern playing, leaving the LED at its last level.
+            Call with the lock held.
+ */
+static void LedHalt(void) {
+    if (led_dma.State == HAL_DMA_STATE_BUSY) HAL_DMA_Abort(&led_dma);
+    if (led_dma.LinkedListQueue != NULL) HAL_DMAEx_List_UnLinkQ(&led_dma);
+    if (led_queue.Head != NULL) HAL_DMAEx_List_ResetQ(&led_queue);
+    led_used = 0;
+}
+
+
+/**
+    @brief  Set up TIM2 for PWM on PA5 and its DMA channel, with the LED
+            off.
+
+    Call once, from App_ThreadX_Init(). PA5 leaves the pin table's GPIO
+    output mode for the timer: PIN_TOGGLE(UnderTest) no longer moves it.
+
+    @return TX_SUCCESS, the ThreadX error, or TX_NOT_AVAILABLE if the
+            timer or the DMA channel could not be configured.
+ */
+UINT LedPatternInit(void) {
+    UINT status = tx_mutex_create(&led_lock, "LedPattern", TX_INHERIT);
+    if (status != TX_SUCCESS) return status;
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+    // Timer clock: PCLK1, doubled when APB1 is divided
+    RCC_ClkInitTypeDef clocks;
+    uint32_t latency, clock;
+    HAL_RCC_GetClockConfig(&clocks, &latency);
+    mvGetPClk1(&clock);
+    if (clocks.APB1CLKDivider != RCC_HCLK_DIV1) clock *= 2U;
+
+    led_tim.Instance = TIM2;
+    led_tim.Init.Prescaler = clock / LED_COUNTER_HZ - 1U;
+    led_tim.Init.Period = LED_PERIOD_TICKS - 1U;
+    led_tim.Init.CounterMode = TIM_COUNTERMODE_UP;
+    led_tim.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    led_tim.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+
+    TIM_OC_InitTypeDef channel = { 0 };
+    channel.OCMode = TIM_OCMODE_PWM1;
+    channel.Pulse = 0;
+    channel.OCPolarity = TIM_OCPOLARITY_HIGH;
+    channel.OCFastMode = TIM_OCFAST_DISABLE;
+
+    if (HAL_TIM_PWM_Init(&led_tim) != HAL_OK ||
+        HAL_TIM_PWM_ConfigChannel(&led_tim, &channel, TIM_CHANNEL_1) != HAL_OK) {
+        return TX_NOT_AVAILABLE;
+    }
+
+    led_dma.Instance = GPDMA1_Channel8;
+    led_dma.InitLinkedList.Priority = DMA_LOW_PRIORITY_LOW_WEIGHT;
+    led_dma.InitLinkedList.LinkStepMode = DMA_LSM_FULL_EXECUTION;
+    led_dma.InitLinkedList.LinkAllocatedPort = DMA_LINK_ALLOCATED_PORT0;
+    led_dma.InitLinkedList.TransferEventMode = DMA_TCEM_LAST_LL_ITEM_TRANSFER;
+    led_dma.InitLinkedList.LinkedListMode = DMA_LINKEDLIST_NORMAL;
+    if (HAL_DMAEx_List_Init(&led_dma) != HAL_OK) return TX_NOT_AVAILABLE;
+
+    HAL_NVIC_SetPriority(GPDMA1_Channel8_IRQn, LED_PATTERN_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(GPDMA1_Channel8_IRQn);
+
+    GPIO_InitTypeDef gpio = { 0 };
+    gpio.Pin = GPIO_PIN_5;
+    gpio.Mode = GPIO_MODE_AF_PP;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    gpio.Alternate = GPIO_AF1_TIM2;
+    HAL_GPIO_Init(GPIOA, &gpio);
+
+    // Each update event asks the DMA for the next compare value
+    __HAL_TIM_ENABLE_DMA(&led_tim, TIM_DMA_UPDATE);
+    if (HAL_TIM_PWM_Start(&led_tim, TIM_CHANNEL_1) != HAL_OK) return TX_NOT_AVAILABLE;
+
+    led_ready = 1;
+    return TX_SUCCESS;
+}
+
+
+/**
+    @brief  Play a pattern, replacing whatever was playing.
+
+    The CPU only builds the pattern's DMA items; the timer and the DMA
+    play it from then on. Call from a thread.
+
+    @param  pattern A pattern that needs no more than
+                    LED_PATTERN_MAX_ITEMS items.
+
+    @return true, or false if the pattern is too long, when the LED is
+            left off.
+ */
+bool LedPatternStart(const LedPattern *pattern) {
+    if (led_ready == 0) return false;
+
+    tx_mutex_get(&led_lock, TX_WAIT_FOREVER);
+    LedHalt();
+
+    bool queued = pattern->count > 0;
+
+    // Where the first step fades from: the end of the last, when looping
+    uint32_t level = 0;
+    if (queued && pattern->repeat) level = pattern->steps[pattern->count - 1U].level;
+
+    for (uint32_t i = 0; i < pattern->count && queued; i++) {
+        const LedStep *step = &pattern->steps[i];
+        uint32_t periods = (uint32_t)step->ms * LED_PWM_HZ / 1000U;
+
+        if (step->fade) {
+            // Even slices, with the last one taking the remainder
+            uint32_t slice = periods / LED_FADE_SLICES;
+            for (uint32_t k = 1; k <= LED_FADE_SLICES && queued; k++) {
+                uint32_t through = (uint32_t)((int32_t)level + ((int32_t)step->level - (int32_t)level) * (int32_t)k / LED_FADE_SLICES);
+                queued = LedQueue(through, k < LED_FADE_SLICES ? slice : periods - slice * (LED_FADE_SLICES - 1U));
+            }
+        } else {
+            queued = LedQueue(step->level, periods);
+        }
+
+        level = step->level;
+    }
+
+    if (queued && pattern->repeat) queued = HAL_DMAEx_List_SetCircularMode(&led_queue) == HAL_OK;
+
+    if (queued) {
+        // Start on the first level rather than one period of the old one
+        __HAL_TIM_SET_COMPARE(&led_tim, TIM_CHANNEL_1, led_levels[0]);
+        // LinkQ() checks the queue against the handle's mode, which only
+        // List_Init() copies from InitLinkedList: set it directly
+        led_dma.Mode = pattern->repeat ? DMA_LINKEDLIST_CIRCULAR : DMA_LINKEDLIST_NORMAL;
+        queued = HAL_DMAEx_List_LinkQ(&led_dma, &led_queue) == HAL_OK &&
+                 HAL_DMAEx_List_Start_IT(&led_dma) == HAL_OK;
+
+        // A loop never completes: only errors need the interrupt. A
+        // one-shot pattern needs just the one at its end
+        if (queued) __HAL_DMA_DISABLE_IT(&led_dma, pattern->repeat ? DMA_IT_TC | DMA_IT_HT : DMA_IT_HT);
+    }
+
+    if (!queued) {
+        LedHalt();
+        __HAL_TIM_SET_COMPARE(&led_tim, TIM_CHANNEL_1, 0);
+    }
+
+    tx_mutex_put(&led_lock);
+    return queued;
+}
+
+
+/**
+    @brief  Stop any pattern and hold the LED at one brightness.
+
+    @param  level   0 (off) to 255.
+ */
+void LedPatternSet(uint8_t level) {
+    if (led_ready == 0) return;
+
+    tx_mutex_get(&led_lock, TX_WAIT_FOREVER);
+    LedHalt();
+    __HAL_TIM_SET_COMPARE(&led_tim, TIM_CHANNEL_1, LedCompare(level));
+    tx_mutex_put(&led_lock);
+}
+
+#endif /* APP_ENABLE_LED_PATTERNS */
@@ -11,9 +11,28 @@
 #include <errno.h>
 
 #include "logging.h"
+#include "boot_profile.h"
+#include "flash_log.h"
+#include "frame.h"
+#include "profile.h"
+#include "ramfunc.h"
+#include "trace.h"
+#include "tx_api.h"
 #include "stm32u5xx_hal.h"
 #include "mv_syscalls.h"
 
+#ifndef TX_TIMER_TICKS_PER_SECOND
+#define TX_TIMER_TICKS_PER_SECOND   ((ULONG)100)
+#endif
+
+// Network status poll while the channel comes up, in ThreadX ticks
+#define LOG_CONNECT_POLL_TICKS      (TX_TIMER_TICKS_PER_SECOND / 20)
+
+// Ticks a refused write is retried for, one per tick, while the channel
+// empties its send buffer: a ServerLog() line, and a backlog frame
+#define LOG_WRITE_RETRY_TICKS       TX_TIMER_TICKS_PER_SECOND
+#define LOG_DRAIN_RETRY_TICKS       20
+
 
 // Central store for Microvisor resource handles used in this code.
 // See 'https://www.twilio.com/docs/iot/microvisor/syscalls#handles'
@@ -27,14 +46,147 @@ struct {
 // a time -- each record is 16 bytes in size.
 static volatile struct MvNotification log_notification_buffer[16];
 
+#define LOG_NOTIFICATIONS           (sizeof(log_notification_buffer) / sizeof(log_notification_buffer[0]))
+
+// Event type of a store slot with no record in it
+#define LOG_NOTIFICATION_FREE       0xFFFFFFFFUL
+
+// Next record Microvisor writes
+static uint32_t log_notification_index;
+
 // Arbitrary user-specified uint32_t tags for any notifications
 // from Microvisor calls that support notifications:
 const uint32_t USER_TAG_LOGGING_REQUEST_NETWORK = 1;
 const uint32_t USER_TAG_LOGGING_OPEN_CHANNEL    = 2;
 
+// Serialises channel writes that must not interleave. Created on first
+// use, as the channel is opened on first use
+static TX_MUTEX log_lock;
+static volatile uint8_t log_lock_ready;
+
+// ServerLog() line, with its newline: no longer than the send buffer
+static char log_line[LOG_SEND_BUFFER_SIZE];
+
+// Set when the channel or the network drops, and when the network
+// status changes, for a thread to act on: system calls cannot be made
+// from the notification IRQ
+static volatile uint8_t log_lost;
+static volatile uint8_t log_check;
+
+#if defined(LOG_CONNECT_THREAD)
+#define LOG_EVENT_WAKE              0x01UL
+
+static TX_THREAD log_connect_thread;
+static TX_EVENT_FLAGS_GROUP log_connect_events;
+static volatile uint8_t log_connecting;
+#endif
+
+#if defined(APP_ENABLE_FLASH_LOG)
+static volatile uint8_t log_draining;
+
+static void LogDrainBacklog(void);
+#endif
+
+
+/**
+    @brief  Note that the channel has dropped, so it is closed and opened
+            again. Callable from the notification IRQ.
+ */
+static void LogChannelLost(void) {
+    log_lost = 1;
+
+#if defined(LOG_CONNECT_THREAD)
+    // Frames are kept from now on, until the connect thread has the
+    // channel back
+    log_connecting = 1;
+    tx_event_flags_set(&log_connect_events, LOG_EVENT_WAKE, TX_OR);
+#endif
+}
+
+
+RAMFUNC void TIM8_BRK_IRQHandler(void) {
+    PROFILE_ISR_ENTER();
+    TRACE_ISR_ENTER();
+
+    // Microvisor writes records into the store in turn: take each new
+    // one, and free its slot
+    for (uint32_t i = 0; i < LOG_NOTIFICATIONS; i++) {
+        volatile struct MvNotification *record = &log_notification_buffer[log_notification_index];
+        uint32_t event_type = record->event_type;
+        if (event_type == LOG_NOTIFICATION_FREE) break;
 
-void TIM8_BRK_IRQHandler(void) {
-    // You can handle events here
+        record->event_type = LOG_NOTIFICATION_FREE;
+        log_notification_index = (log_notification_index + 1) % LOG_NOTIFICATIONS;
+
+        if (event_type == MV_EVENTTYPE_CHANNELNOTCONNECTED) {
+            LogChannelLost();
+        } else if (event_type == MV_EVENTTYPE_NETWORKSTATUSCHANGED) {
+            log_check = 1;
+#if defined(LOG_CONNECT_THREAD)
+            tx_event_flags_set(&log_connect_events, LOG_EVENT_WAKE, TX_OR);
+#endif
+        }
+    }
+
+    TRACE_ISR_EXIT();
+    PROFILE_ISR_EXIT();
+}
+
+
+/**
+    @brief  Take the log lock. Before the kernel runs there is only one
+            caller, and nothing to take.
+ */
+static void LogLock(void) {
+    TX_INTERRUPT_SAVE_AREA
+
+    if (tx_thread_identify() == TX_NULL) return;
+
+    TX_DISABLE
+    if (log_lock_ready == 0) {
+        tx_mutex_create(&log_lock, "Log", TX_INHERIT);
+        log_lock_ready = 1;
+    }
+    TX_RESTORE
+
+    tx_mutex_get(&log_lock, TX_WAIT_FOREVER);
+}
+
+
+static void LogUnlock(void) {
+    if (tx_thread_identify() != TX_NULL) tx_mutex_put(&log_lock);
+}
+
+
+/**
+    @brief  Write to the log channel, retrying while the send buffer is
+            too full to take the data.
+
+    @param  data        The bytes to send.
+    @param  length      The number of bytes.
+    @param  retry_ticks How long to keep trying, one try a tick. Only a
+                        thread can wait: from anywhere else there is one
+                        try.
+
+    @return true, or false if the channel kept refusing the write, or
+            has dropped.
+ */
+static bool LogWrite(const uint8_t *data, uint32_t length, ULONG retry_ticks) {
+    uint32_t available, status;
+    ULONG tries = 0;
+
+    while ((status = mvWriteChannel(log_handles.channel, data, length, &available)) != MV_STATUS_OKAY) {
+        if (status == MV_STATUS_CHANNELCLOSED) {
+            LogChannelLost();
+            return false;
+        }
+
+        // Most likely the send buffer is full: let it empty
+        if (++tries > retry_ticks || tx_thread_identify() == TX_NULL) return false;
+        tx_thread_sleep(1);
+    }
+
+    return true;
 }
 
 
@@ -42,44 +194,52 @@ void TIM8_BRK_IRQHandler(void) {
     @brief  Open a logging channel.
 
     Open a data channel for Microvisor logging.
-    This call will also request a network connection.
+    This call will also request a network connection. The notification
+    center is set up once, and kept when the channel is reopened.
  */
 void OpenLogChannel(void) {
-    // Clear the notification store
-    memset((void *)log_notification_buffer, 0xFF, sizeof(log_notification_buffer));
-
-    // Configure a notification center for network-centric notifications
-    static struct MvNotificationSetup notification_center_setup = {
-        .irq = TIM8_BRK_IRQn,
-        .buffer = (struct MvNotification *)log_notification_buffer,
-        .buffer_size = sizeof(log_notification_buffer)
-    };
-
-    // Ask Microvisor to establish the notification center
-    // and confirm that it has accepted the request
-    uint32_t status = mvSetupNotifications(&notification_center_setup, &log_handles.notification);
-    assert(status == MV_STATUS_OKAY);
+    uint32_t status;
 
-    NVIC_ClearPendingIRQ(TIM8_BRK_IRQn);
-    NVIC_EnableIRQ(TIM8_BRK_IRQn);
+    if (log_handles.notification == 0) {
+        // Clear the notification store
+        memset((void *)log_notification_buffer, 0xFF, sizeof(log_notification_buffer));
+        log_notification_index = 0;
+
+        // Configure a notification center for network-centric notifications
+        static struct MvNotificationSetup notification_center_setup = {
+            .irq = TIM8_BRK_IRQn,
+            .buffer = (struct MvNotification *)log_notification_buffer,
+            .buffer_size = sizeof(log_notification_buffer)
+        };
+
+        // Ask Microvisor to establish the notification center
+        // and confirm that it has accepted the request
+        status = mvSetupNotifications(&notification_center_setup, &log_handles.notification);
+        assert(status == MV_STATUS_OKAY);
 
-    // Configure the network connection request
-    struct MvRequestNetworkParams network_params = {
-        .version = 1,
-        .v1 = {
-            .notification_handle = log_handles.notification,
-            .notification_tag = USER_TAG_LOGGING_REQUEST_NETWORK,
-        }
-    };
+        NVIC_ClearPendingIRQ(TIM8_BRK_IRQn);
+        NVIC_EnableIRQ(TIM8_BRK_IRQn);
+    }
 
-    // Ask Microvisor to establish the network connection
-    // and confirm that it has accepted the request
-    status = mvRequestNetwork(&network_params, &log_handles.network);
-    assert(status == MV_STATUS_OKAY);
+    if (log_handles.network == 0) {
+        // Configure the network connection request
+        struct MvRequestNetworkParams network_params = {
+            .version = 1,
+            .v1 = {
+                .notification_handle = log_handles.notification,
+                .notification_tag = USER_TAG_LOGGING_REQUEST_NETWORK,
+            }
+        };
+
+        // Ask Microvisor to establish the network connection
+        // and confirm that it has accepted the request
+        status = mvRequestNetwork(&network_params, &log_handles.network);
+        assert(status == MV_STATUS_OKAY);
+    }
 
     // Set up the channel's send and receive buffers
     static volatile uint8_t receive_buffer[16];
-    static volatile uint8_t send_buffer[512] __attribute__((aligned(512)));
+    static volatile uint8_t send_buffer[LOG_SEND_BUFFER_SIZE] __attribute__((aligned(512)));
     char endpoint[] = "log";
 
     // Configure the required data channel
@@ -112,20 +272,166 @@ void OpenLogChannel(void) {
             break;
         }
 
-        // ... or wait a short period before retrying
+        // ... or wait a short period before retrying. From a thread,
+        // sleep, so lower priority threads keep running meanwhile
+        if (tx_thread_identify() != TX_NULL) {
+            tx_thread_sleep(LOG_CONNECT_POLL_TICKS);
+            continue;
+        }
+
         for (volatile unsigned i = 0; i < 50000; i++) {
             // No op
             __asm("nop");
         }
     }
 
+    BOOT_PROFILE_MARK(BOOT_PHASE_NETWORK);
+
     // Ask Microvisor to open the channel
     // and confirm that it has accepted the request
     status = mvOpenChannel(&channel_params, &log_handles.channel);
     assert(status == MV_STATUS_OKAY);
+
+    BOOT_PROFILE_MARK(BOOT_PHASE_LOG_CHANNEL);
+#if defined(APP_ENABLE_BOOT_PROFILE)
+    BootProfileReport();
+#endif
+
+#if defined(APP_ENABLE_FLASH_LOG)
+    // Frames kept while the network was down go first
+    LogDrainBacklog();
+#endif
 }
 
 
+/**
+    @brief  Close a channel that has dropped, and release its network,
+            so the channel can be opened again. Call with the log lock.
+ */
+static void LogDropChannel(void) {
+    // The handles may be stale already, so the results are moot
+    log_lost = 0;
+    if (log_handles.channel != 0) mvCloseChannel(&log_handles.channel);
+    if (log_handles.network != 0) mvReleaseNetwork(&log_handles.network);
+    log_handles.channel = 0;
+    log_handles.network = 0;
+}
+
+
+/**
+    @brief  Open the log channel, or close and reopen it if it has
+            dropped, then send any backlog.
+
+    Holds the log lock throughout, waiting for the network if need be.
+ */
+static void LogReconnect(void) {
+    LogLock();
+
+    // A network status change may be the network going: ask
+    if (log_check != 0) {
+        enum MvNetworkStatus status;
+        log_check = 0;
+
+        if (log_handles.network != 0 &&
+            (mvGetNetworkStatus(log_handles.network, &status) != MV_STATUS_OKAY ||
+             status != MV_NETWORKSTATUS_CONNECTED)) {
+            log_lost = 1;
+        }
+    }
+
+    if (log_lost != 0) LogDropChannel();
+    if (log_handles.channel == 0) OpenLogChannel();
+    LogUnlock();
+}
+
+
+/**
+    @brief  Make sure the log channel is open before writing to it.
+
+    The first thread to find it closed opens it, holding the log lock
+    while it waits for the network. Any other thread that logs meanwhile,
+    the connect thread included, waits on the lock for it rather than
+    opening the channel again.
+
+    A channel that has dropped is reopened by the connect thread, where
+    there is one. Otherwise the next thread to log reopens it.
+ */
+static void LogEnsureChannel(void) {
+    // Do we have an open channel? If not, any stored channel handle
+    // will be invalid, ie. zero. If that's the case, open a channel
+    if (log_handles.channel != 0) {
+#if defined(LOG_CONNECT_THREAD)
+        return;
+#else
+        if (log_lost == 0 && log_check == 0) return;
+#endif
+    }
+
+    LogReconnect();
+}
+
+
+#if defined(LOG_CONNECT_THREAD)
+/**
+    @brief  Connect thread: open the log channel in the background, then
+            reopen it whenever it drops.
+ */
+static VOID LogConnectThread(ULONG input) {
+    ULONG flags;
+    (void)input;
+
+    while (1) {
+        LogReconnect();
+
+        // Writers send again, unless the channel has dropped meanwhile
+        log_connecting = log_lost;
+
+        tx_event_flags_get(&log_connect_events, LOG_EVENT_WAKE, TX_OR_CLEAR, &flags, TX_WAIT_FOREVER);
+    }
+}
+
+
+/**
+    @brief  Start opening the log channel without holding up the
+            other threads.
+
+    Call from App_ThreadX_Init(), after the acquisition threads are
+    created. The channel opens at LOG_CONNECT_THREAD_PRIO, so those
+    threads sample from boot rather than from modem attach. The thread
+    stays, to reopen the channel whenever the channel or the network
+    drops.
+
+    @param  pool    Byte pool to take the connect thread's stack from.
+
+    @return TX_SUCCESS, or the ThreadX error.
+ */
+UINT LogConnectStart(TX_BYTE_POOL *pool) {
+    VOID *stack;
+
+    UINT status = tx_event_flags_create(&log_connect_events, "LogConnect");
+    if (status != TX_SUCCESS) return status;
+
+    status = tx_byte_allocate(pool, &stack, LOG_CONNECT_STACK_SIZE, TX_NO_WAIT);
+    if (status != TX_SUCCESS) {
+        tx_event_flags_delete(&log_connect_events);
+        return status;
+    }
+
+    log_connecting = 1;
+    status = tx_thread_create(&log_connect_thread, "LogConnect", LogConnectThread, 0,
+                              stack, LOG_CONNECT_STACK_SIZE,
+                              LOG_CONNECT_THREAD_PRIO, LOG_CONNECT_THREAD_PRIO,
+                              TX_NO_TIME_SLICE, TX_AUTO_START);
+    if (status != TX_SUCCESS) {
+        log_connecting = 0;
+        tx_byte_release(stack);
+        tx_event_flags_delete(&log_connect_events);
+    }
+    return status;
+}
+#endif
+
+
 /**
     @brief  Open the logging channel.
 
@@ -175,27 +481,130 @@ void CloseLogChannel(void) {
     @brief  Send a log entry.
 
     Send a log message, opening a logging data channel if one
-    is not already open.
+    is not already open. When the channel's send buffer is full, wait
+    up to LOG_WRITE_RETRY_TICKS for room; a line that still does not
+    fit is dropped.
 
     @param  message     The log entry -- a C string -- to send.
  */
 void ServerLog(const char *message) {
-    // Do we have an open channel? If not, any stored channel handle
-    // will be invalid, ie. zero. If that's the case, open a channel
-    if (log_handles.channel == 0) {
-        OpenLogChannel();
+    LogEnsureChannel();
+
+    // Write out the message string with a convenient newline, in one
+    // write under the lock, so lines logged by different threads never
+    // interleave. A longer line than the send buffer holds is cut short.
+    // Lines queue on the lock while one waits for room, so they still
+    // go out in order
+    LogLock();
+    size_t length = strlen(message);
+    if (length > sizeof(log_line) - 1) length = sizeof(log_line) - 1;
+    memcpy(log_line, message, length);
+    log_line[length++] = '\n';
+
+    LogWrite((const uint8_t*)log_line, length, LOG_WRITE_RETRY_TICKS);
+    LogUnlock();
+}
+
+
+#if defined(APP_ENABLE_FLASH_LOG)
+/**
+    @brief  Keep a sealed frame in the flash backlog.
+ */
+static bool LogKeepFrame(const uint8_t *frame, uint8_t type, uint32_t size) {
+    return size <= FLASH_LOG_MAX_RECORD && FlashLogAppend(type, frame, (uint16_t)size);
+}
+
+
+/**
+    @brief  Send the frames in the flash backlog, oldest first, as fast
+            as the channel takes them.
+
+    They go straight from flash to the channel. One thread drains at a
+    time; frames logged meanwhile join the backlog, so they still arrive
+    in order. A write the channel keeps refusing ends the drain and
+    leaves the rest for the next one.
+ */
+static void LogDrainBacklog(void) {
+    TX_INTERRUPT_SAVE_AREA
+    bool sent_all;
+
+    do {
+        TX_DISABLE
+        bool claimed = log_draining == 0;
+        log_draining = 1;
+        TX_RESTORE
+
+        if (!claimed) return;
+
+        const uint8_t *frame;
+        uint8_t type;
+        uint16_t length;
+        sent_all = true;
+
+        while (sent_all && (frame = FlashLogPeek(&type, &length)) != NULL) {
+            sent_all = LogWrite(frame, length, LOG_DRAIN_RETRY_TICKS);
+            if (sent_all) FlashLogConsume();
+        }
+
+        log_draining = 0;
+
+        // Pick up frames another thread kept after the last peek
+    } while (sent_all && !FlashLogIsEmpty());
+}
+#endif
+
+
+/**
+    @brief  Send a framed record.
+
+    Seals the frame and writes it in one go, opening a logging data
+    channel if one is not already open, so records from different threads
+    never interleave. A frame bigger than the channel's free space is not
+    sent; tools/frame_decode.py then reports a gap in the sequence.
+
+    With the flash backlog, a frame logged while the connect thread is
+    opening or reopening the channel, or one the channel refuses, is kept
+    in flash instead and sent when the channel next opens or takes a
+    frame.
+
+    @param  frame   FRAME_SIZE(length) bytes, with the payload already
+                    at FRAME_PAYLOAD(frame).
+    @param  type    The record type.
+    @param  length  Payload bytes.
+
+    @return true, or false if the frame was neither sent nor kept.
+ */
+bool ServerLogFrame(uint8_t *frame, uint8_t type, uint16_t length) {
+    uint32_t size = FrameSeal(frame, type, length);
+
+#if defined(APP_ENABLE_FLASH_LOG)
+    if (log_connecting != 0) return LogKeepFrame(frame, type, size);
+#endif
+
+    LogEnsureChannel();
+
+#if defined(APP_ENABLE_FLASH_LOG)
+    // Behind the backlog, and help send it
+    if (!FlashLogIsEmpty()) {
+        bool kept = LogKeepFrame(frame, type, size);
+        LogDrainBacklog();
+        return kept;
     }
+#endif
 
-    // Write out the message string and then send a convenient
-    // carriage return too. Each time confirm that Microvisor has
-    // accepted the request to write data to the channel.
     uint32_t available, status;
-    status = mvWriteChannel(log_handles.channel, (const uint8_t*)message, strlen(message), &available);
-    assert(status == MV_STATUS_OKAY);
-    status = mvWriteChannel(log_handles.channel, (const uint8_t*)"\n", 1, &available);
-    assert(status == MV_STATUS_OKAY);
+    status = mvWriteChannel(log_handles.channel, frame, size, &available);
+    if (status == MV_STATUS_OKAY) return true;
+    if (status == MV_STATUS_CHANNELCLOSED) LogChannelLost();
+
+#if defined(APP_ENABLE_FLASH_LOG)
+    return LogKeepFrame(frame, type, size);
+#else
+    return false;
+#endif
 }
 
+
 /**
     Wire up the `stdio` system call, so that `printf()`
     works as a logging message generator.
@@ -212,11 +621,7 @@ int _write(int file, char *ptr, int length) {
         return -1;
     }
 
-    // Do we have an open channel? If not, any stored channel handle
-    // will be invalid, ie. zero. If that's the case, open a channel
-    if (log_handles.channel == 0) {
-        OpenLogChannel();
-    }
+    LogEnsureChannel();
 
     // Write out the message string. Each time confirm that Microvisor
     // has accepted the request to write data to the channel.
@@ -227,6 +632,7 @@ int _write(int file, char *ptr, int length) {
         // out to the channel
         return written;
     } else {
+        if (status == MV_STATUS_CHANNELCLOSED) LogChannelLost();
         errno = EIO;
         return -1;
     }
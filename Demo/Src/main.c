@@ -28,7 +28,11 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "boot_profile.h"
+#include "fpu.h"
+#include "icache.h"
+#include "pins.h"
+#include "ramfunc.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -73,6 +77,14 @@ void StartDebugTask(void *argument);
 int main(void)
 {
     /* USER CODE BEGIN 1 */
+#if defined(APP_ENABLE_HARD_FLOAT)
+    if (!FpuInit())
+    {
+        Error_Handler();
+    }
+#endif
+    RAMFUNC_INIT();
+    BOOT_PROFILE_START();
     /* USER CODE END 1 */
 
     /* MCU Configuration--------------------------------------------------------*/
@@ -81,19 +93,23 @@ int main(void)
     HAL_Init();
 
     /* USER CODE BEGIN Init */
+    BOOT_PROFILE_MARK(BOOT_PHASE_HAL_INIT);
+#if defined(APP_ENABLE_ICACHE)
+    ICacheInit();
+#endif
     /* USER CODE END Init */
 
     /* Configure the system clock */
     SystemClock_Config();
 
     /* USER CODE BEGIN SysInit */
-
+    BOOT_PROFILE_MARK(BOOT_PHASE_CLOCK_CONFIG);
     /* USER CODE END SysInit */
 
     /* Initialize all configured peripherals */
     MX_GPIO_Init();
     /* USER CODE BEGIN 2 */
-
+    BOOT_PROFILE_MARK(BOOT_PHASE_GPIO_INIT);
     /* USER CODE END 2 */
 
     /* Init scheduler */
@@ -160,21 +176,9 @@ void SystemClock_Config(void)
   */
 void MX_GPIO_Init(void)
 {
-    GPIO_InitTypeDef GPIO_InitStruct = {0};
-
-    /* GPIO Ports Clock Enable */
-
-    __HAL_RCC_GPIOA_CLK_ENABLE();
-
-    /*Configure GPIO pin Output Level */
-    HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET);
-
-    /*Configure GPIO pin : PA5 - Pin under test */
-    GPIO_InitStruct.Pin = GPIO_PIN_5;
-    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
-    GPIO_InitStruct.Pull = GPIO_PULLUP;
-    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
-    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+    /* Clocks, output levels and modes of the pins in PINS_TABLE (pins.h),
+       including PA5 - Pin under test */
+    PinsInit();
 }
 
 /* USER CODE BEGIN 4 */
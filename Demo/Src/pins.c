@@ -0,0 +1,53 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include "pins.h"
+
+// One HAL_GPIO_Init() call's worth of pin configuration
+typedef struct {
+    GPIO_TypeDef *port;
+    uint32_t      pin;
+    uint32_t      mode;
+    uint32_t      pull;
+    uint32_t      speed;
+} PinConfig;
+
+#define PINS_CONFIG_ROW(name, port, number, mode, pull, speed, level)                               \
+    { GPIO##port, 1UL << (number), (mode), (pull), (speed) },
+
+static const PinConfig pin_configs[] = {
+    PINS_TABLE(PINS_CONFIG_ROW)
+};
+
+#define PINS_ENABLE_CLOCK(name, port, number, mode, pull, speed, level)                             \
+    __HAL_RCC_GPIO##port##_CLK_ENABLE();
+
+#define PINS_SET_LEVEL(name, port, number, mode, pull, speed, level)                                \
+    PIN_BSRR_WRITE(GPIO##port, (level) ? 1UL << (number) : 1UL << ((number) + 16));
+
+
+/**
+    @brief  Set up every pin in PINS_TABLE.
+
+    Clocks first, then the output levels, then the modes, so outputs
+    come up driving their initial level rather than glitching through
+    whatever ODR held. Call once, from MX_GPIO_Init().
+ */
+void PinsInit(void) {
+    PINS_TABLE(PINS_ENABLE_CLOCK)
+    PINS_TABLE(PINS_SET_LEVEL)
+
+    GPIO_InitTypeDef init = { 0 };
+    for (uint32_t i = 0; i < sizeof(pin_configs) / sizeof(pin_configs[0]); i++) {
+        const PinConfig *config = &pin_configs[i];
+        init.Pin = config->pin;
+        init.Mode = config->mode;
+        init.Pull = config->pull;
+        init.Speed = config->speed;
+        HAL_GPIO_Init(config->port, &init);
+    }
+}
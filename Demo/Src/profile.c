@@ -0,0 +1,334 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <string.h>
+
+#include "profile.h"
+#include "logging.h"
+#include "ramfunc.h"
+#include "stm32u5xx_hal.h"
+
+#if defined(TX_ENABLE_EXECUTION_CHANGE_NOTIFY)
+
+// Scheduler internals: the running thread and the created thread list
+#include "tx_thread.h"
+
+
+/*
+ * Every cycle between two reports is charged to exactly one context: the
+ * running thread, the innermost active ISR, or idle (no thread ready, the
+ * scheduler waiting for an interrupt). ThreadX calls the hooks below on each
+ * change, and profile_mark is the DWT cycle count at the last change.
+ */
+
+// Exception numbers: 16 system exceptions plus the STM32U585 IRQs
+#define PROFILE_EXCEPTIONS          (16 + 128)
+#define PROFILE_ISR_NEST_MAX        8
+
+#ifndef TX_TIMER_TICKS_PER_SECOND
+#define TX_TIMER_TICKS_PER_SECOND   ((ULONG)100)
+#endif
+
+typedef struct {
+    uint32_t cycles;
+    uint32_t count;
+} ProfileIsr;
+
+static uint32_t   profile_mark;
+static uint32_t   profile_idle_cycles;
+static uint32_t   profile_switches;
+static uint32_t   profile_isr_depth;
+static uint8_t    profile_isr_stack[PROFILE_ISR_NEST_MAX];
+static ProfileIsr profile_isrs[PROFILE_EXCEPTIONS];
+
+static TX_THREAD  profile_thread;
+static uint32_t   profile_window_start;
+static uint16_t   profile_sequence;
+
+// Wire format, little endian:
+//   header   'T' 'P' version threads isrs flags sequence:u16
+//            core_hz:u32 window:u32 idle:u32 switches:u32
+//   thread   name[8] priority:u8 runs:u16 cycles:u32       (x threads)
+//   isr      exception:u8 count:u32 cycles:u32              (x isrs)
+#define PROFILE_HEADER_SIZE         24
+#define PROFILE_THREAD_SIZE         15
+#define PROFILE_ISR_SIZE            9
+#define PROFILE_REPORT_SIZE         (PROFILE_HEADER_SIZE + PROFILE_MAX_THREADS * PROFILE_THREAD_SIZE \
+                                     + PROFILE_MAX_ISRS * PROFILE_ISR_SIZE)
+#define PROFILE_LINE_PREFIX         "#prof "
+
+// Header flags
+#define PROFILE_FLAG_THREADS_TRUNCATED  0x01
+#define PROFILE_FLAG_ISRS_TRUNCATED     0x02
+
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+/*
+ * EXECUTION CHANGE HOOKS
+ */
+
+/**
+    @brief  Cycles since the last context change, moving the mark on.
+
+    @return The elapsed cycle count.
+ */
+static inline uint32_t ProfileElapsed(void) {
+    uint32_t now = DWT->CYCCNT;
+    uint32_t elapsed = now - profile_mark;
+    profile_mark = now;
+    return elapsed;
+}
+
+
+/**
+    @brief  Charge cycles to whatever ran up to now.
+
+    @param  cycles  The cycles to charge.
+ */
+static inline void ProfileCharge(uint32_t cycles) {
+    if (profile_isr_depth > 0) {
+        // Beyond the tracked depth, charge the innermost tracked ISR
+        uint32_t top = profile_isr_depth < PROFILE_ISR_NEST_MAX ? profile_isr_depth : PROFILE_ISR_NEST_MAX;
+        profile_isrs[profile_isr_stack[top - 1]].cycles += cycles;
+    } else if (_tx_thread_current_ptr != TX_NULL) {
+        _tx_thread_current_ptr->tx_thread_profile_cycles += cycles;
+    } else {
+        profile_idle_cycles += cycles;
+    }
+}
+
+
+/**
+    @brief  A thread is about to run. Called by the scheduler with the
+            new thread already current, so the gap is charged to idle.
+ */
+RAMFUNC VOID _tx_execution_thread_enter(VOID) {
+    profile_idle_cycles += ProfileElapsed();
+    _tx_thread_current_ptr->tx_thread_profile_runs++;
+    profile_switches++;
+}
+
+
+/**
+    @brief  The current thread is being switched out.
+ */
+RAMFUNC VOID _tx_execution_thread_exit(VOID) {
+    if (_tx_thread_current_ptr != TX_NULL) {
+        _tx_thread_current_ptr->tx_thread_profile_cycles += ProfileElapsed();
+    }
+}
+
+
+RAMFUNC VOID _tx_execution_isr_enter(VOID) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    ProfileCharge(ProfileElapsed());
+
+    uint32_t exception = __get_IPSR();
+    if (exception >= PROFILE_EXCEPTIONS) exception = 0;
+    profile_isrs[exception].count++;
+
+    if (profile_isr_depth < PROFILE_ISR_NEST_MAX) {
+        profile_isr_stack[profile_isr_depth] = (uint8_t)exception;
+    }
+
+    profile_isr_depth++;
+    __set_PRIMASK(primask);
+}
+
+
+RAMFUNC VOID _tx_execution_isr_exit(VOID) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (profile_isr_depth > 0) {
+        ProfileCharge(ProfileElapsed());
+        profile_isr_depth--;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+
+/*
+ * REPORTING
+ */
+
+static uint8_t *PutU16(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    return out + 2;
+}
+
+
+static uint8_t *PutU32(uint8_t *out, uint32_t value) {
+    out = PutU16(out, value & 0xFFFF);
+    return PutU16(out, value >> 16);
+}
+
+
+/**
+    @brief  Base64 encode a report into a NUL terminated string.
+
+    @param  data    The bytes to encode.
+    @param  length  The number of bytes.
+    @param  out     Receives at least 4 * ((length + 2) / 3) + 1 chars.
+ */
+static void ProfileBase64(const uint8_t *data, uint32_t length, char *out) {
+    for (uint32_t i = 0; i < length; i += 3) {
+        uint32_t remain = length - i;
+        uint32_t group = (uint32_t)data[i] << 16;
+        if (remain > 1) group |= (uint32_t)data[i + 1] << 8;
+        if (remain > 2) group |= data[i + 2];
+
+        *out++ = base64_chars[(group >> 18) & 0x3F];
+        *out++ = base64_chars[(group >> 12) & 0x3F];
+        *out++ = remain > 1 ? base64_chars[(group >> 6) & 0x3F] : '=';
+        *out++ = remain > 2 ? base64_chars[group & 0x3F] : '=';
+    }
+
+    *out = '\0';
+}
+
+
+/**
+    @brief  Read and clear all counters, then publish one report line.
+
+    The counters are copied with interrupts masked so a report is a
+    consistent snapshot of one window; formatting and sending happen
+    afterwards with interrupts enabled.
+ */
+static void ProfileReport(void) {
+    static uint8_t report[PROFILE_REPORT_SIZE];
+    static char line[sizeof(PROFILE_LINE_PREFIX) + 4 * ((PROFILE_REPORT_SIZE + 2) / 3)];
+    uint8_t *out = report + PROFILE_HEADER_SIZE;
+    uint8_t threads = 0, isrs = 0, flags = 0;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    // Close the window: charge the reporter's own time so far
+    ProfileCharge(ProfileElapsed());
+    uint32_t window = profile_mark - profile_window_start;
+    profile_window_start = profile_mark;
+
+    uint32_t idle = profile_idle_cycles;
+    uint32_t switches = profile_switches;
+    profile_idle_cycles = 0;
+    profile_switches = 0;
+
+    TX_THREAD *thread = _tx_thread_created_ptr;
+    for (ULONG i = 0; i < _tx_thread_created_count; i++, thread = thread->tx_thread_created_next) {
+        if (threads < PROFILE_MAX_THREADS) {
+            // Names are padded or cut to a fixed width
+            const char *name = thread->tx_thread_name != TX_NULL ? thread->tx_thread_name : "";
+            size_t length = strnlen(name, PROFILE_NAME_LENGTH);
+            memset(out, 0, PROFILE_NAME_LENGTH);
+            memcpy(out, name, length);
+            out += PROFILE_NAME_LENGTH;
+
+            ULONG runs = thread->tx_thread_profile_runs;
+            *out++ = (uint8_t)thread->tx_thread_priority;
+            out = PutU16(out, runs > 0xFFFF ? 0xFFFF : runs);
+            out = PutU32(out, thread->tx_thread_profile_cycles);
+            threads++;
+        } else {
+            flags |= PROFILE_FLAG_THREADS_TRUNCATED;
+        }
+
+        thread->tx_thread_profile_cycles = 0;
+        thread->tx_thread_profile_runs = 0;
+    }
+
+    for (uint32_t exception = 0; exception < PROFILE_EXCEPTIONS; exception++) {
+        ProfileIsr *isr = &profile_isrs[exception];
+        if (isr->count == 0 && isr->cycles == 0) continue;
+
+        if (isrs < PROFILE_MAX_ISRS) {
+            *out++ = (uint8_t)exception;
+            out = PutU32(out, isr->count);
+            out = PutU32(out, isr->cycles);
+            isrs++;
+        } else {
+            flags |= PROFILE_FLAG_ISRS_TRUNCATED;
+        }
+
+        isr->count = 0;
+        isr->cycles = 0;
+    }
+
+    __set_PRIMASK(primask);
+
+    uint8_t *header = report;
+    *header++ = 'T';
+    *header++ = 'P';
+    *header++ = PROFILE_FORMAT_VERSION;
+    *header++ = threads;
+    *header++ = isrs;
+    *header++ = flags;
+    header = PutU16(header, profile_sequence++);
+    header = PutU32(header, SystemCoreClock);
+    header = PutU32(header, window);
+    header = PutU32(header, idle);
+    PutU32(header, switches);
+
+    strcpy(line, PROFILE_LINE_PREFIX);
+    ProfileBase64(report, (uint32_t)(out - report), line + strlen(PROFILE_LINE_PREFIX));
+    ServerLog(line);
+}
+
+
+/**
+    @brief  Reporter thread: publish a report every PROFILE_PERIOD_MS.
+ */
+static VOID ProfileThread(ULONG input) {
+    (void)input;
+
+    ULONG period = (PROFILE_PERIOD_MS * TX_TIMER_TICKS_PER_SECOND) / 1000;
+    if (period == 0) period = 1;
+
+    for (;;) {
+        tx_thread_sleep(period);
+        ProfileReport();
+    }
+}
+
+
+/**
+    @brief  Start the cycle counter and the reporter thread.
+
+    Call from App_ThreadX_Init(), before the scheduler starts, so the
+    first window covers everything after boot.
+
+    @param  pool    Byte pool to take the reporter stack from.
+
+    @return TX_SUCCESS, or the ThreadX error.
+ */
+UINT ProfileStart(TX_BYTE_POOL *pool) {
+    VOID *stack;
+
+    UINT status = tx_byte_allocate(pool, &stack, PROFILE_STACK_SIZE, TX_NO_WAIT);
+    if (status != TX_SUCCESS) return status;
+
+    // Enable the DWT cycle counter; left running, as the boot profile
+    // may already be using it
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    profile_mark = DWT->CYCCNT;
+    profile_window_start = profile_mark;
+
+    status = tx_thread_create(&profile_thread, "Profile", ProfileThread, 0,
+                              stack, PROFILE_STACK_SIZE,
+                              PROFILE_THREAD_PRIO, PROFILE_THREAD_PRIO,
+                              TX_NO_TIME_SLICE, TX_AUTO_START);
+    if (status != TX_SUCCESS) tx_byte_release(stack);
+    return status;
+}
+
+#endif /* TX_ENABLE_EXECUTION_CHANGE_NOTIFY */
@@ -0,0 +1,37 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "ramfunc.h"
+#include "stm32u5xx_hal.h"
+
+#if defined(APP_ENABLE_RAMFUNC)
+
+// From Config/ramfunc.ld: the SRAM run address and the flash load address
+extern uint32_t __ramfunc_start__;
+extern uint32_t __ramfunc_end__;
+extern uint32_t __ramfunc_load__;
+
+
+/**
+    @brief  Copy the RAMFUNC code from flash to SRAM.
+
+    Call first thing in main(): the TIM6 tick handler is a RAMFUNC and
+    HAL_Init() enables it.
+ */
+void RamFuncInit(void) {
+    size_t size = (size_t)((uint8_t *)&__ramfunc_end__ - (uint8_t *)&__ramfunc_start__);
+    memcpy(&__ramfunc_start__, &__ramfunc_load__, size);
+
+    // Make sure the copy is complete before the first fetch from it
+    __DSB();
+    __ISB();
+}
+
+#endif /* APP_ENABLE_RAMFUNC */
@@ -0,0 +1,206 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "stack_monitor.h"
+#include "logging.h"
+#include "stm32u5xx_hal.h"
+
+// Scheduler internals: the created thread list
+#include "tx_thread.h"
+
+#ifndef TX_TIMER_TICKS_PER_SECOND
+#define TX_TIMER_TICKS_PER_SECOND   ((ULONG)100)
+#endif
+
+// Threads reported per scan; later threads are counted but not listed
+#define STACK_MONITOR_MAX_THREADS   16
+
+static TX_THREAD   stack_monitor_thread;
+static TX_THREAD  *stack_threads[STACK_MONITOR_MAX_THREADS];
+
+#if defined(TX_ENABLE_STACK_CHECKING)
+// Set by ThreadX when it catches a thread beyond its stack
+static TX_THREAD * volatile stack_overflow_thread;
+#endif
+
+
+/**
+    @brief  Measure a thread's stack high-water mark.
+
+    ThreadX fills each stack with TX_STACK_FILL when the thread is created.
+    Stacks grow down, so the first word that no longer holds the pattern,
+    counting up from the bottom, marks the deepest point ever reached.
+
+    @param  thread  The thread to measure.
+
+    @return The peak stack usage in bytes.
+ */
+ULONG StackMonitorUsed(const TX_THREAD *thread) {
+    const ULONG *bottom = (const ULONG *)thread->tx_thread_stack_start;
+    const ULONG *top = (const ULONG *)((const UCHAR *)thread->tx_thread_stack_start + thread->tx_thread_stack_size);
+    const ULONG *word = bottom;
+
+    while (word < top && *word == TX_STACK_FILL) {
+        word++;
+    }
+
+    return (ULONG)((const UCHAR *)top - (const UCHAR *)word);
+}
+
+
+#if defined(TX_ENABLE_STACK_CHECKING)
+/**
+    @brief  ThreadX stack error callback.
+
+    Runs in the scheduler, so only record the culprit; the monitor
+    thread reports it on its next pass.
+
+    @param  thread  The thread whose stack overflowed.
+ */
+static VOID StackMonitorOverflow(TX_THREAD *thread) {
+    stack_overflow_thread = thread;
+}
+#endif
+
+
+/**
+    @brief  Keep other threads off the CPU, or let them back on.
+
+    Threads are only created and deleted by threads, so while the monitor
+    cannot be preempted the created list holds still and no stack in it
+    is released. Interrupts still run.
+
+    @param  hold    true to hold other threads off.
+ */
+static void StackMonitorHold(bool hold) {
+    UINT previous;
+
+    tx_thread_preemption_change(&stack_monitor_thread, hold ? 0 : STACK_MONITOR_THREAD_PRIO, &previous);
+}
+
+
+/**
+    @brief  Whether a thread from an earlier walk is still created. Call
+            holding other threads off.
+ */
+static bool StackMonitorIsCreated(const TX_THREAD *wanted) {
+    TX_THREAD *thread = _tx_thread_created_ptr;
+
+    for (ULONG i = 0; i < _tx_thread_created_count; i++) {
+        if (thread == wanted) return true;
+        thread = thread->tx_thread_created_next;
+    }
+
+    return false;
+}
+
+
+/**
+    @brief  Scan every thread and log one '#stack' line for each.
+
+    Line format: #stack "<name>" <size> <used>, in bytes, for
+    tools/stack_report.py. Each stack is measured holding other threads
+    off, so a thread the benchmarks delete meanwhile is skipped rather
+    than read after its stack is gone; they are let back on between
+    stacks, and while logging.
+ */
+static void StackMonitorScan(void) {
+    char line[80];
+    UINT count = 0;
+
+    StackMonitorHold(true);
+
+    TX_THREAD *thread = _tx_thread_created_ptr;
+    ULONG created = _tx_thread_created_count;
+    for (ULONG i = 0; i < created && count < STACK_MONITOR_MAX_THREADS; i++) {
+        stack_threads[count++] = thread;
+        thread = thread->tx_thread_created_next;
+    }
+
+    StackMonitorHold(false);
+
+    for (UINT i = 0; i < count; i++) {
+        thread = stack_threads[i];
+
+        StackMonitorHold(true);
+        bool live = StackMonitorIsCreated(thread);
+        if (live) {
+            snprintf(line, sizeof(line), "#stack \"%s\" %lu %lu",
+                     thread->tx_thread_name != TX_NULL ? thread->tx_thread_name : "?",
+                     (unsigned long)thread->tx_thread_stack_size,
+                     (unsigned long)StackMonitorUsed(thread));
+        }
+        StackMonitorHold(false);
+
+        if (live) ServerLog(line);
+    }
+
+    if (created > count) {
+        snprintf(line, sizeof(line), "#stack %lu threads not listed", (unsigned long)(created - count));
+        ServerLog(line);
+    }
+
+#if defined(TX_ENABLE_STACK_CHECKING)
+    TX_THREAD *overflow = stack_overflow_thread;
+    if (overflow != TX_NULL) {
+        stack_overflow_thread = TX_NULL;
+        snprintf(line, sizeof(line), "#stack-overflow \"%s\"",
+                 overflow->tx_thread_name != TX_NULL ? overflow->tx_thread_name : "?");
+        ServerLog(line);
+    }
+#endif
+}
+
+
+/**
+    @brief  Monitor thread: scan every STACK_MONITOR_PERIOD_MS.
+ */
+static VOID StackMonitorThread(ULONG input) {
+    (void)input;
+
+    ULONG period = (STACK_MONITOR_PERIOD_MS * TX_TIMER_TICKS_PER_SECOND) / 1000;
+    if (period == 0) period = 1;
+
+    for (;;) {
+        tx_thread_sleep(period);
+        StackMonitorScan();
+    }
+}
+
+
+/**
+    @brief  Start the stack monitor thread.
+
+    Each stack is read with other threads held off, so threads may come
+    and go while the monitor runs. Reading a stack delays higher priority
+    threads by that long, and a scan reads every stack: keep the monitor
+    at a low priority.
+
+    @param  pool    Byte pool to take the monitor stack from.
+
+    @return TX_SUCCESS, or the ThreadX error.
+ */
+UINT StackMonitorStart(TX_BYTE_POOL *pool) {
+    VOID *stack;
+
+    UINT status = tx_byte_allocate(pool, &stack, STACK_MONITOR_STACK_SIZE, TX_NO_WAIT);
+    if (status != TX_SUCCESS) return status;
+
+#if defined(TX_ENABLE_STACK_CHECKING)
+    tx_thread_stack_error_notify(StackMonitorOverflow);
+#endif
+
+    status = tx_thread_create(&stack_monitor_thread, "Stacks", StackMonitorThread, 0,
+                              stack, STACK_MONITOR_STACK_SIZE,
+                              STACK_MONITOR_THREAD_PRIO, STACK_MONITOR_THREAD_PRIO,
+                              TX_NO_TIME_SLICE, TX_AUTO_START);
+    if (status != TX_SUCCESS) tx_byte_release(stack);
+    return status;
+}
@@ -6,8 +6,12 @@
   *
   *          This file overrides the native HAL time base functions (defined as weak)
   *          the TIM time base:
-  *           + Intializes the TIM peripheral to generate a Period elapsed Event each 1ms
-  *           + HAL_IncTick is called inside HAL_TIM_PeriodElapsedCallback ie each 1ms
+  *           + Intializes the TIM peripheral to generate a Period elapsed Event each
+  *             tick (APP_TICK_RATE_HZ, 1ms by default)
+  *           + HAL_IncTick and the RTOS tick handler are called directly from
+  *             TIM6_IRQHandler, so the HAL and the RTOS share one time base
+  *           + TimebaseGetMicros returns a 64-bit microsecond clock built from
+  *             the TIM6 counter and an epoch advanced on each update
   *
  @verbatim
   ==============================================================================
@@ -35,8 +39,13 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
+#include <string.h>
 #include "stm32u5xx_hal.h"
 #include "mv_syscalls.h"
+#include "profile.h"
+#include "trace.h"
+#include "timebase.h"
+#include "ramfunc.h"
 
 /** @addtogroup STM32U5xx_HAL_Driver
   * @{
@@ -48,21 +57,71 @@
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+/* TIM6 counts microseconds and is 16 bits wide */
+#define TIMEBASE_PERIOD_US    (1000000U / APP_TICK_RATE_HZ)
+_Static_assert((1000U % APP_TICK_RATE_HZ) == 0U, "the HAL tick must be a whole number of ms");
+_Static_assert((1000000U / APP_TICK_RATE_HZ) <= 65536U, "tick period too long for TIM6");
+
 /* Private macro -------------------------------------------------------------*/
+/* RTOS tick handler fed from TIM6: ThreadX unless built for FreeRTOS */
+#if defined(TIMEBASE_FREERTOS)
+extern void xPortSysTickHandler(void);
+#define TIMEBASE_RTOS_TICK()  xPortSysTickHandler()
+#else
+extern void _tx_timer_interrupt(void);
+#define TIMEBASE_RTOS_TICK()  _tx_timer_interrupt()
+#endif
+
+#if defined(APP_ENABLE_TICK_STATS)
+#define TICK_STATS_ENTER()    uint32_t tick_enter = DWT->CYCCNT
+#define TICK_STATS_EXIT()     TickStatsRecord(tick_enter)
+#else
+#define TICK_STATS_ENTER()
+#define TICK_STATS_EXIT()
+#endif
+
 /* Private variables ---------------------------------------------------------*/
 static TIM_HandleTypeDef        TimHandle;
 
+/* Set once the RTOS is ready for ticks */
+static volatile uint32_t        RtosTickRunning;
+
+/* Microseconds at the last TIM6 update. The counter is bumped on every
+   change, so a reader that was preempted part way through reading the
+   64-bit epoch sees it move and reads again */
+static volatile uint32_t        TimebaseSeq;
+static volatile uint64_t        TimebaseEpochUs;
+
+#if defined(APP_ENABLE_TICK_STATS)
+static TimebaseTickStats        TickStats;
+static uint32_t                 TickStatsLast;
+static uint32_t                 TickStatsNominal;
+#endif
+
 /* Private function prototypes -----------------------------------------------*/
 void TIM6_IRQHandler(void);
-#if (USE_HAL_TIM_REGISTER_CALLBACKS == 1U)
-void TimeBase_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
-#endif
+uint32_t osKernelGetSysTimerCount(void);
+uint32_t osKernelGetSysTimerFreq(void);
 /* Private functions ---------------------------------------------------------*/
 
+/**
+  * @brief  Move the microsecond epoch on.
+  * @note   Interrupts must be masked: the update and the TIM6 state it
+  *         matches must look atomic to a higher priority reader.
+  * @param  us Microseconds to add
+  * @retval None
+  */
+static inline void TimebaseAdvanceEpoch(uint64_t us)
+{
+  TimebaseEpochUs += us;
+  __DMB();
+  TimebaseSeq++;
+}
+
 /**
   * @brief  This function configures the TIM6 as a time base source.
-  *         The time source is configured  to have 1ms time base with a dedicated
-  *         Tick interrupt priority.
+  *         The time source is configured  to have a 1/APP_TICK_RATE_HZ time base
+  *         with a dedicated Tick interrupt priority.
   * @note   This function is called  automatically at the beginning of program after
   *         reset by HAL_Init() or at any time when clock is configured, by HAL_RCC_ClockConfig().
   * @param  TickPriority Tick interrupt priority.
@@ -79,6 +138,19 @@ HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
   /* Enable TIM6 clock */
   __HAL_RCC_TIM6_CLK_ENABLE();
 
+  /* Called again on a clock change: the counter restarts from 0, so carry
+     the time so far into the epoch first */
+  if ((TIM6->CR1 & TIM_CR1_CEN) != 0U)
+  {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint64_t now = TimebaseGetMicros();
+    TIM6->CR1 &= ~TIM_CR1_CEN;
+    TIM6->SR = ~TIM_SR_UIF;
+    TimebaseAdvanceEpoch(now - TimebaseEpochUs);
+    __set_PRIMASK(primask);
+  }
+
   /* Get clock configuration */
   HAL_RCC_GetClockConfig(&clkconfig, &pFLatency);
 
@@ -99,12 +171,12 @@ HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
   TimHandle.Instance = TIM6;
 
   /* Initialize TIMx peripheral as follow:
-  + Period = [(TIM6CLK/1000) - 1]. to have a (1/1000) s time base.
-  + Prescaler = (uwTimclock/100000 - 1) to have a 100KHz counter clock.
+  + Period = [(1000000/APP_TICK_RATE_HZ) - 1]. to have a (1/APP_TICK_RATE_HZ) s time base.
+  + Prescaler = (uwTimclock/1000000 - 1) to have a 1MHz counter clock.
   + ClockDivision = 0
   + Counter direction = Up
   */
-  TimHandle.Init.Period = (1000000U / 1000U) - 1U;
+  TimHandle.Init.Period = TIMEBASE_PERIOD_US - 1U;
   TimHandle.Init.Prescaler = uwPrescalerValue;
   TimHandle.Init.ClockDivision = 0;
   TimHandle.Init.CounterMode = TIM_COUNTERMODE_UP;
@@ -120,6 +192,9 @@ HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
         /* Enable the TIM6 global Interrupt */
         HAL_NVIC_SetPriority(TIM6_IRQn, TickPriority ,0);
         uwTickPrio = TickPriority;
+
+        /* HAL_GetTick() stays in ms whatever the tick rate */
+        uwTickFreq = (HAL_TickFreqTypeDef)(1000U / APP_TICK_RATE_HZ);
       }
       else
       {
@@ -127,8 +202,12 @@ HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
       }
     }
   }
-#if (USE_HAL_TIM_REGISTER_CALLBACKS == 1U)
-  HAL_TIM_RegisterCallback(&TimHandle, HAL_TIM_PERIOD_ELAPSED_CB_ID, TimeBase_TIM_PeriodElapsedCallback);
+#if defined(APP_ENABLE_TICK_STATS)
+  /* Tick ISR timings come from the DWT cycle counter */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  TickStatsNominal = SystemCoreClock / APP_TICK_RATE_HZ;
+  TimebaseResetTickStats();
 #endif
 
   HAL_NVIC_EnableIRQ(TIM6_IRQn);
@@ -161,36 +240,208 @@ void HAL_ResumeTick(void)
   __HAL_TIM_ENABLE_IT(&TimHandle, TIM_IT_UPDATE);
 }
 
+#if defined(TIMEBASE_FREERTOS)
 /**
-  * @brief  Period elapsed callback in non blocking mode
-  * @note   This function is called  when TIM6 interrupt took place, inside
-  * HAL_TIM_IRQHandler(). It makes a direct call to HAL_IncTick() to increment
-  * a global variable "uwTick" used as application time base.
-  * @param  htim TIM handle
+  * @brief  FreeRTOS tick setup, called as the scheduler starts.
+  * @note   Overrides the port's SysTick setup: the tick comes from TIM6.
+  * @param  None
   * @retval None
   */
-
-#if (USE_HAL_TIM_REGISTER_CALLBACKS == 1U)
-void TimeBase_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+void vPortSetupTimerInterrupt(void)
+{
+  RtosTickRunning = 1U;
+}
 #else
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+/**
+  * @brief  Feed the ThreadX tick from TIM6.
+  * @note   Call from tx_application_define(): after the ThreadX port has
+  *         started SysTick, which this stops, and before the scheduler runs.
+  * @param  None
+  * @retval None
+  */
+void TimebaseStartRtosTick(void)
+{
+  SysTick->CTRL = 0U;
+  SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+  RtosTickRunning = 1U;
+}
+
+/**
+  * @brief  CMSIS-RTOS2 kernel timer, overriding the SysTick-based one in
+  *         the ThreadX wrapper now that SysTick is stopped.
+  * @param  None
+  * @retval The low 32 bits of the microsecond clock
+  */
+uint32_t osKernelGetSysTimerCount(void)
+{
+  return (uint32_t)TimebaseGetMicros();
+}
+
+/**
+  * @brief  CMSIS-RTOS2 kernel timer frequency.
+  * @param  None
+  * @retval 1MHz
+  */
+uint32_t osKernelGetSysTimerFreq(void)
+{
+  return 1000000U;
+}
 #endif
+
+/**
+  * @brief  Read the 64-bit microsecond clock.
+  * @note   Safe from any thread or handler without masking interrupts.
+  *         A wrap that TIM6_IRQHandler has not handled yet, because
+  *         interrupts are masked or the caller is a higher priority
+  *         handler, is accounted for from the pending update flag; with
+  *         interrupts masked for more than a tick period the clock falls
+  *         behind.
+  * @param  None
+  * @retval Microseconds since HAL_InitTick() first ran
+  */
+RAMFUNC uint64_t TimebaseGetMicros(void)
+{
+  uint32_t seq;
+  uint64_t epoch;
+  uint32_t count;
+
+  do
+  {
+    seq = TimebaseSeq;
+    __DMB();
+    epoch = TimebaseEpochUs;
+    count = TIM6->CNT;
+    if ((TIM6->SR & TIM_SR_UIF) != 0U)
+    {
+      /* The count may have been read either side of the wrap */
+      count = TIM6->CNT;
+      epoch += TIMEBASE_PERIOD_US;
+    }
+    __DMB();
+  } while (seq != TimebaseSeq);
+
+  return epoch + count;
+}
+
+/**
+  * @brief  Credit whole ticks that passed without a TIM6 update, as after
+  *         a tickless sleep, to HAL_GetTick() and the microsecond clock.
+  * @note   Call with interrupts masked. The RTOS tick is not advanced.
+  * @param  ticks Number of tick periods
+  * @retval None
+  */
+void TimebaseCreditTicks(uint32_t ticks)
+{
+  uwTick += ticks * (uint32_t)uwTickFreq;
+  TimebaseAdvanceEpoch((uint64_t)ticks * TIMEBASE_PERIOD_US);
+}
+
+#if defined(APP_ENABLE_TICK_STATS)
+/**
+  * @brief  Record one tick ISR's duration and its distance from the last.
+  * @param  enter Cycle count on ISR entry
+  * @retval None
+  */
+static RAMFUNC void TickStatsRecord(uint32_t enter)
+{
+  uint32_t duration = DWT->CYCCNT - enter;
+
+  if (TickStatsLast != 0U)
+  {
+    uint32_t interval = enter - TickStatsLast;
+
+    /* A tickless sleep or a long masked section is not jitter */
+    if (interval > 2U * TickStatsNominal)
+    {
+      TickStats.gaps++;
+    }
+    else
+    {
+      uint32_t jitter = (interval > TickStatsNominal) ? (interval - TickStatsNominal) : (TickStatsNominal - interval);
+      TickStats.jitter_total += jitter;
+      if (jitter > TickStats.jitter_max)
+      {
+        TickStats.jitter_max = jitter;
+      }
+    }
+  }
+  TickStatsLast = enter;
+
+  TickStats.count++;
+  TickStats.duration_total += duration;
+  if (duration < TickStats.duration_min)
+  {
+    TickStats.duration_min = duration;
+  }
+  if (duration > TickStats.duration_max)
+  {
+    TickStats.duration_max = duration;
+  }
+}
+
+/**
+  * @brief  Read the tick ISR measurements.
+  * @param  stats Filled in with the measurements so far
+  * @retval None
+  */
+void TimebaseGetTickStats(TimebaseTickStats *stats)
 {
-  /* Prevent unused argument(s) compilation warning */
-  UNUSED(htim);
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = TickStats;
+  __set_PRIMASK(primask);
+}
 
-  // should we limit this to if (htim->Instance == TIM6) ?
-  HAL_IncTick();
+/**
+  * @brief  Start the tick ISR measurements afresh.
+  * @param  None
+  * @retval None
+  */
+void TimebaseResetTickStats(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memset(&TickStats, 0, sizeof(TickStats));
+  TickStats.duration_min = UINT32_MAX;
+  TickStatsLast = 0U;
+  __set_PRIMASK(primask);
 }
+#endif
 
 /**
   * @brief  This function handles TIM interrupt request.
+  * @note   TIM6 is dedicated to the time base and only its update interrupt
+  *         is enabled, so the flag is handled here directly instead of
+  *         through HAL_TIM_IRQHandler() and HAL_TIM_PeriodElapsedCallback().
+  *         One interrupt advances both the HAL and the RTOS tick.
   * @param  None
   * @retval None
   */
-void TIM6_IRQHandler(void)
+RAMFUNC void TIM6_IRQHandler(void)
 {
-  HAL_TIM_IRQHandler(&TimHandle);
+  TICK_STATS_ENTER();
+  PROFILE_ISR_ENTER();
+  TRACE_ISR_ENTER();
+
+  if ((TIM6->SR & TIM_SR_UIF) != 0U)
+  {
+    /* The flag and the epoch change together for TimebaseGetMicros();
+       rc_w0: writing the other bits as 1 leaves them alone */
+    __disable_irq();
+    TIM6->SR = ~TIM_SR_UIF;
+    TimebaseAdvanceEpoch(TIMEBASE_PERIOD_US);
+    __enable_irq();
+    HAL_IncTick();
+
+    if (RtosTickRunning != 0U)
+    {
+      TIMEBASE_RTOS_TICK();
+    }
+  }
+
+  TRACE_ISR_EXIT();
+  PROFILE_ISR_EXIT();
+  TICK_STATS_EXIT();
 }
 
 /**
@@ -0,0 +1,175 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include "tickless.h"
+#include "timebase.h"
+#include "stm32u5xx_hal.h"
+
+#if defined(TX_LOW_POWER)
+
+// Scheduler internals: the timer wheel and the tick handler
+#include "tx_timer.h"
+
+// TIM6 counts 1 us as the tick; long sleeps count 100 us
+#define TICKLESS_FINE_MAX_US        0xFFFFUL
+#define TICKLESS_COARSE_SCALE       100UL
+
+/*
+ * When no thread is ready, ThreadX's scheduler calls tx_low_power_enter(),
+ * executes WFI and calls tx_low_power_exit(), all with interrupts masked.
+ * Enter stops the periodic TIM6 tick, which drives both the HAL and ThreadX,
+ * and turns TIM6 into a one-shot timer that fires when the next ThreadX
+ * timer is due. Exit measures how long the core actually slept, which is
+ * shorter if some other interrupt woke it, credits both tick counts with
+ * that time and restarts the tick in phase.
+ */
+static uint32_t tickless_sleep_us;          // Programmed sleep; 0 when not sleeping
+static uint32_t tickless_scale;             // us per TIM6 count during the sleep
+static uint32_t tickless_phase_us;          // Time into the tick at entry
+static uint32_t tickless_psc;
+static uint32_t tickless_arr;
+static TicklessStats tickless_stats;
+
+
+/**
+    @brief  Ticks until the first ThreadX timer slot that holds a timer.
+
+    Each wheel slot expires one tick after the last; a timer further out
+    than the wheel sits in the last slot and is re-filed when that slot
+    expires, so the answer never exceeds TX_TIMER_ENTRIES and waking then
+    is always safe. Thread sleeps and timeouts are wheel timers too.
+
+    @return The number of ticks, or 0 if no timer is active.
+ */
+static ULONG TicklessNextExpiry(void) {
+    TX_TIMER_INTERNAL **slot = _tx_timer_current_ptr;
+
+    for (ULONG ticks = 1; ticks <= TX_TIMER_ENTRIES; ticks++) {
+        if (*slot != TX_NULL) {
+            // A running time slice ends sooner
+            if (_tx_timer_time_slice != 0 && _tx_timer_time_slice < ticks) return _tx_timer_time_slice;
+            return ticks;
+        }
+
+        slot++;
+        if (slot == _tx_timer_list_end) slot = _tx_timer_list_start;
+    }
+
+    return _tx_timer_time_slice;
+}
+
+
+/**
+    @brief  ThreadX idle entry: stop the tick and arm TIM6 for the
+            next timer expiry.
+
+    Called by the scheduler, with interrupts masked, just before WFI.
+ */
+VOID tx_low_power_enter(VOID) {
+    tickless_sleep_us = 0;
+
+    ULONG ticks = TicklessNextExpiry();
+    if (ticks != 0 && ticks < TICKLESS_MIN_TICKS) return;
+
+    // Freeze the tick; one that is already due is handled the usual way
+    TIM6->CR1 &= ~TIM_CR1_CEN;
+    if ((TIM6->SR & TIM_SR_UIF) != 0) {
+        TIM6->CR1 |= TIM_CR1_CEN;
+        return;
+    }
+
+    tickless_phase_us = TIM6->CNT;
+    tickless_psc = TIM6->PSC;
+    tickless_arr = TIM6->ARR;
+
+    // Ticks >= 2, so the expiry is at least one tick away
+    uint32_t period = tickless_arr + 1U;
+    uint32_t sleep = TICKLESS_MAX_SLEEP_US;
+    if (ticks != 0 && ticks * period - tickless_phase_us < sleep) {
+        sleep = ticks * period - tickless_phase_us;
+    }
+
+    tickless_scale = sleep > TICKLESS_FINE_MAX_US ? TICKLESS_COARSE_SCALE : 1U;
+    if (sleep / tickless_scale > 0xFFFFUL) sleep = 0xFFFFUL * tickless_scale;
+
+    // Whole timer counts only, so the expiry credits what was slept
+    sleep -= sleep % tickless_scale;
+
+    // One-shot: URS keeps the UG that loads the new prescaler from raising UIF
+    TIM6->CR1 |= TIM_CR1_URS;
+    TIM6->PSC = (tickless_psc + 1U) * tickless_scale - 1U;
+    TIM6->ARR = sleep / tickless_scale - 1U;
+    TIM6->EGR = TIM_EGR_UG;
+    TIM6->SR = 0;
+    TIM6->CR1 |= TIM_CR1_CEN;
+
+    tickless_sleep_us = sleep;
+}
+
+
+/**
+    @brief  ThreadX idle exit: credit the time slept to the HAL and
+            ThreadX tick counts and restart the tick.
+
+    Called by the scheduler, with interrupts still masked, after WFI.
+    The interrupt that woke the core runs once this returns.
+ */
+VOID tx_low_power_exit(VOID) {
+    if (tickless_sleep_us == 0) return;
+
+    TIM6->CR1 &= ~TIM_CR1_CEN;
+
+    uint32_t slept;
+    if ((TIM6->SR & TIM_SR_UIF) != 0) {
+        slept = tickless_sleep_us;
+    } else {
+        slept = TIM6->CNT * tickless_scale;
+        tickless_stats.early_wakes++;
+    }
+
+    // The one-shot expiry is not a tick
+    TIM6->SR = 0;
+    NVIC_ClearPendingIRQ(TIM6_IRQn);
+    tickless_sleep_us = 0;
+
+    tickless_stats.sleeps++;
+    tickless_stats.slept_us += slept;
+
+    // Restart the tick in phase with where it would have been
+    uint32_t period = tickless_arr + 1U;
+    uint32_t elapsed = tickless_phase_us + slept;
+    uint32_t ticks = elapsed / period;
+
+    TIM6->PSC = tickless_psc;
+    TIM6->ARR = tickless_arr;
+    TIM6->EGR = TIM_EGR_UG;
+    TIM6->CNT = elapsed % period;
+    TIM6->CR1 |= TIM_CR1_CEN;
+
+    // Then credit the ticks that passed: the HAL's and the microsecond
+    // clock's in one go, ThreadX's by running its tick handler once per tick
+    TimebaseCreditTicks(ticks);
+    while (ticks-- > 0) {
+        _tx_timer_interrupt();
+    }
+}
+
+
+/**
+    @brief  Read the idle statistics.
+
+    @param  stats   Filled in with the counts since boot.
+ */
+void TicklessGetStats(TicklessStats *stats) {
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    *stats = tickless_stats;
+    TX_RESTORE
+}
+
+#endif /* TX_LOW_POWER */
@@ -0,0 +1,197 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+#include "inputs.h"
+#include "logging.h"
+#include "stm32u5xx_hal.h"
+
+#if defined(TX_ENABLE_EVENT_TRACE)
+
+/*
+ * ThreadX writes TraceX events (thread switches, ISR entry/exit, every API
+ * call on queues, semaphores, event flags and so on, plus user markers)
+ * into trace_buffer, wrapping round when it is full. A dump stops tracing,
+ * sends the buffer as-is over the log channel and starts a fresh trace;
+ * tools/trace_dump.py rebuilds the .trx file TraceX opens. With the
+ * inputs service, pressing the user button asks for a dump too.
+ */
+#define TRACE_DUMP_FLAG             0x80000000UL
+
+#if defined(APP_ENABLE_INPUTS)
+// The button's event lands in the same group
+#define TRACE_DUMP_EVENTS           (TRACE_DUMP_FLAG | INPUT_EVENT_ACTIVE(UserButton))
+
+_Static_assert((INPUT_EVENT_ACTIVE(UserButton) & TRACE_DUMP_FLAG) == 0, "the dump flag must be clear of the button's");
+#else
+#define TRACE_DUMP_EVENTS           TRACE_DUMP_FLAG
+#endif
+
+static UCHAR trace_buffer[TRACE_BUFFER_SIZE] __attribute__((aligned(4)));
+static TX_THREAD trace_thread;
+static TX_EVENT_FLAGS_GROUP trace_flags;
+static char trace_base64[4 * (TRACE_CHUNK_SIZE / 3) + 1];
+
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+_Static_assert((TRACE_CHUNK_SIZE % 3) == 0, "trace chunks must encode without padding");
+
+
+/**
+    @brief  Update a CRC-32 (IEEE 802.3, as zlib) with more bytes.
+
+    @param  crc     The running CRC, 0 to start.
+    @param  data    The bytes to add.
+    @param  length  The number of bytes.
+
+    @return The updated CRC.
+ */
+static uint32_t TraceCrc32(uint32_t crc, const UCHAR *data, uint32_t length) {
+    crc = ~crc;
+    while (length--) {
+        crc ^= *data++;
+        for (uint32_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+
+    return ~crc;
+}
+
+
+/**
+    @brief  Base64 encode one whole chunk into trace_base64.
+
+    @param  data    TRACE_CHUNK_SIZE bytes.
+ */
+static void TraceEncodeChunk(const UCHAR *data) {
+    char *out = trace_base64;
+
+    for (uint32_t i = 0; i < TRACE_CHUNK_SIZE; i += 3) {
+        uint32_t group = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        *out++ = base64_chars[(group >> 18) & 0x3F];
+        *out++ = base64_chars[(group >> 12) & 0x3F];
+        *out++ = base64_chars[(group >> 6) & 0x3F];
+        *out++ = base64_chars[group & 0x3F];
+    }
+
+    *out = '\0';
+}
+
+
+/**
+    @brief  Send the trace buffer over the log channel.
+
+    Lines: '#trace-begin <bytes> <chunk size>', then '#trace <index> <base64>'
+    per chunk, then '#trace-end <crc32>'. Tracing is off while the dump
+    runs, so the dump itself does not appear in the next trace. Each line
+    waits in ServerLog() for room in the channel's send buffer, so the
+    dump goes out at the rate the channel takes it.
+ */
+static void TraceDump(void) {
+    char line[24 + sizeof(trace_base64)];
+    uint32_t crc = 0;
+
+    tx_trace_disable();
+
+    snprintf(line, sizeof(line), "#trace-begin %u %u", (unsigned)TRACE_BUFFER_SIZE, (unsigned)TRACE_CHUNK_SIZE);
+    ServerLog(line);
+
+    uint32_t chunks = (TRACE_BUFFER_SIZE + TRACE_CHUNK_SIZE - 1) / TRACE_CHUNK_SIZE;
+    for (uint32_t index = 0; index < chunks; index++) {
+        static UCHAR chunk[TRACE_CHUNK_SIZE];
+        uint32_t offset = index * TRACE_CHUNK_SIZE;
+        uint32_t length = TRACE_BUFFER_SIZE - offset;
+        if (length > TRACE_CHUNK_SIZE) length = TRACE_CHUNK_SIZE;
+
+        // The last chunk is zero padded; the begin line gives the true size
+        memset(chunk, 0, sizeof(chunk));
+        memcpy(chunk, &trace_buffer[offset], length);
+        crc = TraceCrc32(crc, chunk, length);
+
+        TraceEncodeChunk(chunk);
+        snprintf(line, sizeof(line), "#trace %lu %s", (unsigned long)index, trace_base64);
+        ServerLog(line);
+    }
+
+    snprintf(line, sizeof(line), "#trace-end %08lx", (unsigned long)crc);
+    ServerLog(line);
+
+    tx_trace_enable(trace_buffer, TRACE_BUFFER_SIZE, TRACE_REGISTRY_ENTRIES);
+}
+
+
+/**
+    @brief  Dump thread: wait for a request, then dump.
+ */
+static VOID TraceThread(ULONG input) {
+    (void)input;
+    ULONG actual;
+
+    for (;;) {
+        tx_event_flags_get(&trace_flags, TRACE_DUMP_EVENTS, TX_OR_CLEAR, &actual, TX_WAIT_FOREVER);
+        TraceDump();
+    }
+}
+
+
+/**
+    @brief  Ask for the trace buffer to be dumped.
+
+    Safe from threads and ISRs; the dump runs in the trace thread. Call
+    it when something worth looking at has just happened, eg. from the
+    code that spots a fault; a press of the user button does the same
+    when the inputs service is on.
+ */
+void TraceDumpRequest(void) {
+    tx_event_flags_set(&trace_flags, TRACE_DUMP_FLAG, TX_OR);
+}
+
+
+/**
+    @brief  Start tracing and the dump thread.
+
+    Call from App_ThreadX_Init(), after the application's own objects are
+    created if they should be named in the trace registry.
+
+    @param  pool    Byte pool to take the dump thread stack from.
+
+    @return TX_SUCCESS, or the ThreadX error.
+ */
+UINT TraceStart(TX_BYTE_POOL *pool) {
+    VOID *stack;
+
+    // Timestamps come from the DWT cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    UINT status = tx_trace_enable(trace_buffer, TRACE_BUFFER_SIZE, TRACE_REGISTRY_ENTRIES);
+    if (status != TX_SUCCESS) return status;
+
+    status = tx_event_flags_create(&trace_flags, "Trace");
+    if (status != TX_SUCCESS) return status;
+
+#if defined(APP_ENABLE_INPUTS)
+    status = InputsSubscribe(&trace_flags, INPUT_EVENT_ACTIVE(UserButton));
+    if (status != TX_SUCCESS) return status;
+#endif
+
+    status = tx_byte_allocate(pool, &stack, TRACE_STACK_SIZE, TX_NO_WAIT);
+    if (status != TX_SUCCESS) return status;
+
+    status = tx_thread_create(&trace_thread, "Trace", TraceThread, 0,
+                              stack, TRACE_STACK_SIZE,
+                              TRACE_THREAD_PRIO, TRACE_THREAD_PRIO,
+                              TX_NO_TIME_SLICE, TX_AUTO_START);
+    if (status != TX_SUCCESS) tx_byte_release(stack);
+    return status;
+}
+
+#endif /* TX_ENABLE_EVENT_TRACE */
@@ -0,0 +1,320 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Host test for the pre-trigger capture (Demo/Src/capture.c). Each sample
+ * written carries its own number, so every sample a snapshot returns can
+ * be checked against the place it should hold in the window. Checks:
+ *   - triggers older than the history or past the newest sample are
+ *     moved to the oldest or newest sample;
+ *   - random windows, written in uneven blocks, that cross segments, are
+ *     complete only once their last sample is written, and read back;
+ *   - overlapping snapshots held while the history moves well past them;
+ *   - every snapshot held at its largest window while writing goes on:
+ *     the pool never runs dry, a further trigger is refused, and every
+ *     segment comes back once they are released.
+ *
+ * Runs in a thread on the ThreadX Linux port, as the snapshot waits use
+ * event flags.
+ *
+ * Usage: capture_test [seed]; exits 0 if every check passes.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "capture.h"
+#include "tx_api.h"
+
+#define TEST_WINDOWS                2000
+#define TEST_DEFAULT_SEED           0x5EEDU
+#define TEST_MAX_BLOCK              (3 * CAPTURE_SEGMENT_SAMPLES)
+
+#define TEST_STACK_SIZE             16384
+
+static uint32_t  rng_state;
+static uint32_t  failures;
+static TX_THREAD test_thread;
+static ULONG     test_stack[TEST_STACK_SIZE / sizeof(ULONG)];
+
+
+static uint32_t Random(void) {
+    // xorshift32, as heap_bench: the same values on every host
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+
+static void Fail(const char *what, uint64_t got, uint64_t expected) {
+    if (failures++ < 20) {
+        fprintf(stderr, "FAIL %s: got %llu, expected %llu\n", what,
+                (unsigned long long)got, (unsigned long long)expected);
+    }
+}
+
+
+/**
+    @brief  The value written for a sample number.
+ */
+static CaptureSample TestSample(uint64_t number) {
+    return (CaptureSample)(number * 40503U);
+}
+
+
+/**
+    @brief  Write samples on from the newest, in blocks of up to
+            max_block.
+ */
+static void TestWrite(uint64_t count, uint32_t max_block) {
+    static CaptureSample block[TEST_MAX_BLOCK];
+    uint64_t next = CaptureWritten();
+
+    while (count > 0) {
+        uint32_t size = 1U + Random() % max_block;
+        if (size > count) size = (uint32_t)count;
+
+        for (uint32_t i = 0; i < size; i++) block[i] = TestSample(next + i);
+        CaptureWrite(block, size);
+
+        next += size;
+        count -= size;
+    }
+
+    if (CaptureWritten() != next) Fail("written", CaptureWritten(), next);
+}
+
+
+/**
+    @brief  Wait for a snapshot and check every sample in its window.
+ */
+static void TestRead(const char *what, CaptureSnapshot *snapshot) {
+    if (CaptureWait(snapshot, TX_NO_WAIT) != TX_SUCCESS) {
+        Fail(what, 0, 1);
+        return;
+    }
+
+    uint32_t offset = 0, run;
+    for (; offset < snapshot->count; offset += run) {
+        const CaptureSample *samples;
+        run = CaptureSpan(snapshot, offset, &samples);
+        if (run == 0 || run > CAPTURE_SEGMENT_SAMPLES) {
+            Fail(what, run, CAPTURE_SEGMENT_SAMPLES);
+            return;
+        }
+
+        for (uint32_t i = 0; i < run; i++) {
+            if (samples[i] != TestSample(snapshot->first + offset + i)) {
+                Fail(what, snapshot->first + offset + i, (uint64_t)samples[i]);
+                return;
+            }
+        }
+    }
+
+    const CaptureSample *samples;
+    if (CaptureSpan(snapshot, snapshot->count, &samples) != 0) Fail(what, 1, 0);
+}
+
+
+/**
+    @brief  Triggers outside the history are moved to its ends.
+ */
+static void TestClamp(void) {
+    TestWrite(10 * CAPTURE_HISTORY_SAMPLES + 17, TEST_MAX_BLOCK);
+    uint64_t written = CaptureWritten();
+
+    // Older than anything kept: the window starts at the oldest sample
+    CaptureSnapshot *snapshot = CaptureTrigger(0, 16, 8);
+    if (snapshot == NULL) {
+        Fail("clamp old trigger", 0, 1);
+        return;
+    }
+
+    if (snapshot->trigger % CAPTURE_SEGMENT_SAMPLES != 0 ||
+        snapshot->trigger > written - CAPTURE_HISTORY_SAMPLES ||
+        snapshot->trigger + CAPTURE_HISTORY_SAMPLES + CAPTURE_SEGMENT_SAMPLES <= written) {
+        Fail("clamp old trigger", snapshot->trigger, written - CAPTURE_HISTORY_SAMPLES);
+    }
+    if (snapshot->first != snapshot->trigger) Fail("clamp old first", snapshot->first, snapshot->trigger);
+    if (snapshot->count != 8) Fail("clamp old count", snapshot->count, 8);
+    TestRead("clamp old samples", snapshot);
+    CaptureRelease(snapshot);
+
+    // Past the newest: the window ends in samples still to come
+    snapshot = CaptureTrigger(written + 1000, 16, 8);
+    if (snapshot == NULL) {
+        Fail("clamp new trigger", 0, 1);
+        return;
+    }
+
+    if (snapshot->trigger != written) Fail("clamp new trigger", snapshot->trigger, written);
+    if (snapshot->first != written - 16) Fail("clamp new first", snapshot->first, written - 16);
+    if (CaptureWait(snapshot, TX_NO_WAIT) == TX_SUCCESS) Fail("clamp new early", 1, 0);
+    TestWrite(8, 1);
+    TestRead("clamp new samples", snapshot);
+    CaptureRelease(snapshot);
+}
+
+
+/**
+    @brief  Random windows, complete only once their last sample is in.
+ */
+static void TestWindows(void) {
+    for (uint32_t n = 0; n < TEST_WINDOWS; n++) {
+        TestWrite(Random() % (2 * CAPTURE_HISTORY_SAMPLES), TEST_MAX_BLOCK);
+
+        uint64_t written = CaptureWritten();
+        uint32_t post = 1U + Random() % CAPTURE_POST_MAX;
+        uint32_t behind = Random() % post;
+        uint32_t pre = Random() % (CAPTURE_HISTORY_SAMPLES - behind + 1U);
+        uint64_t trigger = written - behind;
+
+        CaptureSnapshot *snapshot = CaptureTrigger(trigger, pre, post);
+        if (snapshot == NULL) {
+            Fail("window trigger", 0, 1);
+            return;
+        }
+
+        if (snapshot->trigger != trigger) Fail("window trigger", snapshot->trigger, trigger);
+        if (snapshot->first != trigger - pre) Fail("window first", snapshot->first, trigger - pre);
+        if (snapshot->count != pre + post) Fail("window count", snapshot->count, pre + post);
+
+        // All but the last sample, then the last
+        uint64_t missing = trigger + post - written;
+        TestWrite(missing - 1U, 1U + Random() % TEST_MAX_BLOCK);
+        if (CaptureWait(snapshot, TX_NO_WAIT) == TX_SUCCESS) Fail("window early", n, 0);
+        TestWrite(1, 1);
+
+        TestRead("window samples", snapshot);
+        CaptureRelease(snapshot);
+    }
+}
+
+
+/**
+    @brief  Overlapping snapshots keep their samples while the history
+            moves on past both.
+ */
+static void TestOverlap(void) {
+    TestWrite(CAPTURE_HISTORY_SAMPLES, TEST_MAX_BLOCK);
+    uint64_t written = CaptureWritten();
+
+    CaptureSnapshot *first = CaptureTrigger(written - 100, 200, 150);
+    CaptureSnapshot *second = CaptureTrigger(written - 30, 300, 200);
+    if (first == NULL || second == NULL || first == second) {
+        Fail("overlap trigger", 0, 1);
+        return;
+    }
+
+    TestWrite(20 * CAPTURE_HISTORY_SAMPLES, TEST_MAX_BLOCK);
+    TestRead("overlap first", first);
+    TestRead("overlap second", second);
+
+    // Released out of order
+    CaptureRelease(first);
+    TestWrite(CAPTURE_HISTORY_SAMPLES, TEST_MAX_BLOCK);
+    TestRead("overlap second after release", second);
+    CaptureRelease(second);
+}
+
+
+/**
+    @brief  Every snapshot held at its largest window: writes never find
+            the pool empty, and a further trigger is refused.
+ */
+static void TestPool(void) {
+    static CaptureSnapshot *held[CAPTURE_SNAPSHOTS];
+    CaptureStats stats;
+
+    // History full, then every slot at the largest window it can hold.
+    // The windows share no segment, and start part way into one, so each
+    // spans as many segments as it can
+    TestWrite(2 * CAPTURE_HISTORY_SAMPLES, TEST_MAX_BLOCK);
+    CaptureGetStats(&stats);
+    uint32_t idle_free = stats.segments_free;
+
+    for (uint32_t i = 0; i < CAPTURE_SNAPSHOTS; i++) {
+        TestWrite(CAPTURE_HISTORY_SAMPLES + CAPTURE_POST_MAX + CAPTURE_SEGMENT_SAMPLES, TEST_MAX_BLOCK);
+        if (CaptureWritten() % CAPTURE_SEGMENT_SAMPLES == 0) TestWrite(1, 1);
+        uint64_t written = CaptureWritten();
+        held[i] = CaptureTrigger(written, CAPTURE_HISTORY_SAMPLES, CAPTURE_POST_MAX);
+        if (held[i] == NULL) {
+            Fail("pool trigger", i, 1);
+            return;
+        }
+
+        // Complete one in two, so some stay filling
+        if (i % 2 == 0) TestWrite(CAPTURE_POST_MAX, TEST_MAX_BLOCK);
+    }
+
+    CaptureGetStats(&stats);
+    uint32_t refused = stats.snapshots_refused;
+    if (CaptureTrigger(CaptureWritten(), 0, 1) != NULL) Fail("pool extra trigger", 1, 0);
+    CaptureGetStats(&stats);
+    if (stats.snapshots_refused != refused + 1U) Fail("pool refused", stats.snapshots_refused, refused + 1U);
+
+    // Each segment opened takes one from the pool, after the history has
+    // let its oldest go: the pool can reach empty, but never go past it
+    for (uint32_t i = 0; i < 4 * CAPTURE_SEGMENTS; i++) {
+        TestWrite(CAPTURE_SEGMENT_SAMPLES, TEST_MAX_BLOCK);
+        CaptureGetStats(&stats);
+        if (stats.segments_free > CAPTURE_SEGMENTS) {
+            Fail("pool free", stats.segments_free, 1);
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < CAPTURE_SNAPSHOTS; i++) {
+        TestRead("pool samples", held[i]);
+        CaptureRelease(held[i]);
+    }
+
+    CaptureGetStats(&stats);
+    if (stats.segments_free != idle_free) Fail("pool returned", stats.segments_free, idle_free);
+}
+
+
+static VOID TestThread(ULONG input) {
+    (void)input;
+
+    if (CaptureInit() != TX_SUCCESS) {
+        fprintf(stderr, "FAIL init\n");
+        exit(1);
+    }
+
+    TestClamp();
+    TestWindows();
+    TestOverlap();
+    TestPool();
+
+    if (failures != 0) {
+        fprintf(stderr, "%lu checks failed\n", (unsigned long)failures);
+        exit(1);
+    }
+
+    printf("capture: all checks passed\n");
+    exit(0);
+}
+
+
+VOID tx_application_define(VOID *first_unused_memory) {
+    (void)first_unused_memory;
+
+    tx_thread_create(&test_thread, "CaptureTest", TestThread, 0,
+                     test_stack, sizeof(test_stack), 1, 1, TX_NO_TIME_SLICE, TX_AUTO_START);
+}
+
+
+int main(int argc, char *argv[]) {
+    rng_state = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : TEST_DEFAULT_SEED;
+    if (rng_state == 0) rng_state = TEST_DEFAULT_SEED;
+
+    tx_kernel_enter();
+    return 1;
+}
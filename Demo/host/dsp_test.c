@@ -0,0 +1,260 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Host test for the portable kernels in Demo/Src/dsp.c, which the device
+ * falls back to whenever the FMAC or CORDIC is busy. Filters are checked
+ * sample for sample against a direct evaluation of the same difference
+ * equation over the whole signal, fed in uneven blocks so the history
+ * carried between calls is exercised too. The vector functions are
+ * checked against libm, within the kernels' stated precision.
+ *
+ * Usage: dsp_test [seed]; exits 0 if every check passes.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dsp.h"
+
+#define TEST_SAMPLES                1000
+#define TEST_VECTORS                20000
+#define TEST_DEFAULT_SEED           0x5EEDU
+
+// Allowed error: angles in degrees, CORDIC lengths in input units (they
+// are rounded down, after a gain correction good to about 1e-4), roots
+// in q1.31 units
+#define TEST_ANGLE_TOLERANCE        0.01
+#define TEST_LENGTH_TOLERANCE       1.01
+#define TEST_ROOT_TOLERANCE         1
+
+static uint32_t rng_state;
+static uint32_t failures;
+
+
+static uint32_t Random(void) {
+    // xorshift32, as heap_bench: the same values on every host
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+
+static int16_t RandomSample(void) {
+    return (int16_t)(Random() & 0xFFFFU);
+}
+
+
+static void Fail(const char *what, long index, double got, double expected) {
+    if (failures++ < 20) {
+        fprintf(stderr, "FAIL %s [%ld]: got %.4f, expected %.4f\n", what, index, got, expected);
+    }
+}
+
+
+/**
+    @brief  The filter's difference equation, evaluated over the whole
+            signal at once, from zero history.
+ */
+static void ReferenceFilter(const int16_t *b, uint32_t taps_b, const int16_t *a, uint32_t taps_a,
+                            uint32_t gain_shift, const int16_t *in, int16_t *out, uint32_t count) {
+    for (uint32_t n = 0; n < count; n++) {
+        int64_t acc = 0;
+
+        for (uint32_t k = 0; k < taps_b && k <= n; k++) acc += (int64_t)b[k] * in[n - k];
+        for (uint32_t k = 0; k < taps_a && k + 1 <= n; k++) acc += (int64_t)a[k] * out[n - k - 1];
+
+        acc >>= 15 - gain_shift;
+        out[n] = acc > INT16_MAX ? INT16_MAX : acc < INT16_MIN ? INT16_MIN : (int16_t)acc;
+    }
+}
+
+
+/**
+    @brief  Run a filter over TEST_SAMPLES random samples in random sized
+            blocks and compare with the reference.
+ */
+static void TestFilter(const char *name, const int16_t *b, uint8_t taps_b, const int16_t *a, uint8_t taps_a,
+                       uint8_t gain_shift, int16_t amplitude) {
+    static int16_t in[TEST_SAMPLES], out[TEST_SAMPLES], expected[TEST_SAMPLES];
+    DspFilter filter;
+
+    if (!DspFilterInit(&filter, b, taps_b, a, taps_a, gain_shift)) {
+        Fail(name, -1, 0, 1);
+        return;
+    }
+
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++) {
+        in[i] = (int16_t)((int32_t)RandomSample() * amplitude / 32768);
+    }
+
+    for (uint32_t done = 0; done < TEST_SAMPLES; ) {
+        uint32_t block = 1U + Random() % 70U;
+        if (block > TEST_SAMPLES - done) block = TEST_SAMPLES - done;
+        DspFilterRun(&filter, &in[done], &out[done], (uint16_t)block);
+        done += block;
+    }
+
+    ReferenceFilter(b, taps_b, a, taps_a, gain_shift, in, expected, TEST_SAMPLES);
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++) {
+        if (out[i] != expected[i]) Fail(name, (long)i, out[i], expected[i]);
+    }
+}
+
+
+static void TestFilters(void) {
+    // 16-tap moving average: DC passes at unity, bar rounding
+    static int16_t average[16];
+    for (uint32_t k = 0; k < 16; k++) average[k] = 32768 / 16;
+    TestFilter("fir average", average, 16, NULL, 0, 0, 32767);
+
+    // Longest FIR, with random taps and gain, driven into saturation
+    static int16_t taps[DSP_FILTER_MAX_B];
+    for (uint32_t k = 0; k < DSP_FILTER_MAX_B; k++) taps[k] = (int16_t)(RandomSample() / 8);
+    TestFilter("fir long", taps, DSP_FILTER_MAX_B, NULL, 0, 3, 32767);
+
+    // One-pole low-pass, y[n] = x[n] / 4 + 3 y[n-1] / 4
+    static const int16_t pole_b[] = { 8192 };
+    static const int16_t pole_a[] = { 24576 };
+    TestFilter("iir one pole", pole_b, 1, pole_a, 1, 0, 32767);
+
+    // Second order section at a gain shift of 1
+    static const int16_t biquad_b[] = { 4096, 8192, 4096 };
+    static const int16_t biquad_a[] = { 16384, -8192 };
+    TestFilter("iir biquad", biquad_b, 3, biquad_a, 2, 1, 16384);
+
+    // The one-pole filter's impulse response, worked by hand
+    static const int16_t impulse_b[] = { 32767 };
+    static const int16_t impulse_a[] = { 16384 };
+    static const int16_t impulse_expected[] = { 999, 499, 249, 124 };
+    DspFilter filter;
+    DspFilterInit(&filter, impulse_b, 1, impulse_a, 1, 0);
+    for (uint32_t n = 0; n < 4; n++) {
+        int16_t in = n == 0 ? 1000 : 0, out;
+        DspFilterRun(&filter, &in, &out, 1);
+        if (out != impulse_expected[n]) Fail("iir impulse", (long)n, out, impulse_expected[n]);
+    }
+
+    // After a reset the filter starts from zero history again
+    DspFilterReset(&filter);
+    int16_t in = 1000, out;
+    DspFilterRun(&filter, &in, &out, 1);
+    if (out != impulse_expected[0]) Fail("iir reset", 0, out, impulse_expected[0]);
+
+    if (DspFilterInit(&filter, taps, DSP_FILTER_MAX_B + 1, NULL, 0, 0)) Fail("fir too long", 0, 1, 0);
+    if (DspFilterInit(&filter, pole_b, 1, pole_a, DSP_FILTER_MAX_A + 1, 0)) Fail("iir too long", 0, 1, 0);
+}
+
+
+static double Degrees(int32_t angle) {
+    return angle * 180.0 / 2147483648.0;
+}
+
+
+/**
+    @brief  The difference between two angles in degrees, taken the short
+            way round.
+ */
+static double AngleError(int32_t angle, double expected) {
+    return fabs(remainder(Degrees(angle) - expected, 360.0));
+}
+
+
+static void TestVector(long index, int16_t x, int16_t y) {
+    double expected_angle = (x == 0 && y == 0) ? 0.0 : atan2(y, x) * 180.0 / M_PI;
+    double expected_length = hypot(x, y);
+
+    int32_t angle = DspAtan2(y, x);
+    if (AngleError(angle, expected_angle) > TEST_ANGLE_TOLERANCE) {
+        Fail("atan2", index, Degrees(angle), expected_angle);
+    }
+
+    // Rounded down
+    uint32_t length = DspMagnitude2(x, y);
+    if (length != (uint32_t)floor(expected_length)) Fail("magnitude2", index, length, expected_length);
+
+    // The conversion rounds towards minus infinity
+    int32_t centidegrees = DspAngleToCentidegrees(angle);
+    if (centidegrees < -18000 || centidegrees > 17999 ||
+        fabs(remainder(centidegrees / 100.0 - Degrees(angle), 360.0)) >= 0.01) {
+        Fail("centidegrees", index, centidegrees, Degrees(angle) * 100.0);
+    }
+
+    int32_t polar_angle;
+    uint32_t polar_length;
+    DspPolar(&x, &y, &polar_angle, &polar_length, 1);
+    if (AngleError(polar_angle, expected_angle) > TEST_ANGLE_TOLERANCE) {
+        Fail("polar angle", index, Degrees(polar_angle), expected_angle);
+    }
+    if (fabs(polar_length - expected_length) > TEST_LENGTH_TOLERANCE) {
+        Fail("polar magnitude", index, polar_length, expected_length);
+    }
+}
+
+
+static void TestVectors(void) {
+    static const int16_t corners[][2] = {
+        { 0, 0 }, { 1000, 0 }, { 0, 1000 }, { -1000, 0 }, { 0, -1000 },
+        { 1, 1 }, { -1, 1 }, { -5, 3 }, { 12345, -23456 },
+        { INT16_MAX, INT16_MAX }, { INT16_MIN, INT16_MIN }, { INT16_MIN, INT16_MAX },
+        { INT16_MAX, INT16_MIN }, { INT16_MIN, 0 }, { 0, INT16_MIN }
+    };
+
+    long index = 0;
+    for (uint32_t i = 0; i < sizeof(corners) / sizeof(corners[0]); i++) {
+        TestVector(index++, corners[i][0], corners[i][1]);
+    }
+
+    for (uint32_t i = 0; i < TEST_VECTORS; i++) {
+        // Short vectors as well as long ones
+        int16_t x = (int16_t)(RandomSample() >> (Random() % 15U));
+        int16_t y = (int16_t)(RandomSample() >> (Random() % 15U));
+        TestVector(index++, x, y);
+
+        int16_t z = RandomSample();
+        double expected = sqrt((double)x * x + (double)y * y + (double)z * z);
+        uint32_t length = DspMagnitude3(x, y, z);
+        if (length != (uint32_t)floor(expected)) Fail("magnitude3", (long)i, length, expected);
+    }
+}
+
+
+static void TestSqrt(void) {
+    static const int32_t corners[] = { 1, 2, 3, 0x20000000, 0x40000000, 0x60000000, INT32_MAX };
+
+    for (uint32_t i = 0; i < sizeof(corners) / sizeof(corners[0]) + TEST_VECTORS; i++) {
+        int32_t x = i < sizeof(corners) / sizeof(corners[0]) ? corners[i] :
+                    (int32_t)((Random() & 0x7FFFFFFFU) >> (Random() % 31U));
+        double expected = sqrt((double)x * 2147483648.0);
+        int32_t root = DspSqrt(x);
+        if (fabs(root - expected) > TEST_ROOT_TOLERANCE) Fail("sqrt", (long)i, root, expected);
+    }
+
+    if (DspSqrt(0) != 0) Fail("sqrt zero", 0, DspSqrt(0), 0);
+    if (DspSqrt(-1) != 0) Fail("sqrt negative", 0, DspSqrt(-1), 0);
+}
+
+
+int main(int argc, char *argv[]) {
+    rng_state = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : TEST_DEFAULT_SEED;
+    if (rng_state == 0) rng_state = TEST_DEFAULT_SEED;
+
+    TestFilters();
+    TestVectors();
+    TestSqrt();
+
+    if (failures != 0) {
+        fprintf(stderr, "%lu checks failed\n", (unsigned long)failures);
+        return 1;
+    }
+
+    printf("dsp: all checks passed\n");
+    return 0;
+}
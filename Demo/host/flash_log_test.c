@@ -0,0 +1,367 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Host test for the flash backlog (Demo/Src/flash_log.c) across power
+ * loss. A fixed workload appends, flushes and consumes records until the
+ * store has been round its pages a few times. It runs once whole, to count
+ * the flash operations, then once for each of them, with
+ * HAL_SIM_FLASH_FAIL_AFTER cutting the power part way through it. After
+ * each cut, a fresh process mounts the same flash, as the next boot would,
+ * and checks that:
+ *   - every record flushed but not consumed before the cut is read back;
+ *   - records are whole and in order, with none missing in between, and
+ *     only whole pages of consumed ones again;
+ *   - the store then takes new records and returns them.
+ *
+ * Every run is a child process on the ThreadX Linux port, so the process
+ * the simulated flash ends is never the test itself.
+ *
+ * Usage: flash_log_test [first operation [last operation]]; exits 0 if
+ * every check passes.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "flash_log.h"
+#include "hal_sim.h"
+#include "tx_api.h"
+
+#define TEST_RECORDS                300
+#define TEST_RECORDS_AFTER          20
+#define TEST_MAX_PAYLOAD            300
+#define TEST_SEED                   0x5EEDU
+
+#define TEST_STACK_SIZE             16384
+
+// Child exit statuses, besides HAL_SIM_POWER_LOSS_EXIT
+#define TEST_EXIT_PASS              0
+#define TEST_EXIT_FAIL              1
+
+typedef enum {
+    TEST_RUN_WORKLOAD = 0,
+    TEST_RUN_RECOVERY
+} TestRun;
+
+// Progress of the run the power was cut in, shared with the parent and
+// kept however the run ended
+typedef struct {
+    uint32_t appended;              // Last record handed to FlashLogAppend()
+    uint32_t flushed;               // Last record FlashLogFlush() saw programmed
+    uint32_t consumed;              // Last record read and consumed
+    uint32_t operations;            // Flash operations in the whole run
+} TestState;
+
+static TestState *test_state;
+static TestRun   test_run;
+static TX_THREAD test_thread;
+static ULONG     test_stack[TEST_STACK_SIZE / sizeof(ULONG)];
+static uint8_t   test_payload[TEST_MAX_PAYLOAD + 4];
+static char      test_flash_file[] = "/tmp/flash_log_test.XXXXXX";
+
+
+static uint32_t Random(uint32_t *state) {
+    // xorshift32, as heap_bench: the same workload on every host
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+
+/**
+    @brief  A record's contents, which follow from its number alone.
+
+    @return The payload length.
+ */
+static uint16_t TestPayload(uint32_t id, uint8_t *payload) {
+    uint16_t length = (uint16_t)(4U + (id * 2654435761UL >> 16) % TEST_MAX_PAYLOAD);
+
+    memcpy(payload, &id, sizeof(id));
+    for (uint32_t i = 4; i < length; i++) {
+        payload[i] = (uint8_t)(id * 31U + i);
+    }
+
+    return length;
+}
+
+
+static int TestAppend(uint32_t id) {
+    uint16_t length = TestPayload(id, test_payload);
+
+    if (!FlashLogAppend((uint8_t)id, test_payload, length)) {
+        fprintf(stderr, "FAIL append of record %lu refused\n", (unsigned long)id);
+        return TEST_EXIT_FAIL;
+    }
+
+    test_state->appended = id;
+    return TEST_EXIT_PASS;
+}
+
+
+static int TestFlush(void) {
+    if (!FlashLogFlush()) {
+        fprintf(stderr, "FAIL flush refused\n");
+        return TEST_EXIT_FAIL;
+    }
+
+    test_state->flushed = test_state->appended;
+    return TEST_EXIT_PASS;
+}
+
+
+/**
+    @brief  Read the oldest record, check it and consume it.
+
+    @param  id  Set to the record's number, or 0 once the store is empty.
+ */
+static int TestConsume(uint32_t *id) {
+    uint8_t type;
+    uint16_t length;
+    const uint8_t *payload = FlashLogPeek(&type, &length);
+
+    *id = 0;
+    if (payload == NULL) return TEST_EXIT_PASS;
+
+    if (length >= 4) memcpy(id, payload, sizeof(*id));
+    if (length < 4 || *id == 0 || *id > test_state->appended ||
+        length != TestPayload(*id, test_payload) || type != (uint8_t)*id ||
+        memcmp(payload, test_payload, length) != 0) {
+        fprintf(stderr, "FAIL record %lu (%u bytes) is corrupt\n", (unsigned long)*id, (unsigned)length);
+        return TEST_EXIT_FAIL;
+    }
+
+    FlashLogConsume();
+    if (*id > test_state->consumed) test_state->consumed = *id;
+    return TEST_EXIT_PASS;
+}
+
+
+/**
+    @brief  Append, flush and consume, keeping the store from ever having
+            to drop a page, then read everything back.
+ */
+static int TestWorkload(void) {
+    uint32_t rng = TEST_SEED;
+    uint32_t id;
+    int result = TEST_EXIT_PASS;
+
+    for (uint32_t next = 1; next <= TEST_RECORDS && result == TEST_EXIT_PASS; next++) {
+        result = TestAppend(next);
+        if (result == TEST_EXIT_PASS && Random(&rng) % 4U == 0) result = TestFlush();
+
+        FlashLogStats stats;
+        FlashLogGetStats(&stats);
+        uint32_t reads = stats.pages_used >= FLASH_LOG_PAGES - 1U ? UINT32_MAX :
+                         Random(&rng) % 3U == 0 ? Random(&rng) % 8U : 0;
+
+        for (uint32_t i = 0; i < reads && result == TEST_EXIT_PASS; i++) {
+            result = TestConsume(&id);
+            if (id == 0) break;
+        }
+    }
+
+    if (result == TEST_EXIT_PASS) result = TestFlush();
+
+    do {
+        if (result == TEST_EXIT_PASS) result = TestConsume(&id);
+    } while (result == TEST_EXIT_PASS && id != 0);
+
+    FlashLogStats stats;
+    FlashLogGetStats(&stats);
+    if (result == TEST_EXIT_PASS && (stats.pages_dropped != 0 || test_state->consumed != TEST_RECORDS)) {
+        fprintf(stderr, "FAIL workload read back %lu of %u records, %lu pages dropped\n",
+                (unsigned long)test_state->consumed, TEST_RECORDS, (unsigned long)stats.pages_dropped);
+        result = TEST_EXIT_FAIL;
+    }
+
+    test_state->operations = HalSimFlashOperations();
+    return result;
+}
+
+
+/**
+    @brief  Mount what the cut run left, read it all back, then check the
+            store still works.
+ */
+static int TestRecovery(void) {
+    uint32_t expected = test_state->consumed + 1U;
+    uint32_t last = 0, id;
+    int result;
+
+    do {
+        result = TestConsume(&id);
+        if (result != TEST_EXIT_PASS || id == 0) break;
+
+        if (id <= last) {
+            fprintf(stderr, "FAIL record %lu read after %lu\n", (unsigned long)id, (unsigned long)last);
+            result = TEST_EXIT_FAIL;
+        } else if (id >= expected) {
+            if (id != expected) {
+                fprintf(stderr, "FAIL records %lu to %lu missing\n", (unsigned long)expected, (unsigned long)id - 1U);
+                result = TEST_EXIT_FAIL;
+            }
+            expected = id + 1U;
+        }
+        last = id;
+    } while (result == TEST_EXIT_PASS);
+
+    if (result == TEST_EXIT_PASS && expected <= test_state->flushed) {
+        fprintf(stderr, "FAIL flushed records %lu to %lu lost\n",
+                (unsigned long)expected, (unsigned long)test_state->flushed);
+        result = TEST_EXIT_FAIL;
+    }
+
+    // New records go after whatever the cut left
+    uint32_t first = test_state->appended + 1U;
+    test_state->consumed = test_state->appended;
+    for (uint32_t next = first; next < first + TEST_RECORDS_AFTER && result == TEST_EXIT_PASS; next++) {
+        result = TestAppend(next);
+    }
+
+    if (result == TEST_EXIT_PASS) result = TestFlush();
+
+    for (expected = first; result == TEST_EXIT_PASS; expected++) {
+        result = TestConsume(&id);
+        if (result != TEST_EXIT_PASS || id == 0) break;
+        if (id != expected) {
+            fprintf(stderr, "FAIL after recovery, read record %lu for %lu\n", (unsigned long)id, (unsigned long)expected);
+            result = TEST_EXIT_FAIL;
+        }
+    }
+
+    if (result == TEST_EXIT_PASS && expected != first + TEST_RECORDS_AFTER) {
+        fprintf(stderr, "FAIL after recovery, read %lu of %u records\n",
+                (unsigned long)(expected - first), TEST_RECORDS_AFTER);
+        result = TEST_EXIT_FAIL;
+    }
+
+    return result;
+}
+
+
+static VOID TestThread(ULONG input) {
+    (void)input;
+
+    int result = FlashLogInit() != TX_SUCCESS ? TEST_EXIT_FAIL :
+                 test_run == TEST_RUN_WORKLOAD ? TestWorkload() : TestRecovery();
+
+    fflush(stderr);
+    exit(result);
+}
+
+
+VOID tx_application_define(VOID *first_unused_memory) {
+    (void)first_unused_memory;
+
+    tx_thread_create(&test_thread, "FlashLogTest", TestThread, 0,
+                     test_stack, sizeof(test_stack), 1, 1, TX_NO_TIME_SLICE, TX_AUTO_START);
+}
+
+
+/**
+    @brief  Run the workload or the recovery in a child process.
+
+    @param  fail_after  The flash operation to cut the power in, or 0.
+
+    @return The child's exit status.
+ */
+static int TestSpawn(TestRun run, uint32_t fail_after) {
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(TEST_EXIT_FAIL);
+    }
+
+    if (pid == 0) {
+        char operation[16];
+        snprintf(operation, sizeof(operation), "%lu", (unsigned long)fail_after);
+        setenv("HAL_SIM_FLASH_FAIL_AFTER", operation, 1);
+
+        test_run = run;
+        tx_kernel_enter();
+        _exit(TEST_EXIT_FAIL);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+
+/**
+    @brief  Start over from an erased flash.
+ */
+static void TestErase(void) {
+    if (truncate(test_flash_file, 0) != 0) {
+        perror(test_flash_file);
+        exit(TEST_EXIT_FAIL);
+    }
+
+    memset(test_state, 0, sizeof(*test_state));
+}
+
+
+int main(int argc, char *argv[]) {
+    int fd = mkstemp(test_flash_file);
+    if (fd < 0) {
+        perror(test_flash_file);
+        return TEST_EXIT_FAIL;
+    }
+    close(fd);
+    setenv("HAL_SIM_FLASH_FILE", test_flash_file, 1);
+
+    test_state = mmap(NULL, sizeof(*test_state), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (test_state == MAP_FAILED) {
+        perror("mmap");
+        return TEST_EXIT_FAIL;
+    }
+
+    TestErase();
+    if (TestSpawn(TEST_RUN_WORKLOAD, 0) != TEST_EXIT_PASS) {
+        fprintf(stderr, "FAIL workload without power loss\n");
+        unlink(test_flash_file);
+        return TEST_EXIT_FAIL;
+    }
+
+    uint32_t operations = test_state->operations;
+    uint32_t first = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1U;
+    uint32_t last = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : operations;
+    if (first == 0) first = 1;
+    if (last > operations) last = operations;
+
+    uint32_t failures = 0;
+    for (uint32_t cut = first; cut <= last; cut++) {
+        TestErase();
+
+        int status = TestSpawn(TEST_RUN_WORKLOAD, cut);
+        if (status == HAL_SIM_POWER_LOSS_EXIT) status = TestSpawn(TEST_RUN_RECOVERY, 0);
+
+        if (status != TEST_EXIT_PASS) {
+            fprintf(stderr, "FAIL power lost in flash operation %lu of %lu (exit %d)\n",
+                    (unsigned long)cut, (unsigned long)operations, status);
+            if (++failures == 10) break;
+        }
+    }
+
+    unlink(test_flash_file);
+
+    if (failures != 0) return TEST_EXIT_FAIL;
+
+    printf("flash_log: recovered from power loss in each of flash operations %lu to %lu\n",
+           (unsigned long)first, (unsigned long)last);
+    return TEST_EXIT_PASS;
+}
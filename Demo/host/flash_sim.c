@@ -0,0 +1,181 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Simulated internal flash for the host build of the Demo, with the rules
+ * the STM32U5 enforces: a quad-word is programmed once per erase, bursts
+ * are eight aligned quad-words and erase works on 8KB pages. The flash is
+ * kept in HAL_SIM_FLASH_FILE, if set, so a later run finds what an
+ * earlier one wrote. With HAL_SIM_FLASH_FAIL_AFTER set, power is lost
+ * part way through that operation: the quad-word or page is left with
+ * some of its bits changed, as on the device, and the process ends at
+ * once, without flushing anything else. See shim/hal_sim.h.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hal_sim.h"
+
+#define FLASH_SIM_SIZE              0x200000UL
+#define FLASH_SIM_BANK_SIZE         (FLASH_SIM_SIZE / 2U)
+#define FLASH_SIM_QUAD              16U
+
+static uint8_t  *flash_sim_memory;
+static uint32_t flash_sim_operations;
+static uint32_t flash_sim_fail_after;
+static int      flash_sim_unlocked;
+
+
+/**
+    @brief  Map the flash, from HAL_SIM_FLASH_FILE or fresh and erased.
+ */
+static void FlashSimOpen(void) {
+    if (flash_sim_memory != NULL) return;
+
+    const char *fail = getenv("HAL_SIM_FLASH_FAIL_AFTER");
+    flash_sim_fail_after = fail != NULL ? (uint32_t)strtoul(fail, NULL, 10) : 0;
+    srand(flash_sim_fail_after);
+
+    const char *path = getenv("HAL_SIM_FLASH_FILE");
+    if (path == NULL) {
+        flash_sim_memory = mmap(NULL, FLASH_SIM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (flash_sim_memory == MAP_FAILED) {
+            perror("#sim flash");
+            exit(1);
+        }
+        memset(flash_sim_memory, 0xFF, FLASH_SIM_SIZE);
+        return;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        perror("#sim flash file");
+        exit(1);
+    }
+
+    // A new file, or one of the wrong size, starts out erased
+    int fresh = info.st_size != (off_t)FLASH_SIM_SIZE;
+    if (fresh && ftruncate(fd, FLASH_SIM_SIZE) != 0) {
+        perror("#sim flash file");
+        exit(1);
+    }
+
+    // Shared, so everything programmed is in the file however the run ends
+    flash_sim_memory = mmap(NULL, FLASH_SIM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (flash_sim_memory == MAP_FAILED) {
+        perror("#sim flash file");
+        exit(1);
+    }
+    if (fresh) memset(flash_sim_memory, 0xFF, FLASH_SIM_SIZE);
+}
+
+
+/**
+    @brief  Count an operation; on the one set to fail, leave it half
+            done and end the process.
+
+    @param  target  The quad-word or page being changed.
+    @param  data    The quad-word being programmed, or NULL for an erase.
+ */
+static void FlashSimOperation(uint8_t *target, const uint8_t *data, uint32_t size) {
+    flash_sim_operations++;
+    if (flash_sim_operations != flash_sim_fail_after) return;
+
+    // Programming only clears bits and erasing only sets them: a cut
+    // operation leaves some of the bits it would have changed unchanged
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t mask = (uint8_t)rand();
+        target[i] = data != NULL ? (uint8_t)(target[i] & (data[i] | mask)) : (uint8_t)(target[i] | mask);
+    }
+
+    fprintf(stderr, "#sim power lost in flash operation %lu\n", (unsigned long)flash_sim_operations);
+    _exit(HAL_SIM_POWER_LOSS_EXIT);
+}
+
+
+static uint8_t *FlashSimAt(uint32_t address, uint32_t size) {
+    FlashSimOpen();
+    if (address < FLASH_BASE_NS || address - FLASH_BASE_NS + size > FLASH_SIM_SIZE) return NULL;
+    return &flash_sim_memory[address - FLASH_BASE_NS];
+}
+
+
+const uint8_t *HalSimFlashPointer(uint32_t address) {
+    const uint8_t *memory = FlashSimAt(address, 1);
+    assert(memory != NULL);
+    return memory;
+}
+
+
+/**
+    @brief  Program and erase operations since the start of the run, to
+            pick values for HAL_SIM_FLASH_FAIL_AFTER.
+ */
+uint32_t HalSimFlashOperations(void) {
+    return flash_sim_operations;
+}
+
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+    flash_sim_unlocked = 1;
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+    flash_sim_unlocked = 0;
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uintptr_t DataAddress) {
+    uint32_t size = TypeProgram == FLASH_TYPEPROGRAM_BURST ? 8U * FLASH_SIM_QUAD : FLASH_SIM_QUAD;
+    uint8_t *target = FlashSimAt(Address, size);
+    const uint8_t *data = (const uint8_t *)DataAddress;
+
+    if (flash_sim_unlocked == 0 || target == NULL || (Address % size) != 0) return HAL_ERROR;
+
+    // Each quad-word once per erase
+    for (uint32_t i = 0; i < size; i++) {
+        if (target[i] != 0xFFU) return HAL_ERROR;
+    }
+
+    for (uint32_t offset = 0; offset < size; offset += FLASH_SIM_QUAD) {
+        FlashSimOperation(target + offset, data + offset, FLASH_SIM_QUAD);
+        memcpy(target + offset, data + offset, FLASH_SIM_QUAD);
+    }
+
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError) {
+    *PageError = 0xFFFFFFFFU;
+    if (flash_sim_unlocked == 0 || pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES) return HAL_ERROR;
+
+    uint32_t bank = pEraseInit->Banks == FLASH_BANK_2 ? FLASH_SIM_BANK_SIZE : 0;
+    for (uint32_t page = pEraseInit->Page; page < pEraseInit->Page + pEraseInit->NbPages; page++) {
+        uint8_t *target = FlashSimAt(FLASH_BASE_NS + bank + page * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE);
+        if (target == NULL || page * FLASH_PAGE_SIZE >= FLASH_SIM_BANK_SIZE) {
+            *PageError = page;
+            return HAL_ERROR;
+        }
+
+        FlashSimOperation(target, NULL, FLASH_PAGE_SIZE);
+        memset(target, 0xFF, FLASH_PAGE_SIZE);
+    }
+
+    return HAL_OK;
+}
@@ -0,0 +1,339 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Simulated GPIO and I2C for the host build of the Demo, plus the timed
+ * end of a soak run. See shim/stm32u5xx_hal.h and shim/hal_sim.h.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hal_sim.h"
+#include "timebase.h"
+
+#define HAL_SIM_PORTS               9
+#define HAL_SIM_PINS                16
+
+typedef struct {
+    I2C_TypeDef             *bus;
+    uint8_t                 address;
+    const HalSimI2cDevice   *device;
+    void                    *context;
+} HalSimI2cSlot;
+
+uint32_t SystemCoreClock = 160000000U;
+
+GPIO_TypeDef hal_sim_gpio[HAL_SIM_PORTS];
+I2C_TypeDef  hal_sim_i2c[4] = { { 0 }, { 1 }, { 2 }, { 3 } };
+
+static HalSimI2cSlot hal_sim_i2c_slots[HAL_SIM_I2C_MAX_DEVICES];
+static int           hal_sim_trace_gpio;
+
+// From main.c: the clock as Microvisor reports it
+uint32_t SECURE_SystemCoreClockUpdate(void);
+
+
+/**
+    @brief  Print a summary of the GPIO activity and end the process.
+ */
+static void *HalSimRunTimer(void *argument) {
+    unsigned long ms = (unsigned long)(uintptr_t)argument;
+    usleep(ms * 1000UL);
+
+    fprintf(stderr, "#sim run ended after %lu ms\n", ms);
+    for (uint32_t port = 0; port < HAL_SIM_PORTS; port++) {
+        for (uint32_t pin = 0; pin < HAL_SIM_PINS; pin++) {
+            if (hal_sim_gpio[port].toggles[pin] != 0) {
+                fprintf(stderr, "#sim gpio %c%lu %lu changes\n", 'A' + (char)port,
+                        (unsigned long)pin, (unsigned long)hal_sim_gpio[port].toggles[pin]);
+            }
+        }
+    }
+
+    fflush(stdout);
+    exit(0);
+    return NULL;
+}
+
+
+void SystemCoreClockUpdate(void) {
+    SystemCoreClock = SECURE_SystemCoreClockUpdate();
+}
+
+
+/**
+    @brief  Reset the models and start the timebase; with HAL_SIM_RUN_MS
+            set, end the run after that long.
+ */
+HAL_StatusTypeDef HAL_Init(void) {
+    memset(hal_sim_gpio, 0, sizeof(hal_sim_gpio));
+    memset(hal_sim_i2c_slots, 0, sizeof(hal_sim_i2c_slots));
+    hal_sim_trace_gpio = getenv("HAL_SIM_TRACE_GPIO") != NULL;
+
+    const char *run = getenv("HAL_SIM_RUN_MS");
+    if (run != NULL && strtoul(run, NULL, 10) > 0) {
+        pthread_t timer;
+        uintptr_t ms = (uintptr_t)strtoul(run, NULL, 10);
+        if (pthread_create(&timer, NULL, HalSimRunTimer, (void *)ms) != 0) return HAL_ERROR;
+        pthread_detach(timer);
+    }
+
+    return HAL_InitTick(TICK_INT_PRIORITY);
+}
+
+
+/*
+ * GPIO
+ */
+
+/**
+    @brief  Record an output change, tracing it if asked to.
+ */
+static void HalSimGpioOutput(GPIO_TypeDef *port, uint32_t pins, uint32_t odr) {
+    uint32_t changed = (port->ODR ^ odr) & pins & port->MODER;
+    port->ODR = (port->ODR & ~pins) | (odr & pins);
+    port->IDR = (port->IDR & ~port->MODER) | (port->ODR & port->MODER);
+
+    for (uint32_t pin = 0; pin < HAL_SIM_PINS; pin++) {
+        if ((changed & (1U << pin)) == 0) continue;
+
+        port->toggles[pin]++;
+        if (hal_sim_trace_gpio) {
+            fprintf(stderr, "#sim %llu gpio %c%lu %lu\n", (unsigned long long)TimebaseGetMicros(),
+                    'A' + (char)(port - hal_sim_gpio), (unsigned long)pin,
+                    (unsigned long)((port->ODR >> pin) & 1U));
+        }
+    }
+}
+
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init) {
+    uint32_t output = GPIO_Init->Mode == GPIO_MODE_OUTPUT_PP || GPIO_Init->Mode == GPIO_MODE_OUTPUT_OD;
+
+    if (output) {
+        GPIOx->MODER |= GPIO_Init->Pin;
+    } else {
+        GPIOx->MODER &= ~GPIO_Init->Pin;
+        // An input floats to its pull
+        if (GPIO_Init->Pull == GPIO_PULLUP) GPIOx->IDR |= GPIO_Init->Pin;
+        if (GPIO_Init->Pull == GPIO_PULLDOWN) GPIOx->IDR &= ~GPIO_Init->Pin;
+    }
+}
+
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin) {
+    GPIOx->MODER &= ~GPIO_Pin;
+}
+
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+    return (GPIOx->IDR & GPIO_Pin) != 0 ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+    HalSimGpioOutput(GPIOx, GPIO_Pin, PinState == GPIO_PIN_SET ? GPIO_Pin : 0U);
+}
+
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+    HalSimGpioOutput(GPIOx, GPIO_Pin, ~GPIOx->ODR);
+}
+
+
+/**
+    @brief  A bit set/reset register store: set bits in the low half,
+            reset bits in the high half, set winning as on the device.
+ */
+void HalSimGpioBsrr(GPIO_TypeDef *port, uint32_t value) {
+    uint32_t set = value & 0xFFFFU;
+    uint32_t pins = set | (value >> 16);
+    HalSimGpioOutput(port, pins, set);
+}
+
+
+/**
+    @brief  Drive an input pin from a test or device model.
+ */
+void HalSimGpioSetInput(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+    uint32_t inputs = pin & ~port->MODER;
+    port->IDR = state == GPIO_PIN_SET ? (port->IDR | inputs) : (port->IDR & ~inputs);
+}
+
+
+/**
+    @brief  Output changes on one pin since HAL_Init().
+ */
+uint32_t HalSimGpioToggles(GPIO_TypeDef *port, uint16_t pin) {
+    for (uint32_t index = 0; index < HAL_SIM_PINS; index++) {
+        if (pin == (1U << index)) return port->toggles[index];
+    }
+    return 0;
+}
+
+
+/*
+ * I2C BUS
+ */
+
+/**
+    @brief  Put a device model on a bus.
+
+    @param  bus         I2C1 to I2C4.
+    @param  address     7-bit address.
+    @param  device      The model's transfer handlers.
+    @param  context     Passed to the handlers.
+
+    @return 0, or -1 when the bus is full.
+ */
+int HalSimI2cAttach(I2C_TypeDef *bus, uint8_t address, const HalSimI2cDevice *device, void *context) {
+    for (uint32_t i = 0; i < HAL_SIM_I2C_MAX_DEVICES; i++) {
+        HalSimI2cSlot *slot = &hal_sim_i2c_slots[i];
+        if (slot->device == NULL) {
+            slot->bus = bus;
+            slot->address = address;
+            slot->device = device;
+            slot->context = context;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+/**
+    @brief  The model at a HAL device address (7-bit address << 1), or
+            NULL if nothing acknowledges it.
+ */
+static HalSimI2cSlot *HalSimI2cFind(I2C_HandleTypeDef *hi2c, uint16_t DevAddress) {
+    for (uint32_t i = 0; i < HAL_SIM_I2C_MAX_DEVICES; i++) {
+        HalSimI2cSlot *slot = &hal_sim_i2c_slots[i];
+        if (slot->device != NULL && slot->bus == hi2c->Instance && slot->address == (DevAddress >> 1)) {
+            return slot;
+        }
+    }
+
+    hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+    return NULL;
+}
+
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c) {
+    if (hi2c == NULL) return HAL_ERROR;
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->State = HAL_I2C_STATE_READY;
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c) {
+    if (hi2c == NULL) return HAL_ERROR;
+    hi2c->State = HAL_I2C_STATE_RESET;
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                          uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    HalSimI2cSlot *slot = HalSimI2cFind(hi2c, DevAddress);
+    if (slot == NULL) return HAL_ERROR;
+    return slot->device->write(slot->context, pData, Size);
+}
+
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                         uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    HalSimI2cSlot *slot = HalSimI2cFind(hi2c, DevAddress);
+    if (slot == NULL) return HAL_ERROR;
+    return slot->device->read(slot->context, pData, Size);
+}
+
+
+/**
+    @brief  Register address bytes, most significant first as on the wire.
+ */
+static uint16_t HalSimI2cMemAddress(uint8_t *out, uint16_t MemAddress, uint16_t MemAddSize) {
+    if (MemAddSize == I2C_MEMADD_SIZE_16BIT) {
+        out[0] = (uint8_t)(MemAddress >> 8);
+        out[1] = (uint8_t)MemAddress;
+        return 2;
+    }
+    out[0] = (uint8_t)MemAddress;
+    return 1;
+}
+
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    HalSimI2cSlot *slot = HalSimI2cFind(hi2c, DevAddress);
+    if (slot == NULL) return HAL_ERROR;
+
+    // One transfer: address then data
+    uint8_t buffer[2 + 256];
+    if (Size > 256) return HAL_ERROR;
+    uint16_t length = HalSimI2cMemAddress(buffer, MemAddress, MemAddSize);
+    memcpy(buffer + length, pData, Size);
+    return slot->device->write(slot->context, buffer, (uint16_t)(length + Size));
+}
+
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    HalSimI2cSlot *slot = HalSimI2cFind(hi2c, DevAddress);
+    if (slot == NULL) return HAL_ERROR;
+
+    // Address write, repeated start, read
+    uint8_t address[2];
+    uint16_t length = HalSimI2cMemAddress(address, MemAddress, MemAddSize);
+    HAL_StatusTypeDef status = slot->device->write(slot->context, address, length);
+    if (status != HAL_OK) return status;
+    return slot->device->read(slot->context, pData, Size);
+}
+
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials,
+                                        uint32_t Timeout) {
+    (void)Trials;
+    (void)Timeout;
+    return HalSimI2cFind(hi2c, DevAddress) != NULL ? HAL_OK : HAL_ERROR;
+}
+
+
+static HAL_StatusTypeDef HalSimRegisterFileWrite(void *context, const uint8_t *data, uint16_t size) {
+    HalSimI2cRegisterFile *file = context;
+    if (size == 0) return HAL_OK;
+
+    file->pointer = data[0];
+    for (uint16_t i = 1; i < size; i++) {
+        file->regs[file->pointer++] = data[i];
+    }
+    return HAL_OK;
+}
+
+
+static HAL_StatusTypeDef HalSimRegisterFileRead(void *context, uint8_t *data, uint16_t size) {
+    HalSimI2cRegisterFile *file = context;
+
+    for (uint16_t i = 0; i < size; i++) {
+        data[i] = file->regs[file->pointer++];
+    }
+    return HAL_OK;
+}
+
+
+const HalSimI2cDevice hal_sim_i2c_register_file = {
+    .write = HalSimRegisterFileWrite,
+    .read = HalSimRegisterFileRead
+};
@@ -0,0 +1,140 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Simulated Microvisor system calls for the host build. Handles are
+ * nonzero counters, the network reports connected MV_SIM_ATTACH_MS after
+ * it is requested, and channel writes go to stdout. With MV_SIM_DROP_MS,
+ * the network drops once, that long after it first attaches: the channel
+ * then reports closed until the network is requested again.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mv_syscalls.h"
+#include "timebase.h"
+
+static uint32_t mv_sim_next_handle = 1;
+static uint64_t mv_sim_attach_us;
+static uint64_t mv_sim_drop_us = UINT64_MAX;
+static uint8_t  mv_sim_requested;
+static uint8_t  mv_sim_dropped;
+
+
+static uint32_t MvSimHandle(void) {
+    return mv_sim_next_handle++;
+}
+
+
+static uint32_t MvSimMillis(const char *name) {
+    const char *value = getenv(name);
+    return value != NULL ? (uint32_t)strtoul(value, NULL, 10) : 0;
+}
+
+
+/**
+    @brief  Whether the network has dropped since it was last requested.
+ */
+static uint8_t MvSimDropped(void) {
+    if (TimebaseGetMicros() >= mv_sim_drop_us) {
+        mv_sim_drop_us = UINT64_MAX;
+        mv_sim_dropped = 1;
+    }
+
+    return mv_sim_dropped;
+}
+
+
+enum MvStatus mvSetupNotifications(const struct MvNotificationSetup *setup, MvNotificationHandle *handle) {
+    (void)setup;
+    *handle = MvSimHandle();
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvCloseNotifications(MvNotificationHandle *handle) {
+    if (*handle == 0) return MV_STATUS_INVALIDHANDLE;
+    *handle = 0;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvRequestNetwork(const struct MvRequestNetworkParams *params, MvNetworkHandle *handle) {
+    (void)params;
+
+    mv_sim_attach_us = TimebaseGetMicros() + (uint64_t)MvSimMillis("MV_SIM_ATTACH_MS") * 1000U;
+    mv_sim_dropped = 0;
+
+    uint32_t drop_ms = MvSimMillis("MV_SIM_DROP_MS");
+    if (mv_sim_requested == 0 && drop_ms != 0) mv_sim_drop_us = mv_sim_attach_us + (uint64_t)drop_ms * 1000U;
+    mv_sim_requested = 1;
+
+    *handle = MvSimHandle();
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvReleaseNetwork(MvNetworkHandle *handle) {
+    if (*handle == 0) return MV_STATUS_INVALIDHANDLE;
+    *handle = 0;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetNetworkStatus(MvNetworkHandle handle, enum MvNetworkStatus *status) {
+    if (handle == 0) return MV_STATUS_INVALIDHANDLE;
+    *status = TimebaseGetMicros() >= mv_sim_attach_us && MvSimDropped() == 0 ?
+              MV_NETWORKSTATUS_CONNECTED : MV_NETWORKSTATUS_CONNECTING;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvOpenChannel(const struct MvOpenChannelParams *params, MvChannelHandle *handle) {
+    if (params->v1.network_handle == 0) return MV_STATUS_INVALIDHANDLE;
+    *handle = MvSimHandle();
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvCloseChannel(MvChannelHandle *handle) {
+    if (*handle == 0) return MV_STATUS_INVALIDHANDLE;
+    *handle = 0;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvWriteChannel(MvChannelHandle handle, const uint8_t *data, uint32_t length, uint32_t *available) {
+    if (handle == 0 || MvSimDropped() != 0) return MV_STATUS_CHANNELCLOSED;
+
+    fwrite(data, 1, length, stdout);
+    fflush(stdout);
+    *available = 512;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvWriteChannelStream(MvChannelHandle handle, const uint8_t *data, uint32_t length, uint32_t *written) {
+    if (handle == 0 || MvSimDropped() != 0) return MV_STATUS_CHANNELCLOSED;
+
+    fwrite(data, 1, length, stdout);
+    fflush(stdout);
+    *written = length;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetHClk(uint32_t *hz) {
+    *hz = 160000000U;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetPClk1(uint32_t *hz) {
+    *hz = 160000000U;
+    return MV_STATUS_OKAY;
+}
@@ -0,0 +1,61 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+#include <stdint.h>
+
+#include "stm32u5xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Host-only controls for the simulated peripherals, for soak tests and
+ * device models. Environment variables read by HAL_Init():
+ *   HAL_SIM_RUN_MS       end the run after this many ms, with a summary
+ *   HAL_SIM_TRACE_GPIO   print every output change to stderr
+ * and by the flash model, on first use:
+ *   HAL_SIM_FLASH_FILE   keep the flash in this file, across runs
+ *   HAL_SIM_FLASH_FAIL_AFTER
+ *                        lose power part way through this flash operation,
+ *                        counting quad-words and page erases from 1: the
+ *                        process ends with HAL_SIM_POWER_LOSS_EXIT
+ */
+
+// An I2C device model. Each call is one transfer; a register address is
+// the first byte(s) of a write, as on the wire
+typedef struct {
+    HAL_StatusTypeDef (*write)(void *context, const uint8_t *data, uint16_t size);
+    HAL_StatusTypeDef (*read)(void *context, uint8_t *data, uint16_t size);
+} HalSimI2cDevice;
+
+// Generic register file device: the first byte written sets the register
+// pointer, which auto-increments on every byte read or written
+typedef struct {
+    uint8_t regs[256];
+    uint8_t pointer;
+} HalSimI2cRegisterFile;
+
+extern const HalSimI2cDevice hal_sim_i2c_register_file;
+
+#define HAL_SIM_I2C_MAX_DEVICES     8
+
+#define HAL_SIM_POWER_LOSS_EXIT     3
+
+int  HalSimI2cAttach(I2C_TypeDef *bus, uint8_t address, const HalSimI2cDevice *device, void *context);
+void HalSimGpioSetInput(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+uint32_t HalSimGpioToggles(GPIO_TypeDef *port, uint16_t pin);
+uint32_t HalSimFlashOperations(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_SIM_H */
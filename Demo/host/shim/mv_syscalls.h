@@ -0,0 +1,103 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Stand-in for the Microvisor system calls on the host build
+ * (Demo/host/mv_syscalls_sim.c): the calls the Demo makes, with the same
+ * names and shapes. The network 'attaches' after MV_SIM_ATTACH_MS (from
+ * the environment, default 0) and the log channel writes to stdout.
+ */
+#ifndef MV_SYSCALLS_H
+#define MV_SYSCALLS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t MvNotificationHandle;
+typedef uint32_t MvNetworkHandle;
+typedef uint32_t MvChannelHandle;
+
+enum MvStatus {
+    MV_STATUS_OKAY = 0,
+    MV_STATUS_INVALIDHANDLE = 2,
+    MV_STATUS_CHANNELCLOSED = 7
+};
+
+enum MvNetworkStatus {
+    MV_NETWORKSTATUS_DELIBERATELYOFFLINE = 0,
+    MV_NETWORKSTATUS_CONNECTED = 1,
+    MV_NETWORKSTATUS_CONNECTING = 2
+};
+
+enum MvEventType {
+    MV_EVENTTYPE_NOEVENT = 0,
+    MV_EVENTTYPE_NETWORKSTATUSCHANGED = 1,
+    MV_EVENTTYPE_CHANNELDATAREADABLE = 2,
+    MV_EVENTTYPE_CHANNELNOTCONNECTED = 3
+};
+
+enum MvChannelType {
+    MV_CHANNELTYPE_OPAQUEBYTES = 1
+};
+
+struct MvNotification {
+    uint64_t microseconds;
+    uint32_t event_type;
+    uint32_t tag;
+};
+
+struct MvNotificationSetup {
+    uint32_t irq;
+    struct MvNotification *buffer;
+    uint32_t buffer_size;
+};
+
+struct MvRequestNetworkParams {
+    uint32_t version;
+    struct {
+        MvNotificationHandle notification_handle;
+        uint32_t notification_tag;
+    } v1;
+};
+
+struct MvOpenChannelParams {
+    uint32_t version;
+    struct {
+        MvNotificationHandle notification_handle;
+        uint32_t notification_tag;
+        MvNetworkHandle network_handle;
+        uint8_t *receive_buffer;
+        uint32_t receive_buffer_len;
+        uint8_t *send_buffer;
+        uint32_t send_buffer_len;
+        enum MvChannelType channel_type;
+        const uint8_t *endpoint;
+        uint32_t endpoint_len;
+    } v1;
+};
+
+enum MvStatus mvSetupNotifications(const struct MvNotificationSetup *setup, MvNotificationHandle *handle);
+enum MvStatus mvCloseNotifications(MvNotificationHandle *handle);
+enum MvStatus mvRequestNetwork(const struct MvRequestNetworkParams *params, MvNetworkHandle *handle);
+enum MvStatus mvReleaseNetwork(MvNetworkHandle *handle);
+enum MvStatus mvGetNetworkStatus(MvNetworkHandle handle, enum MvNetworkStatus *status);
+enum MvStatus mvOpenChannel(const struct MvOpenChannelParams *params, MvChannelHandle *handle);
+enum MvStatus mvCloseChannel(MvChannelHandle *handle);
+enum MvStatus mvWriteChannel(MvChannelHandle handle, const uint8_t *data, uint32_t length, uint32_t *available);
+enum MvStatus mvWriteChannelStream(MvChannelHandle handle, const uint8_t *data, uint32_t length, uint32_t *written);
+enum MvStatus mvGetHClk(uint32_t *hz);
+enum MvStatus mvGetPClk1(uint32_t *hz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MV_SYSCALLS_H */
@@ -0,0 +1,270 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Simulated HAL for the host build of the Demo (Demo/host): the parts of
+ * the STM32U5 HAL the application uses, with the same names and
+ * signatures. GPIO and I2C act on models in hal_sim.c, and flash on the
+ * one in flash_sim.c; the time base is the host's monotonic clock
+ * (timebase_sim.c). Interrupt control is a no-op, as the ThreadX Linux
+ * port does its own locking.
+ */
+#ifndef STM32U5xx_HAL_H
+#define STM32U5xx_HAL_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cmsis_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define __ALIGN_BEGIN
+#define __ALIGN_END                 __attribute__((aligned(4)))
+
+#define HAL_MAX_DELAY               0xFFFFFFFFU
+#define TICK_INT_PRIORITY           15U
+
+typedef enum {
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum {
+    HAL_TICK_FREQ_1KHZ = 1U
+} HAL_TickFreqTypeDef;
+
+extern uint32_t SystemCoreClock;
+extern volatile uint32_t uwTick;
+extern HAL_TickFreqTypeDef uwTickFreq;
+
+void SystemCoreClockUpdate(void);
+
+HAL_StatusTypeDef HAL_Init(void);
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority);
+void HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+
+// Interrupts: the numbers the application refers to
+typedef enum {
+    EXTI0_IRQn      = 11,
+    TIM6_IRQn       = 49,
+    TIM8_BRK_IRQn   = 51
+} IRQn_Type;
+
+__STATIC_INLINE void NVIC_EnableIRQ(IRQn_Type IRQn)         { (void)IRQn; }
+__STATIC_INLINE void NVIC_DisableIRQ(IRQn_Type IRQn)        { (void)IRQn; }
+__STATIC_INLINE void NVIC_ClearPendingIRQ(IRQn_Type IRQn)   { (void)IRQn; }
+__STATIC_INLINE void NVIC_SetPendingIRQ(IRQn_Type IRQn)     { (void)IRQn; }
+__STATIC_INLINE void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority) {
+    (void)IRQn; (void)PreemptPriority; (void)SubPriority;
+}
+__STATIC_INLINE void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)     { (void)IRQn; }
+__STATIC_INLINE void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)    { (void)IRQn; }
+__STATIC_INLINE void __DSB(void)                            { __sync_synchronize(); }
+__STATIC_INLINE void __DMB(void)                            { __sync_synchronize(); }
+__STATIC_INLINE void __ISB(void)                            { }
+
+/*
+ * GPIO
+ */
+typedef struct {
+    volatile uint32_t MODER;        // One bit per pin here: 1 = output
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+    uint32_t toggles[16];           // Output changes per pin, for soak tests
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef hal_sim_gpio[9];
+
+#define GPIOA                       (&hal_sim_gpio[0])
+#define GPIOB                       (&hal_sim_gpio[1])
+#define GPIOC                       (&hal_sim_gpio[2])
+#define GPIOD                       (&hal_sim_gpio[3])
+#define GPIOE                       (&hal_sim_gpio[4])
+#define GPIOF                       (&hal_sim_gpio[5])
+#define GPIOG                       (&hal_sim_gpio[6])
+#define GPIOH                       (&hal_sim_gpio[7])
+#define GPIOI                       (&hal_sim_gpio[8])
+
+#define GPIO_PIN_0                  ((uint16_t)0x0001)
+#define GPIO_PIN_1                  ((uint16_t)0x0002)
+#define GPIO_PIN_2                  ((uint16_t)0x0004)
+#define GPIO_PIN_3                  ((uint16_t)0x0008)
+#define GPIO_PIN_4                  ((uint16_t)0x0010)
+#define GPIO_PIN_5                  ((uint16_t)0x0020)
+#define GPIO_PIN_6                  ((uint16_t)0x0040)
+#define GPIO_PIN_7                  ((uint16_t)0x0080)
+#define GPIO_PIN_8                  ((uint16_t)0x0100)
+#define GPIO_PIN_9                  ((uint16_t)0x0200)
+#define GPIO_PIN_10                 ((uint16_t)0x0400)
+#define GPIO_PIN_11                 ((uint16_t)0x0800)
+#define GPIO_PIN_12                 ((uint16_t)0x1000)
+#define GPIO_PIN_13                 ((uint16_t)0x2000)
+#define GPIO_PIN_14                 ((uint16_t)0x4000)
+#define GPIO_PIN_15                 ((uint16_t)0x8000)
+#define GPIO_PIN_All                ((uint16_t)0xFFFF)
+
+#define GPIO_MODE_INPUT             0x00000000U
+#define GPIO_MODE_OUTPUT_PP         0x00000001U
+#define GPIO_MODE_OUTPUT_OD         0x00000011U
+#define GPIO_MODE_AF_PP             0x00000002U
+#define GPIO_MODE_AF_OD             0x00000012U
+#define GPIO_MODE_ANALOG            0x00000003U
+#define GPIO_MODE_IT_RISING         0x10110000U
+#define GPIO_MODE_IT_FALLING        0x10210000U
+#define GPIO_MODE_IT_RISING_FALLING 0x10310000U
+
+#define GPIO_NOPULL                 0x00000000U
+#define GPIO_PULLUP                 0x00000001U
+#define GPIO_PULLDOWN               0x00000002U
+
+#define GPIO_SPEED_FREQ_LOW         0x00000000U
+#define GPIO_SPEED_FREQ_MEDIUM      0x00000001U
+#define GPIO_SPEED_FREQ_HIGH        0x00000002U
+#define GPIO_SPEED_FREQ_VERY_HIGH   0x00000003U
+
+typedef enum {
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE()
+#define __HAL_RCC_GPIOB_CLK_ENABLE()
+#define __HAL_RCC_GPIOC_CLK_ENABLE()
+#define __HAL_RCC_GPIOD_CLK_ENABLE()
+#define __HAL_RCC_GPIOE_CLK_ENABLE()
+#define __HAL_RCC_GPIOF_CLK_ENABLE()
+#define __HAL_RCC_GPIOG_CLK_ENABLE()
+#define __HAL_RCC_GPIOH_CLK_ENABLE()
+#define __HAL_RCC_GPIOI_CLK_ENABLE()
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+// There is no BSRR to store to: pins.h stores through the model instead
+void HalSimGpioBsrr(GPIO_TypeDef *port, uint32_t value);
+
+#define PIN_BSRR_WRITE(port, value)     HalSimGpioBsrr((port), (value))
+
+/*
+ * I2C: transfers go to the device models attached with HalSimI2cAttach()
+ */
+typedef struct {
+    uint32_t index;
+} I2C_TypeDef;
+
+extern I2C_TypeDef hal_sim_i2c[4];
+
+#define I2C1                        (&hal_sim_i2c[0])
+#define I2C2                        (&hal_sim_i2c[1])
+#define I2C3                        (&hal_sim_i2c[2])
+#define I2C4                        (&hal_sim_i2c[3])
+
+#define I2C_ADDRESSINGMODE_7BIT     0x00000001U
+#define I2C_DUALADDRESS_DISABLE     0x00000000U
+#define I2C_GENERALCALL_DISABLE     0x00000000U
+#define I2C_NOSTRETCH_DISABLE       0x00000000U
+#define I2C_OA2_NOMASK              0x00U
+
+#define I2C_MEMADD_SIZE_8BIT        0x00000001U
+#define I2C_MEMADD_SIZE_16BIT       0x00000002U
+
+#define HAL_I2C_ERROR_NONE          0x00000000U
+#define HAL_I2C_ERROR_AF            0x00000004U
+
+typedef enum {
+    HAL_I2C_STATE_RESET = 0x00U,
+    HAL_I2C_STATE_READY = 0x20U
+} HAL_I2C_StateTypeDef;
+
+typedef struct {
+    uint32_t Timing;
+    uint32_t OwnAddress1;
+    uint32_t AddressingMode;
+    uint32_t DualAddressMode;
+    uint32_t OwnAddress2;
+    uint32_t OwnAddress2Masks;
+    uint32_t GeneralCallMode;
+    uint32_t NoStretchMode;
+} I2C_InitTypeDef;
+
+typedef struct {
+    I2C_TypeDef                 *Instance;
+    I2C_InitTypeDef             Init;
+    volatile HAL_I2C_StateTypeDef State;
+    volatile uint32_t           ErrorCode;
+} I2C_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                          uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                         uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials,
+                                        uint32_t Timeout);
+
+/*
+ * FLASH: the 2MB of the STM32U585, at its non-secure address
+ */
+#define FLASH_BASE_NS               0x08000000UL
+#define FLASH_PAGE_SIZE             0x2000U
+
+#define FLASH_TYPEPROGRAM_QUADWORD  0x00000001U
+#define FLASH_TYPEPROGRAM_BURST     0x00000002U
+#define FLASH_TYPEERASE_PAGES       0x00000000U
+#define FLASH_BANK_1                0x00000001U
+#define FLASH_BANK_2                0x00000002U
+
+typedef struct {
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uint32_t Page;
+    uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+// The source is a host pointer, which does not fit the HAL's uint32_t
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uintptr_t DataAddress);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+
+// Flash is not at its device address: flash_log.c reads through the model
+const uint8_t *HalSimFlashPointer(uint32_t address);
+
+#define FLASH_LOG_POINTER(address)  HalSimFlashPointer(address)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STM32U5xx_HAL_H */
@@ -0,0 +1,107 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * Host stand-in for the TIM6 time base. The ThreadX Linux port ticks the
+ * kernel from its own timer thread, so there is no tick interrupt to
+ * share: HAL_GetTick() and the microsecond clock read CLOCK_MONOTONIC.
+ */
+#include <time.h>
+#include <unistd.h>
+
+#include "stm32u5xx_hal.h"
+#include "timebase.h"
+
+#if defined(APP_RUN_BENCHMARKS)
+#include "cmsis_os2.h"
+#endif
+
+volatile uint32_t uwTick;
+HAL_TickFreqTypeDef uwTickFreq = HAL_TICK_FREQ_1KHZ;
+
+static struct timespec timebase_start;
+
+
+static uint64_t TimebaseSinceStart(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - timebase_start.tv_sec) * 1000000U
+         + (uint64_t)((now.tv_nsec - timebase_start.tv_nsec) / 1000);
+}
+
+
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority) {
+    (void)TickPriority;
+
+    if (timebase_start.tv_sec == 0 && timebase_start.tv_nsec == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &timebase_start);
+    }
+    return HAL_OK;
+}
+
+
+void HAL_IncTick(void) {
+}
+
+
+uint32_t HAL_GetTick(void) {
+    uwTick = (uint32_t)(TimebaseSinceStart() / 1000U);
+    return uwTick;
+}
+
+
+void HAL_Delay(uint32_t Delay) {
+    usleep((useconds_t)Delay * 1000U);
+}
+
+
+void HAL_SuspendTick(void) {
+}
+
+
+void HAL_ResumeTick(void) {
+}
+
+
+/**
+    @brief  Microseconds since HAL_Init(), as on the device.
+ */
+uint64_t TimebaseGetMicros(void) {
+    return TimebaseSinceStart();
+}
+
+
+/**
+    @brief  Nothing to credit: the host clock never stops.
+ */
+void TimebaseCreditTicks(uint32_t ticks) {
+    (void)ticks;
+}
+
+
+/**
+    @brief  Nothing to start: the Linux port runs the ThreadX tick.
+ */
+void TimebaseStartRtosTick(void) {
+}
+
+
+#if defined(APP_RUN_BENCHMARKS)
+/*
+ * The benchmarks time with the CMSIS-RTOS2 system timer; as on the device
+ * it counts microseconds rather than whole ticks.
+ */
+uint32_t osKernelGetSysTimerCount(void) {
+    return (uint32_t)TimebaseSinceStart();
+}
+
+
+uint32_t osKernelGetSysTimerFreq(void) {
+    return 1000000U;
+}
+#endif
@@ -0,0 +1,776 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    cmsis_os2_ext.c
+ *      Purpose: CMSIS RTOS2 wrapper extensions for FreeRTOS
+ *
+ *---------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "cmsis_os2_ext.h"              // CMSIS RTOS2 extensions
+#include "cmsis_compiler.h"             // Compiler agnostic definitions
+
+#include "FreeRTOS.h"                   // ARM.FreeRTOS::RTOS:Core
+#include "task.h"                       // ARM.FreeRTOS::RTOS:Core
+#include "queue.h"                      // ARM.FreeRTOS::RTOS:Core
+#include "freertos_mpool.h"             // osMemoryPool definitions
+#include "freertos_refq.h"              // osRefQueue definitions
+#include "freertos_fflags.h"            // osFastFlags definitions
+#include "freertos_os2.h"               // Configuration check and setup
+
+/*---------------------------------------------------------------------------*/
+#define IS_IRQ()                  (__get_IPSR() != 0U)
+
+/* Reference Queue block owner markers */
+#define REFQ_OWNER_FREE           ((void *)0U)
+#define REFQ_OWNER_QUEUE          ((void *)1U)
+#define REFQ_OWNER_ISR            ((void *)2U)
+
+/* Reference Queue status flags */
+#define REFQ_STATUS_CB_HEAP       1U
+#define REFQ_STATUS_OW_HEAP       2U
+
+/* Limits */
+#define MAX_BITS_FAST_FLAGS       31U
+
+#define FAST_FLAGS_INVALID_BITS   (~((1UL << MAX_BITS_FAST_FLAGS) - 1U))
+
+/* Fast Flags status flags */
+#define FFLAGS_STATUS_CB_HEAP     1U
+
+/*---------------------------------------------------------------------------*/
+
+/* Reference queue helper functions */
+static int32_t BlockIndex (RefQueue_t *rq, void *block);
+#if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+static void   *OwnerId    (void);
+#endif
+
+osRefQueueId_t osRefQueueNew (uint32_t block_count, uint32_t block_size, const osRefQueueAttr_t *attr) {
+  RefQueue_t *rq;
+  osMemoryPoolAttr_t mp_attr;
+  osMemoryPoolId_t mp_id;
+  const char *name;
+  int32_t mem_cb, mem_mq, mem_ow;
+
+  rq = NULL;
+
+  if (!IS_IRQ() && (block_count > 0U) && (block_size > 0U)) {
+    memset (&mp_attr, 0, sizeof(mp_attr));
+
+    name   = NULL;
+    mem_cb = -1;
+    mem_mq = -1;
+    mem_ow = -1;
+
+    if (attr != NULL) {
+      name = attr->name;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(RefQueue_t))) {
+        /* Static control block is provided */
+        mem_cb = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        /* Allocate control block memory on heap */
+        mem_cb = 0;
+      }
+
+      if ((attr->mq_mem != NULL) && (attr->mq_size >= REFQUEUE_MQ_SIZE (block_count))) {
+        /* Static pointer queue storage is provided */
+        mem_mq = 1;
+      }
+      else if ((attr->mq_mem == NULL) && (attr->mq_size == 0U)) {
+        /* Allocate pointer queue storage on heap */
+        mem_mq = 0;
+      }
+
+      if ((attr->ow_mem != NULL) && (attr->ow_size >= REFQUEUE_OWNER_SIZE (block_count))) {
+        /* Static owner table is provided */
+        mem_ow = 1;
+      }
+      else if ((attr->ow_mem == NULL) && (attr->ow_size == 0U)) {
+        /* Allocate owner table on heap */
+        mem_ow = 0;
+      }
+
+      /* Block storage is handled by the memory pool */
+      mp_attr.mp_mem  = attr->mp_mem;
+      mp_attr.mp_size = attr->mp_size;
+    }
+    else {
+      /* Attributes not provided, allocate memory on heap */
+      mem_cb = 0;
+      mem_mq = 0;
+      mem_ow = 0;
+    }
+
+    if ((mem_cb != -1) && (mem_mq != -1) && (mem_ow != -1)) {
+      if (mem_cb == 0) {
+        rq = pvPortMalloc (sizeof(RefQueue_t));
+      } else {
+        rq = attr->cb_mem;
+      }
+    }
+
+    if (rq != NULL) {
+      rq->hQueue = NULL;
+      rq->owner  = NULL;
+      rq->name   = name;
+      rq->status = 0U;
+
+      /* Create the block pool inside the reference queue control block */
+      mp_attr.name    = name;
+      mp_attr.cb_mem  = &rq->mp;
+      mp_attr.cb_size = sizeof(MemPool_t);
+
+      mp_id = osMemoryPoolNew (block_count, block_size, &mp_attr);
+
+      if (mp_id != NULL) {
+        /* Queue holds one slot per block, a put never waits for space */
+        if (mem_mq == 1) {
+          #if (configSUPPORT_STATIC_ALLOCATION == 1)
+            rq->hQueue = xQueueCreateStatic (block_count, sizeof(void *), attr->mq_mem, &rq->mem_mq);
+          #endif
+        }
+        else {
+          #if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
+            rq->hQueue = xQueueCreate (block_count, sizeof(void *));
+          #endif
+        }
+      }
+
+      #if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+      if (rq->hQueue != NULL) {
+        if (mem_ow == 0) {
+          rq->owner = pvPortMalloc (REFQUEUE_OWNER_SIZE (block_count));
+        } else {
+          rq->owner = attr->ow_mem;
+        }
+
+        if (rq->owner != NULL) {
+          memset ((void *)rq->owner, 0, REFQUEUE_OWNER_SIZE (block_count));
+        }
+      }
+      #endif
+
+      #if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+      if ((rq->hQueue != NULL) && (rq->owner != NULL)) {
+      #else
+      if (rq->hQueue != NULL) {
+      #endif
+        /* Reference queue can be created */
+        rq->status = REFQ_STATUS;
+
+        if (mem_cb == 0) {
+          /* Control block on heap */
+          rq->status |= REFQ_STATUS_CB_HEAP;
+        }
+        if ((rq->owner != NULL) && (mem_ow == 0)) {
+          /* Owner table on heap */
+          rq->status |= REFQ_STATUS_OW_HEAP;
+        }
+
+        #if (configQUEUE_REGISTRY_SIZE > 0)
+        vQueueAddToRegistry (rq->hQueue, name);
+        #endif
+      }
+      else {
+        /* Reference queue cannot be created, release allocated resources */
+        if (rq->hQueue != NULL) {
+          vQueueDelete (rq->hQueue);
+        }
+        if (mp_id != NULL) {
+          (void)osMemoryPoolDelete (mp_id);
+        }
+        if (mem_cb == 0) {
+          vPortFree (rq);
+        }
+        rq = NULL;
+      }
+    }
+  }
+
+  return ((osRefQueueId_t)rq);
+}
+
+const char *osRefQueueGetName (osRefQueueId_t rq_id) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  const char *p;
+
+  if (IS_IRQ() || (rq == NULL)) {
+    p = NULL;
+  } else {
+    p = rq->name;
+  }
+
+  return (p);
+}
+
+void *osRefQueueAlloc (osRefQueueId_t rq_id, uint32_t timeout) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  void *block;
+
+  block = NULL;
+
+  if ((rq != NULL) && ((rq->status & REFQ_STATUS) == REFQ_STATUS)) {
+    block = osMemoryPoolAlloc (&rq->mp, timeout);
+
+    #if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+    if (block != NULL) {
+      /* Caller owns the block until it is put or released */
+      rq->owner[BlockIndex (rq, block)] = OwnerId();
+    }
+    #endif
+  }
+
+  return (block);
+}
+
+osStatus_t osRefQueuePut (osRefQueueId_t rq_id, void *block) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  osStatus_t stat;
+  BaseType_t yield;
+  int32_t idx;
+
+  if ((rq == NULL) || (block == NULL)) {
+    /* Invalid input parameters */
+    stat = osErrorParameter;
+  }
+  else if ((rq->status & REFQ_STATUS) != REFQ_STATUS) {
+    /* Invalid object status */
+    stat = osErrorResource;
+  }
+  else if ((idx = BlockIndex (rq, block)) < 0) {
+    /* Block pointer does not address a block of this pool */
+    stat = osErrorParameter;
+  }
+  else {
+    stat = osOK;
+
+    #if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+    if (rq->owner[idx] != OwnerId()) {
+      /* Only the owner may hand the block over */
+      osRefQueueOwnerErrorHook (rq_id, block);
+      stat = osErrorParameter;
+    }
+    else {
+      /* Mark as queued before the receiver can see it */
+      rq->owner[idx] = REFQ_OWNER_QUEUE;
+    }
+    #else
+    (void)idx;
+    #endif
+
+    if (stat == osOK) {
+      if (IS_IRQ()) {
+        yield = pdFALSE;
+
+        if (xQueueSendToBackFromISR (rq->hQueue, &block, &yield) != pdTRUE) {
+          stat = osErrorResource;
+        } else {
+          portYIELD_FROM_ISR (yield);
+        }
+      }
+      else {
+        if (xQueueSendToBack (rq->hQueue, &block, 0U) != pdPASS) {
+          stat = osErrorResource;
+        }
+      }
+
+      #if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+      if (stat != osOK) {
+        /* Block was not queued, ownership stays with the caller */
+        rq->owner[idx] = OwnerId();
+      }
+      #endif
+    }
+  }
+
+  return (stat);
+}
+
+void *osRefQueueGet (osRefQueueId_t rq_id, uint32_t timeout) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  BaseType_t yield;
+  void *block;
+
+  block = NULL;
+
+  if ((rq != NULL) && ((rq->status & REFQ_STATUS) == REFQ_STATUS)) {
+    if (IS_IRQ()) {
+      if (timeout == 0U) {
+        yield = pdFALSE;
+
+        if (xQueueReceiveFromISR (rq->hQueue, &block, &yield) != pdPASS) {
+          block = NULL;
+        } else {
+          portYIELD_FROM_ISR (yield);
+        }
+      }
+    }
+    else {
+      if (xQueueReceive (rq->hQueue, &block, (TickType_t)timeout) != pdPASS) {
+        block = NULL;
+      }
+    }
+
+    #if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+    if (block != NULL) {
+      if (rq->owner[BlockIndex (rq, block)] != REFQ_OWNER_QUEUE) {
+        /* The owner table does not show the block as queued: it was put
+           twice, or its table entry was changed while it was queued */
+        osRefQueueOwnerErrorHook (rq_id, block);
+      }
+      rq->owner[BlockIndex (rq, block)] = OwnerId();
+    }
+    #endif
+  }
+
+  return (block);
+}
+
+osStatus_t osRefQueueRelease (osRefQueueId_t rq_id, void *block) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  osStatus_t stat;
+  int32_t idx;
+
+  if ((rq == NULL) || (block == NULL)) {
+    /* Invalid input parameters */
+    stat = osErrorParameter;
+  }
+  else if ((rq->status & REFQ_STATUS) != REFQ_STATUS) {
+    /* Invalid object status */
+    stat = osErrorResource;
+  }
+  else if ((idx = BlockIndex (rq, block)) < 0) {
+    /* Block pointer does not address a block of this pool */
+    stat = osErrorParameter;
+  }
+  else {
+    stat = osOK;
+
+    #if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+    if (rq->owner[idx] != OwnerId()) {
+      /* Only the owner may release the block (catches double free) */
+      osRefQueueOwnerErrorHook (rq_id, block);
+      stat = osErrorParameter;
+    }
+    else {
+      rq->owner[idx] = REFQ_OWNER_FREE;
+    }
+    #else
+    (void)idx;
+    #endif
+
+    if (stat == osOK) {
+      stat = osMemoryPoolFree (&rq->mp, block);
+
+      #if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+      if (stat != osOK) {
+        rq->owner[idx] = OwnerId();
+      }
+      #endif
+    }
+  }
+
+  return (stat);
+}
+
+uint32_t osRefQueueGetCapacity (osRefQueueId_t rq_id) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  uint32_t n;
+
+  if (rq == NULL) {
+    n = 0U;
+  } else {
+    n = osMemoryPoolGetCapacity (&rq->mp);
+  }
+
+  return (n);
+}
+
+uint32_t osRefQueueGetBlockSize (osRefQueueId_t rq_id) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  uint32_t sz;
+
+  if (rq == NULL) {
+    sz = 0U;
+  } else {
+    sz = osMemoryPoolGetBlockSize (&rq->mp);
+  }
+
+  return (sz);
+}
+
+uint32_t osRefQueueGetCount (osRefQueueId_t rq_id) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  UBaseType_t count;
+
+  if ((rq == NULL) || ((rq->status & REFQ_STATUS) != REFQ_STATUS)) {
+    count = 0U;
+  }
+  else if (IS_IRQ()) {
+    count = uxQueueMessagesWaitingFromISR (rq->hQueue);
+  }
+  else {
+    count = uxQueueMessagesWaiting (rq->hQueue);
+  }
+
+  return ((uint32_t)count);
+}
+
+uint32_t osRefQueueGetSpace (osRefQueueId_t rq_id) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  uint32_t n;
+
+  if (rq == NULL) {
+    n = 0U;
+  } else {
+    n = osMemoryPoolGetSpace (&rq->mp);
+  }
+
+  return (n);
+}
+
+osStatus_t osRefQueueDelete (osRefQueueId_t rq_id) {
+  RefQueue_t *rq = (RefQueue_t *)rq_id;
+  osStatus_t stat;
+
+#ifndef USE_FreeRTOS_HEAP_1
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if ((rq == NULL) || ((rq->status & REFQ_STATUS) != REFQ_STATUS)) {
+    stat = osErrorParameter;
+  }
+  else {
+    /* Invalidate control block status */
+    rq->status = rq->status & (REFQ_STATUS_CB_HEAP | REFQ_STATUS_OW_HEAP);
+
+    #if (configQUEUE_REGISTRY_SIZE > 0)
+    vQueueUnregisterQueue (rq->hQueue);
+    #endif
+    vQueueDelete (rq->hQueue);
+
+    /* Pool control block lives inside the reference queue control block */
+    (void)osMemoryPoolDelete (&rq->mp);
+
+    if ((rq->status & REFQ_STATUS_OW_HEAP) != 0U) {
+      vPortFree ((void *)rq->owner);
+    }
+    if ((rq->status & REFQ_STATUS_CB_HEAP) != 0U) {
+      vPortFree (rq);
+    }
+
+    stat = osOK;
+  }
+#else
+  stat = osError;
+#endif
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osFastFlagsId_t osFastFlagsNew (osThreadId_t thread_id, const osFastFlagsAttr_t *attr) {
+  FastFlags_t *ff;
+  const char *name;
+  int32_t mem;
+
+  ff = NULL;
+
+  if (!IS_IRQ()) {
+    mem  = -1;
+    name = NULL;
+
+    if (attr != NULL) {
+      name = attr->name;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(FastFlags_t))) {
+        mem = 1;
+      }
+      else {
+        if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+          mem = 0;
+        }
+      }
+    }
+    else {
+      mem = 0;
+    }
+
+    if (mem == 1) {
+      ff = attr->cb_mem;
+    }
+    else {
+      if (mem == 0) {
+        ff = pvPortMalloc (sizeof(FastFlags_t));
+      }
+    }
+
+    if (ff != NULL) {
+      if (thread_id == NULL) {
+        ff->hTask = xTaskGetCurrentTaskHandle();
+      } else {
+        ff->hTask = (TaskHandle_t)thread_id;
+      }
+      ff->name   = name;
+      ff->status = FFLAGS_STATUS;
+
+      if (mem == 0) {
+        /* Control block on heap */
+        ff->status |= FFLAGS_STATUS_CB_HEAP;
+      }
+
+      /* Start with all flags cleared */
+      (void)ulTaskNotifyValueClearIndexed (ff->hTask, configOS2_FFLAGS_NOTIFY_INDEX, 0xFFFFFFFFU);
+    }
+  }
+
+  return ((osFastFlagsId_t)ff);
+}
+
+const char *osFastFlagsGetName (osFastFlagsId_t ff_id) {
+  FastFlags_t *ff = (FastFlags_t *)ff_id;
+  const char *p;
+
+  if (IS_IRQ() || (ff == NULL)) {
+    p = NULL;
+  } else {
+    p = ff->name;
+  }
+
+  return (p);
+}
+
+uint32_t osFastFlagsSet (osFastFlagsId_t ff_id, uint32_t flags) {
+  FastFlags_t *ff = (FastFlags_t *)ff_id;
+  uint32_t rflags;
+  BaseType_t yield;
+
+  if ((ff == NULL) || ((flags & FAST_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS) {
+    rflags = (uint32_t)osErrorResource;
+  }
+  else if (IS_IRQ()) {
+    yield = pdFALSE;
+
+    /* Waiting task is readied here, within the ISR */
+    (void)xTaskNotifyAndQueryIndexedFromISR (ff->hTask, configOS2_FFLAGS_NOTIFY_INDEX, flags, eSetBits, &rflags, &yield);
+    rflags |= flags;
+
+    portYIELD_FROM_ISR (yield);
+  }
+  else {
+    (void)xTaskNotifyAndQueryIndexed (ff->hTask, configOS2_FFLAGS_NOTIFY_INDEX, flags, eSetBits, &rflags);
+    rflags |= flags;
+  }
+
+  /* Return flags after setting */
+  return (rflags);
+}
+
+uint32_t osFastFlagsClear (osFastFlagsId_t ff_id, uint32_t flags) {
+  FastFlags_t *ff = (FastFlags_t *)ff_id;
+  uint32_t rflags;
+
+  if ((ff == NULL) || ((flags & FAST_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if (IS_IRQ()) {
+    rflags = (uint32_t)osErrorISR;
+  }
+  else if ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS) {
+    rflags = (uint32_t)osErrorResource;
+  }
+  else {
+    rflags = ulTaskNotifyValueClearIndexed (ff->hTask, configOS2_FFLAGS_NOTIFY_INDEX, flags);
+  }
+
+  /* Return flags before clearing */
+  return (rflags);
+}
+
+uint32_t osFastFlagsGet (osFastFlagsId_t ff_id) {
+  FastFlags_t *ff = (FastFlags_t *)ff_id;
+  uint32_t rflags;
+
+  if ((ff == NULL) || ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS)) {
+    rflags = 0U;
+  }
+  else if (IS_IRQ()) {
+    (void)xTaskNotifyAndQueryIndexedFromISR (ff->hTask, configOS2_FFLAGS_NOTIFY_INDEX, 0U, eNoAction, &rflags, NULL);
+  }
+  else {
+    rflags = ulTaskNotifyValueClearIndexed (ff->hTask, configOS2_FFLAGS_NOTIFY_INDEX, 0U);
+  }
+
+  return (rflags);
+}
+
+uint32_t osFastFlagsWait (osFastFlagsId_t ff_id, uint32_t flags, uint32_t options, uint32_t timeout) {
+  FastFlags_t *ff = (FastFlags_t *)ff_id;
+  uint32_t rflags, nval, match;
+  TickType_t t0, td, tout;
+
+  if ((ff == NULL) || ((flags & FAST_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if (IS_IRQ()) {
+    rflags = (uint32_t)osErrorISR;
+  }
+  else if ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS) {
+    rflags = (uint32_t)osErrorResource;
+  }
+  else if (ff->hTask != xTaskGetCurrentTaskHandle()) {
+    /* Flags live in the bound thread's notification value */
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else {
+    tout = timeout;
+    t0   = xTaskGetTickCount();
+
+    for (;;) {
+      /* Read the flags without consuming them */
+      nval  = ulTaskNotifyValueClearIndexed (NULL, configOS2_FFLAGS_NOTIFY_INDEX, 0U);
+      match = nval & flags;
+
+      if ((options & osFlagsWaitAll) == osFlagsWaitAll) {
+        if (match != flags) {
+          match = 0U;
+        }
+      }
+
+      if (match != 0U) {
+        rflags = nval;
+
+        if ((options & osFlagsNoClear) != osFlagsNoClear) {
+          (void)ulTaskNotifyValueClearIndexed (NULL, configOS2_FFLAGS_NOTIFY_INDEX, match);
+        }
+        break;
+      }
+
+      if (tout == 0U) {
+        if (timeout == 0U) {
+          rflags = (uint32_t)osErrorResource;
+        } else {
+          rflags = (uint32_t)osErrorTimeout;
+        }
+        break;
+      }
+
+      /* Block until any flag is set; value is neither cleared on entry nor exit */
+      if (xTaskNotifyWaitIndexed (configOS2_FFLAGS_NOTIFY_INDEX, 0U, 0U, NULL, tout) != pdPASS) {
+        /* Timed out, check the flags one last time */
+        tout = 0U;
+      }
+      else if (timeout != osWaitForever) {
+        /* Update timeout */
+        td = xTaskGetTickCount() - t0;
+
+        if (td > timeout) {
+          tout = 0U;
+        } else {
+          tout = timeout - td;
+        }
+      }
+    }
+  }
+
+  /* Return flags before clearing */
+  return (rflags);
+}
+
+osStatus_t osFastFlagsDelete (osFastFlagsId_t ff_id) {
+  FastFlags_t *ff = (FastFlags_t *)ff_id;
+  osStatus_t stat;
+
+#ifndef USE_FreeRTOS_HEAP_1
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if ((ff == NULL) || ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS)) {
+    stat = osErrorParameter;
+  }
+  else {
+    /* Invalidate control block status */
+    ff->status = ff->status & FFLAGS_STATUS_CB_HEAP;
+
+    if ((ff->status & FFLAGS_STATUS_CB_HEAP) != 0U) {
+      vPortFree (ff);
+    }
+
+    stat = osOK;
+  }
+#else
+  stat = osError;
+#endif
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+  Get index of a block in the pool memory array, -1 if the pointer does not
+  address the start of a block.
+*/
+static int32_t BlockIndex (RefQueue_t *rq, void *block) {
+  uint32_t ofs;
+  int32_t idx = -1;
+
+  if ((uint8_t *)block >= rq->mp.mem_arr) {
+    ofs = (uint32_t)((uint8_t *)block - rq->mp.mem_arr);
+
+    /* Blocks are laid out at bl_sz stride, see CreateBlock */
+    if (((ofs % rq->mp.bl_sz) == 0U) && ((ofs / rq->mp.bl_sz) < rq->mp.bl_cnt)) {
+      idx = (int32_t)(ofs / rq->mp.bl_sz);
+    }
+  }
+
+  return (idx);
+}
+
+#if (configUSE_OS2_REFQUEUE_OWNER_CHECK == 1)
+/*
+  Identify the caller as block owner: the running task or any ISR.
+*/
+static void *OwnerId (void) {
+  void *id;
+
+  if (IS_IRQ()) {
+    id = REFQ_OWNER_ISR;
+  } else {
+    id = (void *)xTaskGetCurrentTaskHandle();
+  }
+
+  return (id);
+}
+#endif
+
+/**
+  Dummy implementation of the callback function osRefQueueOwnerErrorHook().
+*/
+__WEAK void osRefQueueOwnerErrorHook (osRefQueueId_t rq_id, void *block) {
+  (void)rq_id;
+  (void)block;
+  configASSERT(0);
+}
@@ -0,0 +1,197 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    cmsis_os2_ext.h
+ *      Purpose: CMSIS RTOS2 wrapper extensions
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef CMSIS_OS2_EXT_H_
+#define CMSIS_OS2_EXT_H_
+
+#include "cmsis_os2.h"
+
+#ifdef  __cplusplus
+extern "C"
+{
+#endif
+
+
+//  ==== Enumerations, structures, defines ====
+
+/// \details Reference Queue ID identifies the reference queue.
+typedef void *osRefQueueId_t;
+
+/// Attributes structure for reference queue.
+typedef struct {
+  const char                   *name;   ///< name of the reference queue
+  uint32_t                 attr_bits;   ///< attribute bits
+  void                      *cb_mem;    ///< memory for control block
+  uint32_t                   cb_size;   ///< size of provided memory for control block
+  void                      *mp_mem;    ///< memory for block storage
+  uint32_t                   mp_size;   ///< size of provided memory for block storage
+  void                      *mq_mem;    ///< memory for block pointer queue
+  uint32_t                   mq_size;   ///< size of provided memory for block pointer queue
+  void                      *ow_mem;    ///< memory for block owner table (ownership check only)
+  uint32_t                   ow_size;   ///< size of provided memory for block owner table
+} osRefQueueAttr_t;
+
+/// \details Fast Flags ID identifies the fast flags.
+typedef void *osFastFlagsId_t;
+
+/// Attributes structure for fast flags.
+typedef struct {
+  const char                   *name;   ///< name of the fast flags
+  uint32_t                 attr_bits;   ///< attribute bits
+  void                      *cb_mem;    ///< memory for control block
+  uint32_t                   cb_size;   ///< size of provided memory for control block
+} osFastFlagsAttr_t;
+
+
+//  ==== Reference Queue Management Functions ====
+//
+//  A Reference Queue pairs a Memory Pool with a queue of block pointers so
+//  that large messages move between threads without being copied. A sender
+//  allocates a block, fills it in place and puts it; ownership of the block
+//  moves to the queue and then to the receiver, which releases the block
+//  back to the pool when done. The queue holds one slot per block, so a put
+//  never has to wait for space.
+
+/// Create and Initialize a Reference Queue object.
+/// \param[in]     block_count   maximum number of blocks in flight.
+/// \param[in]     block_size    memory block size in bytes.
+/// \param[in]     attr          reference queue attributes; NULL: default values.
+/// \return reference queue ID for reference by other functions or NULL in case of error.
+osRefQueueId_t osRefQueueNew (uint32_t block_count, uint32_t block_size, const osRefQueueAttr_t *attr);
+
+/// Get name of a Reference Queue object.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \return name as NULL terminated string.
+const char *osRefQueueGetName (osRefQueueId_t rq_id);
+
+/// Allocate a block to be filled in and put into a Reference Queue.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \param[in]     timeout       \ref CMSIS_RTOS_TimeOutValue or 0 in case of no time-out.
+/// \return address of the allocated block or NULL in case of no memory is available.
+void *osRefQueueAlloc (osRefQueueId_t rq_id, uint32_t timeout);
+
+/// Put an owned block into a Reference Queue, passing its ownership to the receiver.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \param[in]     block         address of a block obtained by \ref osRefQueueAlloc or \ref osRefQueueGet.
+/// \return status code that indicates the execution status of the function.
+osStatus_t osRefQueuePut (osRefQueueId_t rq_id, void *block);
+
+/// Get a block from a Reference Queue or timeout if the Queue is empty.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \param[in]     timeout       \ref CMSIS_RTOS_TimeOutValue or 0 in case of no time-out.
+/// \return address of the received block or NULL in case of error or time-out.
+void *osRefQueueGet (osRefQueueId_t rq_id, uint32_t timeout);
+
+/// Return an owned block back to the Memory Pool of a Reference Queue.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \param[in]     block         address of a block obtained by \ref osRefQueueAlloc or \ref osRefQueueGet.
+/// \return status code that indicates the execution status of the function.
+osStatus_t osRefQueueRelease (osRefQueueId_t rq_id, void *block);
+
+/// Get maximum number of blocks in a Reference Queue.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \return maximum number of blocks.
+uint32_t osRefQueueGetCapacity (osRefQueueId_t rq_id);
+
+/// Get memory block size in a Reference Queue.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \return memory block size in bytes.
+uint32_t osRefQueueGetBlockSize (osRefQueueId_t rq_id);
+
+/// Get number of blocks waiting in a Reference Queue.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \return number of queued blocks.
+uint32_t osRefQueueGetCount (osRefQueueId_t rq_id);
+
+/// Get number of blocks available for allocation in a Reference Queue.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \return number of free blocks.
+uint32_t osRefQueueGetSpace (osRefQueueId_t rq_id);
+
+/// Delete a Reference Queue object.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \return status code that indicates the execution status of the function.
+osStatus_t osRefQueueDelete (osRefQueueId_t rq_id);
+
+/// Called when a block is put or released by a thread that does not own it, or
+/// got while the owner table does not show it as queued.
+/// Only invoked when configUSE_OS2_REFQUEUE_OWNER_CHECK is enabled.
+/// \param[in]     rq_id         reference queue ID obtained by \ref osRefQueueNew.
+/// \param[in]     block         address of the offending block.
+void osRefQueueOwnerErrorHook (osRefQueueId_t rq_id, void *block);
+
+
+//  ==== Fast Flags Management Functions ====
+//
+//  Fast Flags are event flags bound to a single waiting thread and stored in
+//  that thread's task notification value. Setting them from an ISR wakes the
+//  thread directly from the ISR; unlike osEventFlagsSet no work is deferred to
+//  the timer service task. The ThreadX wrapper backs them with a private event
+//  flags group, which ThreadX already sets directly from an ISR.
+
+/// Create and Initialize a Fast Flags object bound to a waiting thread.
+/// \param[in]     thread_id     thread ID of the only thread allowed to wait; NULL: current thread.
+/// \param[in]     attr          fast flags attributes; NULL: default values.
+/// \return fast flags ID for reference by other functions or NULL in case of error.
+osFastFlagsId_t osFastFlagsNew (osThreadId_t thread_id, const osFastFlagsAttr_t *attr);
+
+/// Get name of a Fast Flags object.
+/// \param[in]     ff_id         fast flags ID obtained by \ref osFastFlagsNew.
+/// \return name as NULL terminated string.
+const char *osFastFlagsGetName (osFastFlagsId_t ff_id);
+
+/// Set the specified Fast Flags.
+/// \param[in]     ff_id         fast flags ID obtained by \ref osFastFlagsNew.
+/// \param[in]     flags         specifies the flags that shall be set.
+/// \return fast flags after setting or error code if highest bit set.
+uint32_t osFastFlagsSet (osFastFlagsId_t ff_id, uint32_t flags);
+
+/// Clear the specified Fast Flags.
+/// \param[in]     ff_id         fast flags ID obtained by \ref osFastFlagsNew.
+/// \param[in]     flags         specifies the flags that shall be cleared.
+/// \return fast flags before clearing or error code if highest bit set.
+uint32_t osFastFlagsClear (osFastFlagsId_t ff_id, uint32_t flags);
+
+/// Get the current Fast Flags.
+/// \param[in]     ff_id         fast flags ID obtained by \ref osFastFlagsNew.
+/// \return current fast flags.
+uint32_t osFastFlagsGet (osFastFlagsId_t ff_id);
+
+/// Wait for one or more Fast Flags to become signaled, from the bound thread only.
+/// \param[in]     ff_id         fast flags ID obtained by \ref osFastFlagsNew.
+/// \param[in]     flags         specifies the flags to wait for.
+/// \param[in]     options       specifies flags options (osFlagsXxxx).
+/// \param[in]     timeout       \ref CMSIS_RTOS_TimeOutValue or 0 in case of no time-out.
+/// \return fast flags before clearing or error code if highest bit set.
+uint32_t osFastFlagsWait (osFastFlagsId_t ff_id, uint32_t flags, uint32_t options, uint32_t timeout);
+
+/// Delete a Fast Flags object.
+/// \param[in]     ff_id         fast flags ID obtained by \ref osFastFlagsNew.
+/// \return status code that indicates the execution status of the function.
+osStatus_t osFastFlagsDelete (osFastFlagsId_t ff_id);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif  // CMSIS_OS2_EXT_H_
@@ -0,0 +1,59 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    freertos_fflags.h
+ *      Purpose: CMSIS RTOS2 wrapper for FreeRTOS - Fast Flags extension
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef FREERTOS_FFLAGS_H_
+#define FREERTOS_FFLAGS_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Fast Flags implementation definitions */
+#define FFLAGS_STATUS             0x5EF00000U
+
+/*
+  Task notification slot used to hold fast flags. With more than one slot the
+  last one is reserved for fast flags, otherwise the slot is shared with the
+  Thread Flags API and the two must not be used on the same thread.
+*/
+#ifndef configOS2_FFLAGS_NOTIFY_INDEX
+#if defined(configTASK_NOTIFICATION_ARRAY_ENTRIES) && (configTASK_NOTIFICATION_ARRAY_ENTRIES > 1)
+#define configOS2_FFLAGS_NOTIFY_INDEX   (configTASK_NOTIFICATION_ARRAY_ENTRIES - 1)
+#else
+#define configOS2_FFLAGS_NOTIFY_INDEX   0
+#endif
+#endif
+
+/* Fast Flags control block */
+typedef struct FastFlagsDef_t {
+  TaskHandle_t        hTask;    /* Waiting (owner) task handle */
+  const char         *name;     /* Pointer to name string      */
+  volatile uint32_t   status;   /* Object status flags         */
+} FastFlags_t;
+
+/* No need to hide static object type, just align to coding style */
+#define StaticFastFlags_t       FastFlags_t
+
+/* Define fast flags control block size */
+#define FASTFLAGS_CB_SIZE       (sizeof(StaticFastFlags_t))
+
+#endif /* FREERTOS_FFLAGS_H_ */
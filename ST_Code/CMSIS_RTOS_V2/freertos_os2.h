@@ -84,6 +84,20 @@
 #define configUSE_OS2_MUTEX                   configUSE_MUTEXES
 #endif
 
+/*
+  Option to enable block ownership tracking in the Reference Queue extension
+  (osRefQueue* functions). Each block records the thread (or ISR) that owns it
+  and puts, gets and releases by a non-owner are rejected. Enabled by default
+  in DEBUG builds.
+*/
+#ifndef configUSE_OS2_REFQUEUE_OWNER_CHECK
+#if defined(DEBUG)
+#define configUSE_OS2_REFQUEUE_OWNER_CHECK    1
+#else
+#define configUSE_OS2_REFQUEUE_OWNER_CHECK    0
+#endif
+#endif
+
 
 /*
   CMSIS-RTOS2 FreeRTOS configuration check (FreeRTOSConfig.h).
@@ -0,0 +1,58 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    freertos_refq.h
+ *      Purpose: CMSIS RTOS2 wrapper for FreeRTOS - Reference Queue extension
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef FREERTOS_REFQ_H_
+#define FREERTOS_REFQ_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "freertos_mpool.h"
+
+/* Reference Queue implementation definitions */
+#define REFQ_STATUS               0x5EEF0000U
+
+/* Reference Queue control block */
+typedef struct RefQueueDef_t {
+  MemPool_t           mp;       /* Block pool control block    */
+  QueueHandle_t       hQueue;   /* Block pointer queue handle  */
+  const char         *name;     /* Pointer to name string      */
+  void * volatile    *owner;    /* Block owner table           */
+  volatile uint32_t   status;   /* Object status flags         */
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  StaticQueue_t       mem_mq;   /* Queue object memory         */
+#endif
+} RefQueue_t;
+
+/* No need to hide static object type, just align to coding style */
+#define StaticRefQueue_t        RefQueue_t
+
+/* Define reference queue control block size */
+#define REFQUEUE_CB_SIZE        (sizeof(StaticRefQueue_t))
+
+/* Define size of the pointer array required to queue count of blocks */
+#define REFQUEUE_MQ_SIZE(bl_count)          ((bl_count) * sizeof(void *))
+
+/* Define size of the owner table required to track count of blocks */
+#define REFQUEUE_OWNER_SIZE(bl_count)       ((bl_count) * sizeof(void *))
+
+#endif /* FREERTOS_REFQ_H_ */
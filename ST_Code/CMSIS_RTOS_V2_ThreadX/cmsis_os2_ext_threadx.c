@@ -0,0 +1,697 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    cmsis_os2_ext_threadx.c
+ *      Purpose: CMSIS RTOS2 wrapper extensions for ThreadX
+ *
+ *---------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "cmsis_os2_ext.h"              // CMSIS RTOS2 extensions
+#include "cmsis_compiler.h"             // Compiler agnostic definitions
+
+#include "tx_api.h"                     // ThreadX API
+#include "threadx_os2.h"                // Configuration and control blocks
+
+/*---------------------------------------------------------------------------*/
+#define IS_IRQ()                  (__get_IPSR() != 0U)
+
+/* Object status magic, same values as the FreeRTOS wrapper */
+#define REFQ_STATUS               0x5EEF0000U
+#define FFLAGS_STATUS             0x5EF00000U
+
+/* Reference Queue block owner markers */
+#define REFQ_OWNER_FREE           ((void *)0U)
+#define REFQ_OWNER_QUEUE          ((void *)1U)
+#define REFQ_OWNER_ISR            ((void *)2U)
+
+/* Reference Queue status flags */
+#define REFQ_STATUS_CB_HEAP       1U
+#define REFQ_STATUS_OW_HEAP       2U
+
+/* Limits */
+#define MAX_BITS_FAST_FLAGS       31U
+
+#define FAST_FLAGS_INVALID_BITS   (~((1UL << MAX_BITS_FAST_FLAGS) - 1U))
+
+/* Fast Flags status flags */
+#define FFLAGS_STATUS_CB_HEAP     1U
+
+/*---------------------------------------------------------------------------*/
+
+/* Reference queue helper functions */
+static int32_t BlockIndex (TxRefQueue_t *rq, void *block);
+#if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+static void   *OwnerId    (void);
+#endif
+
+osRefQueueId_t osRefQueueNew (uint32_t block_count, uint32_t block_size, const osRefQueueAttr_t *attr) {
+  TxRefQueue_t *rq;
+  osMemoryPoolAttr_t mp_attr;
+  osMessageQueueAttr_t mq_attr;
+  osMemoryPoolId_t mp_id;
+  osMessageQueueId_t mq_id;
+  const char *name;
+  int32_t mem_cb, mem_ow;
+
+  rq = NULL;
+
+  if (!IS_IRQ() && (block_count > 0U) && (block_size > 0U)) {
+    memset (&mp_attr, 0, sizeof(mp_attr));
+    memset (&mq_attr, 0, sizeof(mq_attr));
+
+    name   = NULL;
+    mem_cb = -1;
+    mem_ow = -1;
+
+    if (attr != NULL) {
+      name = attr->name;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(TxRefQueue_t))) {
+        /* Static control block is provided */
+        mem_cb = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        /* Allocate control block memory on heap */
+        mem_cb = 0;
+      }
+
+      if ((attr->ow_mem != NULL) && (attr->ow_size >= TX_OS2_REFQUEUE_OWNER_SIZE (block_count))) {
+        /* Static owner table is provided */
+        mem_ow = 1;
+      }
+      else if ((attr->ow_mem == NULL) && (attr->ow_size == 0U)) {
+        /* Allocate owner table on heap */
+        mem_ow = 0;
+      }
+
+      /* Block and pointer storage is handled by the pool and the queue */
+      mp_attr.mp_mem  = attr->mp_mem;
+      mp_attr.mp_size = attr->mp_size;
+      mq_attr.mq_mem  = attr->mq_mem;
+      mq_attr.mq_size = attr->mq_size;
+    }
+    else {
+      /* Attributes not provided, allocate memory on heap */
+      mem_cb = 0;
+      mem_ow = 0;
+    }
+
+    if ((mem_cb != -1) && (mem_ow != -1)) {
+      if (mem_cb == 0) {
+        rq = TxOs2MemAlloc (sizeof(TxRefQueue_t));
+      } else {
+        rq = attr->cb_mem;
+      }
+    }
+
+    if (rq != NULL) {
+      rq->owner  = NULL;
+      rq->name   = name;
+      rq->status = 0U;
+
+      /* Create the block pool and pointer queue inside the control block */
+      mp_attr.name    = name;
+      mp_attr.cb_mem  = &rq->mp;
+      mp_attr.cb_size = sizeof(TxMemPool_t);
+
+      mq_attr.name    = name;
+      mq_attr.cb_mem  = &rq->mq;
+      mq_attr.cb_size = sizeof(TxMsgQueue_t);
+
+      mq_id = NULL;
+      mp_id = osMemoryPoolNew (block_count, block_size, &mp_attr);
+
+      if (mp_id != NULL) {
+        /* Queue holds one slot per block, a put never waits for space */
+        mq_id = osMessageQueueNew (block_count, sizeof(void *), &mq_attr);
+      }
+
+      #if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+      if (mq_id != NULL) {
+        if (mem_ow == 0) {
+          rq->owner = TxOs2MemAlloc (TX_OS2_REFQUEUE_OWNER_SIZE (block_count));
+        } else {
+          rq->owner = attr->ow_mem;
+        }
+
+        if (rq->owner != NULL) {
+          memset ((void *)rq->owner, 0, TX_OS2_REFQUEUE_OWNER_SIZE (block_count));
+        }
+      }
+      #endif
+
+      #if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+      if ((mq_id != NULL) && (rq->owner != NULL)) {
+      #else
+      if (mq_id != NULL) {
+      #endif
+        /* Reference queue can be created */
+        rq->status = REFQ_STATUS;
+
+        if (mem_cb == 0) {
+          /* Control block on heap */
+          rq->status |= REFQ_STATUS_CB_HEAP;
+        }
+        if ((rq->owner != NULL) && (mem_ow == 0)) {
+          /* Owner table on heap */
+          rq->status |= REFQ_STATUS_OW_HEAP;
+        }
+      }
+      else {
+        /* Reference queue cannot be created, release allocated resources */
+        if (mq_id != NULL) {
+          (void)osMessageQueueDelete (mq_id);
+        }
+        if (mp_id != NULL) {
+          (void)osMemoryPoolDelete (mp_id);
+        }
+        if (mem_cb == 0) {
+          TxOs2MemFree (rq);
+        }
+        rq = NULL;
+      }
+    }
+  }
+
+  return ((osRefQueueId_t)rq);
+}
+
+const char *osRefQueueGetName (osRefQueueId_t rq_id) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  const char *p;
+
+  if (IS_IRQ() || (rq == NULL)) {
+    p = NULL;
+  } else {
+    p = rq->name;
+  }
+
+  return (p);
+}
+
+void *osRefQueueAlloc (osRefQueueId_t rq_id, uint32_t timeout) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  void *block;
+
+  block = NULL;
+
+  if ((rq != NULL) && ((rq->status & REFQ_STATUS) == REFQ_STATUS)) {
+    block = osMemoryPoolAlloc (&rq->mp, timeout);
+
+    #if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+    if (block != NULL) {
+      /* Caller owns the block until it is put or released */
+      rq->owner[BlockIndex (rq, block)] = OwnerId();
+    }
+    #endif
+  }
+
+  return (block);
+}
+
+osStatus_t osRefQueuePut (osRefQueueId_t rq_id, void *block) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  osStatus_t stat;
+  int32_t idx;
+
+  if ((rq == NULL) || (block == NULL)) {
+    /* Invalid input parameters */
+    stat = osErrorParameter;
+  }
+  else if ((rq->status & REFQ_STATUS) != REFQ_STATUS) {
+    /* Invalid object status */
+    stat = osErrorResource;
+  }
+  else if ((idx = BlockIndex (rq, block)) < 0) {
+    /* Block pointer does not address a block of this pool */
+    stat = osErrorParameter;
+  }
+  else {
+    stat = osOK;
+
+    #if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+    if (rq->owner[idx] != OwnerId()) {
+      /* Only the owner may hand the block over */
+      osRefQueueOwnerErrorHook (rq_id, block);
+      stat = osErrorParameter;
+    }
+    else {
+      /* Mark as queued before the receiver can see it */
+      rq->owner[idx] = REFQ_OWNER_QUEUE;
+    }
+    #else
+    (void)idx;
+    #endif
+
+    if (stat == osOK) {
+      /* Pointer is one queue word, ThreadX copies it without bouncing */
+      stat = osMessageQueuePut (&rq->mq, &block, 0U, 0U);
+
+      #if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+      if (stat != osOK) {
+        /* Block was not queued, ownership stays with the caller */
+        rq->owner[idx] = OwnerId();
+      }
+      #endif
+    }
+  }
+
+  return (stat);
+}
+
+void *osRefQueueGet (osRefQueueId_t rq_id, uint32_t timeout) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  void *block;
+
+  block = NULL;
+
+  if ((rq != NULL) && ((rq->status & REFQ_STATUS) == REFQ_STATUS)) {
+    if (osMessageQueueGet (&rq->mq, &block, NULL, timeout) != osOK) {
+      block = NULL;
+    }
+
+    #if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+    if (block != NULL) {
+      if (rq->owner[BlockIndex (rq, block)] != REFQ_OWNER_QUEUE) {
+        /* The owner table does not show the block as queued: it was put
+           twice, or its table entry was changed while it was queued */
+        osRefQueueOwnerErrorHook (rq_id, block);
+      }
+      rq->owner[BlockIndex (rq, block)] = OwnerId();
+    }
+    #endif
+  }
+
+  return (block);
+}
+
+osStatus_t osRefQueueRelease (osRefQueueId_t rq_id, void *block) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  osStatus_t stat;
+  int32_t idx;
+
+  if ((rq == NULL) || (block == NULL)) {
+    /* Invalid input parameters */
+    stat = osErrorParameter;
+  }
+  else if ((rq->status & REFQ_STATUS) != REFQ_STATUS) {
+    /* Invalid object status */
+    stat = osErrorResource;
+  }
+  else if ((idx = BlockIndex (rq, block)) < 0) {
+    /* Block pointer does not address a block of this pool */
+    stat = osErrorParameter;
+  }
+  else {
+    stat = osOK;
+
+    #if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+    if (rq->owner[idx] != OwnerId()) {
+      /* Only the owner may release the block (catches double free) */
+      osRefQueueOwnerErrorHook (rq_id, block);
+      stat = osErrorParameter;
+    }
+    else {
+      rq->owner[idx] = REFQ_OWNER_FREE;
+    }
+    #else
+    (void)idx;
+    #endif
+
+    if (stat == osOK) {
+      stat = osMemoryPoolFree (&rq->mp, block);
+
+      #if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+      if (stat != osOK) {
+        rq->owner[idx] = OwnerId();
+      }
+      #endif
+    }
+  }
+
+  return (stat);
+}
+
+uint32_t osRefQueueGetCapacity (osRefQueueId_t rq_id) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  uint32_t n;
+
+  if (rq == NULL) {
+    n = 0U;
+  } else {
+    n = osMemoryPoolGetCapacity (&rq->mp);
+  }
+
+  return (n);
+}
+
+uint32_t osRefQueueGetBlockSize (osRefQueueId_t rq_id) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  uint32_t sz;
+
+  if (rq == NULL) {
+    sz = 0U;
+  } else {
+    sz = osMemoryPoolGetBlockSize (&rq->mp);
+  }
+
+  return (sz);
+}
+
+uint32_t osRefQueueGetCount (osRefQueueId_t rq_id) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  uint32_t count;
+
+  if ((rq == NULL) || ((rq->status & REFQ_STATUS) != REFQ_STATUS)) {
+    count = 0U;
+  } else {
+    count = osMessageQueueGetCount (&rq->mq);
+  }
+
+  return (count);
+}
+
+uint32_t osRefQueueGetSpace (osRefQueueId_t rq_id) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  uint32_t n;
+
+  if (rq == NULL) {
+    n = 0U;
+  } else {
+    n = osMemoryPoolGetSpace (&rq->mp);
+  }
+
+  return (n);
+}
+
+osStatus_t osRefQueueDelete (osRefQueueId_t rq_id) {
+  TxRefQueue_t *rq = (TxRefQueue_t *)rq_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if ((rq == NULL) || ((rq->status & REFQ_STATUS) != REFQ_STATUS)) {
+    stat = osErrorParameter;
+  }
+  else {
+    /* Invalidate control block status */
+    rq->status = rq->status & (REFQ_STATUS_CB_HEAP | REFQ_STATUS_OW_HEAP);
+
+    /* Pool and queue control blocks live inside the reference queue control block */
+    (void)osMessageQueueDelete (&rq->mq);
+    (void)osMemoryPoolDelete (&rq->mp);
+
+    if ((rq->status & REFQ_STATUS_OW_HEAP) != 0U) {
+      TxOs2MemFree ((void *)rq->owner);
+    }
+    if ((rq->status & REFQ_STATUS_CB_HEAP) != 0U) {
+      TxOs2MemFree (rq);
+    }
+
+    stat = osOK;
+  }
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osFastFlagsId_t osFastFlagsNew (osThreadId_t thread_id, const osFastFlagsAttr_t *attr) {
+  TxFastFlags_t *ff;
+  const char *name;
+  int32_t mem;
+
+  ff = NULL;
+
+  if (!IS_IRQ()) {
+    mem  = -1;
+    name = NULL;
+
+    if (attr != NULL) {
+      name = attr->name;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(TxFastFlags_t))) {
+        mem = 1;
+      }
+      else {
+        if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+          mem = 0;
+        }
+      }
+    }
+    else {
+      mem = 0;
+    }
+
+    if (mem == 1) {
+      ff = attr->cb_mem;
+    }
+    else {
+      if (mem == 0) {
+        ff = TxOs2MemAlloc (sizeof(TxFastFlags_t));
+      }
+    }
+
+    if (ff != NULL) {
+      memset (ff, 0, sizeof(TxFastFlags_t));
+
+      if (thread_id == NULL) {
+        ff->thread = tx_thread_identify();
+      } else {
+        ff->thread = (TX_THREAD *)thread_id;
+      }
+
+      /* ThreadX sets event flags from an ISR directly, a private group is all it takes */
+      if (tx_event_flags_create (&ff->group, (CHAR *)name) == TX_SUCCESS) {
+        ff->status = FFLAGS_STATUS;
+
+        if (mem == 0) {
+          /* Control block on heap */
+          ff->status |= FFLAGS_STATUS_CB_HEAP;
+        }
+      }
+      else {
+        if (mem == 0) {
+          TxOs2MemFree (ff);
+        }
+        ff = NULL;
+      }
+    }
+  }
+
+  return ((osFastFlagsId_t)ff);
+}
+
+const char *osFastFlagsGetName (osFastFlagsId_t ff_id) {
+  TxFastFlags_t *ff = (TxFastFlags_t *)ff_id;
+  const char *p;
+
+  if (IS_IRQ() || (ff == NULL)) {
+    p = NULL;
+  } else {
+    p = ff->group.tx_event_flags_group_name;
+  }
+
+  return (p);
+}
+
+uint32_t osFastFlagsSet (osFastFlagsId_t ff_id, uint32_t flags) {
+  TxFastFlags_t *ff = (TxFastFlags_t *)ff_id;
+  uint32_t rflags;
+  ULONG current;
+
+  if ((ff == NULL) || ((flags & FAST_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS) {
+    rflags = (uint32_t)osErrorResource;
+  }
+  else {
+    (void)tx_event_flags_info_get (&ff->group, TX_NULL, &current, TX_NULL, TX_NULL, TX_NULL);
+
+    /* Waiting thread is readied here, within the ISR */
+    (void)tx_event_flags_set (&ff->group, flags, TX_OR);
+    rflags = (uint32_t)current | flags;
+  }
+
+  /* Return flags after setting */
+  return (rflags);
+}
+
+uint32_t osFastFlagsClear (osFastFlagsId_t ff_id, uint32_t flags) {
+  TxFastFlags_t *ff = (TxFastFlags_t *)ff_id;
+  uint32_t rflags;
+  ULONG current;
+
+  if ((ff == NULL) || ((flags & FAST_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if (IS_IRQ()) {
+    rflags = (uint32_t)osErrorISR;
+  }
+  else if ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS) {
+    rflags = (uint32_t)osErrorResource;
+  }
+  else {
+    (void)tx_event_flags_info_get (&ff->group, TX_NULL, &current, TX_NULL, TX_NULL, TX_NULL);
+    (void)tx_event_flags_set (&ff->group, ~flags, TX_AND);
+    rflags = (uint32_t)current;
+  }
+
+  /* Return flags before clearing */
+  return (rflags);
+}
+
+uint32_t osFastFlagsGet (osFastFlagsId_t ff_id) {
+  TxFastFlags_t *ff = (TxFastFlags_t *)ff_id;
+  ULONG current;
+
+  if ((ff == NULL) || ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS)) {
+    current = 0U;
+  }
+  else {
+    (void)tx_event_flags_info_get (&ff->group, TX_NULL, &current, TX_NULL, TX_NULL, TX_NULL);
+  }
+
+  return ((uint32_t)current);
+}
+
+uint32_t osFastFlagsWait (osFastFlagsId_t ff_id, uint32_t flags, uint32_t options, uint32_t timeout) {
+  TxFastFlags_t *ff = (TxFastFlags_t *)ff_id;
+  uint32_t rflags;
+  ULONG actual;
+  UINT option;
+  UINT status;
+
+  if ((ff == NULL) || ((flags & FAST_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if (IS_IRQ()) {
+    rflags = (uint32_t)osErrorISR;
+  }
+  else if ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS) {
+    rflags = (uint32_t)osErrorResource;
+  }
+  else if (ff->thread != tx_thread_identify()) {
+    /* Same contract as the FreeRTOS wrapper: only the bound thread waits */
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else {
+    option  = ((options & osFlagsWaitAll) != 0U) ? TX_AND : TX_OR;
+    option |= ((options & osFlagsNoClear) != 0U) ? 0U : 1U;
+
+    status = tx_event_flags_get (&ff->group, flags, option, &actual, timeout);
+
+    if (status == TX_SUCCESS) {
+      rflags = (uint32_t)actual;
+    }
+    else if (status == TX_NO_EVENTS) {
+      if (timeout == 0U) {
+        rflags = (uint32_t)osErrorResource;
+      } else {
+        rflags = (uint32_t)osErrorTimeout;
+      }
+    }
+    else {
+      rflags = (uint32_t)osErrorResource;
+    }
+  }
+
+  /* Return flags before clearing */
+  return (rflags);
+}
+
+osStatus_t osFastFlagsDelete (osFastFlagsId_t ff_id) {
+  TxFastFlags_t *ff = (TxFastFlags_t *)ff_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if ((ff == NULL) || ((ff->status & FFLAGS_STATUS) != FFLAGS_STATUS)) {
+    stat = osErrorParameter;
+  }
+  else {
+    /* Invalidate control block status */
+    ff->status = ff->status & FFLAGS_STATUS_CB_HEAP;
+
+    (void)tx_event_flags_delete (&ff->group);
+
+    if ((ff->status & FFLAGS_STATUS_CB_HEAP) != 0U) {
+      TxOs2MemFree (ff);
+    }
+
+    stat = osOK;
+  }
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+  Get index of a block in the pool memory array, -1 if the pointer does not
+  address the start of a block.
+*/
+static int32_t BlockIndex (TxRefQueue_t *rq, void *block) {
+  uint32_t ofs, stride;
+  uint8_t *first;
+  int32_t idx = -1;
+
+  /* ThreadX places a pointer sized header in front of every block */
+  first  = rq->mp.mem_arr + sizeof(UCHAR *);
+  stride = TX_OS2_MEMPOOL_BLOCK_SIZE (rq->mp.bl_sz);
+
+  if ((uint8_t *)block >= first) {
+    ofs = (uint32_t)((uint8_t *)block - first);
+
+    if (((ofs % stride) == 0U) && ((ofs / stride) < rq->mp.bl_cnt)) {
+      idx = (int32_t)(ofs / stride);
+    }
+  }
+
+  return (idx);
+}
+
+#if (TX_OS2_REFQUEUE_OWNER_CHECK == 1)
+/*
+  Identify the caller as block owner: the running thread or any ISR.
+*/
+static void *OwnerId (void) {
+  void *id;
+
+  if (IS_IRQ()) {
+    id = REFQ_OWNER_ISR;
+  } else {
+    id = (void *)tx_thread_identify();
+  }
+
+  return (id);
+}
+#endif
+
+/**
+  Dummy implementation of the callback function osRefQueueOwnerErrorHook().
+*/
+__WEAK void osRefQueueOwnerErrorHook (osRefQueueId_t rq_id, void *block) {
+  (void)rq_id;
+  (void)block;
+  for (;;);
+}
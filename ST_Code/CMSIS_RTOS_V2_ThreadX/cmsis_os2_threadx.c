@@ -0,0 +1,2238 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    cmsis_os2_threadx.c
+ *      Purpose: CMSIS RTOS2 wrapper for ThreadX
+ *
+ *---------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "cmsis_os2.h"                  // ::CMSIS:RTOS2
+#include "cmsis_compiler.h"             // Compiler agnostic definitions
+
+#include "tx_api.h"                     // ThreadX API
+#include "tx_thread.h"                  // ThreadX thread internals
+#include "tx_initialize.h"              // ThreadX initialization internals
+#include "threadx_os2.h"                // Configuration and control blocks
+
+/*---------------------------------------------------------------------------*/
+#define IS_IRQ()                  (__get_IPSR() != 0U)
+
+#define IS_IRQ_MASKED()           ((__get_PRIMASK() != 0U) || (__get_BASEPRI() != 0U))
+
+/* Limits */
+#define MAX_BITS_THREAD_FLAGS     31U
+#define MAX_BITS_EVENT_FLAGS      31U
+
+#define THREAD_FLAGS_INVALID_BITS (~((1UL << MAX_BITS_THREAD_FLAGS) - 1U))
+#define EVENT_FLAGS_INVALID_BITS  (~((1UL << MAX_BITS_EVENT_FLAGS)  - 1U))
+
+/* Thread flag bit reserved to signal a joinable thread has exited */
+#define THREAD_FLAG_EXITED        (1UL << MAX_BITS_THREAD_FLAGS)
+
+/* Kernel version and identification string definition (major.minor.rev: mmnnnrrrr dec) */
+#define KERNEL_VERSION            (((uint32_t)THREADX_MAJOR_VERSION * 10000000UL) | \
+                                   ((uint32_t)THREADX_MINOR_VERSION *    10000UL) | \
+                                   ((uint32_t)THREADX_PATCH_VERSION *        1UL))
+
+#define API_VERSION               20010003UL
+
+#define STRINGIFY_(x)             #x
+#define STRINGIFY(x)              STRINGIFY_(x)
+
+#define KERNEL_ID                 ("ThreadX V" STRINGIFY(THREADX_MAJOR_VERSION) "." \
+                                               STRINGIFY(THREADX_MINOR_VERSION) "." \
+                                               STRINGIFY(THREADX_PATCH_VERSION))
+
+/* Threads created by this wrapper all start in ThreadEntry */
+#define IS_OS2_THREAD(th)         (((th) != NULL) && ((th)->tx_thread_entry == ThreadEntry))
+
+/* Map a ThreadX wait status onto a CMSIS status */
+#define WAIT_STATUS(timeout)      (((timeout) == 0U) ? osErrorResource : osErrorTimeout)
+
+/* Kernel initialization state */
+static osKernelState_t KernelState = osKernelInactive;
+
+/* Thread holding the kernel lock and its preemption-threshold before locking */
+static TX_THREAD *KernelLockOwner;
+static UINT       KernelLockThreshold;
+
+/* Byte pool backing objects created without user provided memory */
+static TX_BYTE_POOL BytePool;
+static ULONG        BytePoolMem[TX_OS2_BYTE_POOL_SIZE / sizeof(ULONG)];
+static volatile uint32_t BytePoolReady;
+
+/* Detached threads that have exited, deleted by the next osThreadNew */
+static TxThread_t *ThreadReapList;
+
+static VOID ThreadEntry (ULONG input);
+
+/*---------------------------------------------------------------------------*/
+
+/* Create the byte pool on first use, so objects can be created without osKernelInitialize */
+static void BytePoolSetup (void) {
+  TX_INTERRUPT_SAVE_AREA
+
+  if (BytePoolReady == 0U) {
+    TX_DISABLE
+    if (BytePoolReady == 0U) {
+      (void)tx_byte_pool_create (&BytePool, "os2_pool", BytePoolMem, sizeof(BytePoolMem));
+      BytePoolReady = 1U;
+    }
+    TX_RESTORE
+  }
+}
+
+void *TxOs2MemAlloc (uint32_t size) {
+  void *mem;
+
+  BytePoolSetup();
+
+  if (tx_byte_allocate (&BytePool, &mem, size, TX_NO_WAIT) != TX_SUCCESS) {
+    mem = NULL;
+  }
+
+  return (mem);
+}
+
+void TxOs2MemFree (void *mem) {
+  if (mem != NULL) {
+    (void)tx_byte_release (mem);
+  }
+}
+
+/* Scheduler is running when called from a thread or an ISR after tx_kernel_enter */
+static uint32_t KernelIsRunning (void) {
+  uint32_t running;
+
+  if (_tx_thread_system_state >= TX_INITIALIZE_IN_PROGRESS) {
+    running = 0U;
+  } else {
+    running = ((_tx_thread_current_ptr != TX_NULL) || IS_IRQ()) ? 1U : 0U;
+  }
+
+  return (running);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osStatus_t osKernelInitialize (void) {
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else {
+    if (KernelState == osKernelInactive) {
+      /* Let objects be created before tx_kernel_enter is called */
+      _tx_initialize_kernel_setup();
+      BytePoolSetup();
+
+      KernelState = osKernelReady;
+      stat = osOK;
+    } else {
+      stat = osError;
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osKernelGetInfo (osVersion_t *version, char *id_buf, uint32_t id_size) {
+
+  if (version != NULL) {
+    /* Version encoding is major.minor.rev: mmnnnrrrr dec */
+    version->api    = API_VERSION;
+    version->kernel = KERNEL_VERSION;
+  }
+
+  if ((id_buf != NULL) && (id_size != 0U)) {
+    if (id_size > sizeof(KERNEL_ID)) {
+      id_size = sizeof(KERNEL_ID);
+    }
+    memcpy(id_buf, KERNEL_ID, id_size);
+  }
+
+  return (osOK);
+}
+
+osKernelState_t osKernelGetState (void) {
+  osKernelState_t state;
+
+  if (KernelIsRunning() != 0U) {
+    if ((KernelLockOwner != NULL) && (KernelLockOwner == _tx_thread_current_ptr)) {
+      state = osKernelLocked;
+    } else {
+      state = osKernelRunning;
+    }
+  }
+  else if (KernelState == osKernelReady) {
+    state = osKernelReady;
+  }
+  else {
+    state = osKernelInactive;
+  }
+
+  return (state);
+}
+
+osStatus_t osKernelStart (void) {
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else {
+    if (KernelState == osKernelReady) {
+      KernelState = osKernelRunning;
+      /* Does not return; tx_application_define runs before the scheduler starts */
+      tx_kernel_enter();
+      stat = osOK;
+    } else {
+      stat = osError;
+    }
+  }
+
+  return (stat);
+}
+
+int32_t osKernelLock (void) {
+  TX_THREAD *thread;
+  int32_t lock;
+
+  if (IS_IRQ()) {
+    lock = (int32_t)osErrorISR;
+  }
+  else if (KernelIsRunning() == 0U) {
+    lock = (int32_t)osError;
+  }
+  else if (KernelLockOwner != NULL) {
+    lock = 1;
+  }
+  else {
+    /* A preemption-threshold of 0 keeps every other thread from running */
+    thread = tx_thread_identify();
+    (void)tx_thread_preemption_change (thread, 0U, &KernelLockThreshold);
+    KernelLockOwner = thread;
+    lock = 0;
+  }
+
+  return (lock);
+}
+
+int32_t osKernelUnlock (void) {
+  TX_THREAD *thread;
+  UINT old;
+  int32_t lock;
+
+  if (IS_IRQ()) {
+    lock = (int32_t)osErrorISR;
+  }
+  else if (KernelIsRunning() == 0U) {
+    lock = (int32_t)osError;
+  }
+  else if (KernelLockOwner == NULL) {
+    lock = 0;
+  }
+  else {
+    thread = KernelLockOwner;
+    KernelLockOwner = NULL;
+    /* Restoring the threshold may switch to a thread readied while locked */
+    (void)tx_thread_preemption_change (thread, KernelLockThreshold, &old);
+    lock = 1;
+  }
+
+  return (lock);
+}
+
+int32_t osKernelRestoreLock (int32_t lock) {
+
+  if (IS_IRQ()) {
+    lock = (int32_t)osErrorISR;
+  }
+  else if (KernelIsRunning() == 0U) {
+    lock = (int32_t)osError;
+  }
+  else if (lock == 1) {
+    (void)osKernelLock();
+  }
+  else if (lock == 0) {
+    (void)osKernelUnlock();
+  }
+  else {
+    lock = (int32_t)osError;
+  }
+
+  return (lock);
+}
+
+uint32_t osKernelSuspend (void) {
+  /* Tickless operation is not provided, the tick keeps running */
+  return (0U);
+}
+
+void osKernelResume (uint32_t sleep_ticks) {
+  (void)sleep_ticks;
+}
+
+uint32_t osKernelGetTickCount (void) {
+  return ((uint32_t)tx_time_get());
+}
+
+uint32_t osKernelGetTickFreq (void) {
+  return ((uint32_t)TX_TIMER_TICKS_PER_SECOND);
+}
+
+/* Get OS Tick count value */
+static uint32_t OS_Tick_GetCount (void) {
+  uint32_t load = SysTick->LOAD;
+  return  (load - SysTick->VAL);
+}
+
+/* Get OS Tick overflow status */
+static uint32_t OS_Tick_GetOverflow (void) {
+  return ((SysTick->CTRL >> 16) & 1U);
+}
+
+/* Get OS Tick interval */
+static uint32_t OS_Tick_GetInterval (void) {
+  return (SysTick->LOAD + 1U);
+}
+
+/* Weak: an application that takes the kernel tick from another timer and
+   stops SysTick supplies its own kernel timer */
+__WEAK uint32_t osKernelGetSysTimerCount (void) {
+  uint32_t irqmask = IS_IRQ_MASKED();
+  uint32_t ticks;
+  uint32_t val;
+
+  __disable_irq();
+
+  ticks = (uint32_t)tx_time_get();
+  val   = OS_Tick_GetCount();
+
+  if (OS_Tick_GetOverflow() != 0U) {
+    val = OS_Tick_GetCount();
+    ticks++;
+  }
+  val += ticks * OS_Tick_GetInterval();
+
+  if (irqmask == 0U) {
+    __enable_irq();
+  }
+
+  return (val);
+}
+
+__WEAK uint32_t osKernelGetSysTimerFreq (void) {
+  return (SystemCoreClock);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/* Release all resources held by a thread that is no longer running */
+static void ThreadFree (TxThread_t *th) {
+  void *stack = th->thread.tx_thread_stack_start;
+  uint32_t status = th->status;
+
+  (void)tx_thread_delete (&th->thread);
+  (void)tx_event_flags_delete (&th->flags);
+
+  if ((status & TX_OS2_STATUS_MEM_HEAP) != 0U) {
+    TxOs2MemFree (stack);
+  }
+  if ((status & TX_OS2_STATUS_CB_HEAP) != 0U) {
+    TxOs2MemFree (th);
+  }
+}
+
+/* Delete detached threads that exited; a thread cannot delete itself in ThreadX */
+static void ThreadReap (void) {
+  TX_INTERRUPT_SAVE_AREA
+  TxThread_t *list;
+
+  TX_DISABLE
+  list = ThreadReapList;
+  ThreadReapList = NULL;
+  TX_RESTORE
+
+  while (list != NULL) {
+    TxThread_t *th = list;
+    list = th->reap;
+    ThreadFree (th);
+  }
+}
+
+static VOID ThreadEntry (ULONG input) {
+  TxThread_t *th = (TxThread_t *)tx_thread_identify();
+
+  (void)input;
+
+  th->func (th->arg);
+
+  /* Returning from the thread function is the same as calling osThreadExit */
+  osThreadExit();
+}
+
+osThreadId_t osThreadNew (osThreadFunc_t func, void *argument, const osThreadAttr_t *attr) {
+  const char *name;
+  uint32_t stack;
+  void *stack_mem;
+  TxThread_t *th;
+  uint32_t prio;
+  uint32_t attr_bits;
+  int32_t mem_cb, mem_stack;
+  UINT status;
+
+  th = NULL;
+
+  if (!IS_IRQ() && (func != NULL)) {
+    ThreadReap();
+
+    stack     = TX_OS2_THREAD_STACK_SIZE;
+    prio      = (uint32_t)osPriorityNormal;
+    attr_bits = 0U;
+    stack_mem = NULL;
+
+    name      = NULL;
+    mem_cb    = -1;
+    mem_stack = -1;
+
+    if (attr != NULL) {
+      if (attr->name != NULL) {
+        name = attr->name;
+      }
+      if (attr->priority != osPriorityNone) {
+        prio = (uint32_t)attr->priority;
+      }
+      attr_bits = attr->attr_bits;
+
+      if ((prio < osPriorityIdle) || (prio > osPriorityISR)) {
+        return (NULL);
+      }
+
+      if (attr->stack_size > 0U) {
+        stack = attr->stack_size;
+      }
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(TxThread_t))) {
+        mem_cb = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        mem_cb = 0;
+      }
+
+      if ((attr->stack_mem != NULL) && (attr->stack_size > 0U)) {
+        mem_stack = 1;
+      }
+      else if (attr->stack_mem == NULL) {
+        mem_stack = 0;
+      }
+    }
+    else {
+      mem_cb    = 0;
+      mem_stack = 0;
+    }
+
+    if ((mem_cb != -1) && (mem_stack != -1)) {
+      if (mem_cb == 1) {
+        th = attr->cb_mem;
+      } else {
+        th = TxOs2MemAlloc (sizeof(TxThread_t));
+      }
+
+      if (th != NULL) {
+        if (mem_stack == 1) {
+          stack_mem = attr->stack_mem;
+        } else {
+          stack_mem = TxOs2MemAlloc (stack);
+        }
+
+        if (stack_mem == NULL) {
+          if (mem_cb == 0) {
+            TxOs2MemFree (th);
+          }
+          th = NULL;
+        }
+      }
+    }
+
+    if (th != NULL) {
+      memset (th, 0, sizeof(TxThread_t));
+
+      th->func   = func;
+      th->arg    = argument;
+      th->attr   = attr_bits;
+      th->status = 0U;
+
+      if (mem_cb == 0) {
+        th->status |= TX_OS2_STATUS_CB_HEAP;
+      }
+      if (mem_stack == 0) {
+        th->status |= TX_OS2_STATUS_MEM_HEAP;
+      }
+
+      status = tx_event_flags_create (&th->flags, (CHAR *)name);
+
+      if (status == TX_SUCCESS) {
+        status = tx_thread_create (&th->thread, (CHAR *)name, ThreadEntry, 0U, stack_mem, stack,
+                                   TX_OS2_TO_TX_PRIO(prio), TX_OS2_TO_TX_PRIO(prio),
+                                   TX_OS2_THREAD_TIME_SLICE, TX_AUTO_START);
+
+        if (status != TX_SUCCESS) {
+          (void)tx_event_flags_delete (&th->flags);
+        }
+      }
+
+      if (status != TX_SUCCESS) {
+        /* Thread cannot be created, release allocated resources */
+        if (mem_stack == 0) {
+          TxOs2MemFree (stack_mem);
+        }
+        if (mem_cb == 0) {
+          TxOs2MemFree (th);
+        }
+        th = NULL;
+      }
+    }
+  }
+
+  return ((osThreadId_t)th);
+}
+
+const char *osThreadGetName (osThreadId_t thread_id) {
+  TX_THREAD *thread = (TX_THREAD *)thread_id;
+  const char *name;
+
+  if (IS_IRQ() || (thread == NULL)) {
+    name = NULL;
+  } else {
+    name = thread->tx_thread_name;
+  }
+
+  return (name);
+}
+
+osThreadId_t osThreadGetId (void) {
+  osThreadId_t id;
+
+  id = (osThreadId_t)tx_thread_identify();
+
+  return (id);
+}
+
+osThreadState_t osThreadGetState (osThreadId_t thread_id) {
+  TX_THREAD *thread = (TX_THREAD *)thread_id;
+  osThreadState_t state;
+
+  if (IS_IRQ() || (thread == NULL)) {
+    state = osThreadError;
+  }
+  else {
+    switch (thread->tx_thread_state) {
+      case TX_READY:
+        state = (thread == tx_thread_identify()) ? osThreadRunning : osThreadReady;
+        break;
+
+      case TX_COMPLETED:
+      case TX_TERMINATED:
+        state = osThreadTerminated;
+        break;
+
+      default:
+        state = osThreadBlocked;
+        break;
+    }
+  }
+
+  return (state);
+}
+
+uint32_t osThreadGetStackSize (osThreadId_t thread_id) {
+  TX_THREAD *thread = (TX_THREAD *)thread_id;
+  uint32_t sz;
+
+  if (IS_IRQ() || (thread == NULL)) {
+    sz = 0U;
+  } else {
+    sz = (uint32_t)thread->tx_thread_stack_size;
+  }
+
+  return (sz);
+}
+
+uint32_t osThreadGetStackSpace (osThreadId_t thread_id) {
+  TX_THREAD *thread = (TX_THREAD *)thread_id;
+  const ULONG *p;
+  const ULONG *end;
+  uint32_t sz;
+
+  if (IS_IRQ() || (thread == NULL)) {
+    sz = 0U;
+  }
+  else {
+    /* Stack grows down; count the fill pattern ThreadX wrote at creation */
+    p   = (const ULONG *)thread->tx_thread_stack_start;
+    end = (const ULONG *)thread->tx_thread_stack_end;
+
+    while ((p < end) && (*p == TX_STACK_FILL)) {
+      p++;
+    }
+
+    sz = (uint32_t)((const uint8_t *)p - (const uint8_t *)thread->tx_thread_stack_start);
+  }
+
+  return (sz);
+}
+
+osStatus_t osThreadSetPriority (osThreadId_t thread_id, osPriority_t priority) {
+  TX_THREAD *thread = (TX_THREAD *)thread_id;
+  osStatus_t stat;
+  UINT old;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if ((thread == NULL) || (priority < osPriorityIdle) || (priority > osPriorityISR)) {
+    stat = osErrorParameter;
+  }
+  else {
+    if (tx_thread_priority_change (thread, TX_OS2_TO_TX_PRIO(priority), &old) == TX_SUCCESS) {
+      stat = osOK;
+    } else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+osPriority_t osThreadGetPriority (osThreadId_t thread_id) {
+  TX_THREAD *thread = (TX_THREAD *)thread_id;
+  osPriority_t prio;
+
+  if (IS_IRQ() || (thread == NULL)) {
+    prio = osPriorityError;
+  } else {
+    prio = TX_OS2_FROM_TX_PRIO(thread->tx_thread_priority);
+  }
+
+  return (prio);
+}
+
+osStatus_t osThreadYield (void) {
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  } else {
+    stat = osOK;
+    tx_thread_relinquish();
+  }
+
+  return (stat);
+}
+
+osStatus_t osThreadSuspend (osThreadId_t thread_id) {
+  TX_THREAD *thread = (TX_THREAD *)thread_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (thread == NULL) {
+    stat = osErrorParameter;
+  }
+  else {
+    if (tx_thread_suspend (thread) == TX_SUCCESS) {
+      stat = osOK;
+    } else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osThreadResume (osThreadId_t thread_id) {
+  TX_THREAD *thread = (TX_THREAD *)thread_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (thread == NULL) {
+    stat = osErrorParameter;
+  }
+  else {
+    if (tx_thread_resume (thread) == TX_SUCCESS) {
+      stat = osOK;
+    } else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osThreadDetach (osThreadId_t thread_id) {
+  TxThread_t *th = (TxThread_t *)thread_id;
+  osStatus_t stat;
+  UINT state;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if ((th == NULL) || !IS_OS2_THREAD(&th->thread)) {
+    stat = osErrorParameter;
+  }
+  else if ((th->attr & osThreadJoinable) == 0U) {
+    stat = osErrorResource;
+  }
+  else {
+    /* An exiting thread runs with preemption disabled, so it is either gone or still running here */
+    th->attr &= ~osThreadJoinable;
+
+    state = th->thread.tx_thread_state;
+    if ((state == TX_COMPLETED) || (state == TX_TERMINATED)) {
+      ThreadFree (th);
+    }
+
+    stat = osOK;
+  }
+
+  return (stat);
+}
+
+osStatus_t osThreadJoin (osThreadId_t thread_id) {
+  TxThread_t *th = (TxThread_t *)thread_id;
+  osStatus_t stat;
+  ULONG flags;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if ((th == NULL) || !IS_OS2_THREAD(&th->thread)) {
+    stat = osErrorParameter;
+  }
+  else if (((th->attr & osThreadJoinable) == 0U) || (&th->thread == tx_thread_identify())) {
+    stat = osErrorResource;
+  }
+  else {
+    if (tx_event_flags_get (&th->flags, THREAD_FLAG_EXITED, TX_OR, &flags, TX_WAIT_FOREVER) == TX_SUCCESS) {
+      ThreadFree (th);
+      stat = osOK;
+    } else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+__NO_RETURN void osThreadExit (void) {
+  TX_INTERRUPT_SAVE_AREA
+  TX_THREAD *thread = tx_thread_identify();
+  TxThread_t *th = (TxThread_t *)thread;
+  UINT old;
+
+  if (IS_OS2_THREAD(thread)) {
+    /* Keep every other thread off the CPU until this one is terminated */
+    (void)tx_thread_preemption_change (thread, 0U, &old);
+
+    if ((th->attr & osThreadJoinable) != 0U) {
+      (void)tx_event_flags_set (&th->flags, THREAD_FLAG_EXITED, TX_OR);
+    }
+    else {
+      TX_DISABLE
+      th->reap = ThreadReapList;
+      ThreadReapList = th;
+      TX_RESTORE
+    }
+  }
+
+  (void)tx_thread_terminate (thread);
+
+  for (;;);
+}
+
+osStatus_t osThreadTerminate (osThreadId_t thread_id) {
+  TxThread_t *th = (TxThread_t *)thread_id;
+  osStatus_t stat;
+  UINT state;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (th == NULL) {
+    stat = osErrorParameter;
+  }
+  else if (&th->thread == tx_thread_identify()) {
+    osThreadExit();
+  }
+  else {
+    state = th->thread.tx_thread_state;
+
+    if ((state == TX_COMPLETED) || (state == TX_TERMINATED)) {
+      stat = osErrorResource;
+    }
+    else if (tx_thread_terminate (&th->thread) != TX_SUCCESS) {
+      stat = osErrorResource;
+    }
+    else {
+      stat = osOK;
+
+      if (IS_OS2_THREAD(&th->thread)) {
+        if ((th->attr & osThreadJoinable) != 0U) {
+          (void)tx_event_flags_set (&th->flags, THREAD_FLAG_EXITED, TX_OR);
+        } else {
+          ThreadFree (th);
+        }
+      }
+    }
+  }
+
+  return (stat);
+}
+
+uint32_t osThreadGetCount (void) {
+  uint32_t count;
+
+  if (IS_IRQ()) {
+    count = 0U;
+  } else {
+    count = (uint32_t)_tx_thread_created_count;
+  }
+
+  return (count);
+}
+
+uint32_t osThreadEnumerate (osThreadId_t *thread_array, uint32_t array_items) {
+  TX_INTERRUPT_SAVE_AREA
+  TX_THREAD *thread;
+  uint32_t i, count;
+
+  if (IS_IRQ() || (thread_array == NULL) || (array_items == 0U)) {
+    count = 0U;
+  }
+  else {
+    TX_DISABLE
+
+    thread = _tx_thread_created_ptr;
+    count  = (uint32_t)_tx_thread_created_count;
+
+    if (count > array_items) {
+      count = array_items;
+    }
+
+    for (i = 0U; i < count; i++) {
+      thread_array[i] = (osThreadId_t)thread;
+      thread = thread->tx_thread_created_next;
+    }
+
+    TX_RESTORE
+  }
+
+  return (count);
+}
+
+/*---------------------------------------------------------------------------*/
+
+uint32_t osThreadFlagsSet (osThreadId_t thread_id, uint32_t flags) {
+  TxThread_t *th = (TxThread_t *)thread_id;
+  uint32_t rflags;
+  ULONG current;
+
+  if ((th == NULL) || !IS_OS2_THREAD(&th->thread) || ((flags & THREAD_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else {
+    (void)tx_event_flags_info_get (&th->flags, TX_NULL, &current, TX_NULL, TX_NULL, TX_NULL);
+
+    /* Setting from an ISR readies the waiting thread directly */
+    if (tx_event_flags_set (&th->flags, flags, TX_OR) == TX_SUCCESS) {
+      rflags = ((uint32_t)current | flags) & ~THREAD_FLAG_EXITED;
+    } else {
+      rflags = (uint32_t)osError;
+    }
+  }
+
+  /* Return flags after setting */
+  return (rflags);
+}
+
+uint32_t osThreadFlagsClear (uint32_t flags) {
+  TX_THREAD *thread;
+  TxThread_t *th;
+  uint32_t rflags;
+  ULONG current;
+
+  if (IS_IRQ()) {
+    rflags = (uint32_t)osErrorISR;
+  }
+  else if ((flags & THREAD_FLAGS_INVALID_BITS) != 0U) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else {
+    thread = tx_thread_identify();
+    th     = (TxThread_t *)thread;
+
+    if (!IS_OS2_THREAD(thread)) {
+      rflags = (uint32_t)osError;
+    }
+    else {
+      (void)tx_event_flags_info_get (&th->flags, TX_NULL, &current, TX_NULL, TX_NULL, TX_NULL);
+      (void)tx_event_flags_set (&th->flags, ~flags, TX_AND);
+
+      /* Return flags before clearing */
+      rflags = (uint32_t)current & ~THREAD_FLAG_EXITED;
+    }
+  }
+
+  return (rflags);
+}
+
+uint32_t osThreadFlagsGet (void) {
+  TX_THREAD *thread;
+  uint32_t rflags;
+  ULONG current;
+
+  if (IS_IRQ()) {
+    rflags = (uint32_t)osErrorISR;
+  }
+  else {
+    thread = tx_thread_identify();
+
+    if (!IS_OS2_THREAD(thread)) {
+      rflags = (uint32_t)osError;
+    }
+    else {
+      (void)tx_event_flags_info_get (&((TxThread_t *)thread)->flags, TX_NULL, &current, TX_NULL, TX_NULL, TX_NULL);
+      rflags = (uint32_t)current & ~THREAD_FLAG_EXITED;
+    }
+  }
+
+  return (rflags);
+}
+
+uint32_t osThreadFlagsWait (uint32_t flags, uint32_t options, uint32_t timeout) {
+  TX_THREAD *thread;
+  uint32_t rflags;
+  ULONG actual;
+  UINT option;
+  UINT status;
+
+  if (IS_IRQ()) {
+    rflags = (uint32_t)osErrorISR;
+  }
+  else if ((flags & THREAD_FLAGS_INVALID_BITS) != 0U) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else {
+    thread = tx_thread_identify();
+
+    if (!IS_OS2_THREAD(thread)) {
+      rflags = (uint32_t)osError;
+    }
+    else {
+      option  = ((options & osFlagsWaitAll) != 0U) ? TX_AND : TX_OR;
+      option |= ((options & osFlagsNoClear) != 0U) ? 0U : 1U;
+
+      /* osWaitForever and TX_WAIT_FOREVER share the same encoding */
+      status = tx_event_flags_get (&((TxThread_t *)thread)->flags, flags, option, &actual, timeout);
+
+      if (status == TX_SUCCESS) {
+        /* Return flags before clearing */
+        rflags = (uint32_t)actual & ~THREAD_FLAG_EXITED;
+      }
+      else if (status == TX_NO_EVENTS) {
+        rflags = (uint32_t)WAIT_STATUS(timeout);
+      }
+      else {
+        rflags = (uint32_t)osError;
+      }
+    }
+  }
+
+  return (rflags);
+}
+
+osStatus_t osDelay (uint32_t ticks) {
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else {
+    stat = osOK;
+
+    if (ticks != 0U) {
+      (void)tx_thread_sleep (ticks);
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osDelayUntil (uint32_t ticks) {
+  uint32_t delay;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else {
+    stat  = osOK;
+    delay = ticks - (uint32_t)tx_time_get();
+
+    /* Check if target tick has not expired */
+    if ((delay != 0U) && (0 == (delay >> (8 * sizeof(uint32_t) - 1)))) {
+      (void)tx_thread_sleep (delay);
+    }
+    else {
+      /* No delay or already expired */
+      stat = osErrorParameter;
+    }
+  }
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static VOID TimerCallback (ULONG input) {
+  /* Control block address travels through the ULONG timer argument */
+  TxTimer_t *tm = (TxTimer_t *)(uintptr_t)input;
+
+  tm->func (tm->arg);
+}
+
+osTimerId_t osTimerNew (osTimerFunc_t func, osTimerType_t type, void *argument, const osTimerAttr_t *attr) {
+  const char *name;
+  TxTimer_t *tm;
+  int32_t mem;
+
+  tm = NULL;
+
+  if (!IS_IRQ() && (func != NULL) && ((type == osTimerOnce) || (type == osTimerPeriodic))) {
+    mem  = -1;
+    name = NULL;
+
+    if (attr != NULL) {
+      name = attr->name;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(TxTimer_t))) {
+        mem = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        mem = 0;
+      }
+    }
+    else {
+      mem = 0;
+    }
+
+    if (mem == 1) {
+      tm = attr->cb_mem;
+    }
+    else if (mem == 0) {
+      tm = TxOs2MemAlloc (sizeof(TxTimer_t));
+    }
+
+    if (tm != NULL) {
+      memset (tm, 0, sizeof(TxTimer_t));
+
+      tm->func   = func;
+      tm->arg    = argument;
+      tm->type   = type;
+      tm->status = (mem == 0) ? TX_OS2_STATUS_CB_HEAP : 0U;
+
+      /* Period is set by osTimerStart, the timer stays inactive until then */
+      if (tx_timer_create (&tm->timer, (CHAR *)name, TimerCallback, (ULONG)(uintptr_t)tm,
+                           1U, 0U, TX_NO_ACTIVATE) != TX_SUCCESS) {
+        if (mem == 0) {
+          TxOs2MemFree (tm);
+        }
+        tm = NULL;
+      }
+    }
+  }
+
+  return ((osTimerId_t)tm);
+}
+
+const char *osTimerGetName (osTimerId_t timer_id) {
+  TxTimer_t *tm = (TxTimer_t *)timer_id;
+  const char *p;
+
+  if (IS_IRQ() || (tm == NULL)) {
+    p = NULL;
+  } else {
+    p = tm->timer.tx_timer_name;
+  }
+
+  return (p);
+}
+
+osStatus_t osTimerStart (osTimerId_t timer_id, uint32_t ticks) {
+  TxTimer_t *tm = (TxTimer_t *)timer_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if ((tm == NULL) || (ticks == 0U)) {
+    stat = osErrorParameter;
+  }
+  else {
+    /* A running timer is restarted with the new period */
+    (void)tx_timer_deactivate (&tm->timer);
+
+    if ((tx_timer_change (&tm->timer, ticks, (tm->type == osTimerPeriodic) ? ticks : 0U) == TX_SUCCESS) &&
+        (tx_timer_activate (&tm->timer) == TX_SUCCESS)) {
+      stat = osOK;
+    } else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osTimerStop (osTimerId_t timer_id) {
+  TxTimer_t *tm = (TxTimer_t *)timer_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (tm == NULL) {
+    stat = osErrorParameter;
+  }
+  else if (osTimerIsRunning (timer_id) == 0U) {
+    stat = osErrorResource;
+  }
+  else {
+    (void)tx_timer_deactivate (&tm->timer);
+    stat = osOK;
+  }
+
+  return (stat);
+}
+
+uint32_t osTimerIsRunning (osTimerId_t timer_id) {
+  TxTimer_t *tm = (TxTimer_t *)timer_id;
+  UINT active;
+  uint32_t running;
+
+  if (IS_IRQ() || (tm == NULL)) {
+    running = 0U;
+  }
+  else {
+    active = TX_FALSE;
+    (void)tx_timer_info_get (&tm->timer, TX_NULL, &active, TX_NULL, TX_NULL, TX_NULL);
+
+    running = (active == TX_TRUE) ? 1U : 0U;
+  }
+
+  return (running);
+}
+
+osStatus_t osTimerDelete (osTimerId_t timer_id) {
+  TxTimer_t *tm = (TxTimer_t *)timer_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (tm == NULL) {
+    stat = osErrorParameter;
+  }
+  else if (tx_timer_delete (&tm->timer) != TX_SUCCESS) {
+    stat = osErrorResource;
+  }
+  else {
+    if ((tm->status & TX_OS2_STATUS_CB_HEAP) != 0U) {
+      TxOs2MemFree (tm);
+    }
+    stat = osOK;
+  }
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osEventFlagsId_t osEventFlagsNew (const osEventFlagsAttr_t *attr) {
+  TxEventFlags_t *ef;
+  const char *name;
+  int32_t mem;
+
+  ef = NULL;
+
+  if (!IS_IRQ()) {
+    mem  = -1;
+    name = NULL;
+
+    if (attr != NULL) {
+      name = attr->name;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(TxEventFlags_t))) {
+        mem = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        mem = 0;
+      }
+    }
+    else {
+      mem = 0;
+    }
+
+    if (mem == 1) {
+      ef = attr->cb_mem;
+    }
+    else if (mem == 0) {
+      ef = TxOs2MemAlloc (sizeof(TxEventFlags_t));
+    }
+
+    if (ef != NULL) {
+      memset (ef, 0, sizeof(TxEventFlags_t));
+      ef->status = (mem == 0) ? TX_OS2_STATUS_CB_HEAP : 0U;
+
+      if (tx_event_flags_create (&ef->group, (CHAR *)name) != TX_SUCCESS) {
+        if (mem == 0) {
+          TxOs2MemFree (ef);
+        }
+        ef = NULL;
+      }
+    }
+  }
+
+  return ((osEventFlagsId_t)ef);
+}
+
+const char *osEventFlagsGetName (osEventFlagsId_t ef_id) {
+  TxEventFlags_t *ef = (TxEventFlags_t *)ef_id;
+  const char *p;
+
+  if (IS_IRQ() || (ef == NULL)) {
+    p = NULL;
+  } else {
+    p = ef->group.tx_event_flags_group_name;
+  }
+
+  return (p);
+}
+
+uint32_t osEventFlagsSet (osEventFlagsId_t ef_id, uint32_t flags) {
+  TxEventFlags_t *ef = (TxEventFlags_t *)ef_id;
+  uint32_t rflags;
+  ULONG current;
+
+  if ((ef == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else {
+    (void)tx_event_flags_info_get (&ef->group, TX_NULL, &current, TX_NULL, TX_NULL, TX_NULL);
+
+    /* Unlike FreeRTOS, setting from an ISR is not deferred to a service thread */
+    if (tx_event_flags_set (&ef->group, flags, TX_OR) == TX_SUCCESS) {
+      rflags = (uint32_t)current | flags;
+    } else {
+      rflags = (uint32_t)osErrorResource;
+    }
+  }
+
+  /* Return event flags after setting */
+  return (rflags);
+}
+
+uint32_t osEventFlagsClear (osEventFlagsId_t ef_id, uint32_t flags) {
+  TxEventFlags_t *ef = (TxEventFlags_t *)ef_id;
+  uint32_t rflags;
+  ULONG current;
+
+  if ((ef == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else {
+    (void)tx_event_flags_info_get (&ef->group, TX_NULL, &current, TX_NULL, TX_NULL, TX_NULL);
+
+    if (tx_event_flags_set (&ef->group, ~flags, TX_AND) == TX_SUCCESS) {
+      rflags = (uint32_t)current;
+    } else {
+      rflags = (uint32_t)osErrorResource;
+    }
+  }
+
+  /* Return event flags before clearing */
+  return (rflags);
+}
+
+uint32_t osEventFlagsGet (osEventFlagsId_t ef_id) {
+  TxEventFlags_t *ef = (TxEventFlags_t *)ef_id;
+  ULONG current;
+
+  if (ef == NULL) {
+    current = 0U;
+  }
+  else {
+    (void)tx_event_flags_info_get (&ef->group, TX_NULL, &current, TX_NULL, TX_NULL, TX_NULL);
+  }
+
+  return ((uint32_t)current);
+}
+
+uint32_t osEventFlagsWait (osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout) {
+  TxEventFlags_t *ef = (TxEventFlags_t *)ef_id;
+  uint32_t rflags;
+  ULONG actual;
+  UINT option;
+  UINT status;
+
+  if ((ef == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if (IS_IRQ() && (timeout != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else {
+    option  = ((options & osFlagsWaitAll) != 0U) ? TX_AND : TX_OR;
+    option |= ((options & osFlagsNoClear) != 0U) ? 0U : 1U;
+
+    status = tx_event_flags_get (&ef->group, flags, option, &actual, timeout);
+
+    if (status == TX_SUCCESS) {
+      /* Return event flags before clearing */
+      rflags = (uint32_t)actual;
+    }
+    else if (status == TX_NO_EVENTS) {
+      rflags = (uint32_t)WAIT_STATUS(timeout);
+    }
+    else {
+      rflags = (uint32_t)osErrorResource;
+    }
+  }
+
+  return (rflags);
+}
+
+osStatus_t osEventFlagsDelete (osEventFlagsId_t ef_id) {
+  TxEventFlags_t *ef = (TxEventFlags_t *)ef_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (ef == NULL) {
+    stat = osErrorParameter;
+  }
+  else if (tx_event_flags_delete (&ef->group) != TX_SUCCESS) {
+    stat = osErrorResource;
+  }
+  else {
+    if ((ef->status & TX_OS2_STATUS_CB_HEAP) != 0U) {
+      TxOs2MemFree (ef);
+    }
+    stat = osOK;
+  }
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osMutexId_t osMutexNew (const osMutexAttr_t *attr) {
+  TxMutex_t *mx;
+  const char *name;
+  uint32_t attr_bits;
+  int32_t mem;
+
+  mx = NULL;
+
+  if (!IS_IRQ()) {
+    mem       = -1;
+    name      = NULL;
+    attr_bits = 0U;
+
+    if (attr != NULL) {
+      name      = attr->name;
+      attr_bits = attr->attr_bits;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(TxMutex_t))) {
+        mem = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        mem = 0;
+      }
+    }
+    else {
+      mem = 0;
+    }
+
+    if (mem == 1) {
+      mx = attr->cb_mem;
+    }
+    else if (mem == 0) {
+      mx = TxOs2MemAlloc (sizeof(TxMutex_t));
+    }
+
+    if (mx != NULL) {
+      memset (mx, 0, sizeof(TxMutex_t));
+      mx->attr   = attr_bits;
+      mx->status = (mem == 0) ? TX_OS2_STATUS_CB_HEAP : 0U;
+
+      /*
+        FreeRTOS mutexes always inherit priority, do the same here so both
+        kernels behave alike. Robustness needs no extra work: ThreadX releases
+        the mutexes a thread owns when it is terminated.
+      */
+      if (tx_mutex_create (&mx->mutex, (CHAR *)name, TX_INHERIT) != TX_SUCCESS) {
+        if (mem == 0) {
+          TxOs2MemFree (mx);
+        }
+        mx = NULL;
+      }
+    }
+  }
+
+  return ((osMutexId_t)mx);
+}
+
+const char *osMutexGetName (osMutexId_t mutex_id) {
+  TxMutex_t *mx = (TxMutex_t *)mutex_id;
+  const char *p;
+
+  if (IS_IRQ() || (mx == NULL)) {
+    p = NULL;
+  } else {
+    p = mx->mutex.tx_mutex_name;
+  }
+
+  return (p);
+}
+
+osStatus_t osMutexAcquire (osMutexId_t mutex_id, uint32_t timeout) {
+  TxMutex_t *mx = (TxMutex_t *)mutex_id;
+  osStatus_t stat;
+  TX_THREAD *owner;
+  UINT status;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (mx == NULL) {
+    stat = osErrorParameter;
+  }
+  else {
+    owner = TX_NULL;
+    (void)tx_mutex_info_get (&mx->mutex, TX_NULL, TX_NULL, &owner, TX_NULL, TX_NULL, TX_NULL);
+
+    if (((mx->attr & osMutexRecursive) == 0U) && (owner == tx_thread_identify())) {
+      /* ThreadX mutexes always nest, refuse a second lock of a non-recursive one */
+      stat = osErrorResource;
+    }
+    else {
+      status = tx_mutex_get (&mx->mutex, timeout);
+
+      if (status == TX_SUCCESS) {
+        stat = osOK;
+      }
+      else if (status == TX_NOT_AVAILABLE) {
+        stat = WAIT_STATUS(timeout);
+      }
+      else {
+        stat = osErrorResource;
+      }
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osMutexRelease (osMutexId_t mutex_id) {
+  TxMutex_t *mx = (TxMutex_t *)mutex_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (mx == NULL) {
+    stat = osErrorParameter;
+  }
+  else {
+    if (tx_mutex_put (&mx->mutex) == TX_SUCCESS) {
+      stat = osOK;
+    } else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+osThreadId_t osMutexGetOwner (osMutexId_t mutex_id) {
+  TxMutex_t *mx = (TxMutex_t *)mutex_id;
+  TX_THREAD *owner;
+
+  owner = TX_NULL;
+
+  if (!IS_IRQ() && (mx != NULL)) {
+    (void)tx_mutex_info_get (&mx->mutex, TX_NULL, TX_NULL, &owner, TX_NULL, TX_NULL, TX_NULL);
+  }
+
+  return ((osThreadId_t)owner);
+}
+
+osStatus_t osMutexDelete (osMutexId_t mutex_id) {
+  TxMutex_t *mx = (TxMutex_t *)mutex_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (mx == NULL) {
+    stat = osErrorParameter;
+  }
+  else if (tx_mutex_delete (&mx->mutex) != TX_SUCCESS) {
+    stat = osErrorResource;
+  }
+  else {
+    if ((mx->status & TX_OS2_STATUS_CB_HEAP) != 0U) {
+      TxOs2MemFree (mx);
+    }
+    stat = osOK;
+  }
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osSemaphoreId_t osSemaphoreNew (uint32_t max_count, uint32_t initial_count, const osSemaphoreAttr_t *attr) {
+  TxSemaphore_t *sm;
+  const char *name;
+  int32_t mem;
+
+  sm = NULL;
+
+  if (!IS_IRQ() && (max_count > 0U) && (initial_count <= max_count)) {
+    mem  = -1;
+    name = NULL;
+
+    if (attr != NULL) {
+      name = attr->name;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(TxSemaphore_t))) {
+        mem = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        mem = 0;
+      }
+    }
+    else {
+      mem = 0;
+    }
+
+    if (mem == 1) {
+      sm = attr->cb_mem;
+    }
+    else if (mem == 0) {
+      sm = TxOs2MemAlloc (sizeof(TxSemaphore_t));
+    }
+
+    if (sm != NULL) {
+      memset (sm, 0, sizeof(TxSemaphore_t));
+      sm->max    = max_count;
+      sm->status = (mem == 0) ? TX_OS2_STATUS_CB_HEAP : 0U;
+
+      if (tx_semaphore_create (&sm->sem, (CHAR *)name, initial_count) != TX_SUCCESS) {
+        if (mem == 0) {
+          TxOs2MemFree (sm);
+        }
+        sm = NULL;
+      }
+    }
+  }
+
+  return ((osSemaphoreId_t)sm);
+}
+
+const char *osSemaphoreGetName (osSemaphoreId_t semaphore_id) {
+  TxSemaphore_t *sm = (TxSemaphore_t *)semaphore_id;
+  const char *p;
+
+  if (IS_IRQ() || (sm == NULL)) {
+    p = NULL;
+  } else {
+    p = sm->sem.tx_semaphore_name;
+  }
+
+  return (p);
+}
+
+osStatus_t osSemaphoreAcquire (osSemaphoreId_t semaphore_id, uint32_t timeout) {
+  TxSemaphore_t *sm = (TxSemaphore_t *)semaphore_id;
+  osStatus_t stat;
+  UINT status;
+
+  if (sm == NULL) {
+    stat = osErrorParameter;
+  }
+  else if (IS_IRQ() && (timeout != 0U)) {
+    stat = osErrorParameter;
+  }
+  else {
+    status = tx_semaphore_get (&sm->sem, timeout);
+
+    if (status == TX_SUCCESS) {
+      stat = osOK;
+    }
+    else if (status == TX_NO_INSTANCE) {
+      stat = WAIT_STATUS(timeout);
+    }
+    else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osSemaphoreRelease (osSemaphoreId_t semaphore_id) {
+  TxSemaphore_t *sm = (TxSemaphore_t *)semaphore_id;
+  osStatus_t stat;
+
+  if (sm == NULL) {
+    stat = osErrorParameter;
+  }
+  else {
+    /* Ceiling put enforces the CMSIS maximum token count */
+    if (tx_semaphore_ceiling_put (&sm->sem, sm->max) == TX_SUCCESS) {
+      stat = osOK;
+    } else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+uint32_t osSemaphoreGetCount (osSemaphoreId_t semaphore_id) {
+  TxSemaphore_t *sm = (TxSemaphore_t *)semaphore_id;
+  ULONG count;
+
+  if (sm == NULL) {
+    count = 0U;
+  }
+  else {
+    (void)tx_semaphore_info_get (&sm->sem, TX_NULL, &count, TX_NULL, TX_NULL, TX_NULL);
+  }
+
+  return ((uint32_t)count);
+}
+
+osStatus_t osSemaphoreDelete (osSemaphoreId_t semaphore_id) {
+  TxSemaphore_t *sm = (TxSemaphore_t *)semaphore_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (sm == NULL) {
+    stat = osErrorParameter;
+  }
+  else if (tx_semaphore_delete (&sm->sem) != TX_SUCCESS) {
+    stat = osErrorResource;
+  }
+  else {
+    if ((sm->status & TX_OS2_STATUS_CB_HEAP) != 0U) {
+      TxOs2MemFree (sm);
+    }
+    stat = osOK;
+  }
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osMemoryPoolId_t osMemoryPoolNew (uint32_t block_count, uint32_t block_size, const osMemoryPoolAttr_t *attr) {
+  TxMemPool_t *mp;
+  const char *name;
+  void *mem_arr;
+  uint32_t sz;
+  int32_t mem_cb, mem_mp;
+
+  mp = NULL;
+
+  if (!IS_IRQ() && (block_count > 0U) && (block_size > 0U)) {
+    sz     = TX_OS2_MEMPOOL_ARR_SIZE (block_count, block_size);
+    name   = NULL;
+    mem_cb = -1;
+    mem_mp = -1;
+
+    if (attr != NULL) {
+      name = attr->name;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(TxMemPool_t))) {
+        mem_cb = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        mem_cb = 0;
+      }
+
+      if ((attr->mp_mem != NULL) && (attr->mp_size >= sz)) {
+        mem_mp = 1;
+      }
+      else if ((attr->mp_mem == NULL) && (attr->mp_size == 0U)) {
+        mem_mp = 0;
+      }
+    }
+    else {
+      mem_cb = 0;
+      mem_mp = 0;
+    }
+
+    if ((mem_cb != -1) && (mem_mp != -1)) {
+      if (mem_cb == 1) {
+        mp = attr->cb_mem;
+      } else {
+        mp = TxOs2MemAlloc (sizeof(TxMemPool_t));
+      }
+    }
+
+    if (mp != NULL) {
+      if (mem_mp == 1) {
+        mem_arr = attr->mp_mem;
+      } else {
+        mem_arr = TxOs2MemAlloc (sz);
+      }
+
+      memset (mp, 0, sizeof(TxMemPool_t));
+
+      /* Pass the exact size so the pool holds block_count blocks, not more */
+      if ((mem_arr != NULL) &&
+          (tx_block_pool_create (&mp->pool, (CHAR *)name, block_size, mem_arr, sz) == TX_SUCCESS)) {
+        mp->mem_arr = mem_arr;
+        mp->mem_sz  = sz;
+        mp->bl_sz   = block_size;
+        mp->bl_cnt  = block_count;
+        mp->status  = 0U;
+
+        if (mem_cb == 0) {
+          mp->status |= TX_OS2_STATUS_CB_HEAP;
+        }
+        if (mem_mp == 0) {
+          mp->status |= TX_OS2_STATUS_MEM_HEAP;
+        }
+      }
+      else {
+        /* Memory pool cannot be created, release allocated resources */
+        if ((mem_mp == 0) && (mem_arr != NULL)) {
+          TxOs2MemFree (mem_arr);
+        }
+        if (mem_cb == 0) {
+          TxOs2MemFree (mp);
+        }
+        mp = NULL;
+      }
+    }
+  }
+
+  return ((osMemoryPoolId_t)mp);
+}
+
+const char *osMemoryPoolGetName (osMemoryPoolId_t mp_id) {
+  TxMemPool_t *mp = (TxMemPool_t *)mp_id;
+  const char *p;
+
+  if (IS_IRQ() || (mp == NULL)) {
+    p = NULL;
+  } else {
+    p = mp->pool.tx_block_pool_name;
+  }
+
+  return (p);
+}
+
+void *osMemoryPoolAlloc (osMemoryPoolId_t mp_id, uint32_t timeout) {
+  TxMemPool_t *mp = (TxMemPool_t *)mp_id;
+  void *block;
+
+  block = NULL;
+
+  if ((mp != NULL) && (!IS_IRQ() || (timeout == 0U))) {
+    if (tx_block_allocate (&mp->pool, &block, timeout) != TX_SUCCESS) {
+      block = NULL;
+    }
+  }
+
+  return (block);
+}
+
+osStatus_t osMemoryPoolFree (osMemoryPoolId_t mp_id, void *block) {
+  TxMemPool_t *mp = (TxMemPool_t *)mp_id;
+  osStatus_t stat;
+
+  if ((mp == NULL) || (block == NULL)) {
+    stat = osErrorParameter;
+  }
+  else if (((uint8_t *)block < mp->mem_arr) || ((uint8_t *)block >= (mp->mem_arr + mp->mem_sz))) {
+    /* Block pointer outside of memory array area */
+    stat = osErrorParameter;
+  }
+  else {
+    if (tx_block_release (block) == TX_SUCCESS) {
+      stat = osOK;
+    } else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+uint32_t osMemoryPoolGetCapacity (osMemoryPoolId_t mp_id) {
+  TxMemPool_t *mp = (TxMemPool_t *)mp_id;
+  uint32_t n;
+
+  if (mp == NULL) {
+    n = 0U;
+  } else {
+    n = mp->bl_cnt;
+  }
+
+  return (n);
+}
+
+uint32_t osMemoryPoolGetBlockSize (osMemoryPoolId_t mp_id) {
+  TxMemPool_t *mp = (TxMemPool_t *)mp_id;
+  uint32_t sz;
+
+  if (mp == NULL) {
+    sz = 0U;
+  } else {
+    sz = mp->bl_sz;
+  }
+
+  return (sz);
+}
+
+uint32_t osMemoryPoolGetCount (osMemoryPoolId_t mp_id) {
+  TxMemPool_t *mp = (TxMemPool_t *)mp_id;
+  ULONG available;
+  uint32_t n;
+
+  if (mp == NULL) {
+    n = 0U;
+  }
+  else {
+    (void)tx_block_pool_info_get (&mp->pool, TX_NULL, &available, TX_NULL, TX_NULL, TX_NULL, TX_NULL);
+    n = mp->bl_cnt - (uint32_t)available;
+  }
+
+  return (n);
+}
+
+uint32_t osMemoryPoolGetSpace (osMemoryPoolId_t mp_id) {
+  TxMemPool_t *mp = (TxMemPool_t *)mp_id;
+  ULONG available;
+
+  if (mp == NULL) {
+    available = 0U;
+  }
+  else {
+    (void)tx_block_pool_info_get (&mp->pool, TX_NULL, &available, TX_NULL, TX_NULL, TX_NULL, TX_NULL);
+  }
+
+  return ((uint32_t)available);
+}
+
+osStatus_t osMemoryPoolDelete (osMemoryPoolId_t mp_id) {
+  TxMemPool_t *mp = (TxMemPool_t *)mp_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (mp == NULL) {
+    stat = osErrorParameter;
+  }
+  else if (tx_block_pool_delete (&mp->pool) != TX_SUCCESS) {
+    stat = osErrorResource;
+  }
+  else {
+    if ((mp->status & TX_OS2_STATUS_MEM_HEAP) != 0U) {
+      TxOs2MemFree (mp->mem_arr);
+    }
+    if ((mp->status & TX_OS2_STATUS_CB_HEAP) != 0U) {
+      TxOs2MemFree (mp);
+    }
+    stat = osOK;
+  }
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osMessageQueueId_t osMessageQueueNew (uint32_t msg_count, uint32_t msg_size, const osMessageQueueAttr_t *attr) {
+  TxMsgQueue_t *mq;
+  const char *name;
+  uint8_t *mem;
+  uint32_t sz, words, q_sz;
+  int32_t mem_cb, mem_mq;
+  UINT status;
+
+  mq = NULL;
+
+  if (!IS_IRQ() && (msg_count > 0U) && (msg_size > 0U)) {
+    sz     = TX_OS2_MSGQUEUE_ARR_SIZE (msg_count, msg_size);
+    name   = NULL;
+    mem_cb = -1;
+    mem_mq = -1;
+
+    if (attr != NULL) {
+      name = attr->name;
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(TxMsgQueue_t))) {
+        mem_cb = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        mem_cb = 0;
+      }
+
+      if ((attr->mq_mem != NULL) && (attr->mq_size >= sz)) {
+        mem_mq = 1;
+      }
+      else if ((attr->mq_mem == NULL) && (attr->mq_size == 0U)) {
+        mem_mq = 0;
+      }
+    }
+    else {
+      mem_cb = 0;
+      mem_mq = 0;
+    }
+
+    if ((mem_cb != -1) && (mem_mq != -1)) {
+      if (mem_cb == 1) {
+        mq = attr->cb_mem;
+      } else {
+        mq = TxOs2MemAlloc (sizeof(TxMsgQueue_t));
+      }
+    }
+
+    if (mq != NULL) {
+      if (mem_mq == 1) {
+        mem = attr->mq_mem;
+      } else {
+        mem = TxOs2MemAlloc (sz);
+      }
+
+      memset (mq, 0, sizeof(TxMsgQueue_t));
+
+      words = TX_OS2_MSG_WORDS (msg_size);
+
+      if (words > TX_OS2_MSG_WORDS_MAX) {
+        /* Large messages live in pool blocks, only their pointers are queued */
+        words = TX_OS2_MSG_WORDS (sizeof(void *));
+      }
+      q_sz = msg_count * words * sizeof(ULONG);
+
+      status = TX_PTR_ERROR;
+
+      if (mem != NULL) {
+        status = tx_queue_create (&mq->queue, (CHAR *)name, words, mem, q_sz);
+
+        if ((status == TX_SUCCESS) && (sz > q_sz)) {
+          status = tx_block_pool_create (&mq->pool, (CHAR *)name, msg_size, &mem[q_sz], sz - q_sz);
+
+          if (status != TX_SUCCESS) {
+            (void)tx_queue_delete (&mq->queue);
+          }
+        }
+      }
+
+      if (status == TX_SUCCESS) {
+        mq->mem     = mem;
+        mq->msg_sz  = msg_size;
+        mq->msg_cnt = msg_count;
+        mq->words   = (sz > q_sz) ? 0U : words;
+        mq->status  = 0U;
+
+        if (mem_cb == 0) {
+          mq->status |= TX_OS2_STATUS_CB_HEAP;
+        }
+        if (mem_mq == 0) {
+          mq->status |= TX_OS2_STATUS_MEM_HEAP;
+        }
+      }
+      else {
+        /* Message queue cannot be created, release allocated resources */
+        if ((mem_mq == 0) && (mem != NULL)) {
+          TxOs2MemFree (mem);
+        }
+        if (mem_cb == 0) {
+          TxOs2MemFree (mq);
+        }
+        mq = NULL;
+      }
+    }
+  }
+
+  return ((osMessageQueueId_t)mq);
+}
+
+const char *osMessageQueueGetName (osMessageQueueId_t mq_id) {
+  TxMsgQueue_t *mq = (TxMsgQueue_t *)mq_id;
+  const char *p;
+
+  if (IS_IRQ() || (mq == NULL)) {
+    p = NULL;
+  } else {
+    p = mq->queue.tx_queue_name;
+  }
+
+  return (p);
+}
+
+osStatus_t osMessageQueuePut (osMessageQueueId_t mq_id, const void *msg_ptr, uint8_t msg_prio, uint32_t timeout) {
+  TxMsgQueue_t *mq = (TxMsgQueue_t *)mq_id;
+  ULONG buf[TX_OS2_MSG_WORDS_MAX];
+  osStatus_t stat;
+  void *src;
+  void *block;
+  UINT status;
+
+  (void)msg_prio;
+
+  if ((mq == NULL) || (msg_ptr == NULL) || (IS_IRQ() && (timeout != 0U))) {
+    stat = osErrorParameter;
+  }
+  else if (mq->words != 0U) {
+    /* ThreadX copies whole words, bounce odd sized or unaligned messages */
+    if (((mq->msg_sz % sizeof(ULONG)) == 0U) && (((uintptr_t)msg_ptr % sizeof(ULONG)) == 0U)) {
+      src = (void *)(uintptr_t)msg_ptr;
+    } else {
+      memcpy (buf, msg_ptr, mq->msg_sz);
+      src = buf;
+    }
+
+    status = tx_queue_send (&mq->queue, src, timeout);
+
+    if (status == TX_SUCCESS) {
+      stat = osOK;
+    }
+    else if (status == TX_QUEUE_FULL) {
+      stat = WAIT_STATUS(timeout);
+    }
+    else {
+      stat = osErrorResource;
+    }
+  }
+  else {
+    /* Waiting for a free block is waiting for space, the queue itself never fills */
+    status = tx_block_allocate (&mq->pool, &block, timeout);
+
+    if (status == TX_SUCCESS) {
+      memcpy (block, msg_ptr, mq->msg_sz);
+
+      if (tx_queue_send (&mq->queue, &block, TX_NO_WAIT) == TX_SUCCESS) {
+        stat = osOK;
+      } else {
+        (void)tx_block_release (block);
+        stat = osErrorResource;
+      }
+    }
+    else if (status == TX_NO_MEMORY) {
+      stat = WAIT_STATUS(timeout);
+    }
+    else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osMessageQueueGet (osMessageQueueId_t mq_id, void *msg_ptr, uint8_t *msg_prio, uint32_t timeout) {
+  TxMsgQueue_t *mq = (TxMsgQueue_t *)mq_id;
+  ULONG buf[TX_OS2_MSG_WORDS_MAX];
+  osStatus_t stat;
+  void *block;
+  void *dst;
+  UINT status;
+
+  if (msg_prio != NULL) {
+    *msg_prio = 0U;
+  }
+
+  if ((mq == NULL) || (msg_ptr == NULL) || (IS_IRQ() && (timeout != 0U))) {
+    stat = osErrorParameter;
+  }
+  else {
+    if (mq->words == 0U) {
+      dst = &block;
+    }
+    else if (((mq->msg_sz % sizeof(ULONG)) == 0U) && (((uintptr_t)msg_ptr % sizeof(ULONG)) == 0U)) {
+      dst = msg_ptr;
+    }
+    else {
+      dst = buf;
+    }
+
+    status = tx_queue_receive (&mq->queue, dst, timeout);
+
+    if (status == TX_SUCCESS) {
+      stat = osOK;
+
+      if (mq->words == 0U) {
+        /* Copy out of the pool block carrying the message and return it */
+        memcpy (msg_ptr, block, mq->msg_sz);
+        (void)tx_block_release (block);
+      }
+      else if (dst == buf) {
+        memcpy (msg_ptr, buf, mq->msg_sz);
+      }
+    }
+    else if (status == TX_QUEUE_EMPTY) {
+      stat = WAIT_STATUS(timeout);
+    }
+    else {
+      stat = osErrorResource;
+    }
+  }
+
+  return (stat);
+}
+
+uint32_t osMessageQueueGetCapacity (osMessageQueueId_t mq_id) {
+  TxMsgQueue_t *mq = (TxMsgQueue_t *)mq_id;
+  uint32_t capacity;
+
+  if (mq == NULL) {
+    capacity = 0U;
+  } else {
+    capacity = mq->msg_cnt;
+  }
+
+  return (capacity);
+}
+
+uint32_t osMessageQueueGetMsgSize (osMessageQueueId_t mq_id) {
+  TxMsgQueue_t *mq = (TxMsgQueue_t *)mq_id;
+  uint32_t size;
+
+  if (mq == NULL) {
+    size = 0U;
+  } else {
+    size = mq->msg_sz;
+  }
+
+  return (size);
+}
+
+uint32_t osMessageQueueGetCount (osMessageQueueId_t mq_id) {
+  TxMsgQueue_t *mq = (TxMsgQueue_t *)mq_id;
+  ULONG count;
+
+  if (mq == NULL) {
+    count = 0U;
+  }
+  else {
+    (void)tx_queue_info_get (&mq->queue, TX_NULL, &count, TX_NULL, TX_NULL, TX_NULL, TX_NULL);
+  }
+
+  return ((uint32_t)count);
+}
+
+uint32_t osMessageQueueGetSpace (osMessageQueueId_t mq_id) {
+  TxMsgQueue_t *mq = (TxMsgQueue_t *)mq_id;
+  ULONG space;
+
+  if (mq == NULL) {
+    space = 0U;
+  }
+  else if (mq->words == 0U) {
+    /* Space is bounded by free message blocks */
+    (void)tx_block_pool_info_get (&mq->pool, TX_NULL, &space, TX_NULL, TX_NULL, TX_NULL, TX_NULL);
+  }
+  else {
+    (void)tx_queue_info_get (&mq->queue, TX_NULL, TX_NULL, &space, TX_NULL, TX_NULL, TX_NULL);
+  }
+
+  return ((uint32_t)space);
+}
+
+osStatus_t osMessageQueueReset (osMessageQueueId_t mq_id) {
+  TxMsgQueue_t *mq = (TxMsgQueue_t *)mq_id;
+  osStatus_t stat;
+  void *block;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (mq == NULL) {
+    stat = osErrorParameter;
+  }
+  else {
+    stat = osOK;
+
+    if (mq->words == 0U) {
+      /* Queued pointers own pool blocks, hand them back one by one */
+      while (tx_queue_receive (&mq->queue, &block, TX_NO_WAIT) == TX_SUCCESS) {
+        (void)tx_block_release (block);
+      }
+    }
+    else {
+      (void)tx_queue_flush (&mq->queue);
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osMessageQueueDelete (osMessageQueueId_t mq_id) {
+  TxMsgQueue_t *mq = (TxMsgQueue_t *)mq_id;
+  osStatus_t stat;
+
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (mq == NULL) {
+    stat = osErrorParameter;
+  }
+  else if (tx_queue_delete (&mq->queue) != TX_SUCCESS) {
+    stat = osErrorResource;
+  }
+  else {
+    if (mq->words == 0U) {
+      (void)tx_block_pool_delete (&mq->pool);
+    }
+    if ((mq->status & TX_OS2_STATUS_MEM_HEAP) != 0U) {
+      TxOs2MemFree (mq->mem);
+    }
+    if ((mq->status & TX_OS2_STATUS_CB_HEAP) != 0U) {
+      TxOs2MemFree (mq);
+    }
+    stat = osOK;
+  }
+
+  return (stat);
+}
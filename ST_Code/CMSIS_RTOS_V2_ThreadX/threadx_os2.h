@@ -0,0 +1,221 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    threadx_os2.h
+ *      Purpose: CMSIS RTOS2 wrapper for ThreadX
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef THREADX_OS2_H_
+#define THREADX_OS2_H_
+
+#include <string.h>
+#include <stdint.h>
+
+#include "tx_api.h"                     // ThreadX API
+
+#include "cmsis_os2.h"                  // ::CMSIS:RTOS2
+
+#include CMSIS_device_header
+
+/*
+  CMSIS-RTOS2 ThreadX configuration definitions.
+
+  Note: All definitions may be overridden globally or in tx_user.h.
+*/
+
+/*
+  Size of the byte pool used for control blocks, stacks and storage of objects
+  that are created without user provided memory.
+*/
+#ifndef TX_OS2_BYTE_POOL_SIZE
+#define TX_OS2_BYTE_POOL_SIZE           16384U
+#endif
+
+/*
+  Default thread stack size in bytes, used when osThreadAttr_t::stack_size is 0.
+*/
+#ifndef TX_OS2_THREAD_STACK_SIZE
+#define TX_OS2_THREAD_STACK_SIZE        1024U
+#endif
+
+/*
+  Time slice in ticks given to threads created through CMSIS-RTOS2. ThreadX
+  threads run until they block by default; set a tick count to get round-robin
+  scheduling between threads of equal priority as on FreeRTOS.
+*/
+#ifndef TX_OS2_THREAD_TIME_SLICE
+#define TX_OS2_THREAD_TIME_SLICE        TX_NO_TIME_SLICE
+#endif
+
+/*
+  Option to enable the osRefQueue block ownership check (see cmsis_os2_ext.h).
+  Mirrors configUSE_OS2_REFQUEUE_OWNER_CHECK of the FreeRTOS wrapper.
+*/
+#ifndef TX_OS2_REFQUEUE_OWNER_CHECK
+#if defined(DEBUG)
+#define TX_OS2_REFQUEUE_OWNER_CHECK     1
+#else
+#define TX_OS2_REFQUEUE_OWNER_CHECK     0
+#endif
+#endif
+
+/*
+  CMSIS-RTOS2 defines 56 priority levels, numerically higher is more urgent.
+  ThreadX uses lower numbers for more urgent threads, so levels are mirrored
+  onto the top of the ThreadX priority range.
+*/
+#if (TX_MAX_PRIORITIES < 64)
+  #error "CMSIS-RTOS2 on ThreadX requires TX_MAX_PRIORITIES of at least 64 (see tx_user.h)."
+#endif
+
+#define TX_OS2_PRIO_BASE                ((UINT)TX_MAX_PRIORITIES - 1U)
+#define TX_OS2_TO_TX_PRIO(prio)         (TX_OS2_PRIO_BASE - (UINT)(prio))
+#define TX_OS2_FROM_TX_PRIO(prio)       ((osPriority_t)(TX_OS2_PRIO_BASE - (UINT)(prio)))
+
+#ifndef TX_TIMER_TICKS_PER_SECOND
+#define TX_TIMER_TICKS_PER_SECOND       ((ULONG)100)
+#endif
+
+/* Object status flags */
+#define TX_OS2_STATUS_CB_HEAP           1U    /* Control block on heap */
+#define TX_OS2_STATUS_MEM_HEAP          2U    /* Storage on heap       */
+
+/* Largest message ThreadX queues copy directly, in ULONG words */
+#define TX_OS2_MSG_WORDS_MAX            16U
+
+/* Thread control block */
+typedef struct TxThreadDef_t {
+  TX_THREAD             thread;   /* ThreadX thread, must be first */
+  TX_EVENT_FLAGS_GROUP  flags;    /* Thread flags                  */
+  osThreadFunc_t        func;     /* Thread function               */
+  void                 *arg;      /* Thread function argument      */
+  struct TxThreadDef_t *reap;     /* Next exited thread to delete  */
+  uint32_t              attr;     /* Thread attribute bits         */
+  volatile uint32_t     status;   /* Object status flags           */
+} TxThread_t;
+
+/* Timer control block */
+typedef struct TxTimerDef_t {
+  TX_TIMER              timer;    /* ThreadX timer, must be first  */
+  osTimerFunc_t         func;     /* Timer callback function       */
+  void                 *arg;      /* Timer callback argument       */
+  osTimerType_t         type;     /* Once or periodic              */
+  volatile uint32_t     status;   /* Object status flags           */
+} TxTimer_t;
+
+/* Event flags control block */
+typedef struct TxEventFlagsDef_t {
+  TX_EVENT_FLAGS_GROUP  group;    /* ThreadX event flags group     */
+  volatile uint32_t     status;   /* Object status flags           */
+} TxEventFlags_t;
+
+/* Mutex control block */
+typedef struct TxMutexDef_t {
+  TX_MUTEX              mutex;    /* ThreadX mutex                 */
+  uint32_t              attr;     /* Mutex attribute bits          */
+  volatile uint32_t     status;   /* Object status flags           */
+} TxMutex_t;
+
+/* Semaphore control block */
+typedef struct TxSemaphoreDef_t {
+  TX_SEMAPHORE          sem;      /* ThreadX semaphore             */
+  uint32_t              max;      /* Maximum token count           */
+  volatile uint32_t     status;   /* Object status flags           */
+} TxSemaphore_t;
+
+/* Memory pool control block */
+typedef struct TxMemPoolDef_t {
+  TX_BLOCK_POOL         pool;     /* ThreadX block pool            */
+  uint8_t              *mem_arr;  /* Pool memory array             */
+  uint32_t              mem_sz;   /* Pool memory array size        */
+  uint32_t              bl_sz;    /* Size of a single block        */
+  uint32_t              bl_cnt;   /* Number of blocks              */
+  volatile uint32_t     status;   /* Object status flags           */
+} TxMemPool_t;
+
+/* Message queue control block */
+typedef struct TxMsgQueueDef_t {
+  TX_QUEUE              queue;    /* ThreadX queue                 */
+  TX_BLOCK_POOL         pool;     /* Message storage (large only)  */
+  void                 *mem;      /* Queue and pool storage        */
+  uint32_t              msg_sz;   /* Message size in bytes         */
+  uint32_t              msg_cnt;  /* Maximum number of messages    */
+  uint32_t              words;    /* Queue entry size in words     */
+  volatile uint32_t     status;   /* Object status flags           */
+} TxMsgQueue_t;
+
+/* Reference queue control block */
+typedef struct TxRefQueueDef_t {
+  TxMemPool_t           mp;       /* Block pool control block      */
+  TxMsgQueue_t          mq;       /* Block pointer queue           */
+  const char           *name;     /* Pointer to name string        */
+  void * volatile      *owner;    /* Block owner table             */
+  volatile uint32_t     status;   /* Object status flags           */
+} TxRefQueue_t;
+
+/* Fast flags control block */
+typedef struct TxFastFlagsDef_t {
+  TX_EVENT_FLAGS_GROUP  group;    /* ThreadX event flags group     */
+  TX_THREAD            *thread;   /* Waiting (owner) thread        */
+  volatile uint32_t     status;   /* Object status flags           */
+} TxFastFlags_t;
+
+/* Control block sizes to use with the cb_mem/cb_size attributes */
+#define TX_OS2_THREAD_CB_SIZE           (sizeof(TxThread_t))
+#define TX_OS2_TIMER_CB_SIZE            (sizeof(TxTimer_t))
+#define TX_OS2_EVENTFLAGS_CB_SIZE       (sizeof(TxEventFlags_t))
+#define TX_OS2_MUTEX_CB_SIZE            (sizeof(TxMutex_t))
+#define TX_OS2_SEMAPHORE_CB_SIZE        (sizeof(TxSemaphore_t))
+#define TX_OS2_MEMPOOL_CB_SIZE          (sizeof(TxMemPool_t))
+#define TX_OS2_MSGQUEUE_CB_SIZE         (sizeof(TxMsgQueue_t))
+#define TX_OS2_REFQUEUE_CB_SIZE         (sizeof(TxRefQueue_t))
+#define TX_OS2_FASTFLAGS_CB_SIZE        (sizeof(TxFastFlags_t))
+
+/* Define size of a block pool block: data rounded up to words plus the ThreadX block header */
+#define TX_OS2_MEMPOOL_BLOCK_SIZE(bl_size)  \
+  (((((bl_size) + (sizeof(ULONG) - 1U)) / sizeof(ULONG)) * sizeof(ULONG)) + sizeof(UCHAR *))
+
+/* Define size of the byte array required to create count of blocks of given size */
+#define TX_OS2_MEMPOOL_ARR_SIZE(bl_count, bl_size)  \
+  ((bl_count) * TX_OS2_MEMPOOL_BLOCK_SIZE(bl_size))
+
+/* Define size of a message queue entry in ULONG words */
+#define TX_OS2_MSG_WORDS(msg_size)      (((msg_size) + (sizeof(ULONG) - 1U)) / sizeof(ULONG))
+
+/*
+  Define size of the byte array required to queue count of messages of given size.
+  Messages up to TX_OS2_MSG_WORDS_MAX words are copied by the ThreadX queue itself,
+  larger messages are copied into pool blocks and only their pointers are queued.
+*/
+#define TX_OS2_MSGQUEUE_ARR_SIZE(msg_count, msg_size)                                        \
+  ((TX_OS2_MSG_WORDS(msg_size) <= TX_OS2_MSG_WORDS_MAX)                                      \
+    ? ((msg_count) * TX_OS2_MSG_WORDS(msg_size) * sizeof(ULONG))                             \
+    : (((msg_count) * TX_OS2_MSG_WORDS(sizeof(void *)) * sizeof(ULONG)) +                    \
+       TX_OS2_MEMPOOL_ARR_SIZE(msg_count, msg_size)))
+
+/* Define size of the pointer array required to queue count of blocks */
+#define TX_OS2_REFQUEUE_MQ_SIZE(bl_count)     TX_OS2_MSGQUEUE_ARR_SIZE(bl_count, sizeof(void *))
+
+/* Define size of the owner table required to track count of blocks */
+#define TX_OS2_REFQUEUE_OWNER_SIZE(bl_count)  ((bl_count) * sizeof(void *))
+
+/* Byte pool helpers shared by the wrapper modules */
+extern void *TxOs2MemAlloc (uint32_t size);
+extern void  TxOs2MemFree  (void *mem);
+
+#endif /* THREADX_OS2_H_ */
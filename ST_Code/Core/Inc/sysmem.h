@@ -0,0 +1,41 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef SYSMEM_H
+#define SYSMEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Size of the newlib heap region; set with the NEWLIB_HEAP_SIZE CMake cache variable
+#ifndef SYSMEM_HEAP_SIZE
+#define SYSMEM_HEAP_SIZE        (16 * 1024)
+#endif
+
+// newlib heap usage, see SysmemGetStats()
+typedef struct {
+    size_t   heap_size;             // Bytes reserved for the heap
+    size_t   in_use_bytes;          // Bytes in allocated blocks
+    size_t   peak_bytes;            // Most bytes ever claimed by the allocator
+    size_t   free_bytes;            // Bytes available, including unclaimed space
+    size_t   largest_free_block;    // Largest block known to be free
+    uint32_t failures;              // Requests refused for lack of space
+    uint32_t isr_calls;             // Allocator calls from interrupt handlers (unsupported)
+} SysmemStats;
+
+void    SysmemHeapRegion(uint8_t **start, size_t *size);
+void    SysmemGetStats(SysmemStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYSMEM_H */
@@ -0,0 +1,86 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#ifndef TLSF_H
+#define TLSF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Two-level segregated fit allocator.
+ *
+ * Free blocks are kept in size-class lists indexed by a two-level bitmap,
+ * so allocation and release take a bounded number of steps regardless of
+ * heap size or fragmentation. The allocator is not thread safe: callers
+ * serialise access (see heap_tlsf.c and malloc_tlsf.c).
+ */
+
+// Largest block the allocator can manage is 2^TLSF_FL_INDEX_MAX bytes
+#ifndef TLSF_FL_INDEX_MAX
+#define TLSF_FL_INDEX_MAX       20
+#endif
+
+// Number of second-level lists per power of two, as log2
+#ifndef TLSF_SL_INDEX_COUNT_LOG2
+#define TLSF_SL_INDEX_COUNT_LOG2 4
+#endif
+
+// Allocation alignment; matches what newlib guarantees for malloc()
+#define TLSF_ALIGN_SIZE         8U
+
+typedef struct Tlsf Tlsf;
+
+// Heap usage snapshot, see TlsfGetStats()
+typedef struct {
+    size_t   total_bytes;           // Bytes available to allocations after overheads
+    size_t   free_bytes;            // Bytes currently free
+    size_t   min_free_bytes;        // Lowest free_bytes seen since creation
+    size_t   largest_free_block;    // Largest request that can succeed right now
+    size_t   smallest_free_block;
+    uint32_t free_blocks;
+    uint32_t used_blocks;
+    uint32_t alloc_count;           // Successful allocations since creation
+    uint32_t free_count;            // Releases since creation
+    uint32_t fail_count;            // Failed allocations since creation
+    uint32_t fragmentation;         // 0-100: share of free space not in the largest block
+} TlsfStats;
+
+// Called by TlsfWalk() for every block, in address order
+typedef void (*TlsfWalker)(void *ptr, size_t size, bool used, void *user);
+
+Tlsf   *TlsfCreate(void *mem, size_t bytes);
+void   *TlsfMalloc(Tlsf *tlsf, size_t size);
+void    TlsfFree(Tlsf *tlsf, void *ptr);
+void   *TlsfRealloc(Tlsf *tlsf, void *ptr, size_t size);
+size_t  TlsfBlockSize(const void *ptr);
+size_t  TlsfFreeBytes(const Tlsf *tlsf);
+size_t  TlsfMinFreeBytes(const Tlsf *tlsf);
+void    TlsfGetStats(const Tlsf *tlsf, TlsfStats *stats);
+void    TlsfWalk(const Tlsf *tlsf, TlsfWalker walker, void *user);
+int     TlsfCheck(const Tlsf *tlsf);
+
+// FreeRTOS heap backend extras, see heap_tlsf.c
+void    vPortGetHeapTlsfStats(TlsfStats *stats);
+void    vPortWalkHeap(TlsfWalker walker, void *user);
+int     xPortCheckHeap(void);
+
+// newlib malloc backend, see malloc_tlsf.c
+void    TlsfMallocGetStats(TlsfStats *stats);
+void    TlsfMallocWalk(TlsfWalker walker, void *user);
+int     TlsfMallocCheck(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TLSF_H */
@@ -0,0 +1,181 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * FreeRTOS heap backend built on the TLSF allocator: a drop-in alternative
+ * to portable/MemMang/heap_4.c with constant time pvPortMalloc()/vPortFree().
+ * Select it with USE_FreeRTOS_HEAP_TLSF in FreeRTOSConfig.h and build this
+ * file in place of heap_4.c. No target here builds the FreeRTOS kernel, so
+ * neither is selected by default.
+ */
+#include <stdlib.h>
+
+// Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+// all the API functions to use the MPU wrappers
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "tlsf.h"
+
+#if defined(USE_FreeRTOS_HEAP_TLSF)
+
+#if (configSUPPORT_DYNAMIC_ALLOCATION == 0)
+    #error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
+#endif
+
+// The TLSF control structure is taken from the start of the heap array
+#if (configAPPLICATION_ALLOCATED_HEAP == 1)
+    extern uint8_t ucHeap[configTOTAL_HEAP_SIZE];
+#else
+    static uint8_t ucHeap[configTOTAL_HEAP_SIZE] __attribute__((aligned(TLSF_ALIGN_SIZE)));
+#endif
+
+static Tlsf *heap = NULL;
+
+
+/**
+    @brief  Create the heap on first use.
+
+    Must be called with the scheduler suspended.
+ */
+static void HeapTlsfInit(void) {
+    if (heap == NULL) {
+        heap = TlsfCreate(ucHeap, configTOTAL_HEAP_SIZE);
+        configASSERT(heap != NULL);
+    }
+}
+
+
+void *pvPortMalloc(size_t xWantedSize) {
+    void *pvReturn;
+
+    vTaskSuspendAll();
+    {
+        HeapTlsfInit();
+        pvReturn = TlsfMalloc(heap, xWantedSize);
+        traceMALLOC(pvReturn, xWantedSize);
+    }
+    (void)xTaskResumeAll();
+
+    #if (configUSE_MALLOC_FAILED_HOOK == 1)
+    {
+        if (pvReturn == NULL) {
+            extern void vApplicationMallocFailedHook(void);
+            vApplicationMallocFailedHook();
+        }
+    }
+    #endif
+
+    return pvReturn;
+}
+
+
+void vPortFree(void *pv) {
+    if (pv != NULL) {
+        vTaskSuspendAll();
+        {
+            traceFREE(pv, TlsfBlockSize(pv));
+            TlsfFree(heap, pv);
+        }
+        (void)xTaskResumeAll();
+    }
+}
+
+
+size_t xPortGetFreeHeapSize(void) {
+    return heap != NULL ? TlsfFreeBytes(heap) : configTOTAL_HEAP_SIZE;
+}
+
+
+size_t xPortGetMinimumEverFreeHeapSize(void) {
+    return heap != NULL ? TlsfMinFreeBytes(heap) : configTOTAL_HEAP_SIZE;
+}
+
+
+void vPortInitialiseBlocks(void) {
+    // Only required when static memory is not cleared
+}
+
+
+void vPortGetHeapStats(HeapStats_t *pxHeapStats) {
+    TlsfStats stats;
+
+    vTaskSuspendAll();
+    {
+        HeapTlsfInit();
+        TlsfGetStats(heap, &stats);
+    }
+    (void)xTaskResumeAll();
+
+    pxHeapStats->xAvailableHeapSpaceInBytes = stats.free_bytes;
+    pxHeapStats->xSizeOfLargestFreeBlockInBytes = stats.largest_free_block;
+    pxHeapStats->xSizeOfSmallestFreeBlockInBytes = stats.smallest_free_block;
+    pxHeapStats->xNumberOfFreeBlocks = stats.free_blocks;
+    pxHeapStats->xMinimumEverFreeBytesRemaining = stats.min_free_bytes;
+    pxHeapStats->xNumberOfSuccessfulAllocations = stats.alloc_count;
+    pxHeapStats->xNumberOfSuccessfulFrees = stats.free_count;
+}
+
+
+/**
+    @brief  Fragmentation and block level detail beyond HeapStats_t.
+
+    @param  stats   Receives the statistics.
+ */
+void vPortGetHeapTlsfStats(TlsfStats *stats) {
+    vTaskSuspendAll();
+    {
+        HeapTlsfInit();
+        TlsfGetStats(heap, stats);
+    }
+    (void)xTaskResumeAll();
+}
+
+
+/**
+    @brief  Visit every heap block, eg. to dump the heap layout.
+
+    The scheduler stays suspended for the whole walk, so the walker
+    must not block or call into the heap.
+
+    @param  walker  Called for each block in address order.
+    @param  user    Passed through to walker.
+ */
+void vPortWalkHeap(TlsfWalker walker, void *user) {
+    vTaskSuspendAll();
+    {
+        HeapTlsfInit();
+        TlsfWalk(heap, walker, user);
+    }
+    (void)xTaskResumeAll();
+}
+
+
+/**
+    @brief  Check the heap for corruption.
+
+    @return 0 if the heap is consistent, otherwise the number of problems found.
+ */
+int xPortCheckHeap(void) {
+    int errors;
+
+    vTaskSuspendAll();
+    {
+        HeapTlsfInit();
+        errors = TlsfCheck(heap);
+    }
+    (void)xTaskResumeAll();
+
+    return errors;
+}
+
+#endif /* USE_FreeRTOS_HEAP_TLSF */
@@ -0,0 +1,159 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+
+/*
+ * newlib malloc family on the TLSF allocator. Enabled by the USE_TLSF_MALLOC
+ * CMake option, which also forces the linker to take these definitions over
+ * newlib's own. The heap is the sysmem.c region and locking goes through the
+ * same __malloc_lock()/__malloc_unlock() hooks newlib's allocator uses.
+ * memalign() and friends are not provided.
+ */
+#include <errno.h>
+#include <malloc.h>
+#include <reent.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sysmem.h"
+#include "tlsf.h"
+
+#if defined(USE_TLSF_MALLOC)
+
+static Tlsf *malloc_tlsf = NULL;
+
+
+/**
+    @brief  Return the heap, creating it on first use.
+
+    Must be called with the lock held.
+ */
+static Tlsf *MallocHeap(void) {
+    if (malloc_tlsf == NULL) {
+        uint8_t *start;
+        size_t size;
+        SysmemHeapRegion(&start, &size);
+        malloc_tlsf = TlsfCreate(start, size);
+    }
+
+    return malloc_tlsf;
+}
+
+
+void *_malloc_r(struct _reent *r, size_t size) {
+    __malloc_lock(r);
+    void *ptr = TlsfMalloc(MallocHeap(), size);
+    __malloc_unlock(r);
+
+    if (ptr == NULL && size != 0) r->_errno = ENOMEM;
+    return ptr;
+}
+
+
+void _free_r(struct _reent *r, void *ptr) {
+    if (ptr != NULL) {
+        __malloc_lock(r);
+        TlsfFree(MallocHeap(), ptr);
+        __malloc_unlock(r);
+    }
+}
+
+
+void *_realloc_r(struct _reent *r, void *ptr, size_t size) {
+    __malloc_lock(r);
+    void *moved = TlsfRealloc(MallocHeap(), ptr, size);
+    __malloc_unlock(r);
+
+    if (moved == NULL && size != 0) r->_errno = ENOMEM;
+    return moved;
+}
+
+
+void *_calloc_r(struct _reent *r, size_t count, size_t size) {
+    size_t bytes;
+    if (__builtin_mul_overflow(count, size, &bytes)) {
+        r->_errno = ENOMEM;
+        return NULL;
+    }
+
+    void *ptr = _malloc_r(r, bytes);
+    if (ptr != NULL) memset(ptr, 0, bytes);
+    return ptr;
+}
+
+
+size_t _malloc_usable_size_r(struct _reent *r, void *ptr) {
+    (void)r;
+    return TlsfBlockSize(ptr);
+}
+
+
+void *malloc(size_t size) {
+    return _malloc_r(_REENT, size);
+}
+
+
+void free(void *ptr) {
+    _free_r(_REENT, ptr);
+}
+
+
+void *realloc(void *ptr, size_t size) {
+    return _realloc_r(_REENT, ptr, size);
+}
+
+
+void *calloc(size_t count, size_t size) {
+    return _calloc_r(_REENT, count, size);
+}
+
+
+size_t malloc_usable_size(void *ptr) {
+    return TlsfBlockSize(ptr);
+}
+
+
+/**
+    @brief  Collect statistics for the malloc heap.
+
+    @param  stats   Receives the statistics.
+ */
+void TlsfMallocGetStats(TlsfStats *stats) {
+    __malloc_lock(_REENT);
+    TlsfGetStats(MallocHeap(), stats);
+    __malloc_unlock(_REENT);
+}
+
+
+/**
+    @brief  Visit every malloc heap block with the lock held.
+
+    The walker must not allocate or free.
+
+    @param  walker  Called for each block in address order.
+    @param  user    Passed through to walker.
+ */
+void TlsfMallocWalk(TlsfWalker walker, void *user) {
+    __malloc_lock(_REENT);
+    TlsfWalk(MallocHeap(), walker, user);
+    __malloc_unlock(_REENT);
+}
+
+
+/**
+    @brief  Check the malloc heap for corruption.
+
+    @return 0 if the heap is consistent, otherwise the number of problems found.
+ */
+int TlsfMallocCheck(void) {
+    __malloc_lock(_REENT);
+    int errors = TlsfCheck(MallocHeap());
+    __malloc_unlock(_REENT);
+    return errors;
+}
+
+#endif /* USE_TLSF_MALLOC */
@@ -48,11 +48,30 @@
 
 /* Includes */
 #include <errno.h>
+#include <malloc.h>
+#include <reent.h>
+#include <stdint.h>
 #include <stdio.h>
 
+#include "sysmem.h"
+#include "tlsf.h"
+#include "tx_api.h"
+#include CMSIS_device_header
+
 /* Variables */
 extern int errno;
-register char * stack_ptr asm("sp");
+
+/* Dedicated newlib heap. It is a fixed region in its own .bss input section,
+   so the map file shows its size and the limit no longer depends on which
+   thread's stack pointer happens to be live when malloc() runs. */
+static uint8_t sysmem_heap[SYSMEM_HEAP_SIZE] __attribute__((aligned(8), section(".bss.sysmem_heap")));
+static uint8_t *sysmem_break = sysmem_heap;
+static uint8_t *sysmem_peak = sysmem_heap;
+static uint32_t sysmem_failures;
+static uint32_t sysmem_isr_calls;
+
+static TX_MUTEX sysmem_mutex;
+static volatile uint32_t sysmem_mutex_ready;
 
 /* Functions */
 
@@ -62,22 +81,116 @@ register char * stack_ptr asm("sp");
 **/
 caddr_t _sbrk(int incr)
 {
-	extern char end asm("end");
-	static char *heap_end;
-	char *prev_heap_end;
+	uint8_t *prev_break = sysmem_break;
 
-	if (heap_end == 0)
-		heap_end = &end;
-
-	prev_heap_end = heap_end;
-	if (heap_end + incr > stack_ptr)
+	if ((incr > 0 && (size_t)incr > (size_t)(sysmem_heap + SYSMEM_HEAP_SIZE - sysmem_break)) ||
+	    (incr < 0 && (size_t)-incr > (size_t)(sysmem_break - sysmem_heap)))
 	{
+		sysmem_failures++;
 		errno = ENOMEM;
 		return (caddr_t) -1;
 	}
 
-	heap_end += incr;
+	sysmem_break += incr;
+	if (sysmem_break > sysmem_peak)
+		sysmem_peak = sysmem_break;
+
+	return (caddr_t) prev_break;
+}
+
+/**
+ SysmemThreaded
+ True when called from a ThreadX thread once the kernel runs. Before
+ that there is only one context and no locking is needed.
+**/
+static int SysmemThreaded(void)
+{
+	if (__get_IPSR() != 0)
+	{
+		/* The allocator must not be used from interrupt handlers */
+		sysmem_isr_calls++;
+		return 0;
+	}
+
+	return tx_thread_identify() != TX_NULL;
+}
+
+/**
+ __malloc_lock
+ Serialise the allocator between threads. ThreadX mutexes nest for their
+ owner, as newlib requires, and inherit priority so a low priority thread
+ in malloc() cannot stall a high priority one indefinitely.
+**/
+void __malloc_lock(struct _reent *r)
+{
+	(void)r;
+
+	if (!SysmemThreaded())
+		return;
+
+	if (!sysmem_mutex_ready)
+	{
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		if (!sysmem_mutex_ready)
+		{
+			tx_mutex_create(&sysmem_mutex, "newlib heap", TX_INHERIT);
+			sysmem_mutex_ready = 1;
+		}
+		__set_PRIMASK(primask);
+	}
+
+	tx_mutex_get(&sysmem_mutex, TX_WAIT_FOREVER);
+}
+
+/**
+ __malloc_unlock
+**/
+void __malloc_unlock(struct _reent *r)
+{
+	(void)r;
+
+	if (SysmemThreaded() && sysmem_mutex_ready)
+		tx_mutex_put(&sysmem_mutex);
+}
 
-	return (caddr_t) prev_heap_end;
+/**
+ SysmemHeapRegion
+ Report the heap region, for allocators that manage it directly.
+**/
+void SysmemHeapRegion(uint8_t **start, size_t *size)
+{
+	*start = sysmem_heap;
+	*size = SYSMEM_HEAP_SIZE;
 }
 
+/**
+ SysmemGetStats
+ Snapshot of heap usage. Takes the allocator lock, so call it from a thread.
+**/
+void SysmemGetStats(SysmemStats *stats)
+{
+	stats->heap_size = SYSMEM_HEAP_SIZE;
+	stats->isr_calls = sysmem_isr_calls;
+
+#if defined(USE_TLSF_MALLOC)
+	TlsfStats tlsf;
+	TlsfMallocGetStats(&tlsf);
+
+	stats->in_use_bytes = tlsf.total_bytes - tlsf.free_bytes;
+	stats->peak_bytes = tlsf.total_bytes - tlsf.min_free_bytes;
+	stats->free_bytes = tlsf.free_bytes;
+	stats->largest_free_block = tlsf.largest_free_block;
+	stats->failures = tlsf.fail_count;
+#else
+	struct mallinfo info = mallinfo();
+	size_t unclaimed = (size_t)(sysmem_heap + SYSMEM_HEAP_SIZE - sysmem_break);
+
+	/* Space beyond the break is free too, it just has not been claimed yet */
+	stats->in_use_bytes = info.uordblks;
+	stats->peak_bytes = (size_t)(sysmem_peak - sysmem_heap);
+	stats->free_bytes = info.fordblks + unclaimed;
+	stats->largest_free_block = unclaimed;
+	stats->failures = sysmem_failures;
+#endif
+}
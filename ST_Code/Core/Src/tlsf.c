@@ -0,0 +1,582 @@
+/**
+    Twilio Microvisor FreeRTOS Demo
+
+    Copyright © 2021, Twilio
+    License: Apache 2.0
+
+ */
+#include <limits.h>
+#include <string.h>
+
+#include "tlsf.h"
+
+
+/*
+ * Every block starts with a two word header: a pointer to the physically
+ * preceding block and the payload size, whose low bits carry the block's
+ * own free flag and the free flag of the preceding block. Free blocks use
+ * the first two payload words to link into their size-class list. A zero
+ * size, used block terminates the pool so merging never runs off the end.
+ *
+ * Size classes: the first level splits sizes by power of two, the second
+ * level splits each power of two into TLSF_SL_INDEX_COUNT equal ranges.
+ * Sizes below TLSF_SMALL_BLOCK all share first-level index 0, split into
+ * TLSF_ALIGN_SIZE steps.
+ */
+#define TLSF_ALIGN_LOG2         3
+#define TLSF_SL_INDEX_COUNT     (1 << TLSF_SL_INDEX_COUNT_LOG2)
+#define TLSF_FL_INDEX_SHIFT     (TLSF_SL_INDEX_COUNT_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_FL_INDEX_COUNT     (TLSF_FL_INDEX_MAX - TLSF_FL_INDEX_SHIFT + 1)
+#define TLSF_SMALL_BLOCK        ((size_t)1 << TLSF_FL_INDEX_SHIFT)
+
+#define TLSF_BLOCK_FREE         ((size_t)1)
+#define TLSF_BLOCK_PREV_FREE    ((size_t)2)
+#define TLSF_BLOCK_FLAGS        (TLSF_BLOCK_FREE | TLSF_BLOCK_PREV_FREE)
+
+#define TLSF_ALIGN_UP(x)        (((x) + (TLSF_ALIGN_SIZE - 1)) & ~(size_t)(TLSF_ALIGN_SIZE - 1))
+#define TLSF_ALIGN_DOWN(x)      ((x) & ~(size_t)(TLSF_ALIGN_SIZE - 1))
+
+typedef struct TlsfBlock {
+    struct TlsfBlock *prev_phys;
+    size_t            size;
+    // Only valid while the block is free
+    struct TlsfBlock *next_free;
+    struct TlsfBlock *prev_free;
+} TlsfBlock;
+
+#define TLSF_BLOCK_OVERHEAD     offsetof(TlsfBlock, next_free)
+#define TLSF_BLOCK_SIZE_MIN     TLSF_ALIGN_UP(sizeof(TlsfBlock) - TLSF_BLOCK_OVERHEAD)
+#define TLSF_BLOCK_SIZE_MAX     (((size_t)1 << TLSF_FL_INDEX_MAX) - TLSF_ALIGN_SIZE)
+
+_Static_assert(TLSF_SL_INDEX_COUNT <= 32, "second-level bitmap is 32 bits wide");
+_Static_assert(TLSF_FL_INDEX_COUNT > 0 && TLSF_FL_INDEX_COUNT <= 32, "first-level bitmap is 32 bits wide");
+_Static_assert((TLSF_BLOCK_OVERHEAD % TLSF_ALIGN_SIZE) == 0, "block header must keep payloads aligned");
+
+struct Tlsf {
+    uint32_t   fl_bitmap;
+    uint32_t   sl_bitmap[TLSF_FL_INDEX_COUNT];
+    TlsfBlock *blocks[TLSF_FL_INDEX_COUNT][TLSF_SL_INDEX_COUNT];
+    TlsfBlock *first;
+    TlsfBlock *last;            // Zero size terminator
+    size_t     total_bytes;
+    size_t     free_bytes;
+    size_t     min_free_bytes;
+    uint32_t   alloc_count;
+    uint32_t   free_count;
+    uint32_t   fail_count;
+};
+
+
+/*
+ * BIT SCANS
+ */
+
+static inline int TlsfFls(size_t value) {
+    return (int)(sizeof(unsigned long) * CHAR_BIT) - 1 - __builtin_clzl((unsigned long)value);
+}
+
+static inline int TlsfFfs(uint32_t value) {
+    return __builtin_ctz(value);
+}
+
+
+/*
+ * BLOCK HELPERS
+ */
+
+static inline size_t TlsfBlockPayload(const TlsfBlock *block) {
+    return block->size & ~TLSF_BLOCK_FLAGS;
+}
+
+static inline bool TlsfBlockIsFree(const TlsfBlock *block) {
+    return (block->size & TLSF_BLOCK_FREE) != 0;
+}
+
+static inline bool TlsfBlockIsPrevFree(const TlsfBlock *block) {
+    return (block->size & TLSF_BLOCK_PREV_FREE) != 0;
+}
+
+static inline TlsfBlock *TlsfBlockNext(const TlsfBlock *block) {
+    return (TlsfBlock *)((uint8_t *)block + TLSF_BLOCK_OVERHEAD + TlsfBlockPayload(block));
+}
+
+static inline void *TlsfBlockToPtr(const TlsfBlock *block) {
+    return (uint8_t *)block + TLSF_BLOCK_OVERHEAD;
+}
+
+static inline TlsfBlock *TlsfBlockFromPtr(const void *ptr) {
+    return (TlsfBlock *)((uint8_t *)ptr - TLSF_BLOCK_OVERHEAD);
+}
+
+
+/**
+    @brief  Map a block size to the list that holds blocks of that size.
+
+    @param  size    The payload size.
+    @param  fl      Receives the first-level index.
+    @param  sl      Receives the second-level index.
+ */
+static inline void TlsfMappingInsert(size_t size, int *fl, int *sl) {
+    if (size < TLSF_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (int)(size / (TLSF_SMALL_BLOCK / TLSF_SL_INDEX_COUNT));
+    } else {
+        int f = TlsfFls(size);
+        *sl = (int)(size >> (f - TLSF_SL_INDEX_COUNT_LOG2)) ^ TLSF_SL_INDEX_COUNT;
+        *fl = f - (TLSF_FL_INDEX_SHIFT - 1);
+    }
+}
+
+
+/**
+    @brief  Map a request to the first list whose blocks are all large enough.
+
+    Rounding the request up to the next list boundary is what makes the
+    search a pair of bit scans rather than a list walk.
+
+    @param  size    The payload size wanted.
+    @param  fl      Receives the first-level index.
+    @param  sl      Receives the second-level index.
+ */
+static inline void TlsfMappingSearch(size_t size, int *fl, int *sl) {
+    if (size >= TLSF_SMALL_BLOCK) {
+        size += ((size_t)1 << (TlsfFls(size) - TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+    }
+
+    TlsfMappingInsert(size, fl, sl);
+}
+
+
+/**
+    @brief  Find a free block at least as large as list (fl, sl) guarantees.
+
+    @param  tlsf    The heap.
+    @param  fl      First-level index; updated to the list actually used.
+    @param  sl      Second-level index; updated to the list actually used.
+
+    @return The head of a suitable list, or NULL when the heap is exhausted.
+ */
+static TlsfBlock *TlsfFindSuitable(const Tlsf *tlsf, int *fl, int *sl) {
+    if (*fl >= TLSF_FL_INDEX_COUNT) return NULL;
+
+    uint32_t sl_map = tlsf->sl_bitmap[*fl] & (~0U << *sl);
+    if (sl_map == 0) {
+        // Nothing left at this power of two, move to the next non-empty one
+        uint32_t fl_map = (*fl + 1 < 32) ? (tlsf->fl_bitmap & (~0U << (*fl + 1))) : 0;
+        if (fl_map == 0) return NULL;
+
+        *fl = TlsfFfs(fl_map);
+        sl_map = tlsf->sl_bitmap[*fl];
+    }
+
+    *sl = TlsfFfs(sl_map);
+    return tlsf->blocks[*fl][*sl];
+}
+
+
+static void TlsfInsertFree(Tlsf *tlsf, TlsfBlock *block) {
+    int fl, sl;
+    TlsfMappingInsert(TlsfBlockPayload(block), &fl, &sl);
+
+    TlsfBlock *head = tlsf->blocks[fl][sl];
+    block->prev_free = NULL;
+    block->next_free = head;
+    if (head != NULL) head->prev_free = block;
+    tlsf->blocks[fl][sl] = block;
+
+    tlsf->fl_bitmap |= 1U << fl;
+    tlsf->sl_bitmap[fl] |= 1U << sl;
+    tlsf->free_bytes += TlsfBlockPayload(block);
+}
+
+
+static void TlsfRemoveFree(Tlsf *tlsf, TlsfBlock *block) {
+    int fl, sl;
+    TlsfMappingInsert(TlsfBlockPayload(block), &fl, &sl);
+
+    if (block->prev_free != NULL) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        tlsf->blocks[fl][sl] = block->next_free;
+    }
+
+    if (block->next_free != NULL) block->next_free->prev_free = block->prev_free;
+
+    if (tlsf->blocks[fl][sl] == NULL) {
+        tlsf->sl_bitmap[fl] &= ~(1U << sl);
+        if (tlsf->sl_bitmap[fl] == 0) tlsf->fl_bitmap &= ~(1U << fl);
+    }
+
+    tlsf->free_bytes -= TlsfBlockPayload(block);
+}
+
+
+/**
+    @brief  Trim a used block to size, returning any usable tail to the heap.
+
+    @param  tlsf    The heap.
+    @param  block   A used block of at least size bytes.
+    @param  size    The payload size to keep, already aligned.
+ */
+static void TlsfTrim(Tlsf *tlsf, TlsfBlock *block, size_t size) {
+    size_t payload = TlsfBlockPayload(block);
+    if (payload < size + TLSF_BLOCK_OVERHEAD + TLSF_BLOCK_SIZE_MIN) return;
+
+    TlsfBlock *rest = (TlsfBlock *)((uint8_t *)block + TLSF_BLOCK_OVERHEAD + size);
+    rest->prev_phys = block;
+    rest->size = (payload - size - TLSF_BLOCK_OVERHEAD) | TLSF_BLOCK_FREE;
+    block->size = size | (block->size & TLSF_BLOCK_FLAGS);
+
+    // A shrinking realloc can leave the tail next to a free block
+    TlsfBlock *next = TlsfBlockNext(rest);
+    if (TlsfBlockIsFree(next)) {
+        TlsfRemoveFree(tlsf, next);
+        rest->size += TLSF_BLOCK_OVERHEAD + TlsfBlockPayload(next);
+        next = TlsfBlockNext(rest);
+    }
+
+    next->prev_phys = rest;
+    next->size |= TLSF_BLOCK_PREV_FREE;
+    TlsfInsertFree(tlsf, rest);
+}
+
+
+/**
+    @brief  Round a request up to a valid payload size.
+
+    @param  size    The requested size.
+
+    @return The payload size, or 0 if the request cannot be met.
+ */
+static inline size_t TlsfAdjustSize(size_t size) {
+    if (size == 0 || size > TLSF_BLOCK_SIZE_MAX) return 0;
+
+    size = TLSF_ALIGN_UP(size);
+    return size < TLSF_BLOCK_SIZE_MIN ? TLSF_BLOCK_SIZE_MIN : size;
+}
+
+
+/*
+ * PUBLIC API
+ */
+
+/**
+    @brief  Build a heap inside a caller supplied memory region.
+
+    The control structure lives at the start of the region, the rest
+    becomes a single free block.
+
+    @param  mem     The memory region.
+    @param  bytes   The size of the region.
+
+    @return The heap, or NULL if the region is too small.
+ */
+Tlsf *TlsfCreate(void *mem, size_t bytes) {
+    uintptr_t start = TLSF_ALIGN_UP((uintptr_t)mem);
+    uintptr_t end = TLSF_ALIGN_DOWN((uintptr_t)mem + bytes);
+    uintptr_t pool = TLSF_ALIGN_UP(start + sizeof(Tlsf));
+
+    // Room for the control structure, one minimum block and the terminator
+    if (end < pool || (end - pool) < 2 * TLSF_BLOCK_OVERHEAD + TLSF_BLOCK_SIZE_MIN) return NULL;
+
+    Tlsf *tlsf = (Tlsf *)start;
+    memset(tlsf, 0, sizeof(Tlsf));
+
+    size_t payload = (size_t)(end - pool) - 2 * TLSF_BLOCK_OVERHEAD;
+    if (payload > TLSF_BLOCK_SIZE_MAX) payload = TLSF_BLOCK_SIZE_MAX;
+
+    TlsfBlock *block = (TlsfBlock *)pool;
+    block->prev_phys = NULL;
+    block->size = payload | TLSF_BLOCK_FREE;
+
+    TlsfBlock *last = TlsfBlockNext(block);
+    last->prev_phys = block;
+    last->size = TLSF_BLOCK_PREV_FREE;
+
+    tlsf->first = block;
+    tlsf->last = last;
+    tlsf->total_bytes = payload;
+    TlsfInsertFree(tlsf, block);
+    tlsf->min_free_bytes = tlsf->free_bytes;
+    return tlsf;
+}
+
+
+/**
+    @brief  Allocate a block in constant time.
+
+    @param  tlsf    The heap.
+    @param  size    The number of bytes wanted.
+
+    @return Pointer to TLSF_ALIGN_SIZE aligned memory, or NULL.
+ */
+void *TlsfMalloc(Tlsf *tlsf, size_t size) {
+    size_t adjusted = TlsfAdjustSize(size);
+    if (adjusted == 0) {
+        if (size != 0) tlsf->fail_count++;
+        return NULL;
+    }
+
+    int fl, sl;
+    TlsfMappingSearch(adjusted, &fl, &sl);
+    TlsfBlock *block = TlsfFindSuitable(tlsf, &fl, &sl);
+    if (block == NULL) {
+        tlsf->fail_count++;
+        return NULL;
+    }
+
+    TlsfRemoveFree(tlsf, block);
+    block->size &= ~TLSF_BLOCK_FREE;
+    TlsfBlockNext(block)->size &= ~TLSF_BLOCK_PREV_FREE;
+    TlsfTrim(tlsf, block, adjusted);
+
+    tlsf->alloc_count++;
+    if (tlsf->free_bytes < tlsf->min_free_bytes) tlsf->min_free_bytes = tlsf->free_bytes;
+    return TlsfBlockToPtr(block);
+}
+
+
+/**
+    @brief  Release a block in constant time, merging it with free neighbours.
+
+    @param  tlsf    The heap.
+    @param  ptr     A pointer returned by TlsfMalloc() or TlsfRealloc(), or NULL.
+ */
+void TlsfFree(Tlsf *tlsf, void *ptr) {
+    if (ptr == NULL) return;
+
+    TlsfBlock *block = TlsfBlockFromPtr(ptr);
+
+    // Ignore double frees rather than corrupt the lists
+    if (TlsfBlockIsFree(block)) return;
+
+    block->size |= TLSF_BLOCK_FREE;
+    TlsfBlock *next = TlsfBlockNext(block);
+    next->size |= TLSF_BLOCK_PREV_FREE;
+
+    if (TlsfBlockIsPrevFree(block)) {
+        TlsfBlock *prev = block->prev_phys;
+        TlsfRemoveFree(tlsf, prev);
+        prev->size += TLSF_BLOCK_OVERHEAD + TlsfBlockPayload(block);
+        next->prev_phys = prev;
+        block = prev;
+    }
+
+    if (TlsfBlockIsFree(next)) {
+        TlsfRemoveFree(tlsf, next);
+        block->size += TLSF_BLOCK_OVERHEAD + TlsfBlockPayload(next);
+        TlsfBlockNext(block)->prev_phys = block;
+    }
+
+    TlsfInsertFree(tlsf, block);
+    tlsf->free_count++;
+}
+
+
+/**
+    @brief  Resize a block, in place when the following block allows it.
+
+    @param  tlsf    The heap.
+    @param  ptr     The block to resize, or NULL to allocate.
+    @param  size    The new size; 0 frees the block.
+
+    @return The resized block, or NULL with ptr untouched on failure.
+ */
+void *TlsfRealloc(Tlsf *tlsf, void *ptr, size_t size) {
+    if (ptr == NULL) return TlsfMalloc(tlsf, size);
+
+    if (size == 0) {
+        TlsfFree(tlsf, ptr);
+        return NULL;
+    }
+
+    size_t adjusted = TlsfAdjustSize(size);
+    if (adjusted == 0) {
+        tlsf->fail_count++;
+        return NULL;
+    }
+
+    TlsfBlock *block = TlsfBlockFromPtr(ptr);
+    size_t current = TlsfBlockPayload(block);
+
+    if (adjusted <= current) {
+        TlsfTrim(tlsf, block, adjusted);
+        return ptr;
+    }
+
+    TlsfBlock *next = TlsfBlockNext(block);
+    if (TlsfBlockIsFree(next) && current + TLSF_BLOCK_OVERHEAD + TlsfBlockPayload(next) >= adjusted) {
+        TlsfRemoveFree(tlsf, next);
+        block->size += TLSF_BLOCK_OVERHEAD + TlsfBlockPayload(next);
+        next = TlsfBlockNext(block);
+        next->prev_phys = block;
+        next->size &= ~TLSF_BLOCK_PREV_FREE;
+        TlsfTrim(tlsf, block, adjusted);
+
+        if (tlsf->free_bytes < tlsf->min_free_bytes) tlsf->min_free_bytes = tlsf->free_bytes;
+        return ptr;
+    }
+
+    void *moved = TlsfMalloc(tlsf, size);
+    if (moved != NULL) {
+        memcpy(moved, ptr, current);
+        TlsfFree(tlsf, ptr);
+    }
+
+    return moved;
+}
+
+
+/**
+    @brief  Usable size of an allocated block.
+
+    @param  ptr     A pointer returned by TlsfMalloc() or TlsfRealloc().
+
+    @return The payload size, which may exceed the size requested.
+ */
+size_t TlsfBlockSize(const void *ptr) {
+    return ptr != NULL ? TlsfBlockPayload(TlsfBlockFromPtr(ptr)) : 0;
+}
+
+
+/**
+    @brief  Bytes currently free, in constant time.
+
+    @param  tlsf    The heap.
+
+    @return The sum of all free block payloads.
+ */
+size_t TlsfFreeBytes(const Tlsf *tlsf) {
+    return tlsf->free_bytes;
+}
+
+
+/**
+    @brief  Lowest free byte count since the heap was created.
+
+    @param  tlsf    The heap.
+
+    @return The free space low-water mark.
+ */
+size_t TlsfMinFreeBytes(const Tlsf *tlsf) {
+    return tlsf->min_free_bytes;
+}
+
+
+/**
+    @brief  Collect heap statistics.
+
+    Walks every block, so the cost is proportional to the number of blocks:
+    call it from diagnostics, not from time critical code.
+
+    @param  tlsf    The heap.
+    @param  stats   Receives the statistics.
+ */
+void TlsfGetStats(const Tlsf *tlsf, TlsfStats *stats) {
+    memset(stats, 0, sizeof(TlsfStats));
+    stats->total_bytes = tlsf->total_bytes;
+    stats->free_bytes = tlsf->free_bytes;
+    stats->min_free_bytes = tlsf->min_free_bytes;
+    stats->alloc_count = tlsf->alloc_count;
+    stats->free_count = tlsf->free_count;
+    stats->fail_count = tlsf->fail_count;
+
+    for (const TlsfBlock *block = tlsf->first; block < tlsf->last; block = TlsfBlockNext(block)) {
+        size_t payload = TlsfBlockPayload(block);
+        if (!TlsfBlockIsFree(block)) {
+            stats->used_blocks++;
+            continue;
+        }
+
+        stats->free_blocks++;
+        if (payload > stats->largest_free_block) stats->largest_free_block = payload;
+        if (stats->smallest_free_block == 0 || payload < stats->smallest_free_block) {
+            stats->smallest_free_block = payload;
+        }
+    }
+
+    if (stats->free_bytes > 0) {
+        stats->fragmentation = 100U - (uint32_t)(((uint64_t)stats->largest_free_block * 100U) / stats->free_bytes);
+    }
+}
+
+
+/**
+    @brief  Visit every block in address order.
+
+    @param  tlsf    The heap.
+    @param  walker  Called with each block's payload pointer, size and state.
+    @param  user    Passed through to walker.
+ */
+void TlsfWalk(const Tlsf *tlsf, TlsfWalker walker, void *user) {
+    for (const TlsfBlock *block = tlsf->first; block < tlsf->last; block = TlsfBlockNext(block)) {
+        walker(TlsfBlockToPtr(block), TlsfBlockPayload(block), !TlsfBlockIsFree(block), user);
+    }
+}
+
+
+/**
+    @brief  Verify the heap's internal consistency.
+
+    Checks the physical block chain, the free flags, the size-class lists
+    and the bitmaps against each other. Intended for debug builds and tests
+    chasing heap corruption.
+
+    @param  tlsf    The heap.
+
+    @return 0 if the heap is consistent, otherwise the number of problems found.
+ */
+int TlsfCheck(const Tlsf *tlsf) {
+    int errors = 0;
+    uint32_t free_blocks = 0;
+    size_t free_bytes = 0;
+
+    // Physical chain: links, flags and coalescing
+    const TlsfBlock *prev = NULL;
+    const TlsfBlock *block = tlsf->first;
+    while (block < tlsf->last) {
+        if (block->prev_phys != prev) errors++;
+        if (TlsfBlockIsPrevFree(block) != (prev != NULL && TlsfBlockIsFree(prev))) errors++;
+        if (TlsfBlockPayload(block) < TLSF_BLOCK_SIZE_MIN) errors++;
+
+        if (TlsfBlockIsFree(block)) {
+            // Adjacent free blocks should always have been merged
+            if (prev != NULL && TlsfBlockIsFree(prev)) errors++;
+            free_blocks++;
+            free_bytes += TlsfBlockPayload(block);
+        }
+
+        prev = block;
+        block = TlsfBlockNext(block);
+    }
+
+    // Walking past the terminator means a corrupt size field
+    if (block != tlsf->last || tlsf->last->prev_phys != prev) {
+        return errors + 1;
+    }
+
+    // Size-class lists and bitmaps
+    uint32_t listed = 0;
+    for (int fl = 0; fl < TLSF_FL_INDEX_COUNT; fl++) {
+        if (((tlsf->fl_bitmap >> fl) & 1U) != (tlsf->sl_bitmap[fl] != 0)) errors++;
+
+        for (int sl = 0; sl < TLSF_SL_INDEX_COUNT; sl++) {
+            const TlsfBlock *entry = tlsf->blocks[fl][sl];
+            if (((tlsf->sl_bitmap[fl] >> sl) & 1U) != (entry != NULL)) errors++;
+
+            const TlsfBlock *link = NULL;
+            for (; entry != NULL && listed <= free_blocks; entry = entry->next_free) {
+                int efl, esl;
+                TlsfMappingInsert(TlsfBlockPayload(entry), &efl, &esl);
+                if (!TlsfBlockIsFree(entry) || efl != fl || esl != sl) errors++;
+                if (entry->prev_free != link) errors++;
+                link = entry;
+                listed++;
+            }
+        }
+    }
+
+    if (listed != free_blocks) errors++;
+    if (free_bytes != tlsf->free_bytes) errors++;
+    return errors;
+}
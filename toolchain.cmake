@@ -5,9 +5,18 @@ set(CMAKE_C_COMPILER arm-none-eabi-gcc CACHE FILEPATH "C compiler")
 set(CMAKE_CXX_COMPILER arm-none-eabi-g++ CACHE FILEPATH "C++ compiler")
 set(CMAKE_C_OUTPUT_EXTENSION .o)
 
+# cmake -DENABLE_HARD_FLOAT=ON: FP instructions and the hard-float ABI for
+# every target, libc included. The ABIs do not link together, so this
+# switches the whole build; configure a separate build directory for it
+if(ENABLE_HARD_FLOAT)
+  set(FLOAT_ABI "hard")
+else()
+  set(FLOAT_ABI "soft")
+endif()
+
 set(CMAKE_C_LINK_EXECUTABLE "<CMAKE_C_COMPILER> -Wl,-Map=<TARGET>.map <CMAKE_C_LINK_FLAGS> <LINK_FLAGS> <OBJECTS>  -o <TARGET> <LINK_LIBRARIES>")
 set(CMAKE_ASM_COMPILER arm-none-eabi-gcc CACHE FILEPATH "ASM compiler")
-set(CMAKE_ASM_COMPILE_OBJECT "<CMAKE_ASM_COMPILER> -mcpu=cortex-m33 -DTX_SINGLE_MODE_NON_SECURE <DEFINES> <INCLUDES> <FLAGS> -o <OBJECT> -c <SOURCE>")
+set(CMAKE_ASM_COMPILE_OBJECT "<CMAKE_ASM_COMPILER> -mcpu=cortex-m33 -mfpu=fpv5-sp-d16 -mfloat-abi=${FLOAT_ABI} -DTX_SINGLE_MODE_NON_SECURE <DEFINES> <INCLUDES> <FLAGS> -o <OBJECT> -c <SOURCE>")
 set(CMAKE_INCLUDE_FLAG_ASM "-I")
 set(CMAKE_OBJCOPY arm-none-eabi-objcopy CACHE FILEPATH "")
 set(CMAKE_OBJDUMP arm-none-eabi-objdump CACHE FILEPATH "")
@@ -19,11 +28,16 @@ set(CMAKE_CXX_COMPILER_WORKS ON)
 set(CMAKE_C_FLAGS "-mcpu=cortex-m33 -std=gnu11 -g3 \
   -DUSE_CUSTOM_SYSTICK_HANDLER_IMPLEMENTATION -DUSE_HAL_DRIVER -DSTM32L552xx \
   -DSTM32U585xx -DDEBUG -DCMSIS_device_header=\\\"stm32u585xx.h\\\" -DTX_SINGLE_MODE_NON_SECURE \
-  -c -O0 -ffunction-sections -fdata-sections -Wall -fstack-usage \
-  -MMD -MP --specs=nano.specs -mfpu=fpv5-sp-d16 -mfloat-abi=soft -mthumb")
+  -c -O0 -ffunction-sections -fdata-sections -Wall -fstack-usage -fcallgraph-info=su \
+  -MMD -MP --specs=nano.specs -mfpu=fpv5-sp-d16 -mfloat-abi=${FLOAT_ABI} -mthumb")
+
+# The FPU is single precision: flag doubles that would fall back to software
+if(ENABLE_HARD_FLOAT)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -Wdouble-promotion")
+endif()
 
 set(CMAKE_C_LINK_FLAGS "-mcpu=cortex-m33 --specs=nosys.specs -Wl,--gc-sections -static \
-  -Wl,--start-group -lc -lm -Wl,--end-group -mfloat-abi=soft" CACHE INTERNAL "")
+  -Wl,--start-group -lc -lm -Wl,--end-group -mfpu=fpv5-sp-d16 -mfloat-abi=${FLOAT_ABI}" CACHE INTERNAL "")
 
 set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
 set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
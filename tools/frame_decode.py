@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Decode the framed records the firmware writes to the Microvisor log
+channel with ServerLogFrame() (see Demo/Inc/frame.h).
+
+Reads the raw channel stream on stdin or from files. Text log lines
+around the frames are skipped. Each frame's CRC is checked; a frame that
+fails is reported and the search for the next one restarts a byte on, so
+one damaged record does not take the rest with it:
+
+    <device log stream> | tools/frame_decode.py
+    tools/frame_decode.py saved.bin --payload
+    tools/frame_decode.py saved.bin --type 2 --quiet
+
+The exit status is 1 if any frame failed its check or was cut short.
+
+Copyright (c) 2021, Twilio
+License: Apache 2.0
+"""
+
+import argparse
+import binascii
+import struct
+import sys
+import zlib
+
+SYNC = b"\xa5\x5a"
+FORMAT_VERSION = 1
+
+HEADER = struct.Struct("<2sHBBH")
+TRAILER = struct.Struct("<I")
+
+TYPE_NAMES = {1: "text", 2: "telemetry"}
+
+
+class Frame:
+    def __init__(self, offset, length, type_, sequence, payload):
+        self.offset = offset
+        self.length = length
+        self.type = type_
+        self.sequence = sequence
+        self.payload = payload
+
+    @property
+    def type_name(self):
+        return TYPE_NAMES.get(self.type, str(self.type))
+
+
+def scan(data):
+    """Yield (status, frame) for each frame in the stream, in order.
+
+    status is "ok", "crc" for a frame whose CRC does not match (its fields
+    may be garbage) or "short" for one the stream ends inside.
+    """
+    offset = data.find(SYNC)
+    while offset >= 0:
+        if offset + HEADER.size > len(data):
+            yield "short", Frame(offset, 0, 0, 0, b"")
+            return
+
+        _, length, type_, version, sequence = HEADER.unpack_from(data, offset)
+        end = offset + HEADER.size + length
+        frame = Frame(offset, length, type_, sequence, data[offset + HEADER.size:end])
+
+        if version != FORMAT_VERSION:
+            # Not a frame: a sync pattern inside text or a damaged header
+            offset = data.find(SYNC, offset + 1)
+            continue
+
+        if end + TRAILER.size > len(data):
+            # May also be a damaged length; look for later frames
+            yield "short", frame
+            offset = data.find(SYNC, offset + 1)
+            continue
+
+        (crc,) = TRAILER.unpack_from(data, end)
+        if zlib.crc32(data[offset:end]) != crc:
+            yield "crc", frame
+            offset = data.find(SYNC, offset + 1)
+            continue
+
+        yield "ok", frame
+        offset = data.find(SYNC, end + TRAILER.size)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode and check framed log channel records")
+    parser.add_argument("files", nargs="*", help="raw channel captures (default: stdin)")
+    parser.add_argument("--type", type=int, help="only list frames of this type")
+    parser.add_argument("--payload", action="store_true", help="print each good frame's payload in hex")
+    parser.add_argument("--quiet", action="store_true", help="print the summary only")
+    args = parser.parse_args()
+
+    if args.files:
+        data = b""
+        for path in args.files:
+            with open(path, "rb") as capture:
+                data += capture.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    counts = {"ok": 0, "crc": 0, "short": 0}
+    gaps = 0
+    expected = None
+
+    for status, frame in scan(data):
+        counts[status] += 1
+
+        if status == "ok":
+            # Sequence numbers are 16 bits and wrap
+            if expected is not None and frame.sequence != expected:
+                gaps += 1
+                if not args.quiet:
+                    print("gap: expected sequence %d, got %d" % (expected, frame.sequence))
+            expected = (frame.sequence + 1) & 0xFFFF
+
+        if args.quiet or (args.type is not None and frame.type != args.type and status == "ok"):
+            continue
+
+        if status == "ok":
+            print("%8d  seq %5d  %-10s %6d bytes" % (frame.offset, frame.sequence, frame.type_name, frame.length))
+            if args.payload:
+                print("          %s" % binascii.hexlify(frame.payload).decode())
+        else:
+            print("%8d  %s" % (frame.offset, "bad CRC" if status == "crc" else "cut short"))
+
+    print("%d good, %d bad CRC, %d cut short, %d sequence gaps" % (
+        counts["ok"], counts["crc"], counts["short"], gaps), file=sys.stderr)
+
+    return 1 if counts["crc"] or counts["short"] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
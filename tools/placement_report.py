@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+Report where each function was placed, from the linker map that the build
+writes next to the .elf (<target>.map). Functions marked RAMFUNC
+(Demo/Inc/ramfunc.h, built with -DENABLE_RAMFUNC=ON) should show up in
+SRAM; everything else runs from flash.
+
+    tools/placement_report.py build/Demo/gpio_toggle_demo-threadx.elf.map
+    tools/placement_report.py build/Demo/gpio_toggle_demo-threadx.elf.map --all
+    tools/placement_report.py build/Demo/gpio_toggle_demo-threadx.elf.map \\
+        --expect TIM6_IRQHandler,TimebaseGetMicros
+
+With --expect, the exit status is 1 if any listed function is not in SRAM.
+
+Copyright (c) 2021, Twilio
+License: Apache 2.0
+"""
+
+import argparse
+import re
+import sys
+
+# Input section line: name, then address, size and object, which ld moves
+# to the next line when the name is long
+SECTION_LINE = re.compile(r"^ (\.(?:text|ramfunc)\.\S+)(?:\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S+))?\s*$")
+CONTINUATION_LINE = re.compile(r"^\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S+)\s*$")
+SYMBOL_LINE = re.compile(r"^\s+(0x[0-9a-f]+)\s+([A-Za-z_]\w*)\s*$")
+
+SRAM_START = 0x20000000
+SRAM_END = 0x40000000
+
+
+class Function:
+    def __init__(self, section, address, size, obj):
+        self.section = section
+        self.address = address
+        self.size = size
+        self.obj = obj.rsplit("/", 1)[-1]
+        self.names = []
+
+    @property
+    def in_sram(self):
+        return SRAM_START <= self.address < SRAM_END
+
+    @property
+    def name(self):
+        if self.names:
+            return ",".join(self.names)
+        # Static functions have no symbol line in the map
+        if self.section.startswith(".text."):
+            return self.section[len(".text."):]
+        return "(static, line %s)" % self.section.rsplit(".", 1)[-1]
+
+
+def parse(path):
+    """Return the linked code input sections of the map, in map order."""
+    functions = []
+    pending = None
+    current = None
+    in_map = False
+
+    with open(path) as map_file:
+        for line in map_file:
+            if line.startswith("Linker script and memory map"):
+                in_map = True
+                continue
+            if not in_map:
+                continue
+
+            if pending is not None:
+                match = CONTINUATION_LINE.match(line)
+                if match:
+                    current = add(functions, pending, *match.groups())
+                pending = None
+                continue
+
+            match = SECTION_LINE.match(line)
+            if match:
+                current = None
+                if match.group(2) is None:
+                    pending = match.group(1)
+                else:
+                    current = add(functions, *match.groups())
+                continue
+
+            match = SYMBOL_LINE.match(line)
+            if match and current is not None:
+                current.names.append(match.group(2))
+                continue
+
+            if not line.startswith("  "):
+                current = None
+
+    return functions
+
+
+def add(functions, section, address, size, obj):
+    """Record one input section; discarded (zero size) ones are skipped."""
+    if int(size, 16) == 0:
+        return None
+    function = Function(section, int(address, 16), int(size, 16), obj)
+    functions.append(function)
+    return function
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report per-function code placement from a linker map")
+    parser.add_argument("map", help="linker map file")
+    parser.add_argument("--all", action="store_true", help="list the flash functions too")
+    parser.add_argument("--expect", default="", help="comma separated functions that must be in SRAM")
+    args = parser.parse_args()
+
+    functions = parse(args.map)
+    if not functions:
+        print("no code sections found in %s" % args.map, file=sys.stderr)
+        return 1
+
+    print("%-10s %-6s %6s  %-40s %s" % ("address", "region", "size", "function", "object"))
+    for function in sorted(functions, key=lambda f: f.address):
+        if function.in_sram or args.all:
+            print("0x%08x %-6s %6d  %-40s %s" % (function.address, "SRAM" if function.in_sram else "flash",
+                                                  function.size, function.name, function.obj))
+
+    sram = [f for f in functions if f.in_sram]
+    flash = [f for f in functions if not f.in_sram]
+    print("SRAM: %d functions, %d bytes; flash: %d functions, %d bytes" % (
+        len(sram), sum(f.size for f in sram), len(flash), sum(f.size for f in flash)))
+
+    missing = []
+    placed = {name for f in sram for name in f.names}
+    for name in filter(None, args.expect.split(",")):
+        if name not in placed:
+            missing.append(name)
+    if missing:
+        print("not in SRAM: %s" % ", ".join(missing), file=sys.stderr)
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""
+Decode the CPU profile reports the firmware writes to the Microvisor log
+channel when built with -DENABLE_PROFILING=ON (see Demo/Src/profile.c).
+
+Reads log output on stdin or from files, picks out the '#prof <base64>'
+lines and prints one table per report:
+
+    <device log stream> | tools/profile_decode.py
+    tools/profile_decode.py saved.log --csv > profile.csv
+
+Copyright (c) 2021, Twilio
+License: Apache 2.0
+"""
+
+import argparse
+import base64
+import binascii
+import fileinput
+import re
+import struct
+import sys
+
+FORMAT_VERSION = 1
+LINE_PATTERN = re.compile(r"#prof ([A-Za-z0-9+/=]+)")
+
+HEADER = struct.Struct("<2sBBBBHIIII")
+THREAD = struct.Struct("<8sBHI")
+ISR = struct.Struct("<BII")
+
+FLAG_THREADS_TRUNCATED = 0x01
+FLAG_ISRS_TRUNCATED = 0x02
+
+# Cortex-M system exceptions; anything from 16 up is IRQ (number - 16)
+SYSTEM_EXCEPTIONS = {
+    2: "NMI", 3: "HardFault", 4: "MemManage", 5: "BusFault", 6: "UsageFault",
+    7: "SecureFault", 11: "SVCall", 12: "DebugMon", 14: "PendSV", 15: "SysTick",
+}
+
+
+def exception_name(number):
+    if number >= 16:
+        return "IRQ%d" % (number - 16)
+    return SYSTEM_EXCEPTIONS.get(number, "EXC%d" % number)
+
+
+def decode(payload):
+    """Unpack one binary report into a dict, or raise ValueError."""
+    if len(payload) < HEADER.size:
+        raise ValueError("short report (%d bytes)" % len(payload))
+
+    (magic, version, thread_count, isr_count, flags, sequence,
+     core_hz, window, idle, switches) = HEADER.unpack_from(payload, 0)
+    if magic != b"TP":
+        raise ValueError("bad magic %r" % magic)
+    if version != FORMAT_VERSION:
+        raise ValueError("unsupported report version %d" % version)
+
+    expected = HEADER.size + thread_count * THREAD.size + isr_count * ISR.size
+    if len(payload) != expected:
+        raise ValueError("report is %d bytes, expected %d" % (len(payload), expected))
+
+    offset = HEADER.size
+    threads = []
+    for _ in range(thread_count):
+        name, priority, runs, cycles = THREAD.unpack_from(payload, offset)
+        offset += THREAD.size
+        threads.append({
+            "name": name.rstrip(b"\0").decode("ascii", "replace"),
+            "priority": priority, "runs": runs, "cycles": cycles,
+        })
+
+    isrs = []
+    for _ in range(isr_count):
+        exception, count, cycles = ISR.unpack_from(payload, offset)
+        offset += ISR.size
+        isrs.append({"exception": exception, "count": count, "cycles": cycles})
+
+    return {
+        "sequence": sequence, "flags": flags, "core_hz": core_hz, "window": window,
+        "idle": idle, "switches": switches, "threads": threads, "isrs": isrs,
+    }
+
+
+def percent(cycles, window):
+    return 100.0 * cycles / window if window else 0.0
+
+
+def print_table(report):
+    window = report["window"]
+    ms = 1000.0 * window / report["core_hz"] if report["core_hz"] else 0.0
+    print("report %d: %.1f ms window, %d context switches, idle %.1f%%" % (
+        report["sequence"], ms, report["switches"], percent(report["idle"], window)))
+
+    print("  %-10s %4s %8s %12s %7s" % ("thread", "prio", "runs", "cycles", "cpu"))
+    for thread in sorted(report["threads"], key=lambda t: -t["cycles"]):
+        print("  %-10s %4d %8d %12d %6.2f%%" % (
+            thread["name"], thread["priority"], thread["runs"], thread["cycles"],
+            percent(thread["cycles"], window)))
+    if report["flags"] & FLAG_THREADS_TRUNCATED:
+        print("  (more threads not reported)")
+
+    if report["isrs"]:
+        print("  %-10s %4s %8s %12s %7s" % ("isr", "", "count", "cycles", "cpu"))
+        for isr in sorted(report["isrs"], key=lambda i: -i["cycles"]):
+            print("  %-10s %4s %8d %12d %6.2f%%" % (
+                exception_name(isr["exception"]), "", isr["count"], isr["cycles"],
+                percent(isr["cycles"], window)))
+    if report["flags"] & FLAG_ISRS_TRUNCATED:
+        print("  (more ISRs not reported)")
+    print()
+
+
+def print_csv_header():
+    print("sequence,kind,name,priority,count,cycles,cpu_percent")
+
+
+def print_csv(report):
+    window = report["window"]
+    seq = report["sequence"]
+    print("%d,idle,idle,,,%d,%.3f" % (seq, report["idle"], percent(report["idle"], window)))
+    for thread in report["threads"]:
+        print("%d,thread,%s,%d,%d,%d,%.3f" % (
+            seq, thread["name"], thread["priority"], thread["runs"], thread["cycles"],
+            percent(thread["cycles"], window)))
+    for isr in report["isrs"]:
+        print("%d,isr,%s,,%d,%d,%.3f" % (
+            seq, exception_name(isr["exception"]), isr["count"], isr["cycles"],
+            percent(isr["cycles"], window)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode firmware CPU profile reports")
+    parser.add_argument("files", nargs="*", help="log files to read (default: stdin)")
+    parser.add_argument("--csv", action="store_true", help="emit CSV instead of tables")
+    args = parser.parse_args()
+
+    if args.csv:
+        print_csv_header()
+
+    for line in fileinput.input(args.files):
+        match = LINE_PATTERN.search(line)
+        if not match:
+            continue
+
+        try:
+            report = decode(base64.b64decode(match.group(1), validate=True))
+        except (ValueError, binascii.Error) as error:
+            print("skipping report: %s" % error, file=sys.stderr)
+            continue
+
+        if args.csv:
+            print_csv(report)
+        else:
+            print_table(report)
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
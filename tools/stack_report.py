@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""
+Turn the firmware's stack high-water reports into recommended stack sizes.
+
+Built with -DENABLE_STACK_MONITOR=ON, the firmware logs one line per thread
+every few seconds (see Demo/Src/stack_monitor.c):
+
+    #stack "<name>" <size> <used>
+
+This tool keeps the peak usage seen for each thread across all the log
+input. A high-water mark only covers the paths a test run actually took,
+so with --su-dir and --entry it also works out each thread's worst-case
+call depth from its entry function, from the call graph (.ci) and frame
+sizes (.su) files the build produces with -fcallgraph-info=su. The larger
+of the two, plus room for an exception frame and a safety margin, is the
+recommended size, compared with the configured one.
+
+The static depth can only be a lower bound where a path holds a call
+through a pointer, recursion, a function without stack information (eg.
+in a prebuilt library) or a dynamic frame; those are flagged. The largest
+frames and the functions with dynamic stack use are listed too.
+
+    tools/stack_report.py device.log --su-dir build
+    tools/stack_report.py device.log --su-dir build --entry "Startup Thread=StartupTask_Entry" \
+        --map "Startup Thread=STARTUP_STACK_SIZE"
+
+Copyright (c) 2021, Twilio
+License: Apache 2.0
+"""
+
+import argparse
+import fileinput
+import os
+import re
+import sys
+
+STACK_LINE = re.compile(r'#stack "([^"]*)" (\d+) (\d+)')
+OVERFLOW_LINE = re.compile(r'#stack-overflow "([^"]*)"')
+
+# -fcallgraph-info output (VCG): one node per function, with its frame when
+# it is defined in that unit, and one edge per call site
+CI_NODE = re.compile(r'node: \{ title: "([^"]*)" label: "[^"]*?(?:\\n(\d+) bytes \(([^)]*)\))?"')
+CI_EDGE = re.compile(r'edge: \{ sourcename: "([^"]*)" targetname: "([^"]*)"')
+INDIRECT_CALL = "__indirect_call"
+
+# Cortex-M33 exception entry with an extended (FP) frame: 26 words. ISRs run
+# on the main stack, but this frame always lands on the thread stack.
+EXCEPTION_FRAME_BYTES = 26 * 4
+
+
+def read_logs(files):
+    """Return {name: (size, peak used)} and the set of overflowed threads."""
+    threads = {}
+    overflowed = set()
+
+    for line in fileinput.input(files):
+        match = STACK_LINE.search(line)
+        if match:
+            name, size, used = match.group(1), int(match.group(2)), int(match.group(3))
+            previous = threads.get(name, (size, 0))
+            threads[name] = (size, max(previous[1], used))
+            continue
+
+        match = OVERFLOW_LINE.search(line)
+        if match:
+            overflowed.add(match.group(1))
+
+    return threads, overflowed
+
+
+def read_stack_usage(directory):
+    """Return a list of (bytes, qualifiers, function) from every .su file."""
+    frames = []
+
+    for root, _, names in os.walk(directory):
+        for name in names:
+            if not name.endswith(".su"):
+                continue
+
+            with open(os.path.join(root, name)) as su_file:
+                for line in su_file:
+                    parts = line.rstrip("\n").split("\t")
+                    if len(parts) != 3:
+                        continue
+                    # location is file:line:column:function
+                    function = parts[0].rsplit(":", 1)[-1]
+                    frames.append((int(parts[1]), parts[2], "%s (%s)" % (function, name[:-3])))
+
+    return frames
+
+
+def read_call_graph(directory):
+    """Return {function: (bytes, qualifiers)} and {function: set of callees}
+    from every .ci file. Functions never defined in the build have no entry
+    in the first."""
+    frames = {}
+    calls = {}
+
+    for root, _, names in os.walk(directory):
+        for name in names:
+            if not name.endswith(".ci"):
+                continue
+
+            with open(os.path.join(root, name)) as ci_file:
+                for line in ci_file:
+                    match = CI_NODE.match(line)
+                    if match:
+                        if match.group(2) is not None:
+                            frames[match.group(1)] = (int(match.group(2)), match.group(3))
+                        continue
+
+                    match = CI_EDGE.match(line)
+                    if match:
+                        calls.setdefault(match.group(1), set()).add(match.group(2))
+
+    return frames, calls
+
+
+def call_depth(function, frames, calls, memo, active):
+    """Return (bytes, flags) for the deepest path from function: its own frame
+    plus its deepest callee's. flags name what makes the bound incomplete."""
+    if function in memo:
+        return memo[function]
+    if function == INDIRECT_CALL:
+        return 0, {"indirect"}
+    if function in active:
+        return 0, {"recursion"}
+    if function not in frames:
+        return 0, {"unknown"}
+
+    size, qualifiers = frames[function]
+    flags = {"dynamic"} if "dynamic" in qualifiers else set()
+    deepest = 0
+
+    active.add(function)
+    for callee in sorted(calls.get(function, ())):
+        depth, callee_flags = call_depth(callee, frames, calls, memo, active)
+        deepest = max(deepest, depth)
+        flags |= callee_flags
+    active.discard(function)
+
+    # A result cut short by recursion depends on the path in: keep it out
+    if "recursion" not in flags:
+        memo[function] = (size + deepest, flags)
+    return size + deepest, flags
+
+
+def round_up(value, step):
+    return ((value + step - 1) // step) * step
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Recommend thread stack sizes from high-water reports")
+    parser.add_argument("logs", nargs="*", help="log files to read (default: stdin)")
+    parser.add_argument("--su-dir", default=None, help="build directory to search for .su files")
+    parser.add_argument("--margin", type=int, default=25, help="safety margin in percent (default: 25)")
+    parser.add_argument("--align", type=int, default=256, help="round sizes up to this many bytes (default: 256)")
+    parser.add_argument("--minimum", type=int, default=512, help="smallest size to recommend (default: 512)")
+    parser.add_argument("--top", type=int, default=10, help="largest .su frames to list (default: 10)")
+    parser.add_argument("--map", action="append", default=[], metavar="NAME=MACRO",
+                        help="thread name to app_threadx.h macro, for a #define listing")
+    parser.add_argument("--entry", action="append", default=[], metavar="NAME=FUNCTION",
+                        help="thread name to entry function, for its static call depth (needs --su-dir)")
+    args = parser.parse_args()
+
+    threads, overflowed = read_logs(args.logs)
+    if not threads:
+        print("no '#stack' lines found: is the firmware built with -DENABLE_STACK_MONITOR=ON?", file=sys.stderr)
+        return 1
+
+    macros = dict(entry.split("=", 1) for entry in args.map)
+    entries = dict(entry.split("=", 1) for entry in args.entry)
+    total_size = total_recommended = 0
+    defines = []
+
+    frames = calls = None
+    if args.su_dir and entries:
+        frames, calls = read_call_graph(args.su_dir)
+        if not frames:
+            print("no .ci files found: is the build using -fcallgraph-info=su?", file=sys.stderr)
+    memo = {}
+
+    print("%-24s %8s %8s %8s %6s %11s %9s" % ("thread", "size", "peak", "static", "used", "recommended", "change"))
+    for name in sorted(threads):
+        size, peak = threads[name]
+
+        # The worst path the call graph shows, where it reaches further
+        # than the run did
+        depth, flags = 0, set()
+        if frames and name in entries:
+            depth, flags = call_depth(entries[name], frames, calls, memo, set())
+
+        needed = (max(peak, depth) + EXCEPTION_FRAME_BYTES) * (100 + args.margin) // 100
+        recommended = max(args.minimum, round_up(needed, args.align))
+
+        # A thread that filled its stack tells us nothing about what it needs
+        notes = []
+        if name in overflowed:
+            notes.append("OVERFLOWED")
+        elif peak >= size:
+            notes.append("full, grow and re-measure")
+        if flags:
+            notes.append("static depth misses: " + ", ".join(sorted(flags)))
+
+        print("%-24s %8d %8d %8s %5d%% %11d %+9d%s" % (
+            name, size, peak, depth if depth else "-", 100 * peak // size if size else 0,
+            recommended, recommended - size, "".join("  " + note for note in notes)))
+
+        total_size += size
+        total_recommended += recommended
+        if name in macros:
+            defines.append("#define %-32s %d" % (macros[name], recommended))
+
+    print("%-24s %8d %8s %8s %6s %11d %+9d" % ("total", total_size, "", "", "", total_recommended,
+                                                total_recommended - total_size))
+
+    if defines:
+        print()
+        print("\n".join(defines))
+
+    if args.su_dir:
+        frames = read_stack_usage(args.su_dir)
+        dynamic = [frame for frame in frames if "dynamic" in frame[1]]
+
+        print()
+        print("largest stack frames (-fstack-usage):")
+        for size, qualifiers, function in sorted(frames, reverse=True)[:args.top]:
+            print("  %6d  %-8s  %s" % (size, qualifiers, function))
+
+        if dynamic:
+            print()
+            print("functions with dynamic stack use; high-water marks may not cover them:")
+            for size, qualifiers, function in sorted(dynamic, reverse=True):
+                print("  %6d  %-16s  %s" % (size, qualifiers, function))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""
+Rebuild ThreadX event traces from the firmware log (Demo/Src/trace.c, built
+with -DENABLE_TRACE=ON) into .trx files that Azure RTOS TraceX opens as a
+timeline.
+
+A dump arrives as:
+
+    #trace-begin <bytes> <chunk size>
+    #trace <index> <base64>          (one per chunk)
+    #trace-end <crc32>
+
+Each complete dump is written to <prefix>-<n>.trx. With --list, the events
+are also printed in time order.
+
+    tools/trace_dump.py device.log --prefix capture
+    tools/trace_dump.py device.log --list
+
+Copyright (c) 2021, Twilio
+License: Apache 2.0
+"""
+
+import argparse
+import base64
+import binascii
+import fileinput
+import re
+import struct
+import sys
+import zlib
+
+BEGIN_LINE = re.compile(r"#trace-begin (\d+) (\d+)")
+CHUNK_LINE = re.compile(r"#trace (\d+) ([A-Za-z0-9+/=]+)")
+END_LINE = re.compile(r"#trace-end ([0-9a-fA-F]{8})")
+
+# TraceX buffer layout (little endian): a control header, the object
+# registry, then 32-byte event entries.
+CONTROL_HEADER_ID = 0x54585442
+CONTROL_HEADER = struct.Struct("<IIIIHHIIIIIII")
+ENTRY = struct.Struct("<IIIIIIII")
+
+EVENT_NAMES = {
+    1: "thread resume", 2: "thread suspend", 3: "isr enter", 4: "isr exit",
+    5: "time slice", 6: "running",
+}
+USER_EVENT_START = 4096
+
+
+class Dump:
+    def __init__(self, size, chunk):
+        self.size = size
+        self.chunk = chunk
+        self.chunks = {}
+
+
+def reassemble(files):
+    """Yield the payload of each complete, CRC-checked dump in the input."""
+    dump = None
+
+    for line in fileinput.input(files):
+        match = BEGIN_LINE.search(line)
+        if match:
+            if dump is not None:
+                print("dump incomplete, discarded", file=sys.stderr)
+            dump = Dump(int(match.group(1)), int(match.group(2)))
+            continue
+
+        if dump is None:
+            continue
+
+        match = CHUNK_LINE.search(line)
+        if match:
+            try:
+                dump.chunks[int(match.group(1))] = base64.b64decode(match.group(2), validate=True)
+            except binascii.Error:
+                print("bad chunk %s, dump discarded" % match.group(1), file=sys.stderr)
+                dump = None
+            continue
+
+        match = END_LINE.search(line)
+        if match:
+            count = (dump.size + dump.chunk - 1) // dump.chunk
+            missing = [index for index in range(count) if index not in dump.chunks]
+            if missing:
+                print("dump missing %d chunks, discarded" % len(missing), file=sys.stderr)
+            else:
+                payload = b"".join(dump.chunks[index] for index in range(count))[:dump.size]
+                if zlib.crc32(payload) != int(match.group(1), 16):
+                    print("dump CRC mismatch, discarded", file=sys.stderr)
+                else:
+                    yield payload
+            dump = None
+
+
+def list_events(payload):
+    """Print the events of one dump, oldest first."""
+    header = CONTROL_HEADER.unpack_from(payload, 0)
+    if header[0] != CONTROL_HEADER_ID:
+        print("not a TraceX buffer", file=sys.stderr)
+        return
+
+    base = header[2]
+    start, end, current = header[7] - base, header[8] - base, header[9] - base
+    count = (end - start) // ENTRY.size
+
+    # The buffer is circular: the oldest entry is at the current pointer
+    entries = []
+    for slot in range(count):
+        offset = start + ((current - start) // ENTRY.size + slot) % count * ENTRY.size
+        entry = ENTRY.unpack_from(payload, offset)
+        if entry[2] != 0:
+            entries.append(entry)
+
+    if not entries:
+        print("no events")
+        return
+
+    first = entries[0][3]
+    for thread, priority, event, stamp, info1, info2, info3, info4 in entries:
+        name = EVENT_NAMES.get(event)
+        if name is None:
+            name = "user %d" % (event - USER_EVENT_START) if event >= USER_EVENT_START else "api %d" % event
+        print("%12d  %-16s thread=%08x prio=%08x  %08x %08x %08x %08x" % (
+            (stamp - first) & 0xFFFFFFFF, name, thread, priority, info1, info2, info3, info4))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Rebuild TraceX files from firmware trace dumps")
+    parser.add_argument("logs", nargs="*", help="log files to read (default: stdin)")
+    parser.add_argument("--prefix", default="trace", help="output file prefix (default: trace)")
+    parser.add_argument("--list", action="store_true", help="print the events of each dump")
+    args = parser.parse_args()
+
+    count = 0
+    for payload in reassemble(args.logs):
+        count += 1
+        name = "%s-%d.trx" % (args.prefix, count)
+        with open(name, "wb") as trx:
+            trx.write(payload)
+        print("wrote %s (%d bytes)" % (name, len(payload)))
+
+        if args.list:
+            list_events(payload)
+
+    if count == 0:
+        print("no complete trace dumps found", file=sys.stderr)
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())